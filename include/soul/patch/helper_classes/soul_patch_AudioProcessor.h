@@ -33,6 +33,11 @@ namespace patch
     function using the askHostToReinitialise parameter - the object will
     use its own background thread to recompile the SOUL code, and will use
     this callback to tell the host when its configuration has changed.
+
+    If a recompiled patch has the same buses and parameters as the one that's
+    currently running, the host isn't asked to reinitialise. Instead, the new
+    player is swapped in by the audio thread at the start of a block, with an
+    optional crossfade (see hotSwapCrossfadeMilliseconds).
 */
 struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
                                     private juce::Thread,
@@ -72,6 +77,11 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
     {
         stopThread (100000);
         stopTimer();
+        incomingPlayer = nullptr;
+        renderPlayer = nullptr;
+        outgoingPlayer = nullptr;
+        retiredPlayer = {};
+        retiredParameters.clear();
         player = {};
         patch = {};
     }
@@ -97,6 +107,12 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
     */
     std::function<void()> askHostToReinitialise;
 
+    /** When a recompiled player is swapped in without reinitialising the host, this is
+        the length of the crossfade between the old and new players' output. Set it to 0
+        to switch between them instantly at a block boundary.
+    */
+    double hotSwapCrossfadeMilliseconds = 20.0;
+
     std::function<void(uint64_t frameIndex, const char*)> handleConsoleMessage;
     std::function<void(uint64_t frameIndex, const char* endpointName, const choc::value::ValueView& eventData)> handleOutgoingEvent;
 
@@ -119,6 +135,7 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
             updateLastState();
             applyLastStateToPlayer (*replacementPlayer);
             player = std::move (replacementPlayer);
+            renderPlayer = player.get();
             setLatencySamples (static_cast<int> (player->getLatencySamples()));
             refreshParameterList();
             refreshInputEventList();
@@ -267,6 +284,13 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
         midiKeyboardState.reset();
         playheadState.reset();
 
+        // The audio thread isn't running, so any pending player swap can be completed now
+        if (auto newPlayer = incomingPlayer.exchange (nullptr))
+            renderPlayer = newPlayer;
+
+        if (outgoingPlayer != nullptr || swapInProgress)
+            finishPlayerSwap();
+
         if (player != nullptr)
         {
             numPatchInputChannels  = countTotalBusChannels (player->getInputBuses());
@@ -285,6 +309,9 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
             if (numPatchOutputChannels == 1 && pluginBuses.getMainOutputChannels() == 2)  postprocessOutputData = monoToStereo;
             if (numPatchOutputChannels == 2 && pluginBuses.getMainOutputChannels() == 1)  postprocessOutputData = stereoToMono;
         }
+
+        // A replacement player has the same buses, so this is big enough for any crossfade until the next prepareToPlay
+        crossfadeBuffer.setSize (juce::jmax (numPatchOutputChannels, getTotalNumOutputChannels()), maxBlockSize);
     }
 
     void releaseResources() override
@@ -305,10 +332,12 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
         inputBuffer.setSize (juce::jmax (numPatchInputChannels, getTotalNumInputChannels()), numFrames, false, false, true);
         inputBuffer.clear();
 
-        if (player != nullptr && player->isPlayable() && ! isSuspended())
+        startPendingPlayerSwap();
+
+        if (renderPlayer != nullptr && renderPlayer->isPlayable() && ! isSuspended())
         {
             if (auto playhead = getPlayHead())
-                playheadState.updateAndApply (*playhead, *player);
+                playheadState.updateAndApply (*playhead, *renderPlayer);
 
             soul::patch::PatchPlayer::RenderContext rc;
 
@@ -353,10 +382,13 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
                 midi.clear();
             }
 
-            auto result = player->render (rc);
+            auto result = renderPlayer->render (rc);
             juce::ignoreUnused (result);
             jassert (result == PatchPlayer::RenderResult::ok);
 
+            if (outgoingPlayer != nullptr)
+                crossfadeFromOutgoingPlayer (rc);
+
             if (rc.numMIDIMessagesOut != 0)
             {
                 // The numMIDIMessagesOut value could be greater than the buffer size we provided,
@@ -368,6 +400,10 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
                     midi.addEvent (messageSpaceOut[i].message.data, 3, (int) messageSpaceOut[i].frameIndex);
             }
         }
+        else if (outgoingPlayer != nullptr)
+        {
+            finishPlayerSwap();
+        }
 
         if (postprocessOutputData != nullptr)
             postprocessOutputData (outputBuffer);
@@ -523,6 +559,7 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
         PatchParameter (soul::patch::Parameter::Ptr p)
             : AudioProcessorParameterWithID (p->ID, p->name),
               param (std::move (p)),
+              currentParam (param.get()),
               unit (param->unit.toString<juce::String>()),
               textValues (parseTextValues (String::Ptr (param->getProperty ("text")))),
               range (param->minValue, param->maxValue, param->step),
@@ -533,7 +570,8 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
         {
         }
 
-        const soul::patch::Parameter::Ptr param;
+        soul::patch::Parameter::Ptr param;
+        std::atomic<soul::patch::Parameter*> currentParam;
         const juce::String unit;
         const juce::StringArray textValues;
         const juce::NormalisableRange<float> range;
@@ -553,15 +591,16 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
         juce::StringArray getAllValueStrings() const override            { return textValues; }
 
         float getDefaultValue() const override                           { return convertTo0to1 (initialValue); }
-        float getValue() const override                                  { return convertTo0to1 (param->getValue()); }
+        float getValue() const override                                  { return convertTo0to1 (currentParam.load()->getValue()); }
 
         void setValue (float newValue) override
         {
             auto fullRange = convertFrom0to1 (newValue);
+            auto target = currentParam.load();
 
-            if (fullRange != param->getValue())
+            if (fullRange != target->getValue())
             {
-                param->setValue (fullRange);
+                target->setValue (fullRange);
 
                 if (valueChangedCallback != nullptr)
                     valueChangedCallback (fullRange);
@@ -570,6 +609,16 @@ struct SOULPatchAudioProcessor    : public juce::AudioPluginInstance,
             }
         }
 
+        /** Redirects this parameter to an equivalent one belonging to a new player.
+            The caller must keep the old parameter object alive until no other threads
+            could still be using it.
+        */
+        void setPatchParameter (soul::patch::Parameter::Ptr newParam)
+        {
+            currentParam = newParam.get();
+            param = std::move (newParam);
+        }
+
         void setFullRangeValueNotifyingHost (float newFullRangeValue)
         {
             setValueNotifyingHost (convertTo0to1 (newFullRangeValue));
@@ -741,6 +790,18 @@ private:
     soul::patch::ExternalDataProvider::Ptr externalData;
     soul::patch::PatchPlayer::Ptr replacementPlayer;
 
+    // The audio thread renders renderPlayer, and when a new one is posted to incomingPlayer,
+    // it crossfades from the outgoing one. The message thread keeps the old player (and the
+    // parameters that referred to it) alive in retiredPlayer until the swap has finished.
+    soul::patch::PatchPlayer* renderPlayer = nullptr;
+    soul::patch::PatchPlayer* outgoingPlayer = nullptr;
+    std::atomic<soul::patch::PatchPlayer*> incomingPlayer { nullptr };
+    std::atomic<bool> playerSwapFinished { false }, swapInProgress { false };
+    soul::patch::PatchPlayer::Ptr retiredPlayer;
+    std::vector<soul::patch::Parameter::Ptr> retiredParameters;
+    juce::AudioBuffer<float> crossfadeBuffer;
+    int crossfadeLength = 0, crossfadeProgress = 0;
+
     juce::String name, description;
     bool isInstrument = false;
 
@@ -779,6 +840,163 @@ private:
     {
         if (player != nullptr)
             player->handleOutgoingEvents (this, handleEvent, handleConsole);
+
+        if (playerSwapFinished.exchange (false))
+        {
+            retiredPlayer = {};
+            retiredParameters.clear();
+            swapInProgress = false;
+
+            if (replacementPlayer != nullptr)
+                triggerAsyncUpdate();
+        }
+    }
+
+    //==============================================================================
+    static bool haveSameBuses (Span<soul::patch::Bus> buses1, Span<soul::patch::Bus> buses2)
+    {
+        if (buses1.size() != buses2.size())
+            return false;
+
+        for (uint32_t i = 0; i < buses1.size(); ++i)
+            if (buses1[i].numChannels != buses2[i].numChannels)
+                return false;
+
+        return true;
+    }
+
+    static bool areEquivalent (const soul::patch::Parameter& p1, const soul::patch::Parameter& p2)
+    {
+        if (p1.ID.toString<std::string>() != p2.ID.toString<std::string>()
+             || p1.name.toString<std::string>() != p2.name.toString<std::string>()
+             || p1.unit.toString<std::string>() != p2.unit.toString<std::string>()
+             || p1.minValue != p2.minValue || p1.maxValue != p2.maxValue
+             || p1.step != p2.step || p1.initialValue != p2.initialValue)
+            return false;
+
+        auto names1 = p1.getPropertyNames();
+        auto names2 = p2.getPropertyNames();
+
+        if (names1.size() != names2.size())
+            return false;
+
+        for (auto propertyName : names1)
+            if (String::Ptr (p1.getProperty (propertyName)).toString<std::string>()
+                  != String::Ptr (p2.getProperty (propertyName)).toString<std::string>())
+                return false;
+
+        return true;
+    }
+
+    /** A new player can replace the current one without the host being reinitialised
+        if nothing that the host can see (buses, parameters, etc) has changed.
+    */
+    bool canSwapInPlace (soul::patch::PatchPlayer& newPlayer) const
+    {
+        if (player == nullptr || ! player->isPlayable() || ! newPlayer.isPlayable())
+            return false;
+
+        auto desc = soul::patch::Description::Ptr (patch->getDescription());
+
+        if (name != desc->name || isInstrument != desc->isInstrument)
+            return false;
+
+        if (! (haveSameBuses (player->getInputBuses(),  newPlayer.getInputBuses())
+                && haveSameBuses (player->getOutputBuses(), newPlayer.getOutputBuses())))
+            return false;
+
+        auto oldParams = player->getParameters();
+        auto newParams = newPlayer.getParameters();
+
+        if (oldParams.size() != newParams.size())
+            return false;
+
+        for (uint32_t i = 0; i < oldParams.size(); ++i)
+            if (! areEquivalent (*oldParams[i], *newParams[i]))
+                return false;
+
+        return true;
+    }
+
+    void swapInReplacementPlayer()
+    {
+        updateLastState();
+        applyLastStateToPlayer (*replacementPlayer);
+
+        auto newParams = replacementPlayer->getParameters();
+
+        for (auto* p : getPatchParameters())
+        {
+            for (auto& newParam : newParams)
+            {
+                if (newParam->ID.toString<juce::String>() == p->paramID)
+                {
+                    retiredParameters.push_back (p->param);
+                    p->setPatchParameter (newParam);
+                    break;
+                }
+            }
+        }
+
+        retiredPlayer = std::move (player);
+        player = std::move (replacementPlayer);
+        setLatencySamples (static_cast<int> (player->getLatencySamples()));
+        refreshInputEventList();
+
+        swapInProgress = true;
+        incomingPlayer = player.get();
+    }
+
+    // Called by the audio thread at the start of a block
+    void startPendingPlayerSwap()
+    {
+        if (auto newPlayer = incomingPlayer.exchange (nullptr))
+        {
+            outgoingPlayer = renderPlayer;
+            renderPlayer = newPlayer;
+            playheadState.reset();
+            crossfadeLength = juce::roundToInt (getSampleRate() * hotSwapCrossfadeMilliseconds * 0.001);
+            crossfadeProgress = 0;
+
+            if (outgoingPlayer == nullptr || ! outgoingPlayer->isPlayable() || crossfadeLength <= 0)
+                finishPlayerSwap();
+        }
+    }
+
+    void crossfadeFromOutgoingPlayer (soul::patch::PatchPlayer::RenderContext rc)
+    {
+        auto numFrames = static_cast<int> (rc.numFrames);
+
+        // This was sized in prepareToPlay, so it'll only reallocate if the host exceeds the block size it gave there
+        crossfadeBuffer.setSize (outputBuffer.getNumChannels(), numFrames, false, false, true);
+        crossfadeBuffer.clear();
+
+        rc.outputChannels = crossfadeBuffer.getArrayOfWritePointers();
+        rc.outgoingMIDI = nullptr;
+        rc.maximumMIDIMessagesOut = 0;
+        rc.numMIDIMessagesOut = 0;
+        outgoingPlayer->render (rc);
+
+        auto framesToFade = std::min (numFrames, crossfadeLength - crossfadeProgress);
+        auto startGain = crossfadeProgress / static_cast<float> (crossfadeLength);
+        auto endGain = (crossfadeProgress + framesToFade) / static_cast<float> (crossfadeLength);
+
+        for (int i = 0; i < numPatchOutputChannels; ++i)
+        {
+            outputBuffer.applyGainRamp (i, 0, framesToFade, startGain, endGain);
+            outputBuffer.addFromWithRamp (i, 0, crossfadeBuffer.getReadPointer (i), framesToFade, 1.0f - startGain, 1.0f - endGain);
+        }
+
+        crossfadeProgress += framesToFade;
+
+        if (crossfadeProgress >= crossfadeLength)
+            finishPlayerSwap();
+    }
+
+    void finishPlayerSwap()
+    {
+        outgoingPlayer = nullptr;
+        playerSwapFinished = true;
     }
 
     //==============================================================================
@@ -791,6 +1009,7 @@ private:
         double currentQuarterNoteBarStart = 0;
         soul::TransportState currentTransportState = soul::TransportState::stopped;
 
+        // This is called on the audio thread when a new player is swapped in, so it must stay a plain copy
         void reset()   { *this = {}; }
 
         void updateAndApply (juce::AudioPlayHead& playhead, soul::patch::PatchPlayer& playerToUse)
@@ -844,6 +1063,7 @@ private:
         }
     };
 
+    static_assert (std::is_trivially_copyable<PlayheadState>::value, "PlayheadState::reset() mustn't allocate or lock");
     PlayheadState playheadState;
 
     //==============================================================================
@@ -907,7 +1127,12 @@ private:
 
     void handleAsyncUpdate() override
     {
-        if (askHostToReinitialise != nullptr)
+        if (swapInProgress || replacementPlayer == nullptr)
+            return;
+
+        if (canSwapInPlace (*replacementPlayer))
+            swapInReplacementPlayer();
+        else if (askHostToReinitialise != nullptr)
             askHostToReinitialise();
     }
 
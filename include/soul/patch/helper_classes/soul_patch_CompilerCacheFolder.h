@@ -87,11 +87,10 @@ struct CompilerCacheFolder final  : public CompilerCache
         };
 
         std::vector<FileAndDate> files;
-        juce::Time modificationTime;
         bool anyFailed = false;
 
         for (auto i : juce::RangedDirectoryIterator (folder, false, getFilePrefix() + "*", juce::File::findFiles))
-            files.push_back ({ i.getFile(), modificationTime });
+            files.push_back ({ i.getFile(), i.getModificationTime() });
 
         if (files.size() > maxNumFilesToRetain)
         {
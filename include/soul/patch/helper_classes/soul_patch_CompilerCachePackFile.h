@@ -0,0 +1,470 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#pragma once
+
+#ifndef JUCE_CORE_H_INCLUDED
+ #error "this header is designed to be included in JUCE projects that contain the juce_core module"
+#endif
+
+#include "../../soul_patch.h"
+
+#if __clang__
+ #pragma clang diagnostic push
+ #pragma clang diagnostic ignored "-Wnon-virtual-dtor"
+#endif
+
+namespace soul
+{
+namespace patch
+{
+
+//==============================================================================
+/**
+    Implements a CompilerCache that keeps all its items in a single pack file, with a
+    small index file that records where each one lives.
+
+    New items are appended to the pack, and reads copy directly out of a memory-mapped
+    view of it. The index is held in memory as an immutable snapshot which is swapped
+    atomically when an item is stored, so reads never need to take a lock or touch the
+    filesystem. Only one writer at a time is allowed, so stores are serialised.
+
+    Several processes can share a folder: opening the cache, storing an item and saving
+    the index are all done while holding an InterProcessLock for the folder, and each store
+    starts again from the index on disk, so it picks up whatever the other processes have
+    written or compacted. Each item also has a checksum of its key and data, which is checked
+    before it's read, so a stale or damaged entry is treated as missing.
+
+    When either the number of items or their total size goes over the limits, the least
+    recently used items are dropped from the index. The space they took up in the pack is
+    reclaimed by rewriting it once it's mostly made up of dead items.
+
+    The cache doesn't look inside the items, so whoever stores them has to recognise data
+    written in an older format. For example, Program::createFromBinary() rejects data from
+    an older heart::BinaryFormat version, so the program just gets recompiled, and the new
+    version overwrites the old item.
+*/
+struct CompilerCachePackFile final  : public CompilerCache
+{
+    /** Creates a cache in the given folder (which must exist!) */
+    CompilerCachePackFile (juce::File cacheFolder, uint32_t maxNumItemsToCache, uint64_t maxTotalSizeToCache)
+       : folder (std::move (cacheFolder)), maxNumItems (maxNumItemsToCache), maxTotalSize (maxTotalSizeToCache),
+         processLock (juce::String (getFilePrefix()) + juce::String::toHexString (folder.getFullPathName().hashCode64()))
+    {
+        juce::ScopedLock sl (writeLock);
+        juce::InterProcessLock::ScopedLockType pl (processLock);
+        auto initialState = std::make_shared<State>();
+
+        if (pl.isLocked())
+        {
+            initialState = loadIndex();
+
+            if (initialState == nullptr)
+            {
+                deleteAllCacheFiles();
+                initialState = std::make_shared<State>();
+                writeIndex (*initialState);
+            }
+
+            // Another process may still have an older pack mapped, but it'll re-read the
+            // index before storing anything, and will never go back to the old file
+            deleteUnusedPackFiles (initialState->packNumber);
+            mapPackFile (*initialState);
+            removeItemsOverLimits (*initialState);
+        }
+
+        std::atomic_store (&state, std::shared_ptr<const State> (std::move (initialState)));
+    }
+
+    ~CompilerCachePackFile()
+    {
+        // The access times change on every read, so are only saved when something else is
+        // written. Another process may have written a newer index, so they're added to that one.
+        juce::ScopedLock sl (writeLock);
+        juce::InterProcessLock::ScopedLockType pl (processLock);
+
+        if (pl.isLocked())
+        {
+            if (auto latestState = loadIndex())
+            {
+                copyAccessTimes (*latestState);
+                writeIndex (*latestState);
+            }
+        }
+    }
+
+    void storeItemInCache (const char* key, const void* sourceData, uint64_t size) override
+    {
+        juce::ScopedLock sl (writeLock);
+        juce::InterProcessLock::ScopedLockType pl (processLock);
+
+        if (! pl.isLocked())
+            return;
+
+        auto newState = loadLatestState();
+        auto packFile = getPackFile (newState->packNumber);
+        uint64_t offset = 0;
+
+        {
+            juce::FileOutputStream out (packFile);
+
+            if (! out.openedOk())
+                return;
+
+            offset = (uint64_t) out.getPosition();
+
+            if (! out.write (sourceData, (size_t) size))
+                return;
+
+            out.flush();
+
+            if (out.getStatus().failed())
+                return;
+        }
+
+        auto& item = newState->items[key];
+
+        if (item != nullptr)
+            newState->totalItemSize -= item->size;
+
+        item = std::make_shared<Item> (offset, size, getChecksum (key, sourceData, size), ++accessCounter);
+        newState->totalItemSize += size;
+        newState->packSize = offset + size;
+
+        removeItemsOverLimits (*newState);
+
+        if (newState->packSize > minPackSizeToCompact && newState->packSize > 2 * newState->totalItemSize)
+            compactPackFile (*newState);
+
+        mapPackFile (*newState);
+        writeIndex (*newState);
+        std::atomic_store (&state, std::shared_ptr<const State> (std::move (newState)));
+    }
+
+    uint64_t readItemFromCache (const char* key, void* destAddress, uint64_t destSize) override
+    {
+        auto currentState = std::atomic_load (&state);
+        auto found = currentState->items.find (key);
+
+        if (found == currentState->items.end())
+            return 0;
+
+        auto& item = *found->second;
+
+        if (destAddress == nullptr || destSize < item.size)
+            return item.size;
+
+        if (! currentState->containsData (found->first, item))
+            return 0;
+
+        std::memcpy (destAddress, static_cast<const char*> (currentState->packData->getData()) + item.offset, (size_t) item.size);
+        item.lastAccessTime = ++accessCounter;
+        return item.size;
+    }
+
+    /** Returns the number of items currently in the cache. */
+    size_t getNumItems() const          { return std::atomic_load (&state)->items.size(); }
+
+    /** Returns the total size of all the items currently in the cache. */
+    uint64_t getTotalItemSize() const   { return std::atomic_load (&state)->totalItemSize; }
+
+    static std::string getFilePrefix()  { return "soul_patch_pack_"; }
+    juce::File getIndexFile() const     { return folder.getChildFile (getFilePrefix() + "index"); }
+
+    juce::File getPackFile (uint32_t packNumber) const
+    {
+        return folder.getChildFile (getFilePrefix() + std::to_string (packNumber) + ".pack");
+    }
+
+    int addRef() noexcept override   { return ++refCount; }
+    int release() noexcept override  { auto newCount = --refCount; if (newCount == 0) delete this; return newCount; }
+
+private:
+    //==============================================================================
+    struct Item
+    {
+        Item (uint64_t o, uint64_t s, uint64_t c, uint64_t t) : offset (o), size (s), checksum (c), lastAccessTime (t) {}
+
+        bool isSameAs (const Item& other) const     { return offset == other.offset && size == other.size && checksum == other.checksum; }
+
+        const uint64_t offset, size, checksum;
+        std::atomic<uint64_t> lastAccessTime;
+    };
+
+    // Items are shared between successive states, so that a read made through an older
+    // state still updates the access time that the next store will see.
+    struct State
+    {
+        std::unordered_map<std::string, std::shared_ptr<Item>> items;
+        std::shared_ptr<juce::MemoryMappedFile> packData;
+        uint32_t packNumber = 0;
+        uint64_t packSize = 0, totalItemSize = 0;
+
+        bool containsData (const std::string& key, const Item& item) const
+        {
+            return packData != nullptr && packData->getData() != nullptr
+                    && item.offset + item.size <= (uint64_t) packData->getSize()
+                    && getChecksum (key, static_cast<const char*> (packData->getData()) + item.offset, item.size) == item.checksum;
+        }
+    };
+
+    static constexpr int indexFileMagic = 0x58444e49; // "INDX"
+    static constexpr int indexFileVersion = 2;
+    static constexpr uint64_t minPackSizeToCompact = 1024 * 1024;
+
+    std::atomic<int> refCount { 1 };
+    juce::File folder;
+    uint32_t maxNumItems;
+    uint64_t maxTotalSize;
+    std::shared_ptr<const State> state;
+    mutable std::atomic<uint64_t> accessCounter { 0 };
+    juce::CriticalSection writeLock;
+    juce::InterProcessLock processLock;
+
+    //==============================================================================
+    // A 64-bit FNV-1a hash of an item's key, followed by its data
+    static uint64_t getChecksum (const std::string& key, const void* data, uint64_t size) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        auto addBytes = [&] (const void* bytes, size_t numBytes)
+        {
+            for (size_t i = 0; i < numBytes; ++i)
+                hash = (hash ^ static_cast<const uint8_t*> (bytes)[i]) * 1099511628211ull;
+        };
+
+        addBytes (key.c_str(), key.length() + 1);
+        addBytes (data, (size_t) size);
+        return hash;
+    }
+
+    //==============================================================================
+    void mapPackFile (State& s) const
+    {
+        s.packData.reset();
+
+        if (s.packSize != 0)
+        {
+            auto mapped = std::make_shared<juce::MemoryMappedFile> (getPackFile (s.packNumber), juce::MemoryMappedFile::readOnly);
+
+            if (mapped->getData() != nullptr)
+                s.packData = std::move (mapped);
+        }
+    }
+
+    void removeItemsOverLimits (State& s) const
+    {
+        if (s.items.size() <= maxNumItems && s.totalItemSize <= maxTotalSize)
+            return;
+
+        std::vector<std::pair<uint64_t, std::string>> itemsByAge;
+        itemsByAge.reserve (s.items.size());
+
+        for (auto& i : s.items)
+            itemsByAge.push_back ({ i.second->lastAccessTime.load(), i.first });
+
+        std::sort (itemsByAge.begin(), itemsByAge.end());
+
+        for (auto& i : itemsByAge)
+        {
+            if (s.items.size() <= maxNumItems && s.totalItemSize <= maxTotalSize)
+                break;
+
+            auto found = s.items.find (i.second);
+            s.totalItemSize -= found->second->size;
+            s.items.erase (found);
+        }
+    }
+
+    // Copies the live items into a new pack file, leaving the dead ones behind
+    void compactPackFile (State& s) const
+    {
+        mapPackFile (s);
+
+        auto newPackNumber = s.packNumber + 1;
+        auto newPackFile = getPackFile (newPackNumber);
+        std::unordered_map<std::string, std::shared_ptr<Item>> newItems;
+        uint64_t newPackSize = 0;
+
+        {
+            newPackFile.deleteFile();
+            juce::FileOutputStream out (newPackFile);
+
+            if (! out.openedOk())
+                return;
+
+            for (auto& i : s.items)
+            {
+                auto& item = *i.second;
+
+                if (! s.containsData (i.first, item))
+                    continue;
+
+                if (! out.write (static_cast<const char*> (s.packData->getData()) + item.offset, (size_t) item.size))
+                    return;
+
+                newItems[i.first] = std::make_shared<Item> (newPackSize, item.size, item.checksum, item.lastAccessTime.load());
+                newPackSize += item.size;
+            }
+
+            out.flush();
+
+            if (out.getStatus().failed())
+                return;
+        }
+
+        // The old pack may still be mapped by readers holding an older state, either in this
+        // process or another one, in which case deleting it can fail on some platforms, but
+        // it'll get cleaned up the next time a cache is opened
+        auto oldPackFile = getPackFile (s.packNumber);
+        s.items = std::move (newItems);
+        s.packNumber = newPackNumber;
+        s.packSize = newPackSize;
+        s.totalItemSize = newPackSize;
+        s.packData.reset();
+        oldPackFile.deleteFile();
+    }
+
+    //==============================================================================
+    // Another process may have stored or compacted items since our snapshot was taken, so
+    // stores begin with the index that's on disk. If that's gone missing, a new pack is started.
+    std::shared_ptr<State> loadLatestState()
+    {
+        auto latestState = loadIndex();
+
+        if (latestState == nullptr)
+        {
+            deleteAllCacheFiles();
+            latestState = std::make_shared<State>();
+            latestState->packNumber = std::atomic_load (&state)->packNumber + 1;
+            return latestState;
+        }
+
+        copyAccessTimes (*latestState);
+        return latestState;
+    }
+
+    // Shares the items which haven't changed since our snapshot, so that the reads made through
+    // it keep updating their access times
+    void copyAccessTimes (State& latestState) const
+    {
+        auto currentState = std::atomic_load (&state);
+
+        if (currentState->packNumber != latestState.packNumber)
+            return;
+
+        for (auto& i : latestState.items)
+        {
+            auto found = currentState->items.find (i.first);
+
+            if (found != currentState->items.end() && found->second->isSameAs (*i.second))
+            {
+                auto& item = *found->second;
+                item.lastAccessTime = std::max (item.lastAccessTime.load(), i.second->lastAccessTime.load());
+                i.second = found->second;
+            }
+        }
+    }
+
+    std::shared_ptr<State> loadIndex()
+    {
+        juce::MemoryBlock data;
+
+        if (! getIndexFile().loadFileAsData (data))
+            return {};
+
+        juce::MemoryInputStream in (data, false);
+
+        if (in.readInt() != indexFileMagic || in.readInt() != indexFileVersion)
+            return {};
+
+        auto s = std::make_shared<State>();
+        s->packNumber = (uint32_t) in.readInt();
+        s->packSize = (uint64_t) getPackFile (s->packNumber).getSize();
+        auto lastAccessTime = (uint64_t) in.readInt64();
+        auto numItems = in.readInt();
+
+        if (numItems < 0)
+            return {};
+
+        for (int i = 0; i < numItems; ++i)
+        {
+            auto key = in.readString().toStdString();
+
+            if (key.empty() || in.getNumBytesRemaining() < 4 * (int64_t) sizeof (int64_t))
+                return {};
+
+            auto offset   = (uint64_t) in.readInt64();
+            auto size     = (uint64_t) in.readInt64();
+            auto checksum = (uint64_t) in.readInt64();
+            auto time     = (uint64_t) in.readInt64();
+
+            if (offset + size > s->packSize || time > lastAccessTime)
+                return {};
+
+            s->items[key] = std::make_shared<Item> (offset, size, checksum, time);
+            s->totalItemSize += size;
+        }
+
+        if (accessCounter < lastAccessTime)
+            accessCounter = lastAccessTime;
+
+        return s;
+    }
+
+    void writeIndex (const State& s) const
+    {
+        juce::MemoryOutputStream out;
+        out.writeInt (indexFileMagic);
+        out.writeInt (indexFileVersion);
+        out.writeInt ((int) s.packNumber);
+        out.writeInt64 ((juce::int64) accessCounter.load());
+        out.writeInt ((int) s.items.size());
+
+        for (auto& i : s.items)
+        {
+            out.writeString (i.first);
+            out.writeInt64 ((juce::int64) i.second->offset);
+            out.writeInt64 ((juce::int64) i.second->size);
+            out.writeInt64 ((juce::int64) i.second->checksum);
+            out.writeInt64 ((juce::int64) i.second->lastAccessTime.load());
+        }
+
+        // Writing to a temporary file means a crash can't leave a half-written index behind
+        juce::TemporaryFile temp (getIndexFile());
+
+        if (temp.getFile().replaceWithData (out.getData(), out.getDataSize()))
+            temp.overwriteTargetFileWithTemporary();
+    }
+
+    void deleteAllCacheFiles() const
+    {
+        for (auto i : juce::RangedDirectoryIterator (folder, false, getFilePrefix() + "*", juce::File::findFiles))
+            i.getFile().deleteFile();
+    }
+
+    void deleteUnusedPackFiles (uint32_t packNumberInUse) const
+    {
+        auto fileInUse = getPackFile (packNumberInUse);
+
+        for (auto i : juce::RangedDirectoryIterator (folder, false, getFilePrefix() + "*.pack", juce::File::findFiles))
+            if (i.getFile() != fileInUse)
+                i.getFile().deleteFile();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompilerCachePackFile)
+};
+
+
+} // namespace patch
+} // namespace soul
+
+#if __clang__
+ #pragma clang diagnostic pop
+#endif
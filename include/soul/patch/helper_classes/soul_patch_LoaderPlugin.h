@@ -16,7 +16,7 @@
 #include "../../soul_patch.h"
 #include "soul_patch_AudioProcessor.h"
 #include "soul_patch_Utilities.h"
-#include "soul_patch_CompilerCacheFolder.h"
+#include "soul_patch_CompilerCachePackFile.h"
 
 namespace soul
 {
@@ -299,7 +299,6 @@ private:
     soul::patch::PatchInstance::Ptr patchInstance;
     std::unique_ptr<soul::patch::SOULPatchAudioProcessor> plugin;
     juce::ValueTree state;
-    soul::patch::CompilerCache::Ptr compilerCache;
 
     struct IDs
     {
@@ -310,12 +309,16 @@ private:
 
     IDs ids;
 
-    soul::patch::CompilerCache::Ptr getCompilerCache()
+    //==============================================================================
+    // All the plugin instances in a process share one cache, as they'd otherwise be
+    // fighting over the same files
+    struct SharedCompilerCache
     {
-        constexpr uint32_t maxNumCacheFiles = 200;
-
-        if (compilerCache == nullptr)
+        SharedCompilerCache()
         {
+            constexpr uint32_t maxNumCachedItems = 200;
+            constexpr uint64_t maxCacheSize = 256 * 1024 * 1024;
+
            #if JUCE_MAC
             auto tempFolder = juce::File ("~/Library/Caches");
            #else
@@ -325,10 +328,25 @@ private:
             auto cacheFolder = tempFolder.getChildFile ("dev.soul.SOULPlugin").getChildFile ("Cache");
 
             if (cacheFolder.createDirectory())
-                compilerCache = soul::patch::CompilerCache::Ptr (new soul::patch::CompilerCacheFolder (cacheFolder, maxNumCacheFiles));
+            {
+                // Clear out anything left behind by the older cache, which used one file per item
+                for (auto i : juce::RangedDirectoryIterator (cacheFolder, false, "soul_patch_cache_*", juce::File::findFiles))
+                    i.getFile().deleteFile();
+
+                cache = soul::patch::CompilerCache::Ptr (new soul::patch::CompilerCachePackFile (cacheFolder, maxNumCachedItems, maxCacheSize));
+            }
         }
 
-        return compilerCache;
+        soul::patch::CompilerCache::Ptr cache;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedCompilerCache)
+    };
+
+    juce::SharedResourcePointer<SharedCompilerCache> compilerCache;
+
+    soul::patch::CompilerCache::Ptr getCompilerCache()
+    {
+        return compilerCache->cache;
     }
 
     void preparePluginToPlayIfPossible (soul::patch::SOULPatchAudioProcessor& p)
@@ -0,0 +1,2987 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/**
+    Turns a linked program into the source of one self-contained C++ class.
+
+    The graph is flattened into a fixed list of processor instances, sorted so that
+    each one runs after everything it depends on. Every processor becomes a nested
+    struct holding its state as plain members, and its run() function becomes a
+    resumable member function which renders a single frame per call. Rendering a
+    frame then consists of copying each instance's inputs from the outputs of its
+    sources, calling it, and delivering any events it emitted by calling the event
+    handlers of its destinations directly.
+
+    If any processors have clock multipliers, each frame is split into ticks at the
+    fastest rate, and each instance is only rendered on the ticks that fall on one of
+    its own frames. Streams which cross between rates are read from a history of the
+    source's frames, using the same interpolators as the interpreter, except that linear
+    interpolation runs one source frame behind, because the frame after the position
+    being read hasn't been rendered yet.
+*/
+class CPlusPlusGenerator
+{
+public:
+    CPlusPlusGenerator (Program& p, const CPlusPlusGenerationOptions& o)
+        : program (p), options (o), mainModule (p.getMainProcessor())
+    {}
+
+    std::string generate()
+    {
+        resolveExternals();
+        latency = DelayCompensation::apply (mainModule);
+
+        buildGraph();
+        findUsedFunctions();
+        allocateNames();
+        printClass();
+
+        return out.toString();
+    }
+
+private:
+    //==============================================================================
+    struct Route  : public FlattenedGraph::Route
+    {
+        Route (const FlattenedGraph::Route& r) : FlattenedGraph::Route (r) {}
+
+        // For delayed streams and values whose ends run at the same rate
+        std::string delayLine;
+
+        // For streams and values whose ends run at different rates, the history of the
+        // source's frames, and the filter which reads it if it's resampled with a sinc
+        std::string history, sincFilter;
+
+        // For delayed events, the queue holding them and the type of its items
+        std::string eventDelayLine, delayedEventType;
+
+        // For events, the index of the destination type for each type of the source
+        std::vector<int32_t> typeMap;
+    };
+
+    struct Node  : public FlattenedGraph::Node
+    {
+        Node (const FlattenedGraph::Node& n) : FlattenedGraph::Node (n) {}
+
+        std::string memberName;
+    };
+
+    struct EventHandler
+    {
+        std::string functionName;
+        bool hasIndex = false;
+    };
+
+    struct ProcessorInfo
+    {
+        Module* module = nullptr;
+        std::string structName;
+        std::unordered_set<std::string> usedNames;
+        std::unordered_map<const heart::Variable*, std::string> variableNames;
+        std::vector<std::string> inputNames, outputNames;
+        std::vector<std::vector<std::optional<EventHandler>>> eventHandlers;    // one per data type of each input
+        std::vector<std::vector<std::string>> eventWriters;                     // one per data type of each output
+        std::vector<pool_ref<heart::Function>> functions;
+        std::vector<pool_ref<heart::Variable>> runLocals;
+    };
+
+    static constexpr choc::text::CodePrinter::NewLine newLine = {};
+    static constexpr choc::text::CodePrinter::BlankLine blankLine = {};
+    static constexpr choc::text::CodePrinter::SectionBreak sectionBreak = {};
+
+    Program& program;
+    const CPlusPlusGenerationOptions& options;
+    Module& mainModule;
+    choc::text::CodePrinter out;
+    int32_t latency = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> processingOrder;
+    std::vector<Route> routes;
+    uint32_t inputBoundary = 0, outputBoundary = 0;
+    int64_t ticksPerFrame = 1;
+
+    std::vector<std::unique_ptr<ProcessorInfo>> processors;
+    std::unordered_map<const heart::Function*, Module*> functionOwners;
+    std::vector<pool_ref<heart::Function>> namespaceFunctions;
+    std::vector<pool_ref<heart::Variable>> staticVariables;
+    std::vector<const Structure*> structs;
+
+    std::unordered_set<std::string> classScopeNames;
+    std::unordered_map<const heart::Function*, std::string> functionNames;
+    std::unordered_map<const heart::Variable*, std::string> staticVariableNames;
+    std::unordered_map<const Structure*, std::string> structNames;
+    std::unordered_map<const Structure*, std::vector<std::string>> structMemberNames;
+    std::vector<std::string> inputNames, outputNames;
+
+    std::vector<std::pair<std::string, std::string>> hoistedConstants;   // (declaration, name)
+    std::unordered_map<std::string, std::string> hoistedConstantNames;
+    std::vector<std::string> routeStateDeclarations;
+
+    // State used while printing a function
+    ProcessorInfo* currentProcessor = nullptr;
+    heart::Function* currentFunction = nullptr;
+    std::unordered_map<const heart::Variable*, std::string> localVariableNames;
+    std::unordered_set<const heart::Block*> labelledBlocks;
+    uint32_t numResumePoints = 0;
+
+    static constexpr uint32_t maxHoistedLiteralSize = 256;
+
+    //==============================================================================
+    void resolveExternals()
+    {
+        for (auto& v : program.getExternalVariables())
+        {
+            auto name = program.getExternalVariableName (v);
+            auto value = options.externalValues.find (name);
+
+            if (value == options.externalValues.end() || value->second.isVoid())
+                v->location.throwError (Errors::unresolvedExternal (name));
+
+            v->initialValue = program.getAllocator().allocate<heart::Constant> (v->location,
+                                                                                Value::fromExternalValue (v->type, value->second,
+                                                                                                          program.getConstantTable(),
+                                                                                                          program.getStringDictionary()));
+        }
+    }
+
+    //==============================================================================
+    const heart::IODeclaration& getNodeOutput (uint32_t node, uint32_t index) const
+    {
+        if (node == inputBoundary)
+            return mainModule.inputs[index];
+
+        return nodes[node].module->outputs[index];
+    }
+
+    const heart::IODeclaration& getNodeInput (uint32_t node, uint32_t index) const
+    {
+        if (node == outputBoundary)
+            return mainModule.outputs[index];
+
+        return nodes[node].module->inputs[index];
+    }
+
+    void buildGraph()
+    {
+        auto flattened = FlattenedGraph::build (program, mainModule);
+        inputBoundary = flattened.inputBoundary;
+        outputBoundary = flattened.outputBoundary;
+        processingOrder = flattened.processingOrder;
+
+        for (auto& n : flattened.nodes)
+        {
+            ticksPerFrame = std::max (ticksPerFrame, n.ratio.numerator);
+            nodes.push_back (n);
+        }
+
+        for (auto& r : flattened.routes)
+            addRoute (r);
+    }
+
+    void addRoute (const FlattenedGraph::Route& flattenedRoute)
+    {
+        Route r (flattenedRoute);
+        auto& source = getNodeOutput (r.sourceNode, r.sourceOutput);
+        auto& target = getNodeInput (r.destNode, r.destInput);
+
+        if (source.isEventEndpoint())
+        {
+            for (auto& sourceType : source.dataTypes)
+            {
+                auto destType = heart::Utilities::findMatchingEndpointType (program, sourceType, target.dataTypes, r.location);
+                r.typeMap.push_back (destType.has_value() ? (int32_t) *destType : -1);
+            }
+        }
+
+        routes.push_back (std::move (r));
+    }
+
+    //==============================================================================
+    ProcessorInfo& getProcessorInfo (const Module& m)
+    {
+        for (auto& p : processors)
+            if (p->module == std::addressof (m))
+                return *p;
+
+        auto p = std::make_unique<ProcessorInfo>();
+        p->module = const_cast<Module*> (std::addressof (m));
+        processors.push_back (std::move (p));
+        return *processors.back();
+    }
+
+    bool isHandledNatively (const heart::Function& f) const
+    {
+        if (f.intrinsicType == IntrinsicType::none)
+            return false;
+
+        if (f.intrinsicType == IntrinsicType::get_array_size)
+            return true;
+
+        return getNativeIntrinsicName (f) != nullptr;
+    }
+
+    static const char* getNativeIntrinsicName (const heart::Function& f)
+    {
+        if (f.parameters.empty() || f.parameters.size() > 3)
+            return nullptr;
+
+        auto paramType = f.parameters.front()->type.removeReferenceIfPresent().removeConstIfPresent();
+
+        if (! paramType.isPrimitiveOrVector() || paramType.isBool() || paramType.isBoundedInt())
+            return nullptr;
+
+        for (auto& p : f.parameters)
+            if (! p->type.removeReferenceIfPresent().removeConstIfPresent().isIdentical (paramType))
+                return nullptr;
+
+        switch (f.intrinsicType)
+        {
+            case IntrinsicType::clamp:
+            case IntrinsicType::wrap:
+                return paramType.isPrimitive() ? getIntrinsicName (f.intrinsicType) : nullptr;
+
+            case IntrinsicType::abs:        case IntrinsicType::min:        case IntrinsicType::max:
+                return getIntrinsicName (f.intrinsicType);
+
+            case IntrinsicType::fmod:       case IntrinsicType::remainder:  case IntrinsicType::floor:
+            case IntrinsicType::ceil:       case IntrinsicType::sqrt:       case IntrinsicType::pow:
+            case IntrinsicType::exp:        case IntrinsicType::log:        case IntrinsicType::log10:
+            case IntrinsicType::sin:        case IntrinsicType::cos:        case IntrinsicType::tan:
+            case IntrinsicType::sinh:       case IntrinsicType::cosh:       case IntrinsicType::tanh:
+            case IntrinsicType::asinh:      case IntrinsicType::acosh:      case IntrinsicType::atanh:
+            case IntrinsicType::asin:       case IntrinsicType::acos:       case IntrinsicType::atan:
+            case IntrinsicType::atan2:      case IntrinsicType::isnan:      case IntrinsicType::isinf:
+                return paramType.isFloatingPoint() ? getIntrinsicName (f.intrinsicType) : nullptr;
+
+            case IntrinsicType::none:           case IntrinsicType::addModulo2Pi:   case IntrinsicType::sum:
+            case IntrinsicType::roundToInt:     case IntrinsicType::product:        case IntrinsicType::get_array_size:
+            case IntrinsicType::read:           case IntrinsicType::readLinearInterpolated:
+            default:
+                return nullptr;
+        }
+    }
+
+    template <typename Visitor>
+    static void visitCalledFunctions (heart::Function& f, Visitor&& visit)
+    {
+        for (auto& b : f.blocks)
+            for (auto s : b->statements)
+                if (auto call = cast<heart::FunctionCall> (*s))
+                    visit (call->getFunction());
+
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& e, AccessType)
+                            {
+                                if (auto call = cast<heart::PureFunctionCall> (e))
+                                    visit (call->function);
+                            });
+    }
+
+    void findUsedFunctions()
+    {
+        for (auto& m : program.getModules())
+            for (auto& f : m->functions.get())
+                functionOwners[f.getPointer()] = m.getPointer();
+
+        std::vector<pool_ref<heart::Function>> toVisit;
+        std::unordered_set<const heart::Function*> visited;
+
+        auto addFunction = [&] (heart::Function& f)
+        {
+            if (visited.find (std::addressof (f)) != visited.end() || isHandledNatively (f))
+                return;
+
+            if (f.hasNoBody || f.blocks.empty())
+                f.location.throwError (Errors::functionHasNoImplementation());
+
+            visited.insert (std::addressof (f));
+            toVisit.push_back (f);
+
+            auto owner = functionOwners[std::addressof (f)];
+            SOUL_ASSERT (owner != nullptr);
+
+            if (owner->isProcessor())
+                getProcessorInfo (*owner).functions.push_back (f);
+            else
+                namespaceFunctions.push_back (f);
+        };
+
+        for (auto& n : nodes)
+        {
+            if (n.module != nullptr)
+            {
+                getProcessorInfo (*n.module);
+
+                for (auto& f : n.module->functions.get())
+                    if (! f->functionType.isNormal())
+                        addFunction (f);
+            }
+        }
+
+        for (size_t i = 0; i < toVisit.size(); ++i)
+            visitCalledFunctions (toVisit[i], addFunction);
+
+        for (auto& m : program.getModules())
+            for (auto& v : m->stateVariables.get())
+                if (m->isNamespace() || ! v->isState() || v->isExternal())
+                    staticVariables.push_back (v);
+    }
+
+    //==============================================================================
+    static const std::unordered_set<std::string>& getReservedWords()
+    {
+        static const std::unordered_set<std::string> words
+        {
+            "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+            "char", "char16_t", "char32_t", "class", "compl", "concept", "const", "constexpr", "const_cast", "continue",
+            "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+            "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace",
+            "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public",
+            "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", "static_assert",
+            "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef",
+            "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+            "xor", "xor_eq", "std", "int32_t", "int64_t", "uint32_t", "uint64_t", "size_t",
+            "Vector", "FixedArray", "DynamicArray", "DelayLine", "Ops", "elements", "numElements"
+        };
+
+        return words;
+    }
+
+    static std::string getUniqueName (std::unordered_set<std::string>& usedNames, std::string name)
+    {
+        name = makeSafeIdentifierName (std::move (name));
+
+        if (name.empty())
+            name = "_";
+
+        if (getReservedWords().find (name) != getReservedWords().end())
+            name += "_";
+
+        name = addSuffixToMakeUnique (name, [&] (const std::string& nm) { return usedNames.find (nm) != usedNames.end(); });
+        usedNames.insert (name);
+        return name;
+    }
+
+    static std::string getModulePrefix (const Module& m)
+    {
+        return makeIdentifierRemovingColons (m.originalFullName.empty() ? m.shortName : m.originalFullName);
+    }
+
+    void allocateNames()
+    {
+        for (auto name : { "init", "reset", "render", "getXRuns", "maxBlockSize", "latency", "sampleRate", "sessionID",
+                           "currentFrame", "xruns", "maxOutputEvents" })
+            classScopeNames.insert (name);
+
+        classScopeNames.insert (options.className);
+
+        for (auto& m : program.getModules())
+            for (auto& s : m->structs.get())
+                addStruct (*s, getModulePrefix (m));
+
+        for (auto& v : staticVariables)
+        {
+            auto owner = std::find_if (program.getModules().begin(), program.getModules().end(),
+                                       [&] (const Module& m) { return contains (m.stateVariables.get(), v); });
+
+            staticVariableNames[v.getPointer()] = getUniqueName (classScopeNames, (owner != program.getModules().end() ? getModulePrefix (*owner) + "_" : std::string())
+                                                                                     + v->name.toString());
+        }
+
+        for (auto& f : namespaceFunctions)
+            functionNames[f.getPointer()] = getUniqueName (classScopeNames, getModulePrefix (*functionOwners[f.getPointer()]) + "_" + f->name.toString());
+
+        for (auto& p : processors)
+            allocateProcessorNames (*p);
+
+        for (auto& n : nodes)
+            if (n.module != nullptr)
+                n.memberName = getUniqueName (classScopeNames, "node_" + getMemberNameForPath (n));
+
+        for (auto& i : mainModule.inputs)
+            inputNames.push_back (makeSafeIdentifierName (i->name.toString()));
+
+        for (auto& o : mainModule.outputs)
+            outputNames.push_back (makeSafeIdentifierName (o->name.toString()));
+
+        uint32_t delayLineIndex = 0, historyIndex = 0, eventDelayLineIndex = 0;
+
+        for (auto& r : routes)
+        {
+            auto& source = getNodeOutput (r.sourceNode, r.sourceOutput);
+
+            if (source.isEventEndpoint())
+            {
+                if (r.delay > 0)
+                {
+                    auto index = std::to_string (eventDelayLineIndex++);
+                    r.delayedEventType = getUniqueName (classScopeNames, "DelayedEvent_" + index);
+                    r.eventDelayLine = getUniqueName (classScopeNames, "eventDelay_" + index);
+                    routeStateDeclarations.push_back ("struct " + r.delayedEventType + " { " + getEventQueueEventType (source) + " }");
+                    routeStateDeclarations.push_back ("EventDelayLine<" + r.delayedEventType + ", " + std::to_string (options.eventQueueSize)
+                                                        + "> " + r.eventDelayLine);
+                }
+            }
+            else if (crossesRates (r))
+            {
+                auto index = std::to_string (historyIndex++);
+                auto sourceFramesPerDestFrame = getSourceFramesPerDestFrame (r);
+                r.history = getUniqueName (classScopeNames, "history_" + index);
+
+                // Enough frames to reach back past the delay, plus the ones which the source
+                // may have rendered ahead of the destination, and the interpolator's window
+                auto framesNeeded = sourceFramesPerDestFrame.getLocalFrame (r.delay + 1) + 4;
+
+                if (getInterpolation (r) == InterpolationType::sinc)
+                {
+                    auto cutoff = SincFilterBank<double>::getCutoff (1.0 / sourceFramesPerDestFrame.toDouble());
+                    auto halfLength = SincFilterBank<double>::getHalfLength (cutoff, FlattenedGraph::numSincZeroCrossings);
+                    framesNeeded += 2 * halfLength;
+
+                    r.sincFilter = getUniqueName (classScopeNames, "sincFilter_" + index);
+                    routeStateDeclarations.push_back ("SincFilter<" + std::to_string (halfLength) + ", "
+                                                        + std::to_string (SincFilterBank<double>::getNumPhases (cutoff)) + "> " + r.sincFilter);
+                }
+
+                int64_t historySize = 1;
+
+                while (historySize < framesNeeded)
+                    historySize *= 2;
+
+                routeStateDeclarations.push_back ("StreamHistory<" + getTypeName (getRouteSourceType (r)) + ", "
+                                                    + std::to_string (historySize) + "> " + r.history);
+            }
+            else if (r.delay > 0)
+            {
+                r.delayLine = getUniqueName (classScopeNames, "delay_" + std::to_string (delayLineIndex++));
+                routeStateDeclarations.push_back ("DelayLine<" + getTypeName (getRouteSourceType (r)) + ", "
+                                                    + std::to_string (r.delay) + "> " + r.delayLine);
+            }
+        }
+    }
+
+    // Turns a path like "voices[2].osc" into "voices_2_osc"
+    static std::string getMemberNameForPath (const Node& n)
+    {
+        if (n.path.empty())
+            return n.module->shortName;
+
+        std::string name;
+
+        for (auto c : n.path)
+        {
+            if (c == '.' || c == '[')   name += '_';
+            else if (c != ']')          name += c;
+        }
+
+        return name;
+    }
+
+    void addStruct (const Structure& s, const std::string& prefix)
+    {
+        if (structNames.find (std::addressof (s)) != structNames.end())
+            return;
+
+        structNames[std::addressof (s)] = getUniqueName (classScopeNames, prefix + "_" + s.getName());
+        std::unordered_set<std::string> memberNames;
+        auto& names = structMemberNames[std::addressof (s)];
+
+        for (auto& m : s.getMembers())
+            names.push_back (getUniqueName (memberNames, m.name));
+    }
+
+    void allocateProcessorNames (ProcessorInfo& p)
+    {
+        auto& m = *p.module;
+        p.structName = getUniqueName (classScopeNames, getModulePrefix (m));
+
+        for (auto name : { "_reset", "_renderFrame", "_resumePoint", "_frequency", "_period", "_instanceID",
+                           "_sessionID", "_latency", "_xruns", "EventQueue" })
+            p.usedNames.insert (name);
+
+        for (auto& f : p.functions)
+            functionNames[f.getPointer()] = getUniqueName (p.usedNames, f->name.toString());
+
+        for (auto& v : m.stateVariables.get())
+            if (v->isState() && ! v->isExternal())
+                p.variableNames[v.getPointer()] = getUniqueName (p.usedNames, v->name.toString());
+
+        for (auto& i : m.inputs)
+        {
+            p.inputNames.push_back (getUniqueName (p.usedNames, "in_" + i->name.toString()));
+            p.eventHandlers.push_back (findEventHandlers (m, i));
+        }
+
+        for (auto& o : m.outputs)
+        {
+            p.outputNames.push_back (getUniqueName (p.usedNames, "out_" + o->name.toString()));
+            std::vector<std::string> writers;
+
+            if (o->isEventEndpoint())
+                for (size_t i = 0; i < o->dataTypes.size(); ++i)
+                    writers.push_back (getUniqueName (p.usedNames, "write_" + o->name.toString() + "_" + std::to_string (i)));
+
+            p.eventWriters.push_back (std::move (writers));
+        }
+
+        // The locals of run() live in the processor struct, so that they survive across frames
+        for (auto& f : p.functions)
+        {
+            if (f->functionType.isRun())
+            {
+                for (auto& v : getLocalVariables (f))
+                {
+                    p.variableNames[v.getPointer()] = getUniqueName (p.usedNames, v->name.isValid() ? "run_" + v->name.toString() : "run_temp");
+                    p.runLocals.push_back (v);
+                }
+            }
+        }
+    }
+
+    std::vector<std::optional<EventHandler>> findEventHandlers (const Module& m, const heart::InputDeclaration& input)
+    {
+        std::vector<std::optional<EventHandler>> handlers (input.isEventEndpoint() ? input.dataTypes.size() : 0);
+
+        for (auto& f : m.functions.get())
+        {
+            if (! f->functionType.isEvent() || f->parameters.empty()
+                 || f->name.toString() != heart::getEventFunctionName (input.name, f->parameters.front()->type))
+                continue;
+
+            auto& valueType = f->parameters.back()->type;
+
+            if (auto typeIndex = heart::Utilities::findMatchingEndpointType (program, valueType, input.dataTypes, f->location))
+                handlers[*typeIndex] = EventHandler { f->name.toString(), f->parameters.size() > 1 };
+        }
+
+        return handlers;
+    }
+
+    static std::vector<pool_ref<heart::Variable>> getLocalVariables (heart::Function& f)
+    {
+        std::vector<pool_ref<heart::Variable>> locals;
+
+        auto add = [&] (heart::Variable& v)
+        {
+            if (! (v.isState() || contains (f.parameters, v) || contains (locals, v)))
+                locals.push_back (v);
+        };
+
+        for (auto& b : f.blocks)
+            for (auto& p : b->parameters)
+                add (p);
+
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& e, AccessType)
+                            {
+                                if (auto v = cast<heart::Variable> (e))
+                                    if (v->isFunctionLocal() || v->isParameter())
+                                        add (*v);
+                            });
+
+        for (auto& v : f.getAllLocalVariables())
+            add (v);
+
+        return locals;
+    }
+
+    static bool isParameterUsed (heart::Function& f, const heart::Variable& param)
+    {
+        bool used = false;
+
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& e, AccessType)
+                            {
+                                if (std::addressof (e.get()) == std::addressof (param))
+                                    used = true;
+                            });
+
+        return used;
+    }
+
+    //==============================================================================
+    std::string getTypeName (const Type& t)
+    {
+        auto type = t.removeReferenceIfPresent().removeConstIfPresent();
+
+        if (type.isVoid())              return "void";
+        if (type.isBoundedInt())        return "int32_t";
+        if (type.isStringLiteral())     return "uint32_t";
+
+        if (type.isPrimitive())
+        {
+            if (type.isBool())          return "bool";
+            if (type.isInteger32())     return "int32_t";
+            if (type.isInteger64())     return "int64_t";
+            if (type.isFloat32())       return "float";
+            if (type.isFloat64())       return "double";
+        }
+
+        if (type.isVector())
+            return "Vector<" + getTypeName (type.getElementType()) + ", " + std::to_string (type.getVectorSize()) + ">";
+
+        if (type.isFixedSizeArray())
+            return "FixedArray<" + getTypeName (type.getArrayElementType()) + ", " + std::to_string (type.getArraySize()) + ">";
+
+        if (type.isUnsizedArray())
+            return "DynamicArray<" + getTypeName (type.getArrayElementType()) + ">";
+
+        if (type.isStruct())
+        {
+            auto name = structNames.find (std::addressof (type.getStructRef()));
+
+            if (name != structNames.end())
+                return name->second;
+        }
+
+        CodeLocation().throwError (Errors::unsupportedType());
+        return {};
+    }
+
+    std::string getParameterDeclaration (const heart::Variable& v, const std::string& name)
+    {
+        if (v.type.isReference())
+            return (v.type.isConst() ? "const " : "") + getTypeName (v.type) + "&" + (name.empty() ? "" : " " + name);
+
+        return getTypeName (v.type) + (name.empty() ? "" : " " + name);
+    }
+
+    //==============================================================================
+    static std::string getIntegerLiteral (int64_t n, bool is64Bit)
+    {
+        if (! is64Bit)
+            return n == std::numeric_limits<int32_t>::min() ? "(-2147483647 - 1)" : std::to_string (n);
+
+        if (n == std::numeric_limits<int64_t>::min())
+            return "int64_t (-9223372036854775807ll - 1)";
+
+        return "int64_t (" + std::to_string (n) + (n > std::numeric_limits<int32_t>::max() || n < std::numeric_limits<int32_t>::min() ? "ll)" : ")");
+    }
+
+    static std::string getFloatLiteral (double value, bool is32Bit)
+    {
+        auto typeName = std::string (is32Bit ? "float" : "double");
+
+        if (std::isnan (value))
+            return "std::numeric_limits<" + typeName + ">::quiet_NaN()";
+
+        if (std::isinf (value))
+            return (value < 0 ? "-" : "") + ("std::numeric_limits<" + typeName + ">::infinity()");
+
+        auto s = is32Bit ? choc::text::floatToString ((float) value) : choc::text::floatToString (value);
+
+        if (s.find_first_of (".e") == std::string::npos)
+            s += ".0";
+
+        return is32Bit ? s + "f" : s;
+    }
+
+    std::string getLiteral (const Value& value)
+    {
+        auto& type = value.getType();
+
+        if (type.isBoundedInt())            return getIntegerLiteral (value.getAsInt32(), false);
+        if (type.isStringLiteral())         return "uint32_t (" + std::to_string (value.getStringLiteral().handle) + ")";
+
+        if (type.isPrimitive())
+        {
+            if (type.isBool())              return value.getAsBool() ? "true" : "false";
+            if (type.isInteger32())         return getIntegerLiteral (value.getAsInt32(), false);
+            if (type.isInteger64())         return getIntegerLiteral (value.getAsInt64(), true);
+            if (type.isFloat32())           return getFloatLiteral (value.getAsFloat(), true);
+            if (type.isFloat64())           return getFloatLiteral (value.getAsDouble(), false);
+        }
+
+        if (type.isUnsizedArray())
+        {
+            auto content = program.getConstantTable().getValueForHandle (value.getUnsizedArrayContent());
+
+            if (content == nullptr || content->getType().getArraySize() == 0)
+                return getTypeName (type) + " {}";
+
+            auto items = getAggregateItems (*content);
+            auto elementType = getTypeName (type.getArrayElementType());
+            auto dataName = hoistConstant ("static inline " + elementType + " $NAME$[] = { " + joinStrings (items, ", ") + " };");
+
+            return getTypeName (type) + " { " + dataName + ", " + std::to_string (items.size()) + " }";
+        }
+
+        if (value.isZero())
+            return getTypeName (type) + " {}";
+
+        auto items = joinStrings (getAggregateItems (value), ", ");
+        auto literal = type.isStruct() ? getTypeName (type) + " { " + items + " }"
+                                       : getTypeName (type) + " {{ " + items + " }}";
+
+        if (type.getPackedSizeInBytes() > maxHoistedLiteralSize)
+            return hoistConstant ("static inline const " + getTypeName (type) + " $NAME$ = " + literal + ";");
+
+        return literal;
+    }
+
+    std::vector<std::string> getAggregateItems (const Value& value)
+    {
+        std::vector<std::string> items;
+        auto& type = value.getType();
+        auto num = type.isStruct() ? type.getStructRef().getNumMembers() : (size_t) type.getArrayOrVectorSize();
+
+        for (size_t i = 0; i < num; ++i)
+            items.push_back (getLiteral (value.getSubElement (i)));
+
+        return items;
+    }
+
+    std::string hoistConstant (const std::string& declaration)
+    {
+        auto& name = hoistedConstantNames[declaration];
+
+        if (name.empty())
+        {
+            name = getUniqueName (classScopeNames, "constant_" + std::to_string (hoistedConstants.size()));
+            hoistedConstants.push_back ({ choc::text::replace (declaration, "$NAME$", name), name });
+        }
+
+        return name;
+    }
+
+    //==============================================================================
+    static bool typesAreIdentical (const Type& a, const Type& b)
+    {
+        return a.removeReferenceIfPresent().removeConstIfPresent().isIdentical (b.removeReferenceIfPresent().removeConstIfPresent());
+    }
+
+    std::string convert (const std::string& value, const Type& sourceType, const Type& destType)
+    {
+        auto dest = destType.removeReferenceIfPresent().removeConstIfPresent();
+        auto source = sourceType.removeReferenceIfPresent().removeConstIfPresent();
+
+        if (dest.isBoundedInt())
+        {
+            if (typesAreIdentical (source, dest))
+                return value;
+
+            auto asInt = getTypeName (source) == "int32_t" ? value : "Ops::convert<int32_t> (" + value + ")";
+            return std::string (dest.isWrapped() ? "Ops::wrap (" : "Ops::clamp (") + asInt + ", "
+                     + (dest.isWrapped() ? "" : "0, ") + std::to_string (dest.getBoundedIntLimit() - (dest.isWrapped() ? 0 : 1)) + ")";
+        }
+
+        auto destName = getTypeName (dest);
+
+        if (destName == getTypeName (source))
+            return value;
+
+        return "Ops::convert<" + destName + "> (" + value + ")";
+    }
+
+    std::string getExpressionAs (heart::Expression& e, const Type& type)
+    {
+        return convert (getExpression (e), e.getType(), type);
+    }
+
+    //==============================================================================
+    std::string getVariableName (const heart::Variable& v)
+    {
+        auto local = localVariableNames.find (std::addressof (v));
+
+        if (local != localVariableNames.end())
+            return local->second;
+
+        if (currentProcessor != nullptr)
+        {
+            auto member = currentProcessor->variableNames.find (std::addressof (v));
+
+            if (member != currentProcessor->variableNames.end())
+                return member->second;
+        }
+
+        auto global = staticVariableNames.find (std::addressof (v));
+
+        if (global != staticVariableNames.end())
+            return global->second;
+
+        v.location.throwError (Errors::unresolvedSymbol (v.name.toString()));
+        return {};
+    }
+
+    std::string getExpression (heart::Expression& e)
+    {
+        if (auto v = cast<heart::Variable> (e))                   return getVariableName (*v);
+        if (auto c = cast<heart::Constant> (e))                   return getLiteral (c->value);
+        if (auto a = cast<heart::ArrayElement> (e))               return getArrayElement (*a);
+        if (auto s = cast<heart::StructElement> (e))              return getExpression (s->parent) + "." + structMemberNames[std::addressof (s->getStruct())][s->getMemberIndex()];
+        if (auto t = cast<heart::TypeCast> (e))                   return getExpressionAs (t->source, t->destType);
+        if (auto u = cast<heart::UnaryOperator> (e))              return getUnaryOperator (*u);
+        if (auto b = cast<heart::BinaryOperator> (e))             return getBinaryOperator (*b);
+        if (auto f = cast<heart::PureFunctionCall> (e))           return getFunctionCall (f->function, f->arguments, e.location);
+        if (auto p = cast<heart::ProcessorProperty> (e))          return getProcessorProperty (*p);
+        if (auto a = cast<heart::AggregateInitialiserList> (e))   return getAggregate (*a);
+
+        e.location.throwError (Errors::notYetImplemented ("This expression in generated C++"));
+        return {};
+    }
+
+    std::string getArrayElement (heart::ArrayElement& a)
+    {
+        auto parentType = a.parent->getType().removeReferenceIfPresent();
+        auto parent = getExpression (a.parent);
+
+        if (parentType.isPrimitive())
+            return parent;
+
+        if (a.isSlice())
+        {
+            if (a.isDynamic())
+                a.location.throwError (Errors::notYetImplemented ("Slices of dynamic arrays"));
+
+            return "Ops::slice<" + std::to_string (a.fixedStartIndex) + ", " + std::to_string (a.getSliceSize()) + "> (" + parent + ")";
+        }
+
+        return parent + ".elements[" + getArrayIndex (a, parent) + "]";
+    }
+
+    std::string getArrayIndex (heart::ArrayElement& a, const std::string& parent)
+    {
+        auto parentType = a.parent->getType().removeReferenceIfPresent();
+        auto size = parentType.isUnsizedArray() ? parent + ".numElements" : std::to_string (parentType.getArrayOrVectorSize());
+
+        if (! a.isDynamic())
+            return parentType.isUnsizedArray() ? "Ops::index (" + std::to_string (a.fixedStartIndex) + ", " + size + ")"
+                                               : std::to_string (a.fixedStartIndex);
+
+        auto indexType = a.dynamicIndex->getType().removeReferenceIfPresent();
+        auto index = getExpression (*a.dynamicIndex);
+
+        if (! parentType.isUnsizedArray()
+             && (a.isRangeTrusted || (indexType.isBoundedInt() && indexType.getBoundedIntLimit() <= (int64_t) parentType.getArrayOrVectorSize())))
+            return index;
+
+        return "Ops::index (" + index + ", " + size + ")";
+    }
+
+    static bool isScalarArithmetic (const Type& t)
+    {
+        return t.isPrimitive() && (t.isFloatingPoint() || t.isInteger()) && ! t.isBoundedInt();
+    }
+
+    std::string getUnaryOperator (heart::UnaryOperator& u)
+    {
+        auto type = u.source->getType().removeReferenceIfPresent();
+        auto source = getExpression (u.source);
+
+        if (u.operation == UnaryOp::Op::negate && type.isPrimitive() && type.isFloatingPoint())
+            return "(-" + source + ")";
+
+        if (u.operation == UnaryOp::Op::logicalNot && type.isPrimitive())
+            return "(! " + source + ")";
+
+        return std::string ("Ops::") + getOperatorName (u.operation) + " (" + source + ")";
+    }
+
+    std::string getBinaryOperator (heart::BinaryOperator& b)
+    {
+        auto types = BinaryOp::getTypes (b.operation, b.lhs->getType(), b.rhs->getType());
+
+        if (! types.operandType.isValid())
+            b.location.throwError (Errors::illegalTypesForBinaryOperator (BinaryOp::getSymbol (b.operation),
+                                                                          b.lhs->getType().getDescription(),
+                                                                          b.rhs->getType().getDescription()));
+
+        auto lhs = getExpressionAs (b.lhs, types.operandType);
+        auto rhs = getExpressionAs (b.rhs, types.operandType);
+        std::string result;
+
+        // Plain operators are used wherever their C++ behaviour matches SOUL's, and the rest go
+        // through the helper functions, which also handle vectors
+        bool useInfix = false;
+        auto& operandType = types.operandType;
+
+        if (BinaryOp::isComparisonOperator (b.operation) || BinaryOp::isEqualityOperator (b.operation))
+            useInfix = isScalarArithmetic (operandType) || (operandType.isPrimitive() && operandType.isBool());
+        else if (BinaryOp::isLogicalOperator (b.operation))
+            useInfix = operandType.isPrimitive();
+        else if (b.operation == BinaryOp::Op::add || b.operation == BinaryOp::Op::subtract
+                  || b.operation == BinaryOp::Op::multiply || b.operation == BinaryOp::Op::divide)
+            useInfix = operandType.isPrimitive() && operandType.isFloatingPoint();
+
+        if (useInfix)
+            result = "(" + lhs + " " + BinaryOp::getSymbol (b.operation) + " " + rhs + ")";
+        else
+            result = std::string ("Ops::") + getOperatorName (b.operation) + " (" + lhs + ", " + rhs + ")";
+
+        if (types.resultType.isBoundedInt())
+            return convert (result, PrimitiveType::int32, types.resultType);
+
+        return result;
+    }
+
+    static const char* getOperatorName (BinaryOp::Op op)
+    {
+        #define SOUL_CPP_BINARY_OP_NAME(name, symbol)  if (op == BinaryOp::Op::name) return #name;
+        SOUL_BINARY_OPS (SOUL_CPP_BINARY_OP_NAME)
+        #undef SOUL_CPP_BINARY_OP_NAME
+        return "";
+    }
+
+    static const char* getOperatorName (UnaryOp::Op op)
+    {
+        #define SOUL_CPP_UNARY_OP_NAME(name, symbol)  if (op == UnaryOp::Op::name) return #name;
+        SOUL_UNARY_OPS (SOUL_CPP_UNARY_OP_NAME)
+        #undef SOUL_CPP_UNARY_OP_NAME
+        return "";
+    }
+
+    std::string getProcessorProperty (heart::ProcessorProperty& p)
+    {
+        if (currentProcessor == nullptr)
+            p.location.throwError (Errors::notYetImplemented ("Processor properties outside a processor"));
+
+        switch (p.property)
+        {
+            case heart::ProcessorProperty::Property::period:     return "_period";
+            case heart::ProcessorProperty::Property::frequency:  return "_frequency";
+            case heart::ProcessorProperty::Property::id:         return "_instanceID";
+            case heart::ProcessorProperty::Property::session:    return "_sessionID";
+            case heart::ProcessorProperty::Property::latency:    return "_latency";
+            case heart::ProcessorProperty::Property::none:
+            default:                                             break;
+        }
+
+        p.location.throwError (Errors::unknownProperty());
+        return {};
+    }
+
+    std::string getAggregate (heart::AggregateInitialiserList& a)
+    {
+        auto constant = a.getAsConstant();
+
+        if (constant.isValid())
+            return getLiteral (constant);
+
+        auto& type = a.type;
+        std::vector<std::string> items;
+
+        if (type.isStruct())
+        {
+            auto& s = type.getStructRef();
+
+            for (size_t i = 0; i < a.items.size(); ++i)
+                items.push_back (getExpressionAs (a.items[i], s.getMemberType (i)));
+
+            return getTypeName (type) + " { " + joinStrings (items, ", ") + " }";
+        }
+
+        if (type.isFixedSizeArray() || type.isVector())
+        {
+            for (auto& item : a.items)
+                items.push_back (getExpressionAs (item, type.getElementType()));
+
+            return getTypeName (type) + " {{ " + joinStrings (items, ", ") + " }}";
+        }
+
+        SOUL_ASSERT (a.items.size() == 1);
+        return getExpressionAs (a.items.front(), type);
+    }
+
+    template <typename ArgList>
+    std::string getFunctionCall (heart::Function& f, ArgList& args, const CodeLocation& location)
+    {
+        SOUL_ASSERT (args.size() == f.parameters.size());
+
+        if (f.intrinsicType == IntrinsicType::get_array_size)
+        {
+            auto arrayType = args.front()->getType().removeReferenceIfPresent();
+
+            if (arrayType.isUnsizedArray())
+                return getExpression (args.front()) + ".numElements";
+
+            return std::to_string (arrayType.isArrayOrVector() ? arrayType.getArrayOrVectorSize() : 1);
+        }
+
+        std::vector<std::string> argValues;
+
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            auto& paramType = f.parameters[i]->type;
+
+            if (paramType.isNonConstReference())
+                argValues.push_back (getExpression (args[i]));
+            else
+                argValues.push_back (getExpressionAs (args[i], paramType));
+        }
+
+        if (auto intrinsic = getNativeIntrinsicName (f))
+            return std::string ("Ops::") + intrinsic + " (" + joinStrings (argValues, ", ") + ")";
+
+        auto name = functionNames.find (std::addressof (f));
+
+        if (name == functionNames.end())
+            location.throwError (Errors::functionHasNoImplementation());
+
+        return name->second + " (" + joinStrings (argValues, ", ") + ")";
+    }
+
+    //==============================================================================
+    void printStatement (heart::Statement& s)
+    {
+        if (auto a = cast<heart::AssignFromValue> (s))
+            return printAssignment (*a->target, getExpressionAs (a->source, a->target->getType()));
+
+        if (auto call = cast<heart::FunctionCall> (s))
+        {
+            auto& f = call->getFunction();
+            auto value = getFunctionCall (f, call->arguments, call->location);
+
+            if (call->target != nullptr)
+                return printAssignment (*call->target, convert (value, f.returnType, call->target->getType()));
+
+            out << value << ";" << newLine;
+            return;
+        }
+
+        if (auto r = cast<heart::ReadStream> (s))
+        {
+            auto& input = r->source.get();
+            auto value = getEndpointMember (currentProcessor->inputNames[getIndexOf (currentProcessor->module->inputs, input)],
+                                            input, r->element);
+            return printAssignment (*r->target, convert (value, getEndpointElementType (input, r->element), r->target->getType()));
+        }
+
+        if (auto w = cast<heart::WriteStream> (s))
+            return printWriteStream (*w);
+
+        if (is_type<heart::AdvanceClock> (s))
+        {
+            if (currentFunction == nullptr || ! currentFunction->functionType.isRun())
+                s.location.throwError (Errors::advanceCannotBeCalledHere());
+
+            auto index = ++numResumePoints;
+            out << "_resumePoint = " << index << "; return; resume_" << index << ":;" << newLine;
+            return;
+        }
+
+        s.location.throwError (Errors::notYetImplemented ("This statement in generated C++"));
+    }
+
+    void printAssignment (heart::Expression& target, const std::string& value)
+    {
+        if (auto a = cast<heart::ArrayElement> (target))
+        {
+            if (a->isSlice() && ! a->parent->getType().removeReferenceIfPresent().isPrimitive())
+            {
+                if (a->isDynamic())
+                    a->location.throwError (Errors::notYetImplemented ("Slices of dynamic arrays"));
+
+                out << "Ops::setSlice<" << a->fixedStartIndex << "> (" << getExpression (a->parent) << ", " << value << ");" << newLine;
+                return;
+            }
+        }
+
+        out << getExpression (target) << " = " << value << ";" << newLine;
+    }
+
+    template <typename ListType>
+    static size_t getIndexOf (const ListType& list, const heart::IODeclaration& io)
+    {
+        for (size_t i = 0; i < list.size(); ++i)
+            if (std::addressof (list[i].get()) == std::addressof (io))
+                return i;
+
+        SOUL_ASSERT_FALSE;
+        return 0;
+    }
+
+    static Type getEndpointElementType (const heart::IODeclaration& io, pool_ptr<heart::Expression> element)
+    {
+        return element != nullptr ? io.dataTypes.front() : io.getFrameOrValueType();
+    }
+
+    std::string getEndpointMember (const std::string& member, const heart::IODeclaration& io, pool_ptr<heart::Expression> element)
+    {
+        if (element == nullptr)
+            return member;
+
+        auto index = getExpressionAs (*element, PrimitiveType::int32);
+        auto constant = element->getAsConstant();
+
+        if (constant.isValid())
+            return member + ".elements[" + std::to_string (std::clamp (constant.getAsInt64(), (int64_t) 0, (int64_t) io.arraySize.value_or (1) - 1)) + "]";
+
+        return member + ".elements[Ops::index (" + index + ", " + std::to_string (io.arraySize.value_or (1)) + ")]";
+    }
+
+    void printWriteStream (heart::WriteStream& w)
+    {
+        auto& output = w.target.get();
+        auto outputIndex = getIndexOf (currentProcessor->module->outputs, output);
+
+        if (output.isEventEndpoint())
+        {
+            auto valueType = w.value->getType();
+            auto match = heart::Utilities::findMatchingEndpointType (program, valueType, output.dataTypes, w.location);
+            auto typeIndex = match.has_value() ? (int32_t) *match : -1;
+
+            for (size_t i = 0; i < output.dataTypes.size() && typeIndex < 0; ++i)
+                if (TypeRules::canSilentlyCastTo (output.dataTypes[i], valueType))
+                    typeIndex = (int32_t) i;
+
+            if (typeIndex < 0)
+                w.location.throwError (Errors::wrongTypeForEndpoint());
+
+            out << currentProcessor->eventWriters[outputIndex][(size_t) typeIndex] << " ("
+                << (w.element != nullptr ? getExpressionAs (*w.element, PrimitiveType::int32) : std::string ("-1")) << ", "
+                << getExpressionAs (w.value, output.dataTypes[(size_t) typeIndex]) << ");" << newLine;
+            return;
+        }
+
+        auto target = getEndpointMember (currentProcessor->outputNames[outputIndex], output, w.element);
+        auto elementType = getEndpointElementType (output, w.element);
+
+        if (output.isValueEndpoint())
+            out << target << " = " << getExpressionAs (w.value, elementType) << ";" << newLine;
+        else
+            out << "Ops::addTo (" << target << ", " << getExpression (w.value) << ");" << newLine;
+    }
+
+    //==============================================================================
+    void findLabelledBlocks (heart::Function& f)
+    {
+        labelledBlocks.clear();
+
+        for (size_t i = 0; i < f.blocks.size(); ++i)
+        {
+            auto next = i + 1 < f.blocks.size() ? f.blocks[i + 1].getPointer() : nullptr;
+
+            if (auto b = cast<heart::Branch> (f.blocks[i]->terminator))
+            {
+                if (b->target.getPointer() != next)
+                    labelledBlocks.insert (b->target.getPointer());
+            }
+            else if (auto bi = cast<heart::BranchIf> (f.blocks[i]->terminator))
+            {
+                labelledBlocks.insert (bi->targets[0].getPointer());
+
+                if (bi->targets[1].getPointer() != next)
+                    labelledBlocks.insert (bi->targets[1].getPointer());
+            }
+        }
+    }
+
+    std::string getBlockLabel (const heart::Block& b) const
+    {
+        return "block_" + makeSafeIdentifierName (b.name.toString().substr (1));
+    }
+
+    void printBlockArguments (heart::Block& target, heart::Branch::ArgListType& args)
+    {
+        if (args.empty())
+            return;
+
+        SOUL_ASSERT (args.size() == target.parameters.size());
+        bool argsReadParameters = false;
+
+        if (args.size() > 1)
+            for (auto& arg : args)
+                for (auto& p : target.parameters)
+                    if (arg->readsVariable (p))
+                        argsReadParameters = true;
+
+        if (! argsReadParameters)
+        {
+            for (size_t i = 0; i < args.size(); ++i)
+                out << getVariableName (target.parameters[i]) << " = " << getExpressionAs (args[i], target.parameters[i]->type) << ";" << newLine;
+
+            return;
+        }
+
+        auto indent = out.createIndentWithBraces();
+
+        for (size_t i = 0; i < args.size(); ++i)
+            out << "auto arg" << i << " = " << getExpressionAs (args[i], target.parameters[i]->type) << ";" << newLine;
+
+        for (size_t i = 0; i < args.size(); ++i)
+            out << getVariableName (target.parameters[i]) << " = arg" << i << ";" << newLine;
+    }
+
+    void printJump (const heart::Block& target, const heart::Block* next)
+    {
+        if (std::addressof (target) != next)
+            out << "goto " << getBlockLabel (target) << ";" << newLine;
+    }
+
+    void printTerminator (heart::Terminator& t, const heart::Block* next)
+    {
+        if (auto b = cast<heart::Branch> (t))
+        {
+            printBlockArguments (b->target, b->targetArgs);
+            return printJump (b->target, next);
+        }
+
+        if (auto b = cast<heart::BranchIf> (t))
+        {
+            auto condition = getExpressionAs (b->condition, PrimitiveType::bool_);
+
+            if (b->targetArgs[0].empty())
+            {
+                out << "if (" << condition << ") goto " << getBlockLabel (b->targets[0]) << ";" << newLine;
+            }
+            else
+            {
+                out << "if (" << condition << ")" << newLine;
+
+                {
+                    auto indent = out.createIndentWithBraces();
+                    printBlockArguments (b->targets[0], b->targetArgs[0]);
+                    out << "goto " << getBlockLabel (b->targets[0]) << ";" << newLine;
+                }
+
+                out << newLine;
+            }
+
+            printBlockArguments (b->targets[1], b->targetArgs[1]);
+            return printJump (b->targets[1], next);
+        }
+
+        if (auto r = cast<heart::ReturnValue> (t))
+        {
+            out << "return " << getExpressionAs (r->returnValue, currentFunction->returnType) << ";" << newLine;
+            return;
+        }
+
+        SOUL_ASSERT (is_type<heart::ReturnVoid> (t));
+
+        if (currentFunction->functionType.isRun())
+            out << "_resumePoint = -1;" << newLine;
+
+        out << "return;" << newLine;
+    }
+
+    void printFunction (heart::Function& f, bool isStatic)
+    {
+        currentFunction = std::addressof (f);
+        localVariableNames.clear();
+        numResumePoints = 0;
+
+        auto usedNames = currentProcessor != nullptr ? currentProcessor->usedNames : classScopeNames;
+        std::vector<std::string> params;
+
+        for (auto& p : f.parameters)
+        {
+            auto name = getUniqueName (usedNames, p->name.toString());
+            localVariableNames[p.getPointer()] = name;
+
+            // Leaving unused parameters unnamed keeps the generated code free of -Wunused-parameter warnings
+            params.push_back (getParameterDeclaration (p, isParameterUsed (f, p) ? name : std::string()));
+        }
+
+        out << (isStatic ? "static " : "") << getTypeName (f.returnType) << " " << functionNames[std::addressof (f)]
+            << " (" << joinStrings (params, ", ") << ")" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            if (f.functionType.isRun())
+            {
+                uint32_t numAdvances = 0;
+
+                f.visitStatements<heart::AdvanceClock> ([&] (heart::AdvanceClock&) { ++numAdvances; });
+
+                out << "switch (_resumePoint)" << newLine;
+
+                {
+                    auto switchIndent = out.createIndentWithBraces();
+                    out << "case 0: break;" << newLine;
+
+                    for (uint32_t i = 1; i <= numAdvances; ++i)
+                        out << "case " << i << ": goto resume_" << i << ";" << newLine;
+
+                    out << "default: return;" << newLine;
+                }
+
+                out << blankLine;
+            }
+            else
+            {
+                for (auto& v : getLocalVariables (f))
+                {
+                    auto name = getUniqueName (usedNames, v->name.isValid() ? v->name.toString() : "temp");
+                    localVariableNames[v.getPointer()] = name;
+                    out << getTypeName (v->type) << " " << name << " {};" << newLine;
+                }
+
+                out << blankLine;
+            }
+
+            findLabelledBlocks (f);
+
+            for (size_t i = 0; i < f.blocks.size(); ++i)
+            {
+                auto& block = f.blocks[i].get();
+                auto next = i + 1 < f.blocks.size() ? f.blocks[i + 1].getPointer() : nullptr;
+
+                if (labelledBlocks.find (std::addressof (block)) != labelledBlocks.end())
+                {
+                    out.addIndent (-2);
+                    out << getBlockLabel (block) << ":" << newLine;
+                    out.addIndent (2);
+                }
+
+                for (auto s : block.statements)
+                    printStatement (*s);
+
+                SOUL_ASSERT (block.terminator != nullptr);
+                printTerminator (*block.terminator, next);
+            }
+
+            if (! f.blocks.empty() && ! f.blocks.back()->terminator->isReturn() && f.returnType.isVoid())
+                out << "return;" << newLine;
+        }
+
+        out << blankLine;
+        currentFunction = nullptr;
+    }
+
+    //==============================================================================
+    void printClass()
+    {
+        out.setTabSize (4);
+
+        out << "//==============================================================================" << newLine
+            << "// Generated from the SOUL processor " << mainModule.originalFullName << " - do not edit!" << newLine
+            << "//" << newLine
+            << "// This class needs no dependencies beyond the C++17 standard library. Call init()" << newLine
+            << "// before rendering, then for each block of up to maxBlockSize frames, provide the" << newLine
+            << "// input frames and events, call render(), and read back the outputs. An instance may" << newLine
+            << "// be large, so it's best to allocate it on the heap." << newLine
+            << "//==============================================================================" << newLine
+            << blankLine
+            << "#pragma once" << newLine
+            << blankLine
+            << "#include <cstdint>" << newLine
+            << "#include <cstring>" << newLine
+            << "#include <cmath>" << newLine
+            << "#include <limits>" << newLine
+            << "#include <type_traits>" << newLine
+            << blankLine
+            << "class " << options.className << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            printAccessSpecifier ("public");
+            out << options.className << "() = default;" << newLine
+                << "~" << options.className << "() = default;" << newLine
+                << blankLine
+                << "static constexpr uint32_t maxBlockSize = " << options.maxBlockSize << ";" << newLine
+                << "static constexpr uint32_t maxOutputEvents = " << std::max (options.maxBlockSize, options.eventQueueSize) << ";" << newLine
+                << "static constexpr int32_t latency = " << latency << ";" << newLine
+                << blankLine;
+
+            printSupportTypes();
+            printStructs();
+
+            printPublicFunctions();
+
+            out << sectionBreak;
+            printAccessSpecifier ("private");
+            printOps();
+
+            for (auto& f : namespaceFunctions)
+                printFunction (f, true);
+
+            for (auto& p : processors)
+                printProcessor (*p);
+
+            printMembers();
+            printStaticVariables();
+        }
+
+        out << ";" << newLine;
+    }
+
+    void printAccessSpecifier (const char* name)
+    {
+        out.addIndent (-4);
+        out << name << ":" << newLine;
+        out.addIndent (4);
+    }
+
+    // A constant initial value becomes a literal, but anything else (e.g. one that uses processor.period)
+    // is printed as an expression, to be evaluated where the variable is set
+    std::string getInitialValue (heart::Variable& v, const Value& constantValue)
+    {
+        if (constantValue.isValid())
+            return getLiteral (constantValue);
+
+        if (v.initialValue != nullptr)
+            return getExpressionAs (*v.initialValue, v.type.removeReferenceIfPresent().removeConstIfPresent());
+
+        return getTypeName (v.type) + " {}";
+    }
+
+    // These go at the end of the class because the literals used by everything else may have
+    // added hoisted constants, which need to be declared before any static that refers to them
+    void printStaticVariables()
+    {
+        std::vector<std::string> declarations;
+
+        for (auto& v : staticVariables)
+        {
+            auto value = v->initialValue != nullptr ? v->initialValue->getAsConstant() : Value();
+
+            if (value.isValid() && ! typesAreIdentical (value.getType(), v->type))
+                value = value.castToTypeWithError (v->type.removeReferenceIfPresent().removeConstIfPresent(), v->location);
+
+            declarations.push_back ("static inline " + getTypeName (v->type) + " " + staticVariableNames[v.getPointer()]
+                                      + " = " + getInitialValue (v, value) + ";");
+        }
+
+        if (hoistedConstants.empty() && declarations.empty())
+            return;
+
+        out << sectionBreak;
+
+        for (auto& c : hoistedConstants)
+            out << c.first << newLine;
+
+        for (auto& d : declarations)
+            out << d << newLine;
+    }
+
+    void printSupportTypes()
+    {
+        out << sectionBreak
+            << R"(template <typename ElementType, int size>
+struct Vector
+{
+    static constexpr int kind = 1, numElements = size;
+    using Element = ElementType;
+    template <typename NewElementType> using WithElementType = Vector<NewElementType, size>;
+    template <int newSize> using WithSize = Vector<ElementType, newSize>;
+
+    ElementType& operator[] (int index) noexcept                { return elements[index]; }
+    const ElementType& operator[] (int index) const noexcept    { return elements[index]; }
+
+    ElementType elements[size];
+};
+
+template <typename ElementType, int size>
+struct FixedArray
+{
+    static constexpr int kind = 2, numElements = size;
+    using Element = ElementType;
+    template <typename NewElementType> using WithElementType = FixedArray<NewElementType, size>;
+    template <int newSize> using WithSize = FixedArray<ElementType, newSize>;
+
+    ElementType& operator[] (int index) noexcept                { return elements[index]; }
+    const ElementType& operator[] (int index) const noexcept    { return elements[index]; }
+
+    ElementType elements[size];
+};
+
+template <typename ElementType>
+struct DynamicArray
+{
+    static constexpr int kind = 3;
+    using Element = ElementType;
+
+    ElementType* elements;
+    int32_t numElements;
+};
+)";
+    }
+
+    void printStructs()
+    {
+        std::unordered_set<const Structure*> done;
+
+        std::function<void(const Structure&)> printStruct = [&] (const Structure& s)
+        {
+            if (done.find (std::addressof (s)) != done.end())
+                return;
+
+            done.insert (std::addressof (s));
+
+            std::function<void(const Type&)> printDependencies = [&] (const Type& t)
+            {
+                if (t.isStruct())        printStruct (t.getStructRef());
+                else if (t.isArray())    printDependencies (t.getArrayElementType());
+            };
+
+            for (auto& m : s.getMembers())
+                printDependencies (m.type);
+
+            out << "struct " << structNames[std::addressof (s)] << newLine;
+
+            {
+                auto indent = out.createIndentWithBraces();
+                auto& names = structMemberNames[std::addressof (s)];
+
+                for (size_t i = 0; i < s.getNumMembers(); ++i)
+                    out << getTypeName (s.getMemberType (i)) << " " << names[i] << ";" << newLine;
+            }
+
+            out << ";" << newLine << blankLine;
+        };
+
+        if (! structNames.empty())
+            out << sectionBreak;
+
+        for (auto& m : program.getModules())
+            for (auto& s : m->structs.get())
+                printStruct (*s);
+    }
+
+    //==============================================================================
+    std::string getEventQueueEventType (const heart::IODeclaration& output)
+    {
+        std::string members = "uint32_t typeIndex; int32_t element;";
+
+        for (size_t i = 0; i < output.dataTypes.size(); ++i)
+            members += " " + getTypeName (output.dataTypes[i]) + " value" + std::to_string (i) + ";";
+
+        return members;
+    }
+
+    void printProcessor (ProcessorInfo& p)
+    {
+        auto& m = *p.module;
+        currentProcessor = std::addressof (p);
+
+        out << sectionBreak
+            << "struct " << p.structName << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            for (auto& v : m.stateVariables.get())
+            {
+                if (v->isState() && ! v->isExternal())
+                {
+                    auto value = v->initialValue != nullptr ? v->initialValue->getAsConstant() : Value();
+                    out << getTypeName (v->type) << " " << p.variableNames[v.getPointer()];
+
+                    if (value.isValid() && value.getType().isPrimitive())
+                        out << " = " << convert (getLiteral (value), value.getType(), v->type) << ";" << newLine;
+                    else
+                        out << " {};" << newLine;
+                }
+            }
+
+            out << blankLine;
+
+            for (size_t i = 0; i < m.inputs.size(); ++i)
+                if (! m.inputs[i]->isEventEndpoint())
+                    out << getTypeName (m.inputs[i]->getFrameOrValueType()) << " " << p.inputNames[i] << " {};" << newLine;
+
+            for (size_t i = 0; i < m.outputs.size(); ++i)
+            {
+                auto& output = m.outputs[i].get();
+
+                if (output.isEventEndpoint())
+                    out << "struct { struct { " << getEventQueueEventType (output) << " } events[" << options.eventQueueSize
+                        << "]; uint32_t numEvents = 0; } " << p.outputNames[i] << ";" << newLine;
+                else
+                    out << getTypeName (output.getFrameOrValueType()) << " " << p.outputNames[i] << " {};" << newLine;
+            }
+
+            out << blankLine;
+
+            for (auto& v : p.runLocals)
+                out << getTypeName (v->type) << " " << p.variableNames[v.getPointer()] << " {};" << newLine;
+
+            out << blankLine
+                << "int32_t _resumePoint = 0;" << newLine
+                << "double _frequency = 0, _period = 0;" << newLine
+                << "int32_t _instanceID = 0, _sessionID = 0, _latency = " << (int32_t) m.latency << ";" << newLine
+                << "uint32_t _xruns = 0;" << newLine
+                << blankLine;
+
+            printProcessorReset (p);
+            printProcessorRenderFrame (p);
+            printEventWriters (p);
+
+            for (auto& f : p.functions)
+                printFunction (f, false);
+        }
+
+        out << ";" << newLine << blankLine;
+        currentProcessor = nullptr;
+    }
+
+    void printProcessorReset (ProcessorInfo& p)
+    {
+        auto& m = *p.module;
+
+        out << "void _reset (double frequency, int32_t instanceID, int32_t sessionID)" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            // These come first, as the initial values of the state variables may depend on them
+            out << "_frequency = frequency;" << newLine
+                << "_period = 1.0 / frequency;" << newLine
+                << "_instanceID = instanceID;" << newLine
+                << "_sessionID = sessionID;" << newLine;
+
+            for (auto& v : m.stateVariables.get())
+            {
+                if (v->isState() && ! v->isExternal())
+                {
+                    auto value = v->initialValue != nullptr ? v->initialValue->getAsConstant() : Value();
+
+                    if (value.isValid() && ! typesAreIdentical (value.getType(), v->type))
+                        value = value.castToTypeWithError (v->type.removeReferenceIfPresent().removeConstIfPresent(), v->location);
+
+                    out << p.variableNames[v.getPointer()] << " = " << getInitialValue (v, value) << ";" << newLine;
+                }
+            }
+
+            for (size_t i = 0; i < m.inputs.size(); ++i)
+                if (! m.inputs[i]->isEventEndpoint())
+                    out << p.inputNames[i] << " = {};" << newLine;
+
+            for (size_t i = 0; i < m.outputs.size(); ++i)
+            {
+                if (m.outputs[i]->isEventEndpoint())
+                    out << p.outputNames[i] << ".numEvents = 0;" << newLine;
+                else
+                    out << p.outputNames[i] << " = {};" << newLine;
+            }
+
+            out << "_resumePoint = 0;" << newLine
+                << "_xruns = 0;" << newLine;
+
+            for (auto& f : p.functions)
+                if (f->functionType.isSystemInit())
+                    out << functionNames[f.getPointer()] << "();" << newLine;
+
+            for (auto& f : p.functions)
+                if (f->functionType.isUserInit())
+                    out << functionNames[f.getPointer()] << "();" << newLine;
+        }
+
+        out << blankLine;
+    }
+
+    void printProcessorRenderFrame (ProcessorInfo& p)
+    {
+        auto& m = *p.module;
+        out << "void _renderFrame()" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            for (size_t i = 0; i < m.outputs.size(); ++i)
+                if (m.outputs[i]->isStreamEndpoint())
+                    out << p.outputNames[i] << " = {};" << newLine;
+
+            for (auto& f : p.functions)
+                if (f->functionType.isRun())
+                    out << functionNames[f.getPointer()] << "();" << newLine;
+        }
+
+        out << blankLine;
+    }
+
+    void printEventWriters (ProcessorInfo& p)
+    {
+        auto& m = *p.module;
+
+        for (size_t i = 0; i < m.outputs.size(); ++i)
+        {
+            auto& output = m.outputs[i].get();
+
+            if (! output.isEventEndpoint())
+                continue;
+
+            for (size_t type = 0; type < output.dataTypes.size(); ++type)
+            {
+                out << "void " << p.eventWriters[i][type] << " (int32_t element, const " << getTypeName (output.dataTypes[type]) << "& value)" << newLine;
+
+                {
+                    auto indent = out.createIndentWithBraces();
+                    auto& queue = p.outputNames[i];
+
+                    out << "if (" << queue << ".numEvents == " << options.eventQueueSize << ") { ++_xruns; return; }" << newLine
+                        << "auto& e = " << queue << ".events[" << queue << ".numEvents++];" << newLine
+                        << "e.typeIndex = " << type << ";" << newLine
+                        << "e.element = element;" << newLine
+                        << "e.value" << type << " = value;" << newLine;
+                }
+
+                out << blankLine;
+            }
+        }
+    }
+
+    //==============================================================================
+    Type getRouteSourceType (const Route& r) const
+    {
+        auto& source = getNodeOutput (r.sourceNode, r.sourceOutput);
+
+        if (source.isEventEndpoint())
+            return {};
+
+        return r.sourceElement >= 0 ? source.dataTypes.front() : source.getFrameOrValueType();
+    }
+
+    Type getRouteDestType (const Route& r) const
+    {
+        auto& dest = getNodeInput (r.destNode, r.destInput);
+        return r.destElement >= 0 ? dest.dataTypes.front() : dest.getFrameOrValueType();
+    }
+
+    bool crossesRates (const Route& r) const
+    {
+        return nodes[r.sourceNode].ratio != nodes[r.destNode].ratio;
+    }
+
+    // A frame of the destination is at position (frame - delay) * numerator / denominator in the source
+    ClockRatio getSourceFramesPerDestFrame (const Route& r) const
+    {
+        auto& source = nodes[r.sourceNode].ratio;
+        auto& dest = nodes[r.destNode].ratio;
+        auto numerator = source.numerator * dest.denominator;
+        auto denominator = source.denominator * dest.numerator;
+        auto divisor = std::gcd (numerator, denominator);
+        return { numerator / divisor, denominator / divisor };
+    }
+
+    // As in the interpreter, only floating-point streams are interpolated, and linear
+    // interpolation is only used when going to a faster rate
+    InterpolationType getInterpolation (const Route& r) const
+    {
+        auto type = getRouteSourceType (r);
+
+        if (! (type.isPrimitiveOrVector() && type.isFloatingPoint()))
+            return InterpolationType::latch;
+
+        if (r.interpolation == InterpolationType::sinc)
+            return InterpolationType::sinc;
+
+        if (r.interpolation == InterpolationType::linear && getSourceFramesPerDestFrame (r).toDouble() < 1.0)
+            return InterpolationType::linear;
+
+        return InterpolationType::latch;
+    }
+
+    bool readsInputFramesDirectly (const Route& r) const
+    {
+        return r.sourceNode == inputBoundary && r.delay == 0 && r.history.empty()
+                && getNodeOutput (r.sourceNode, r.sourceOutput).isStreamEndpoint();
+    }
+
+    // The index of the frame that a node is rendering, counting from the last reset
+    std::string getLocalFrame (uint32_t node) const
+    {
+        auto& ratio = nodes[node].ratio;
+
+        if (ratio.denominator > 1)
+            return "framesRendered / " + std::to_string (ratio.denominator);
+
+        if (ratio.numerator == 1)
+            return "framesRendered";
+
+        auto ticksPerNodeFrame = ticksPerFrame / ratio.numerator;
+
+        return "framesRendered * " + std::to_string (ratio.numerator) + " + tick"
+                 + (ticksPerNodeFrame > 1 ? " / " + std::to_string (ticksPerNodeFrame) : std::string());
+    }
+
+    static std::string addParenthesesIfNeeded (const std::string& expression)
+    {
+        return expression.find (' ') == std::string::npos ? expression : "(" + expression + ")";
+    }
+
+    // The condition for a node to render on the current tick, or an empty string if it renders on every tick
+    std::string getRenderCondition (uint32_t node) const
+    {
+        auto& ratio = nodes[node].ratio;
+
+        if (ratio.denominator > 1)
+            return (ticksPerFrame > 1 ? "tick == 0 && " : "") + ("framesRendered % " + std::to_string (ratio.denominator) + " == 0");
+
+        if (ratio.numerator < ticksPerFrame)
+            return "tick % " + std::to_string (ticksPerFrame / ratio.numerator) + " == 0";
+
+        return {};
+    }
+
+    bool needsFrameCounter() const
+    {
+        for (auto& n : nodes)
+            if (n.ratio != ClockRatio())
+                return true;
+
+        for (auto& r : routes)
+            if (! r.eventDelayLine.empty())
+                return true;
+
+        return false;
+    }
+
+    std::string getRouteSource (const Route& r, bool ignoreDelay = false)
+    {
+        if (! r.history.empty() && ! ignoreDelay)
+            return getResampledRouteSource (r);
+
+        if (r.delay > 0 && ! ignoreDelay)
+            return r.delayLine + ".read()";
+
+        auto& source = getNodeOutput (r.sourceNode, r.sourceOutput);
+        std::string value;
+
+        if (r.sourceNode == inputBoundary)
+            value = source.isStreamEndpoint() ? "inputFrames_" + inputNames[r.sourceOutput] + "[frame]"
+                                              : "inputValue_" + inputNames[r.sourceOutput];
+        else
+            value = nodes[r.sourceNode].memberName + "." + getProcessorInfo (*nodes[r.sourceNode].module).outputNames[r.sourceOutput];
+
+        if (r.sourceElement >= 0)
+            value += ".elements[" + std::to_string (r.sourceElement) + "]";
+
+        return value;
+    }
+
+    std::string getResampledRouteSource (const Route& r)
+    {
+        auto sourceFramesPerDestFrame = getSourceFramesPerDestFrame (r);
+        auto position = getLocalFrame (r.destNode);
+
+        if (r.delay > 0)
+            position += " - " + std::to_string (r.delay);
+
+        if (sourceFramesPerDestFrame.numerator != 1)
+            position = addParenthesesIfNeeded (position) + " * " + std::to_string (sourceFramesPerDestFrame.numerator);
+
+        auto args = position + ", " + std::to_string (sourceFramesPerDestFrame.denominator) + ")";
+
+        switch (getInterpolation (r))
+        {
+            case InterpolationType::sinc:     return r.sincFilter + ".read (" + r.history + ", " + args;
+            case InterpolationType::linear:   return r.history + ".readLinear (" + args;
+            case InterpolationType::latch:
+            case InterpolationType::none:
+            case InterpolationType::fast:
+            case InterpolationType::best:
+            default:                          return r.history + ".readLatched (" + args;
+        }
+    }
+
+    std::string getInputMember (uint32_t node, uint32_t input, int32_t element)
+    {
+        auto value = node == outputBoundary ? "outputFrames_" + outputNames[input] + "[frame]"
+                                            : nodes[node].memberName + "." + getProcessorInfo (*nodes[node].module).inputNames[input];
+
+        if (node == outputBoundary && ! mainModule.outputs[input]->isStreamEndpoint())
+            value = "outputValue_" + outputNames[input];
+
+        if (element >= 0)
+            value += ".elements[" + std::to_string (element) + "]";
+
+        return value;
+    }
+
+    void printInputGathering (uint32_t node)
+    {
+        auto numInputs = node == outputBoundary ? mainModule.outputs.size() : nodes[node].module->inputs.size();
+
+        for (uint32_t i = 0; i < numInputs; ++i)
+        {
+            auto& input = getNodeInput (node, i);
+
+            if (input.isEventEndpoint())
+                continue;
+
+            std::vector<const Route*> inputRoutes;
+
+            for (auto& r : routes)
+                if (r.destNode == node && r.destInput == i)
+                    inputRoutes.push_back (std::addressof (r));
+
+            if (inputRoutes.empty())
+                continue;
+
+            auto dest = getInputMember (node, i, -1);
+
+            auto printConditionally = [&] (const Route& r, const std::string& statement)
+            {
+                if (readsInputFramesDirectly (r))
+                    out << "if (inputFrames_" << inputNames[r.sourceOutput] << " != nullptr) ";
+
+                out << statement << newLine;
+            };
+
+            if (input.isValueEndpoint())
+            {
+                for (auto r : inputRoutes)
+                    printConditionally (*r, getInputMember (node, i, r->destElement) + " = "
+                                              + convert (getRouteSource (*r), getRouteSourceType (*r), getRouteDestType (*r)) + ";");
+
+                continue;
+            }
+
+            auto& first = *inputRoutes.front();
+
+            if (inputRoutes.size() == 1 && first.destElement < 0 && ! readsInputFramesDirectly (first)
+                 && getTypeName (getRouteSourceType (first)) == getTypeName (getRouteDestType (first)))
+            {
+                out << dest << " = " << getRouteSource (first) << ";" << newLine;
+                continue;
+            }
+
+            out << dest << " = {};" << newLine;
+
+            for (auto r : inputRoutes)
+                printConditionally (*r, "Ops::addTo (" + getInputMember (node, i, r->destElement) + ", " + getRouteSource (*r) + ");");
+        }
+    }
+
+    void printDelayLineWrites (uint32_t node)
+    {
+        for (auto& r : routes)
+        {
+            if (r.sourceNode != node || (r.delayLine.empty() && r.history.empty()))
+                continue;
+
+            auto& target = r.history.empty() ? r.delayLine : r.history;
+
+            if (node == inputBoundary && getNodeOutput (node, r.sourceOutput).isStreamEndpoint())
+                out << target << ".write (inputFrames_" << inputNames[r.sourceOutput] << " != nullptr ? "
+                    << getRouteSource (r, true) << " : " << getTypeName (getRouteSourceType (r)) << " {});" << newLine;
+            else
+                out << target << ".write (" << getRouteSource (r, true) << ");" << newLine;
+        }
+    }
+
+    std::string getEventDeliveryFunctionName (uint32_t node, uint32_t input, int32_t typeIndex)
+    {
+        auto& io = getNodeInput (node, input);
+
+        if (node == outputBoundary)
+            return "addOutputEvent_" + outputNames[input] + (io.dataTypes.size() > 1 ? "_" + std::to_string (typeIndex) : std::string());
+
+        return "deliver_" + nodes[node].memberName.substr (5) + "_" + io.name.toString() + "_" + std::to_string (typeIndex);
+    }
+
+    void printEventDeliveryFunctions()
+    {
+        for (uint32_t n = 0; n < nodes.size(); ++n)
+        {
+            if (nodes[n].module == nullptr)
+                continue;
+
+            auto& p = getProcessorInfo (*nodes[n].module);
+
+            for (uint32_t i = 0; i < nodes[n].module->inputs.size(); ++i)
+            {
+                auto& input = nodes[n].module->inputs[i].get();
+
+                for (size_t type = 0; type < p.eventHandlers[i].size(); ++type)
+                {
+                    if (type != 0)
+                        out << blankLine;
+
+                    out << "void " << getEventDeliveryFunctionName (n, i, (int32_t) type) << " (int32_t element, "
+                        << getTypeName (input.dataTypes[type]) << " value)" << newLine;
+
+                    auto indent = out.createIndentWithBraces();
+                    auto& handler = p.eventHandlers[i][type];
+
+                    if (! handler.has_value())
+                    {
+                        out << "(void) element; (void) value;" << newLine;
+                    }
+                    else if (! handler->hasIndex)
+                    {
+                        out << "(void) element;" << newLine
+                            << nodes[n].memberName << "." << handler->functionName << " (value);" << newLine;
+                    }
+                    else
+                    {
+                        auto arraySize = input.arraySize.value_or (1);
+
+                        if (arraySize > 1)
+                        {
+                            out << "if (element < 0)" << newLine;
+
+                            {
+                                auto loopIndent = out.createIndentWithBraces();
+                                out << "for (int32_t i = 0; i < " << arraySize << "; ++i)" << newLine
+                                    << "    " << nodes[n].memberName << "." << handler->functionName << " (i, value);" << newLine
+                                    << blankLine
+                                    << "return;" << newLine;
+                            }
+
+                            out << blankLine;
+                        }
+
+                        out << nodes[n].memberName << "." << handler->functionName << " (element < 0 ? 0 : element, value);" << newLine;
+                    }
+                }
+
+                out << blankLine;
+            }
+        }
+    }
+
+    void printEventRoute (const Route& r, const std::string& event)
+    {
+        auto& source = getNodeOutput (r.sourceNode, r.sourceOutput);
+        auto& dest = getNodeInput (r.destNode, r.destInput);
+
+        auto element = r.destElement >= 0 ? std::to_string (r.destElement)
+                                          : (r.sourceElement >= 0 ? std::string ("-1") : event + ".element");
+
+        for (size_t type = 0; type < source.dataTypes.size(); ++type)
+        {
+            auto destType = r.typeMap[type];
+
+            if (destType < 0)
+                continue;
+
+            std::string condition;
+
+            if (source.dataTypes.size() > 1)
+                condition = event + ".typeIndex == " + std::to_string (type);
+
+            if (r.sourceElement >= 0)
+                condition += (condition.empty() ? "" : " && ") + ("(" + event + ".element < 0 || " + event + ".element == " + std::to_string (r.sourceElement) + ")");
+
+            if (! condition.empty())
+                out << "if (" << condition << ") ";
+
+            out << getEventDeliveryFunctionName (r.destNode, r.destInput, destType) << " ("
+                << element << ", " << convert (event + ".value" + std::to_string (type), source.dataTypes[type], dest.dataTypes[(size_t) destType])
+                << ");" << newLine;
+        }
+    }
+
+    static std::string getDelayedEventFields (const heart::IODeclaration& source, const std::string& event)
+    {
+        auto fields = event + ".typeIndex, " + event + ".element";
+
+        for (size_t type = 0; type < source.dataTypes.size(); ++type)
+            fields += ", " + event + ".value" + std::to_string (type);
+
+        return fields;
+    }
+
+    // As in the interpreter, an event is due on the destination's frame at the same time
+    // as the source frame that sent it, plus the delay
+    void printDelayedEventPush (const Route& r, const std::string& event)
+    {
+        auto sourceFramesPerDestFrame = getSourceFramesPerDestFrame (r);
+        auto frame = getLocalFrame (r.sourceNode);
+
+        if (sourceFramesPerDestFrame.denominator != 1)
+            frame = addParenthesesIfNeeded (frame) + " * " + std::to_string (sourceFramesPerDestFrame.denominator);
+
+        if (sourceFramesPerDestFrame.numerator != 1)
+            frame = addParenthesesIfNeeded (frame) + " / " + std::to_string (sourceFramesPerDestFrame.numerator);
+
+        out << "if (! " << r.eventDelayLine << ".push (" << event << ", " << frame << " + " << r.delay << ")) ++xruns;" << newLine;
+    }
+
+    void printDelayedEventDelivery (uint32_t node)
+    {
+        for (auto& r : routes)
+        {
+            if (r.destNode == node && ! r.eventDelayLine.empty())
+            {
+                out << r.eventDelayLine << ".deliver (" << getLocalFrame (node) << ", [this] (const " << r.delayedEventType << "& e)" << newLine;
+
+                {
+                    auto indent = out.createIndentWithBraces();
+                    printEventRoute (r, "e");
+                }
+
+                out << ");" << newLine;
+            }
+        }
+    }
+
+    void printEventFlushing (uint32_t node)
+    {
+        auto& module = *nodes[node].module;
+        auto& p = getProcessorInfo (module);
+
+        for (uint32_t o = 0; o < module.outputs.size(); ++o)
+        {
+            if (! module.outputs[o]->isEventEndpoint())
+                continue;
+
+            auto queue = nodes[node].memberName + "." + p.outputNames[o];
+            std::vector<const Route*> outputRoutes;
+
+            for (auto& r : routes)
+                if (r.sourceNode == node && r.sourceOutput == o)
+                    outputRoutes.push_back (std::addressof (r));
+
+            if (! outputRoutes.empty())
+            {
+                out << blankLine
+                    << "for (uint32_t i = 0; i < " << queue << ".numEvents; ++i)" << newLine;
+
+                auto indent = out.createIndentWithBraces();
+                out << "auto& e = " << queue << ".events[i];" << newLine;
+
+                for (auto r : outputRoutes)
+                {
+                    if (r->eventDelayLine.empty())
+                        printEventRoute (*r, "e");
+                    else
+                        printDelayedEventPush (*r, "{ " + getDelayedEventFields (module.outputs[o], "e") + " }");
+                }
+            }
+
+            out << blankLine
+                << queue << ".numEvents = 0;" << newLine;
+        }
+    }
+
+    void printPublicFunctions()
+    {
+        out << sectionBreak
+            << "/** Prepares the processor to render at the given sample rate, and resets its state. */" << newLine
+            << "void init (double newSampleRate, int32_t newSessionID = 0)" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+            out << "sampleRate = newSampleRate;" << newLine
+                << "sessionID = newSessionID;" << newLine;
+
+            for (auto& r : routes)
+            {
+                if (! r.sincFilter.empty())
+                {
+                    auto cutoff = SincFilterBank<double>::getCutoff (1.0 / getSourceFramesPerDestFrame (r).toDouble());
+                    out << r.sincFilter << ".initialise (" << getFloatLiteral (cutoff, false) << ", " << FlattenedGraph::numSincZeroCrossings << ");" << newLine;
+                }
+            }
+
+            out << "reset();" << newLine;
+        }
+
+        out << blankLine
+            << "/** Returns all the processors to their initial state. */" << newLine
+            << "void reset()" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            for (auto& n : nodes)
+                if (n.module != nullptr)
+                    out << n.memberName << "._reset (" << getSampleRate (n.ratio) << ", " << n.instanceID << ", sessionID);" << newLine;
+
+            for (auto& r : routes)
+            {
+                if (! r.delayLine.empty())          out << r.delayLine << " = {};" << newLine;
+                if (! r.history.empty())            out << r.history << " = {};" << newLine;
+                if (! r.eventDelayLine.empty())     out << r.eventDelayLine << " = {};" << newLine;
+            }
+
+            for (size_t i = 0; i < mainModule.inputs.size(); ++i)
+                if (mainModule.inputs[i]->isValueEndpoint())
+                    out << "inputValue_" << inputNames[i] << " = {};" << newLine;
+
+            for (size_t i = 0; i < mainModule.outputs.size(); ++i)
+            {
+                auto& output = mainModule.outputs[i].get();
+
+                if (output.isEventEndpoint())       out << "numOutputEvents_" << outputNames[i] << " = 0;" << newLine;
+                else if (output.isValueEndpoint())  out << "outputValue_" << outputNames[i] << " = {};" << newLine;
+            }
+
+            out << "xruns = 0;" << newLine;
+
+            if (needsFrameCounter())
+                out << "framesRendered = 0;" << newLine;
+        }
+
+        out << blankLine
+            << "/** Renders a block of frames, which must be no longer than maxBlockSize. */" << newLine
+            << "void render (uint32_t numFrames)" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+
+            out << "if (numFrames > maxBlockSize)" << newLine
+                << "    numFrames = maxBlockSize;" << newLine
+                << blankLine;
+
+            for (size_t i = 0; i < mainModule.outputs.size(); ++i)
+                if (mainModule.outputs[i]->isEventEndpoint())
+                    out << "numOutputEvents_" << outputNames[i] << " = 0;" << newLine;
+
+            out << blankLine
+                << "for (uint32_t frame = 0; frame < numFrames; ++frame)" << newLine;
+
+            {
+                auto loopIndent = out.createIndentWithBraces();
+                out << "currentFrame = frame;" << newLine;
+                printDelayLineWrites (inputBoundary);
+
+                if (ticksPerFrame > 1)
+                {
+                    out << blankLine
+                        << "for (uint32_t tick = 0; tick < " << ticksPerFrame << "; ++tick)" << newLine;
+
+                    auto tickIndent = out.createIndentWithBraces();
+                    printTick();
+                }
+                else
+                {
+                    printTick();
+                }
+
+                if (needsFrameCounter())
+                    out << blankLine
+                        << "++framesRendered;" << newLine;
+            }
+
+            out << newLine;
+        }
+
+        out << blankLine
+            << "/** Returns the number of events that have been dropped because a queue was full. */" << newLine
+            << "uint32_t getXRuns() const" << newLine;
+
+        {
+            auto indent = out.createIndentWithBraces();
+            out << "return xruns";
+
+            for (auto& n : nodes)
+                if (n.module != nullptr)
+                    out << " + " << n.memberName << "._xruns";
+
+            out << ";" << newLine;
+        }
+
+        out << blankLine;
+        printEndpointFunctions();
+        out << sectionBreak;
+        printEventDeliveryFunctions();
+    }
+
+    // Prints the code which renders each node that falls due on one tick of a frame, followed by
+    // the main outputs, which are always due on the first tick
+    void printTick()
+    {
+        auto printWithCondition = [this] (const std::string& condition, auto&& printContent)
+        {
+            if (condition.empty())
+                return printContent();
+
+            out << "if (" << condition << ")" << newLine;
+            auto indent = out.createIndentWithBraces();
+            printContent();
+        };
+
+        for (auto n : processingOrder)
+        {
+            if (nodes[n].module == nullptr)
+                continue;
+
+            out << blankLine;
+
+            printWithCondition (getRenderCondition (n), [this, n]
+            {
+                printDelayedEventDelivery (n);
+                printInputGathering (n);
+                out << nodes[n].memberName << "._renderFrame();" << newLine;
+                printDelayLineWrites (n);
+                printEventFlushing (n);
+            });
+        }
+
+        out << blankLine;
+
+        printWithCondition (getRenderCondition (outputBoundary), [this]
+        {
+            printDelayedEventDelivery (outputBoundary);
+            printInputGathering (outputBoundary);
+        });
+
+        for (auto& r : routes)
+        {
+            if (! r.delayLine.empty())
+            {
+                auto condition = getRenderCondition (r.destNode);
+
+                if (! condition.empty())
+                    out << "if (" << condition << ") ";
+
+                out << r.delayLine << ".advance();" << newLine;
+            }
+        }
+    }
+
+    static std::string getSampleRate (ClockRatio ratio)
+    {
+        if (ratio.numerator > 1)    return "sampleRate * " + std::to_string (ratio.numerator);
+        if (ratio.denominator > 1)  return "sampleRate / " + std::to_string (ratio.denominator);
+
+        return "sampleRate";
+    }
+
+    void printEndpointFunctions()
+    {
+        for (size_t i = 0; i < mainModule.inputs.size(); ++i)
+        {
+            auto& input = mainModule.inputs[i].get();
+            auto& name = inputNames[i];
+
+            out << sectionBreak;
+
+            if (input.isStreamEndpoint())
+            {
+                out << "/** Sets the frames which the next render() call will read from the " << input.name.toString() << " input. */" << newLine
+                    << "void setInputStreamFrames_" << name << " (const " << getTypeName (input.getFrameType()) << "* frames)"
+                    << "    { inputFrames_" << name << " = frames; }" << newLine;
+            }
+            else if (input.isValueEndpoint())
+            {
+                out << "void setInputValue_" << name << " (const " << getTypeName (input.getValueType()) << "& value)"
+                    << "    { inputValue_" << name << " = value; }" << newLine;
+            }
+            else
+            {
+                out << "/** Sends an event to the " << input.name.toString() << " input, which will arrive before the next frame is rendered. */" << newLine;
+
+                for (size_t type = 0; type < input.dataTypes.size(); ++type)
+                {
+                    out << "void addInputEvent_" << name << " (const " << getTypeName (input.dataTypes[type]) << "& value)" << newLine;
+                    auto indent = out.createIndentWithBraces();
+                    bool anyRoutes = false;
+
+                    for (auto& r : routes)
+                    {
+                        if (r.sourceNode == inputBoundary && r.sourceOutput == i && ! r.eventDelayLine.empty())
+                        {
+                            auto fields = std::to_string (type) + ", -1";
+
+                            for (size_t t = 0; t < input.dataTypes.size(); ++t)
+                                fields += t == type ? ", value" : ", {}";
+
+                            printDelayedEventPush (r, r.delayedEventType + " { " + fields + " }");
+                            anyRoutes = true;
+                        }
+                        else if (r.sourceNode == inputBoundary && r.sourceOutput == i && r.typeMap[type] >= 0)
+                        {
+                            auto& dest = getNodeInput (r.destNode, r.destInput);
+                            out << getEventDeliveryFunctionName (r.destNode, r.destInput, r.typeMap[type]) << " ("
+                                << (r.destElement >= 0 ? std::to_string (r.destElement) : std::string ("-1")) << ", "
+                                << convert ("value", input.dataTypes[type], dest.dataTypes[(size_t) r.typeMap[type]]) << ");" << newLine;
+                            anyRoutes = true;
+                        }
+                    }
+
+                    if (! anyRoutes)
+                        out << "(void) value;" << newLine;
+                }
+
+                out << blankLine;
+            }
+        }
+
+        for (size_t i = 0; i < mainModule.outputs.size(); ++i)
+        {
+            auto& output = mainModule.outputs[i].get();
+            auto& name = outputNames[i];
+
+            out << sectionBreak;
+
+            if (output.isStreamEndpoint())
+            {
+                out << "/** Returns the frames which the last render() call wrote to the " << output.name.toString() << " output. */" << newLine
+                    << "const " << getTypeName (output.getFrameType()) << "* getOutputStreamFrames_" << name << "() const"
+                    << "    { return outputFrames_" << name << "; }" << newLine;
+            }
+            else if (output.isValueEndpoint())
+            {
+                out << "const " << getTypeName (output.getValueType()) << "& getOutputValue_" << name << "() const"
+                    << "    { return outputValue_" << name << "; }" << newLine;
+            }
+            else
+            {
+                auto eventType = "OutputEvent_" + name;
+                bool singleType = output.dataTypes.size() == 1;
+
+                out << "struct " << eventType << newLine;
+
+                {
+                    auto indent = out.createIndentWithBraces();
+                    out << "uint32_t frame, typeIndex;" << newLine;
+
+                    for (size_t type = 0; type < output.dataTypes.size(); ++type)
+                        out << getTypeName (output.dataTypes[type]) << " value" << (singleType ? std::string() : std::to_string (type)) << ";" << newLine;
+                }
+
+                out << ";" << newLine
+                    << blankLine
+                    << "/** Returns the number of events which the last render() call sent to the " << output.name.toString() << " output. */" << newLine
+                    << "uint32_t getNumOutputEvents_" << name << "() const" << "    { return numOutputEvents_" << name << "; }" << newLine
+                    << "const " << eventType << "& getOutputEvent_" << name << " (uint32_t index) const"
+                    << "    { return outputEvents_" << name << "[index]; }" << newLine
+                    << blankLine;
+
+                for (size_t type = 0; type < output.dataTypes.size(); ++type)
+                {
+                    if (type != 0)
+                        out << blankLine;
+
+                    out << "void " << getEventDeliveryFunctionName (outputBoundary, (uint32_t) i, (int32_t) type) << " (int32_t, const "
+                        << getTypeName (output.dataTypes[type]) << "& value)" << newLine;
+
+                    auto indent = out.createIndentWithBraces();
+                    out << "if (numOutputEvents_" << name << " == maxOutputEvents) { ++xruns; return; }" << newLine
+                        << "auto& e = outputEvents_" << name << "[numOutputEvents_" << name << "++];" << newLine
+                        << "e.frame = currentFrame;" << newLine
+                        << "e.typeIndex = " << type << ";" << newLine
+                        << "e.value" << (singleType ? std::string() : std::to_string (type)) << " = value;" << newLine;
+                }
+
+                out << blankLine;
+            }
+        }
+    }
+
+    void printMembers()
+    {
+        out << sectionBreak;
+
+        for (auto& n : nodes)
+            if (n.module != nullptr)
+                out << getProcessorInfo (*n.module).structName << " " << n.memberName << ";" << newLine;
+
+        out << blankLine;
+
+        for (auto& d : routeStateDeclarations)
+            out << d << ";" << newLine;
+
+        out << blankLine;
+
+        for (size_t i = 0; i < mainModule.inputs.size(); ++i)
+        {
+            auto& input = mainModule.inputs[i].get();
+
+            if (input.isStreamEndpoint())
+                out << "const " << getTypeName (input.getFrameType()) << "* inputFrames_" << inputNames[i] << " = nullptr;" << newLine;
+            else if (input.isValueEndpoint())
+                out << getTypeName (input.getValueType()) << " inputValue_" << inputNames[i] << " {};" << newLine;
+        }
+
+        for (size_t i = 0; i < mainModule.outputs.size(); ++i)
+        {
+            auto& output = mainModule.outputs[i].get();
+
+            if (output.isStreamEndpoint())
+                out << getTypeName (output.getFrameType()) << " outputFrames_" << outputNames[i] << "[maxBlockSize] {};" << newLine;
+            else if (output.isValueEndpoint())
+                out << getTypeName (output.getValueType()) << " outputValue_" << outputNames[i] << " {};" << newLine;
+            else
+                out << "OutputEvent_" << outputNames[i] << " outputEvents_" << outputNames[i] << "[maxOutputEvents];" << newLine
+                    << "uint32_t numOutputEvents_" << outputNames[i] << " = 0;" << newLine;
+        }
+
+        out << blankLine
+            << "double sampleRate = 44100.0;" << newLine
+            << "int32_t sessionID = 0;" << newLine
+            << "uint32_t currentFrame = 0, xruns = 0;" << newLine;
+
+        if (needsFrameCounter())
+            out << "int64_t framesRendered = 0;" << newLine;
+    }
+
+    //==============================================================================
+    void printOps()
+    {
+        out << R"(template <typename ElementType, int length>
+struct DelayLine
+{
+    const ElementType& read() const         { return buffer[position == length ? 0 : position + 1]; }
+    void write (const ElementType& value)   { buffer[position] = value; }
+    void advance()                          { position = (position == length ? 0 : position + 1); }
+
+    ElementType buffer[length + 1];
+    int position;
+};
+
+/* These helpers implement SOUL's operators and intrinsics, applying them element-by-element
+   to vectors and arrays. Integer arithmetic wraps around, and division by zero returns zero.
+*/
+struct Ops
+{
+    template <typename Type> static constexpr auto getKind (int) -> decltype (Type::kind, 0)          { return Type::kind; }
+    template <typename Type> static constexpr int getKind (long)                                      { return 0; }
+    template <typename Type> static constexpr auto getNumElements (int) -> decltype (Type::numElements, 0)  { return Type::numElements; }
+    template <typename Type> static constexpr int getNumElements (long)                               { return 1; }
+    template <typename Type> static constexpr bool isSized = getKind<Type> (0) == 1 || getKind<Type> (0) == 2;
+    template <typename Type> static constexpr bool isInteger = std::is_integral<Type>::value && ! std::is_same<Type, bool>::value;
+    template <typename Type> using Unsigned = typename std::make_unsigned<Type>::type;
+
+    template <typename Type, typename Fn>
+    static auto map (const Type& a, Fn&& fn)
+    {
+        if constexpr (isSized<Type>)
+        {
+            typename Type::template WithElementType<decltype (map (a.elements[0], fn))> result;
+
+            for (int i = 0; i < Type::numElements; ++i)
+                result.elements[i] = map (a.elements[i], fn);
+
+            return result;
+        }
+        else
+        {
+            return fn (a);
+        }
+    }
+
+    template <typename Type, typename Fn>
+    static auto map (const Type& a, const Type& b, Fn&& fn)
+    {
+        if constexpr (isSized<Type>)
+        {
+            typename Type::template WithElementType<decltype (map (a.elements[0], b.elements[0], fn))> result;
+
+            for (int i = 0; i < Type::numElements; ++i)
+                result.elements[i] = map (a.elements[i], b.elements[i], fn);
+
+            return result;
+        }
+        else
+        {
+            return fn (a, b);
+        }
+    }
+
+    template <typename Dest, typename Source>
+    static Dest convert (const Source& source)
+    {
+        if constexpr (std::is_same<Dest, Source>::value)
+        {
+            return source;
+        }
+        else if constexpr (std::is_arithmetic<Dest>::value && std::is_arithmetic<Source>::value)
+        {
+            if constexpr (std::is_same<Dest, bool>::value)
+                return source != 0;
+            else
+                return static_cast<Dest> (source);
+        }
+        else if constexpr (getKind<Dest> (0) == 3 && getKind<Source> (0) == 2)
+        {
+            return { const_cast<typename Source::Element*> (source.elements), Source::numElements };
+        }
+        else if constexpr (isSized<Dest> && std::is_arithmetic<Source>::value)
+        {
+            Dest result;
+
+            for (auto& e : result.elements)
+                e = convert<typename Dest::Element> (source);
+
+            return result;
+        }
+        else if constexpr (std::is_arithmetic<Dest>::value && isSized<Source>)
+        {
+            return convert<Dest> (source.elements[0]);
+        }
+        else if constexpr (isSized<Dest> && isSized<Source> && getNumElements<Dest> (0) == getNumElements<Source> (0))
+        {
+            Dest result;
+
+            for (int i = 0; i < getNumElements<Dest> (0); ++i)
+                result.elements[i] = convert<typename Dest::Element> (source.elements[i]);
+
+            return result;
+        }
+        else
+        {
+            static_assert (sizeof (Dest) == sizeof (Source), "Incompatible types");
+            Dest result;
+            std::memcpy (&result, &source, sizeof (Dest));
+            return result;
+        }
+    }
+
+    template <typename IndexType>
+    static int32_t index (IndexType i, int32_t size) noexcept
+    {
+        if (size <= 0)
+            return 0;
+
+        auto n = static_cast<int32_t> (i % static_cast<IndexType> (size));
+        return n < 0 ? n + size : n;
+    }
+
+    template <int start, int count, typename Type>
+    static auto slice (const Type& source)
+    {
+        if constexpr (getKind<Type> (0) == 3)
+        {
+            FixedArray<typename Type::Element, count> result;
+
+            for (int i = 0; i < count; ++i)
+                result.elements[i] = source.elements[index (start + i, source.numElements)];
+
+            return result;
+        }
+        else
+        {
+            typename Type::template WithSize<count> result;
+
+            for (int i = 0; i < count; ++i)
+                result.elements[i] = source.elements[start + i];
+
+            return result;
+        }
+    }
+
+    template <int start, typename Type, typename Source>
+    static void setSlice (Type& dest, const Source& source)
+    {
+        for (int i = 0; i < Source::numElements; ++i)
+            dest.elements[start + i] = source.elements[i];
+    }
+
+    template <typename Type>
+    static void addTo (Type& dest, const Type& source)                  { dest = add (dest, source); }
+
+    template <typename Type, typename Source>
+    static void addTo (Type& dest, const Source& source)                { dest = add (dest, convert<Type> (source)); }
+
+    template <typename Type>
+    static auto add (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); if constexpr (isInteger<T>) return (T) ((Unsigned<T>) x + (Unsigned<T>) y); else return (T) (x + y); });
+    }
+
+    template <typename Type>
+    static auto subtract (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); if constexpr (isInteger<T>) return (T) ((Unsigned<T>) x - (Unsigned<T>) y); else return (T) (x - y); });
+    }
+
+    template <typename Type>
+    static auto multiply (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); if constexpr (isInteger<T>) return (T) ((Unsigned<T>) x * (Unsigned<T>) y); else return (T) (x * y); });
+    }
+
+    template <typename Type>
+    static auto divide (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y)
+        {
+            using T = decltype (x);
+
+            if constexpr (isInteger<T>)
+            {
+                if (y == 0)   return (T) 0;
+                if (y == -1)  return (T) (Unsigned<T> (0) - (Unsigned<T>) x);
+            }
+
+            return (T) (x / y);
+        });
+    }
+
+    template <typename Type>
+    static auto modulo (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y)
+        {
+            using T = decltype (x);
+
+            if constexpr (isInteger<T>)
+                return (y == 0 || y == -1) ? (T) 0 : (T) (x % y);
+            else
+                return (T) std::fmod (x, y);
+        });
+    }
+
+    template <typename Type>
+    static auto negate (const Type& a)
+    {
+        return map (a, [] (auto x) { using T = decltype (x); if constexpr (isInteger<T>) return (T) (Unsigned<T> (0) - (Unsigned<T>) x); else return (T) -x; });
+    }
+
+    template <typename Type> static auto bitwiseAnd (const Type& a, const Type& b)   { return map (a, b, [] (auto x, auto y) { return (decltype (x)) (x & y); }); }
+    template <typename Type> static auto bitwiseOr  (const Type& a, const Type& b)   { return map (a, b, [] (auto x, auto y) { return (decltype (x)) (x | y); }); }
+    template <typename Type> static auto bitwiseXor (const Type& a, const Type& b)   { return map (a, b, [] (auto x, auto y) { return (decltype (x)) (x ^ y); }); }
+    template <typename Type> static auto bitwiseNot (const Type& a)                  { return map (a, [] (auto x) { return (decltype (x)) ~x; }); }
+
+    template <typename Type>
+    static auto leftShift (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); return (y >= 0 && y < (T) (sizeof (T) * 8)) ? (T) (((Unsigned<T>) x) << y) : (T) 0; });
+    }
+
+    template <typename Type>
+    static auto rightShift (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); return (y >= 0 && y < (T) (sizeof (T) * 8)) ? (T) (x >> y) : (T) (x >= 0 ? 0 : -1); });
+    }
+
+    template <typename Type>
+    static auto rightShiftUnsigned (const Type& a, const Type& b)
+    {
+        return map (a, b, [] (auto x, auto y) { using T = decltype (x); return (y >= 0 && y < (T) (sizeof (T) * 8)) ? (T) (((Unsigned<T>) x) >> y) : (T) 0; });
+    }
+
+    template <typename Type> static auto logicalAnd (const Type& a, const Type& b)          { return map (a, b, [] (bool x, bool y) { return x && y; }); }
+    template <typename Type> static auto logicalOr  (const Type& a, const Type& b)          { return map (a, b, [] (bool x, bool y) { return x || y; }); }
+    template <typename Type> static auto logicalNot (const Type& a)                         { return map (a, [] (bool x) { return ! x; }); }
+    template <typename Type> static auto equals (const Type& a, const Type& b)              { return map (a, b, [] (auto x, auto y) { return x == y; }); }
+    template <typename Type> static auto notEquals (const Type& a, const Type& b)           { return map (a, b, [] (auto x, auto y) { return x != y; }); }
+    template <typename Type> static auto lessThan (const Type& a, const Type& b)            { return map (a, b, [] (auto x, auto y) { return x < y; }); }
+    template <typename Type> static auto lessThanOrEqual (const Type& a, const Type& b)     { return map (a, b, [] (auto x, auto y) { return x <= y; }); }
+    template <typename Type> static auto greaterThan (const Type& a, const Type& b)         { return map (a, b, [] (auto x, auto y) { return x > y; }); }
+    template <typename Type> static auto greaterThanOrEqual (const Type& a, const Type& b)  { return map (a, b, [] (auto x, auto y) { return x >= y; }); }
+
+    template <typename Type> static auto min (const Type& a, const Type& b)         { return map (a, b, [] (auto x, auto y) { return x < y ? x : y; }); }
+    template <typename Type> static auto max (const Type& a, const Type& b)         { return map (a, b, [] (auto x, auto y) { return x > y ? x : y; }); }
+    template <typename Type> static auto abs (const Type& a)                        { return map (a, [] (auto x) { return x < 0 ? negate (x) : x; }); }
+    template <typename Type> static Type clamp (Type n, Type low, Type high)        { return n < low ? low : (n > high ? high : n); }
+
+    template <typename Type>
+    static Type wrap (Type n, Type range)
+    {
+        if (range == 0)
+            return 0;
+
+        auto x = modulo (n, range);
+        return x < 0 ? x + range : x;
+    }
+
+    template <typename Type> static auto pow (const Type& a, const Type& b)         { return map (a, b, [] (auto x, auto y) { return std::pow (x, y); }); }
+    template <typename Type> static auto atan2 (const Type& a, const Type& b)       { return map (a, b, [] (auto x, auto y) { return std::atan2 (x, y); }); }
+    template <typename Type> static auto fmod (const Type& a, const Type& b)        { return map (a, b, [] (auto x, auto y) { return y != 0 ? std::fmod (x, y) : 0; }); }
+    template <typename Type> static auto remainder (const Type& a, const Type& b)   { return map (a, b, [] (auto x, auto y) { return y != 0 ? std::remainder (x, y) : 0; }); }
+
+    template <typename Type> static auto sqrt (const Type& a)     { return map (a, [] (auto x) { return std::sqrt (x); }); }
+    template <typename Type> static auto exp (const Type& a)      { return map (a, [] (auto x) { return std::exp (x); }); }
+    template <typename Type> static auto log (const Type& a)      { return map (a, [] (auto x) { return std::log (x); }); }
+    template <typename Type> static auto log10 (const Type& a)    { return map (a, [] (auto x) { return std::log10 (x); }); }
+    template <typename Type> static auto sin (const Type& a)      { return map (a, [] (auto x) { return std::sin (x); }); }
+    template <typename Type> static auto cos (const Type& a)      { return map (a, [] (auto x) { return std::cos (x); }); }
+    template <typename Type> static auto tan (const Type& a)      { return map (a, [] (auto x) { return std::tan (x); }); }
+    template <typename Type> static auto sinh (const Type& a)     { return map (a, [] (auto x) { return std::sinh (x); }); }
+    template <typename Type> static auto cosh (const Type& a)     { return map (a, [] (auto x) { return std::cosh (x); }); }
+    template <typename Type> static auto tanh (const Type& a)     { return map (a, [] (auto x) { return std::tanh (x); }); }
+    template <typename Type> static auto asinh (const Type& a)    { return map (a, [] (auto x) { return std::asinh (x); }); }
+    template <typename Type> static auto acosh (const Type& a)    { return map (a, [] (auto x) { return std::acosh (x); }); }
+    template <typename Type> static auto atanh (const Type& a)    { return map (a, [] (auto x) { return std::atanh (x); }); }
+    template <typename Type> static auto asin (const Type& a)     { return map (a, [] (auto x) { return std::asin (x); }); }
+    template <typename Type> static auto acos (const Type& a)     { return map (a, [] (auto x) { return std::acos (x); }); }
+    template <typename Type> static auto atan (const Type& a)     { return map (a, [] (auto x) { return std::atan (x); }); }
+    template <typename Type> static auto floor (const Type& a)    { return map (a, [] (auto x) { return std::floor (x); }); }
+    template <typename Type> static auto ceil (const Type& a)     { return map (a, [] (auto x) { return std::ceil (x); }); }
+    template <typename Type> static auto isnan (const Type& a)    { return map (a, [] (auto x) { return std::isnan (x); }); }
+    template <typename Type> static auto isinf (const Type& a)    { return map (a, [] (auto x) { return std::isinf (x); }); }
+};
+)";
+
+        bool needsHistory = false, needsSincFilter = false, needsEventDelayLine = false;
+
+        for (auto& r : routes)
+        {
+            needsHistory        = needsHistory || ! r.history.empty();
+            needsSincFilter     = needsSincFilter || ! r.sincFilter.empty();
+            needsEventDelayLine = needsEventDelayLine || ! r.eventDelayLine.empty();
+        }
+
+        if (needsHistory)
+            out << blankLine << R"(/* Holds the most recent frames of a stream which is read at a different rate. Positions are
+   given as a fraction of a source frame. A frame can't be read before it's been rendered,
+   so linear interpolation runs one frame behind, between the last two frames written.
+*/
+template <typename FrameType, int size>
+struct StreamHistory
+{
+    void write (const FrameType& frame)     { frames[numWritten++ & (size - 1)] = frame; }
+
+    FrameType read (int64_t frame) const
+    {
+        if (frame < 0 || frame >= numWritten || frame < numWritten - size)
+            return {};
+
+        return frames[frame & (size - 1)];
+    }
+
+    FrameType readLatched (int64_t positionNumerator, int64_t positionDenominator) const
+    {
+        return read (positionNumerator >= 0 ? positionNumerator / positionDenominator : -1);
+    }
+
+    FrameType readLinear (int64_t positionNumerator, int64_t positionDenominator) const
+    {
+        auto position = positionNumerator - positionDenominator;
+        auto frame = (position >= 0 ? position : position - positionDenominator + 1) / positionDenominator;
+        auto fraction = (double) (position - frame * positionDenominator) / (double) positionDenominator;
+
+        return Ops::map (read (frame), read (frame + 1), [fraction] (auto a, auto b) { return static_cast<decltype (a)> (a + (b - a) * fraction); });
+    }
+
+    FrameType frames[size];
+    int64_t numWritten;
+};
+)";
+
+        if (needsSincFilter)
+            out << blankLine << R"(/* A polyphase bank of windowed-sinc kernels for resampling a floating-point stream, matching
+   the one that the interpreter uses. It reads from half a kernel behind the position that
+   it's given, so that all the frames it needs have already been rendered.
+*/
+template <int halfLength, int numPhases>
+struct SincFilter
+{
+    static constexpr int kernelSize = (2 * halfLength + 3) / 4 * 4;
+
+    void initialise (double cutoff, int numZeroCrossings)
+    {
+        for (int phase = 0; phase <= numPhases; ++phase)
+        {
+            for (int i = 0; i < kernelSize; ++i)
+            {
+                auto distance = (i - halfLength + 1) - phase / (double) numPhases;
+                kernels[phase][i] = i < 2 * halfLength ? cutoff * windowedSinc (cutoff * distance, numZeroCrossings) : 0;
+            }
+        }
+    }
+
+    template <typename FrameType, int historySize>
+    FrameType read (const StreamHistory<FrameType, historySize>& history, int64_t positionNumerator, int64_t positionDenominator) const
+    {
+        auto position = (double) positionNumerator / (double) positionDenominator - halfLength;
+        auto base = std::floor (position);
+        auto firstFrame = (int64_t) base - halfLength + 1;
+        auto phasePosition = (position - base) * numPhases;
+        auto phase = std::min ((int) phasePosition, numPhases - 1);
+        auto proportion = phasePosition - phase;
+
+        FrameType window[kernelSize], result {};
+
+        for (int i = 0; i < kernelSize; ++i)
+            window[i] = history.read (firstFrame + i);
+
+        for (int element = 0; element < Ops::getNumElements<FrameType> (0); ++element)
+        {
+            double sum1 = 0, sum2 = 0;
+
+            for (int i = 0; i < kernelSize; ++i)
+            {
+                auto sample = (double) getElement (window[i], element);
+                sum1 += sample * kernels[phase][i];
+                sum2 += sample * kernels[phase + 1][i];
+            }
+
+            auto& dest = getElement (result, element);
+            dest = static_cast<std::remove_reference_t<decltype (dest)>> (sum1 + proportion * (sum2 - sum1));
+        }
+
+        return result;
+    }
+
+    template <typename FrameType>
+    static auto& getElement (FrameType& frame, int index)
+    {
+        if constexpr (Ops::isSized<FrameType>)
+            return frame.elements[index];
+        else
+            return frame;
+    }
+
+    static double windowedSinc (double f, int numZeroCrossings)
+    {
+        if (f == 0)
+            return 1.0;
+
+        if (f > numZeroCrossings || f < -numZeroCrossings)
+            return 0;
+
+        f *= 3.141592653589793238;
+        auto window = 0.5 + 0.5 * std::cos (f / numZeroCrossings);
+        return window * std::sin (f) / f;
+    }
+
+    double kernels[numPhases + 1][kernelSize];
+};
+)";
+
+        if (needsEventDelayLine)
+            out << blankLine << R"(/* Holds the events on a delayed connection until the frame of the destination that they're due on. */
+template <typename EventType, int capacity>
+struct EventDelayLine
+{
+    bool push (const EventType& event, int64_t frame)
+    {
+        if (numEvents == capacity)
+            return false;
+
+        items[numEvents++] = { event, frame };
+        return true;
+    }
+
+    // This is called before each frame of the destination, to deliver the events that are due
+    template <typename DeliverFn>
+    void deliver (int64_t currentFrame, DeliverFn&& deliverEvent)
+    {
+        uint32_t numLeft = 0;
+
+        for (uint32_t i = 0; i < numEvents; ++i)
+        {
+            if (items[i].frame <= currentFrame)
+                deliverEvent (items[i].event);
+            else
+                items[numLeft++] = items[i];
+        }
+
+        numEvents = numLeft;
+    }
+
+    struct Item { EventType event; int64_t frame; };
+
+    Item items[capacity];
+    uint32_t numEvents;
+};
+)";
+    }
+};
+
+//==============================================================================
+std::string generateCPlusPlus (CompileMessageList& messageList, const Program& programToConvert,
+                               const CPlusPlusGenerationOptions& options)
+{
+    try
+    {
+        CompileMessageHandler handler (messageList);
+        auto program = programToConvert.clone();
+        return CPlusPlusGenerator (program, options).generate();
+    }
+    catch (AbortCompilationException) {}
+
+    return {};
+}
+
+}
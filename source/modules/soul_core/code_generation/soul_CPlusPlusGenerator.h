@@ -0,0 +1,54 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+struct CPlusPlusGenerationOptions
+{
+    /** The name of the class that will be generated. */
+    std::string className = "SOULProcessor";
+
+    /** The largest number of frames that the class's render() method will accept. */
+    uint32_t maxBlockSize = 1024;
+
+    /** The number of events that each event output or delayed event connection can hold
+        before they're passed on.
+    */
+    uint32_t eventQueueSize = 64;
+
+    /** Values for the program's external variables, keyed by their fully-qualified names. */
+    std::unordered_map<std::string, choc::value::Value> externalValues;
+};
+
+/**
+    Converts a linked program into the source code for a single self-contained C++ class.
+
+    The graph is flattened, and every processor instance becomes a plain struct holding its
+    state, so rendering a frame is just a sequence of direct function calls with no dynamic
+    allocation or lookups. The generated code only needs the C++17 standard library.
+
+    Returns an empty string if the program can't be converted, in which case the reasons
+    will have been added to the message list.
+*/
+std::string generateCPlusPlus (CompileMessageList&, const Program&, const CPlusPlusGenerationOptions&);
+
+}
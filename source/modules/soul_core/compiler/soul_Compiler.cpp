@@ -25,6 +25,184 @@
 namespace soul
 {
 
+//==============================================================================
+/**
+    Parsing and resolving the whole built-in library is by far the biggest fixed cost of
+    a build, so rather than compiling every library module for each program, only the
+    modules that the program's code actually mentions (plus any that those modules use
+    in turn) get added.
+
+    Everything in the library lives inside the soul namespace, so a module is needed if
+    code contains the name of anything it declares directly inside that namespace. This
+    can only over-estimate what's needed, because any reference to a library item has
+    to name it or one of its parent namespaces. The index of declared names is built
+    once, the first time it's needed, and is then shared by all compiles in the process.
+*/
+struct BuiltInLibraryIndex
+{
+    static const BuiltInLibraryIndex& get()
+    {
+        static BuiltInLibraryIndex index;
+        return index;
+    }
+
+    struct Module
+    {
+        const char* name;
+        std::vector<size_t> dependencies;
+        bool usesComplexNumbers = false;
+    };
+
+    std::vector<Module> modules;
+
+    /** Returns the indexes of the modules needed by some code, in the order in which they should be compiled. */
+    std::vector<size_t> getModulesNeededBy (std::string_view code) const
+    {
+        std::vector<bool> needed (modules.size());
+
+        forEachIdentifier (code, [&] (std::string_view name)
+        {
+            auto found = moduleForName.find (std::string (name));
+
+            if (found != moduleForName.end())
+                for (auto i : found->second)
+                    addWithDependencies (needed, i);
+        });
+
+        std::vector<size_t> result;
+
+        for (size_t i = 0; i < needed.size(); ++i)
+            if (needed[i])
+                result.push_back (i);
+
+        return result;
+    }
+
+    static bool usesComplexNumbers (std::string_view code)
+    {
+        bool found = false;
+        forEachIdentifier (code, [&] (std::string_view name) { found = found || choc::text::startsWith (name, "complex"); });
+        return found;
+    }
+
+private:
+    std::unordered_map<std::string, std::vector<size_t>> moduleForName;
+
+    BuiltInLibraryIndex()
+    {
+        // TODO: when we have import & module support, these will no longer be hard-coded here
+        for (auto name : { "soul.audio.utils", "soul.midi", "soul.notes", "soul.frequency", "soul.mixing",
+                           "soul.oscillators", "soul.noise", "soul.timeline", "soul.filters" })
+            modules.push_back ({ name, {}, usesComplexNumbers (getSystemModuleCode (name)) });
+
+        for (size_t i = 0; i < modules.size(); ++i)
+            for (auto& name : findDeclaredNames (modules[i].name))
+                moduleForName[name].push_back (i);
+
+        for (size_t i = 0; i < modules.size(); ++i)
+        {
+            std::vector<bool> used (modules.size());
+
+            forEachIdentifier (getSystemModuleCode (modules[i].name), [&] (std::string_view identifier)
+            {
+                auto found = moduleForName.find (std::string (identifier));
+
+                if (found != moduleForName.end())
+                    for (auto m : found->second)
+                        used[m] = true;
+            });
+
+            for (size_t m = 0; m < modules.size(); ++m)
+                if (used[m] && m != i)
+                    modules[i].dependencies.push_back (m);
+        }
+    }
+
+    void addWithDependencies (std::vector<bool>& needed, size_t module) const
+    {
+        if (! needed[module])
+        {
+            needed[module] = true;
+
+            for (auto d : modules[module].dependencies)
+                addWithDependencies (needed, d);
+        }
+    }
+
+    static std::vector<std::string> findDeclaredNames (const char* moduleName)
+    {
+        std::vector<std::string> names;
+        CompileMessageList list;
+
+        try
+        {
+            CompileMessageHandler handler (list);
+            AST::Allocator allocator;
+
+            for (auto& m : StructuralParser::parseTopLevelDeclarations (allocator, getSystemModule (moduleName),
+                                                                         AST::createRootNamespace (allocator)))
+            {
+                auto addNames = [&] (const auto& items)
+                {
+                    for (auto& item : items)
+                        names.push_back (item->name.toString());
+                };
+
+                addNames (m->getSubModules());
+                addNames (m->getFunctions());
+                addNames (m->getStructDeclarations());
+                addNames (m->getUsingDeclarations());
+                addNames (m->getNamespaceAliases());
+                addNames (m->getVariables());
+            }
+        }
+        catch (AbortCompilationException)
+        {
+            throwInternalCompilerError ("Error in built-in code: " + list.toString());
+        }
+
+        return names;
+    }
+
+    template <typename Handler>
+    static void forEachIdentifier (std::string_view code, Handler&& handle)
+    {
+        auto isIdentifierStart = [] (char c)  { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+        auto isIdentifierBody  = [&] (char c) { return isIdentifierStart (c) || (c >= '0' && c <= '9'); };
+
+        for (size_t i = 0; i < code.length();)
+        {
+            if (isIdentifierStart (code[i]))
+            {
+                auto start = i;
+
+                while (i < code.length() && isIdentifierBody (code[i]))
+                    ++i;
+
+                handle (code.substr (start, i - start));
+            }
+            else if (isIdentifierBody (code[i]))
+            {
+                while (i < code.length() && isIdentifierBody (code[i]))
+                    ++i;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+};
+
+static std::string_view getSourceText (const CodeLocation& code)
+{
+    if (code.sourceCode == nullptr)
+        return {};
+
+    return code.sourceCode->content;
+}
+
+//==============================================================================
 Compiler::Compiler (bool i) : includeStandardLibrary (i)
 {
     reset();
@@ -34,6 +212,8 @@ void Compiler::reset()
 {
     topLevelNamespace.reset();
     allocator.clear();
+    builtInModulesAdded.clear();
+    needsComplexLibrary = false;
 }
 
 bool Compiler::addCode (CompileMessageList& messageList, CodeLocation code)
@@ -42,20 +222,23 @@ bool Compiler::addCode (CompileMessageList& messageList, CodeLocation code)
         return false;
 
     if (topLevelNamespace == nullptr)
-    {
         topLevelNamespace = AST::createRootNamespace (allocator);
 
-        if (includeStandardLibrary)
-            addDefaultBuiltInLibrary();
-    }
-
     try
     {
+        soul::CompileMessageHandler handler (messageList);
+
+        // This must be checked before looking for the library modules that the code needs
         if (code.isEmpty())
             code.throwError (Errors::emptyProgram());
 
+        if (includeStandardLibrary)
+            addBuiltInLibraryModulesNeededBy (code);
+
+        if (BuiltInLibraryIndex::usesComplexNumbers (getSourceText (code)))
+            needsComplexLibrary = true;
+
         SOUL_LOG_TIME_OF_SCOPE ("initial resolution pass: " + code.getFilename());
-        soul::CompileMessageHandler handler (messageList);
         compile (std::move (code));
         return true;
     }
@@ -64,25 +247,38 @@ bool Compiler::addCode (CompileMessageList& messageList, CodeLocation code)
     return false;
 }
 
-void Compiler::addDefaultBuiltInLibrary()
+void Compiler::addBuiltInLibraryModulesNeededBy (const CodeLocation& code)
 {
     CompileMessageList list;
 
     try
     {
         soul::CompileMessageHandler handler (list);
-        compile (getDefaultLibraryCode());
-
-        // TODO: when we have import & module support, these will no longer be hard-coded here
-        compile (getSystemModule ("soul.audio.utils"));
-        compile (getSystemModule ("soul.midi"));
-        compile (getSystemModule ("soul.notes"));
-        compile (getSystemModule ("soul.frequency"));
-        compile (getSystemModule ("soul.mixing"));
-        compile (getSystemModule ("soul.oscillators"));
-        compile (getSystemModule ("soul.noise"));
-        compile (getSystemModule ("soul.timeline"));
-        compile (getSystemModule ("soul.filters"));
+        bool anyAdded = false;
+
+        if (builtInModulesAdded.empty())
+        {
+            parse (getDefaultLibraryCode());
+            builtInModulesAdded.resize (BuiltInLibraryIndex::get().modules.size());
+            anyAdded = true;
+        }
+
+        auto& index = BuiltInLibraryIndex::get();
+
+        for (auto i : index.getModulesNeededBy (getSourceText (code)))
+        {
+            if (! builtInModulesAdded[i])
+            {
+                builtInModulesAdded[i] = true;
+                parse (getSystemModule (index.modules[i].name));
+                needsComplexLibrary = needsComplexLibrary || index.modules[i].usesComplexNumbers;
+                anyAdded = true;
+            }
+        }
+
+        // Resolving is much slower than parsing, so all the new modules are parsed first and then resolved together
+        if (anyAdded)
+            resolve();
     }
     catch (soul::AbortCompilationException)
     {
@@ -175,9 +371,18 @@ void Compiler::compile (CodeLocation code)
 {
     SOUL_LOG_TIME_OF_SCOPE ("compile: " + code.getFilename());
 
+    parse (std::move (code));
+    resolve();
+}
+
+void Compiler::parse (CodeLocation code)
+{
     for (auto& m : StructuralParser::parseTopLevelDeclarations (allocator, code, *topLevelNamespace))
         SanityCheckPass::runPreResolution (m);
+}
 
+void Compiler::resolve()
+{
     ResolutionPass::run (allocator, *topLevelNamespace, true);
 
     ASTUtilities::mergeDuplicateNamespaces (*topLevelNamespace);
@@ -232,14 +437,14 @@ Program Compiler::link (CompileMessageList& messageList, const BuildSettings& se
     {
         CompileMessageHandler handler (messageList);
         sanityCheckBuildSettings (settings);
-        return link (messageList, findMainProcessor (settings));
+        return link (messageList, settings, findMainProcessor (settings));
     }
     catch (AbortCompilationException) {}
 
     return {};
 }
 
-Program Compiler::link (CompileMessageList& messageList, AST::ProcessorBase& processorToRun)
+Program Compiler::link (CompileMessageList& messageList, const BuildSettings& settings, AST::ProcessorBase& processorToRun)
 {
     try
     {
@@ -250,24 +455,38 @@ Program Compiler::link (CompileMessageList& messageList, AST::ProcessorBase& pro
         ASTUtilities::removeModulesWithSpecialisationParams (*topLevelNamespace);
         ResolutionPass::run (allocator, *topLevelNamespace, false);
 
-        compile (getSystemModule ("soul.complex"));
-        ConvertComplexPass::run (allocator, *topLevelNamespace);
+        if (needsComplexLibrary)
+        {
+            compile (getSystemModule ("soul.complex"));
+            ConvertComplexPass::run (allocator, *topLevelNamespace);
+        }
 
         ASTUtilities::connectAnyChildEndpointsNeedingToBeExposed (allocator, processorToRun);
 
         Program program;
         program.getStringDictionary() = allocator.stringDictionary;  // Bring the existing string dictionary along so that the handles match
-        compileAllModules (*topLevelNamespace, program, processorToRun);
-        heart::Utilities::inlineFunctionsThatUseAdvanceOrStreams<Optimisations> (program);
-        heart::Checker::sanityCheck (program);
+
+        {
+            SOUL_LOG_TIME_OF_SCOPE ("link: generate HEART");
+            compileAllModules (*topLevelNamespace, program, processorToRun);
+            heart::Utilities::inlineFunctionsThatUseAdvanceOrStreams<Optimisations> (program);
+            heart::Checker::sanityCheck (program);
+        }
+
         reset();
 
         SOUL_LOG (program.getMainProcessor().originalFullName + ": linked HEART",
                   [&] { return program.toHEART(); });
 
         heart::Checker::testHEARTRoundTrip (program);
-        Optimisations::optimiseFunctionBlocks (program);
-        Optimisations::removeUnusedVariables (program);
+
+        {
+            SOUL_LOG_TIME_OF_SCOPE ("link: optimise");
+            Optimisations::optimiseFunctionBlocks (program);
+            SSAOptimisations::optimise (program, settings.optimisationLevel);
+            Optimisations::removeUnusedVariables (program);
+        }
+
         return program;
     }
     catch (AbortCompilationException) {}
@@ -61,11 +61,15 @@ private:
     //==============================================================================
     AST::Allocator allocator;
     pool_ptr<AST::Namespace> topLevelNamespace;
+    std::vector<bool> builtInModulesAdded;
+    bool needsComplexLibrary = false;
 
     void reset();
-    void addDefaultBuiltInLibrary();
+    void addBuiltInLibraryModulesNeededBy (const CodeLocation&);
     void compile (CodeLocation);
-    Program link (CompileMessageList&, AST::ProcessorBase& processorToRun);
+    void parse (CodeLocation);
+    void resolve();
+    Program link (CompileMessageList&, const BuildSettings&, AST::ProcessorBase& processorToRun);
     AST::ProcessorBase& findMainProcessor (const BuildSettings&);
 
     void compileAllModules (const AST::Namespace& parentNamespace, Program&, AST::ProcessorBase& processorToRun);
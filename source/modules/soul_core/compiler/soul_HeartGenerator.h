@@ -87,6 +87,9 @@ private:
     const uint32_t maxExpressionDepth;
     pool_ptr<heart::Block> breakTarget, continueTarget;
 
+    std::unordered_map<std::string, pool_ref<AST::ProcessorInstance>> sourceInstancesByName;
+    std::unordered_map<std::string, pool_ref<heart::ProcessorInstance>> processorInstancesByName;
+
     //==============================================================================
     Identifier convertIdentifier (Identifier i)
     {
@@ -300,46 +303,51 @@ private:
             return {};
 
         auto instanceName = instance->instanceName->toString();
+        auto existing = processorInstancesByName.find (instanceName);
 
-        for (auto i : module.processorInstances)
-            if (instanceName == i->instanceName)
-                return i;
+        if (existing != processorInstancesByName.end())
+            return existing->second;
 
-        for (auto& i : sourceGraph->processorInstances)
-        {
-            if (i->instanceName->toString() == instanceName)
-            {
-                auto& targetProcessor = sourceGraph->findSingleMatchingProcessor (i);
+        // Big graphs can have thousands of connections, so the instances are looked up by name
+        // rather than searched for each one
+        if (sourceInstancesByName.empty())
+            for (auto& i : sourceGraph->processorInstances)
+                sourceInstancesByName.emplace (i->instanceName->toString(), i);
 
-                auto& p = module.allocate<heart::ProcessorInstance> (CodeLocation{});
-                p.instanceName = instanceName;
-                p.sourceName = targetProcessor.getFullyQualifiedPath().toString();
-                p.arraySize = getProcessorArraySize (i->arraySize).value_or (1);
+        auto source = sourceInstancesByName.find (instanceName);
 
-                if (i->clockMultiplierRatio != nullptr)
-                {
-                    if (auto c = i->clockMultiplierRatio->getAsConstant())
-                        p.clockMultiplier.setMultiplier (i->clockMultiplierRatio->context, c->value);
-                    else
-                        i->clockMultiplierRatio->context.throwError (Errors::ratioMustBeInteger());
-                }
+        if (source == sourceInstancesByName.end())
+            return {};
 
-                if (i->clockDividerRatio != nullptr)
-                {
-                    if (auto c = i->clockDividerRatio->getAsConstant())
-                        p.clockMultiplier.setDivider (i->clockDividerRatio->context, c->value);
-                    else
-                        i->clockDividerRatio->context.throwError (Errors::ratioMustBeInteger());
-                }
+        auto& i = source->second;
+        auto& targetProcessor = sourceGraph->findSingleMatchingProcessor (i);
 
-                SOUL_ASSERT (i->specialisationArgs == nullptr);
+        auto& p = module.allocate<heart::ProcessorInstance> (CodeLocation{});
+        p.instanceName = instanceName;
+        p.sourceName = targetProcessor.getFullyQualifiedPath().toString();
+        p.arraySize = getProcessorArraySize (i->arraySize).value_or (1);
 
-                module.processorInstances.push_back (p);
-                return p;
-            }
+        if (i->clockMultiplierRatio != nullptr)
+        {
+            if (auto c = i->clockMultiplierRatio->getAsConstant())
+                p.clockMultiplier.setMultiplier (i->clockMultiplierRatio->context, c->value);
+            else
+                i->clockMultiplierRatio->context.throwError (Errors::ratioMustBeInteger());
         }
 
-        return {};
+        if (i->clockDividerRatio != nullptr)
+        {
+            if (auto c = i->clockDividerRatio->getAsConstant())
+                p.clockMultiplier.setDivider (i->clockDividerRatio->context, c->value);
+            else
+                i->clockDividerRatio->context.throwError (Errors::ratioMustBeInteger());
+        }
+
+        SOUL_ASSERT (i->specialisationArgs == nullptr);
+
+        module.processorInstances.push_back (p);
+        processorInstancesByName.emplace (instanceName, p);
+        return p;
     }
 
     void visit (AST::Function& f) override
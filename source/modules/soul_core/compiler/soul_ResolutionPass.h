@@ -143,6 +143,25 @@ private:
 
         using RewritingASTVisitor::visit;
 
+        // A module that has already been fully resolved has nothing left to do, so only its
+        // sub-modules need to be visited in case any new ones have been added since then
+        AST::Processor& visit (AST::Processor& p) override   { return isFinished (p) ? p : RewritingASTVisitor::visit (p); }
+        AST::Graph& visit (AST::Graph& g) override           { return isFinished (g) ? g : RewritingASTVisitor::visit (g); }
+
+        AST::Namespace& visit (AST::Namespace& n) override
+        {
+            if (! isFinished (n))
+                return RewritingASTVisitor::visit (n);
+
+            visitArray (n.subModules);
+            return n;
+        }
+
+        static bool isFinished (const AST::ModuleBase& m)
+        {
+            return m.isFullyResolved && ! m.isTemplateModule();
+        }
+
         AST::StaticAssertion& visit (AST::StaticAssertion& a) override
         {
             RewritingASTVisitor::visit (a);
@@ -2109,7 +2128,10 @@ private:
                 }
 
                 auto& graph = *cast<AST::Graph> (instance.getParentScope()->findProcessor());
-                SanityCheckPass::RecursiveGraphDetector::check (graph);
+
+                // The check covers the whole graph, so only needs doing once per pass, rather than for every instance
+                if (graphsCheckedForRecursion.insert (std::addressof (graph)).second)
+                    SanityCheckPass::RecursiveGraphDetector::check (graph);
 
                 if (! instance.isImplicitlyCreated())
                     if (! graph.getMatchingSubModules (instance.instanceName->getIdentifierPath()).empty())
@@ -2163,6 +2185,8 @@ private:
             ++numFails;
             return instance;
         }
+
+        std::unordered_set<const AST::Graph*> graphsCheckedForRecursion;
     };
 
     //==============================================================================
@@ -54,619 +54,295 @@ inline const char* getSystemModuleCode (std::string_view moduleName)
     // in this code chunk below. This obviously needs to be run when the files change.
 
     // BEGIN_INCLUDED_LIBRARY_CODE
-    if (moduleName == "soul.complex")  return R"soul_code(
-namespace soul::complex_lib::imp (using FloatType, int vectorSize)
-{
-    namespace complex_element = imp (FloatType, 1);
-
-    struct ComplexType
-    {
-        FloatType<vectorSize> real, imag;
-    }
-
-    ComplexType negate (ComplexType v)
-    {
-        return ComplexType (-v.real, -v.imag);
-    }
-
-    ComplexType conj (ComplexType v)
-    {
-        return ComplexType (v.real, -v.imag);
-    }
-
-    ComplexType add (ComplexType left, ComplexType right)
-    {
-        return ComplexType (left.real + right.real,
-                            left.imag + right.imag);
-    }
-
-    ComplexType subtract (ComplexType left, ComplexType right)
-    {
-        return ComplexType (left.real - right.real,
-                            left.imag - right.imag);
-    }
-
-    ComplexType multiply (ComplexType left, ComplexType right)
-    {
-        return ComplexType (left.real * right.real - left.imag * right.imag,
-                            left.real * right.imag + left.imag * right.real);
-    }
-
-    ComplexType divide (ComplexType left, ComplexType right)
-    {
-        let c = right.conj();
-        let result = multiply (left, c);
-        let scale = multiply (right, c).real;
+    if (moduleName == "soul.mixing")  return R"soul_code(
+/** Title: Mix and gain control utilities
 
-        return ComplexType (result.real / scale,
-                            result.imag / scale);
-    }
+    This file provides a set of processors for common tasks like mixing together sources,
+    applying fixed gains, or applying envelope shapes.
+*/
 
-    bool<vectorSize> equals (ComplexType left, ComplexType right)
+//==============================================================================
+/// This namespace contains a set of processors for common tasks like mixing together sources.
+namespace soul::mixers
+{
+    //==============================================================================
+    /// Simple processor which adds two sources together using fixed gains for each source.
+    processor FixedSum (using SampleType, float gain1, float gain2)
     {
-        var realComparison = left.real == right.real;
-        let imagComparison = left.imag == right.imag;
-
-        for (wrap<vectorSize> i)
-            realComparison[i] = realComparison[i] && imagComparison[i];
+        input  stream SampleType in1, in2;
+        output stream SampleType out;
 
-        return realComparison;
+        void run()
+        {
+            loop
+            {
+                out << in1 * gain1 + in2 * gain2;
+                advance();
+            }
+        }
     }
 
-    bool<vectorSize> notEquals (ComplexType left, ComplexType right)
+    //==============================================================================
+    /// Simple processor which adds two sources together using streams to control the
+    /// gains to apply to each source.
+    processor DynamicSum (using SampleType)
     {
-        var r = equals (left, right);
-
-        for (wrap<vectorSize> i)
-            r[i] = ! r[i];
+        input  stream SampleType in1, in2;
+        input  stream float gain1, gain2;
+        output stream SampleType out;
 
-        return r;
+        void run()
+        {
+            loop
+            {
+                out << in1 * gain1 + in2 * gain2;
+                advance();
+            }
+        }
     }
 
-    complex_element::ComplexType getElement (ComplexType c, int element)
-    {
-        return complex_element::ComplexType (c.real.at (element),
-                                            c.imag.at (element));
-    }
+    //==============================================================================
+    /** Simple processor which mixes together two sources, using a stream of values
+        to indicate the ratio.
 
+        The mixRange constant allows you to set the range of values that will be passed
+        in the mix stream, so e.g. mixRange = 1.0 means that mix will be in the range 0 to 1,
+        and mixRange = 100 means the values will be 0 to 100.
+        The mix stream is expected to contain values between 0 and mixRange,
 )soul_code"
 R"soul_code(
 
-    complex_element::ComplexType setElement (ComplexType& c, int element, complex_element::ComplexType value)
-    {
-        c.real.at (element) = value.real;
-        c.imag.at (element) = value.imag;
-
-        return value;
-    }
-}
-)soul_code";
-
-    if (moduleName == "soul.noise")  return R"soul_code(
-/** Title: RNGs and noise-generators
-
-    This module contains a range of simple RNG and noise generating functions and processors.
-*/
-
-/** This namespace contains some random number generation helpers.
-    We're assuming that nobody's going to be using these RNGs for security-critical cryptographic
-    applications. All the algorithms here are chosen to be fast, and definitely not cryptographically
-    strong!
-*/
-namespace soul::random
-{
-    /// State for a Park-Miller random number generator.
-    struct RandomNumberState
-    {
-        /** The current seed.
-            Top tip: when generating a seed, you might want to use the `processor.id` constant,
-            to make sure that each instance of a processor has a differently-seeded RNG. If you
-            want the RNG to be different each time the program runs, you could also throw the
-            `processor.session` constant into the mix too.
-        */
-        int64 seed;
-    }
-
-    /// Resets an RNG state object with the given seed value.
-    void reset (RandomNumberState& state, int64 seed)
-    {
-        state.seed = seed;
-    }
-
-    /// Returns the next number in the full 32-bit integer range.
-    int32 getNextInt32 (RandomNumberState& state)
-    {
-        let s = (state.seed * 48271) % 0x7fffffff;
-        state.seed = s + 1;
-        return int32 (s);
-    }
-
-    /// Advances the given RNG state and returns a value 0 to 1.
-    float getNextUnipolar (RandomNumberState& state)
+        where mix = 0 produces 100% in1, and mix = mixRange produces 100% in2.
+    */
+    processor DynamicMix (using SampleType, float mixRange)
     {
-        return float (getNextInt32 (state)) * (1.0f / 2147483647.0f);
-    }
+        input  stream SampleType in1, in2;
+        input  stream float mix;
+        output stream SampleType out;
 
-    /// Advances the given RNG state and returns a value -1 to 1.
-    float getNextBipolar (RandomNumberState& state)
-    {
-        return (float (getNextInt32 (state)) * (2.0f / 2147483647.0f)) - 1.0f;
+        void run()
+        {
+            loop
+            {
+                out << lerp (in1, in2, mix * (1.0f / mixRange));
+                advance();
+            }
+        }
     }
 }
 
-/// This namespace contains generators for various flavours of noise.
-namespace soul::noise
+//==============================================================================
+/// Utility processors for common tasks like applying gain in various ways.
+namespace soul::gain
 {
-    /// White noise generator
-    processor White
+    //==============================================================================
+    /// Simple processor which applies a fixed gain to a signal.
+    processor FixedGain (using SampleType, float fixedGain)
     {
-        output stream float out;
+        input  stream SampleType in;
+        output stream SampleType out;
 
         void run()
         {
-            var rng = random::RandomNumberState (processor.id + 10);
-
-)soul_code"
-R"soul_code(
-
             loop
             {
-                out << rng.getNextBipolar();
+                out << in * fixedGain;
                 advance();
             }
         }
     }
 
-    /// Brown noise generator
-    processor Brown
+    //==============================================================================
+    /// Simple processor which applies a changeable gain level to a signal.
+    processor DynamicGain (using SampleType)
     {
-        output stream float out;
+        input  stream SampleType in;
+        output stream SampleType out;
+        input  stream float gain;
 
         void run()
         {
-            let limit = 32.0f;
-            float runningTotal;
-            var rng = random::RandomNumberState (processor.id + 20);
-
             loop
             {
-                let white = rng.getNextBipolar();
-                runningTotal += white;
-
-                if (runningTotal > limit || runningTotal < -limit)
-                    runningTotal -= white;
-
-                runningTotal *= 0.998f;
-                out << runningTotal * (1.0f / limit);
+                out << in * gain;
                 advance();
             }
         }
     }
 
-    /// Pink noise generator
-    processor Pink
+    //==============================================================================
+    /// Converts an input event parameter in decibels to a smoothed stream of
+    /// raw gain levels.
+    processor SmoothedGainParameter (float slewRateSeconds)
     {
-        output stream float out;
+        input event float volume   [[ label: "Volume", unit: "dB", min: -85, max: 6 ]];
+        output stream float gain;
 
-        void run()
+        event volume (float targetDB)
         {
-            let pinkBits = 12;
-            int counter;
-            float[pinkBits] values;
-            float total;
-            var rng = random::RandomNumberState (processor.id + 30);
+            targetGain = soul::dBtoGain (targetDB);
+)soul_code"
+R"soul_code(
 
+            let maxDelta = float (processor.period / slewRateSeconds);
+            remainingRampSamples = max (1, int (abs (targetGain - currentGain) / maxDelta));
+            increment = (targetGain - currentGain) / remainingRampSamples;
+        }
+
+        float targetGain, currentGain, increment;
+        int remainingRampSamples;
+
+        void run()
+        {
             loop
             {
-                let white = rng.getNextBipolar();
-                ++counter;
-
-                for (int bit = 0; bit < pinkBits; ++bit)
+                if (remainingRampSamples != 0)
                 {
-                    if (((counter >> bit) & 1) != 0)
-                    {
-                        let index = wrap<pinkBits> (bit);
-                        total -= values[index];
-                        values[index] = white;
-                        total += white;
-                        break;
-                    }
+                    if (--remainingRampSamples == 0)
+                        currentGain = targetGain;
+                    else
+                        currentGain += increment;
                 }
 
-                out << total * (1.0f / float (pinkBits - 1));
+                gain << currentGain;
                 advance();
             }
         }
     }
 }
-)soul_code";
 
-    if (moduleName == "soul.audio.utils")  return R"soul_code(
-/** Title: Miscellaneous audio utilities
+//==============================================================================
+/// Generators for common envelope shapes.
+namespace soul::envelope
+{
+    /** Creates an envelope which applies convex attack and release curves based
+        on a stream of NoteOn and NoteOff events.
 
-    This module is a collection of commonly-used audio helper functions and types.
-*/
+        The envelope implements fixed-length attack and release ramps where the hold
+        level is based on the velocity of the triggering NoteOn event, multiplied
+        by the holdLevelMultiplier parameter.
+    */
+    processor FixedAttackReleaseEnvelope (float holdLevelMultiplier,
+                                          float attackTimeSeconds,
+                                          float releaseTimeSeconds)
+    {
+        input event (soul::note_events::NoteOn,
+                     soul::note_events::NoteOff) noteIn;
 
-namespace soul
-{
-    //==============================================================================
-    /// Converts a decibel level to a gain factor.
-    float32 dBtoGain (float32 decibels)   { return decibels > -100.0f ? pow (10.0f, decibels * 0.05f) : 0.0f; }
-    /// Converts a decibel level to a gain factor.
-    float64 dBtoGain (float64 decibels)   { return decibels > -100.0  ? pow (10.0,  decibels * 0.05)  : 0.0; }
+        output stream float levelOut;
 
-    /// Converts a gain factor to a decibel level.
-    float32 gainTodB (float32 gain)       { return gain > 0 ? log10 (gain) * 20.0f : -100.0f; }
-    /// Converts a gain factor to a decibel level.
-    float64 gainTodB (float64 gain)       { return gain > 0 ? log10 (gain) * 20.0  : -100.0; }
+        event noteIn (soul::note_events::NoteOn e)      { active = true; targetLevel = e.velocity; }
+        event noteIn (soul::note_events::NoteOff e)     { active = false; }
 
-    /// Converts a MIDI note (usually in the range 0-127) to a frequency in Hz.
-    float32 noteNumberToFrequency (int note)            { return 440.0f * pow (2.0f, (note - 69) * (1.0f / 12.0f)); }
-    /// Converts a MIDI note (usually in the range 0-127) to a frequency in Hz.
-    float32 noteNumberToFrequency (float32 note)        { return 440.0f * pow (2.0f, (note - 69.0f) * (1.0f / 12.0f)); }
-    /// Converts a frequency in Hz to an equivalent MIDI note number.
-    float32 frequencyToNoteNumber (float32 frequency)   { return 69.0f + (12.0f / log (2.0f)) * log (frequency * (1.0f / 440.0f)); }
+        bool active = false;
+        float targetLevel;
 
-    /// Returns the ratio by which a sample's playback must be sped-up in order to map
-    /// from its native sample-rate and note to a target sample-rate and note.
-    float64 getSpeedRatioForPitchedSample (float64 sourceSampleRate, float32 sourceMIDINote,
-                                           float64 targetSampleRate, float32 targetMIDINote)
-    {
-        return (sourceSampleRate * pow (2.0f, targetMIDINote * (1.0f / 12.0f)))
-             / (targetSampleRate * pow (2.0f, sourceMIDINote * (1.0f / 12.0f)));
-    }
+        void run()
+        {
+            let silenceThreshold = 0.00001f;
 
+            loop
+            {
+                // Waiting for note-on
+                while (! active)
 )soul_code"
 R"soul_code(
 
-    /// Returns the coefficient for a filter pole, based on a t60 decay time in seconds.
-    float64 tau2pole (float64 t60, float64 sampleRate)   { return pow (0.001,  1.0  / (t60 * sampleRate)); }
-    /// Returns the coefficient for a filter pole, based on a t60 decay time in seconds.
-    float32 tau2pole (float32 t60, float32 sampleRate)   { return pow (0.001f, 1.0f / (t60 * sampleRate)); }
-
-    /// Returns the t60 decay time in seconds for a filter pole coefficient in the range 0 to 1.
-    float64 pole2tau (float64 pole, float64 sampleRate)   { return -1.0 / (log (pole) * sampleRate); }
-    /// Returns the t60 decay time in seconds for a filter pole coefficient in the range 0 to 1.
-    float32 pole2tau (float32 pole, float32 sampleRate)   { return -1.0f / (log (pole) * sampleRate); }
-}
+                    advance();
 
-//==============================================================================
-/// This namespace contains some handy stuctures to use when declaring `external`
-/// variables which are going to be loaded with data from audio files.
-namespace soul::audio_samples
-{
-    /// An `external` variable declared with the type `soul::audio_samples::Mono`
-    /// can be loaded with monoised data from an audio file.
-    struct Mono
-    {
-        float[] frames;
-        float64 sampleRate;
-    }
+                float level;
 
-    /// An `external` variable declared with the type `soul::audio_samples::Stereo`
-    /// can be loaded with stereo data from an audio file.
-    struct Stereo
-    {
-        float<2>[] frames;
-        float64 sampleRate;
-    }
-}
+                // Attacking
+                if const (attackTimeSeconds <= 0)
+                {
+                    level = targetLevel;
+                }
+                else
+                {
+                    let attackSamples = int (processor.frequency * attackTimeSeconds);
+                    let attackMultiplier = float (pow (2.0, -1.0 / attackSamples) * pow (targetLevel + 2.0, 1.0 / attackSamples));
 
-/// This namespace contains various pan-related helper functions
-namespace soul::pan_law
-{
-    /// Applies a simple linear pan law to convert a pan position (-1.0 to 1.0) to
-    /// a (left, right) pair of stereo gains.
-    float<2> linear (float pan)
-    {
-        return (1.0f - pan,
-                1.0f + pan);
-    }
+                    for (var attackLevel = 2.0f; active && level < targetLevel; attackLevel *= attackMultiplier)
+                    {
+                        level = attackLevel - 2.0f;
+                        levelOut << level;
+                        advance();
+                    }
+                }
 
-    /// Applies a 3dB-centre pan law to convert a pan position (-1.0 to 1.0) to
-    /// a (left, right) pair of stereo gains.
-    float<2> centre3dB (float pan)
-    {
-)soul_code"
-R"soul_code(
+                // Sustaining
+                while (active)
+                {
+                    levelOut << level;
+                    advance();
+                }
 
-        let quarterPi = float (pi / 4);
+                // Releasing
+                if const (releaseTimeSeconds > 0)
+                {
+                    let releaseMultiplier = float (pow (0.0001, processor.period / releaseTimeSeconds));
 
-        return (sin ((1.0f - pan) * quarterPi),
-                sin ((1.0f + pan) * quarterPi));
+                    while (! active && level > silenceThreshold)
+                    {
+                        levelOut << level;
+                        level *= releaseMultiplier;
+                        advance();
+                    }
+                }
+            }
+        }
     }
 }
 )soul_code";
 
-    if (moduleName == "soul.mixing")  return R"soul_code(
-/** Title: Mix and gain control utilities
-
-    This file provides a set of processors for common tasks like mixing together sources,
-    applying fixed gains, or applying envelope shapes.
+    if (moduleName == "soul.intrinsics")  return R"soul_code(
+/** Title: Intrinsic functions
 */
 
-//==============================================================================
-/// This namespace contains a set of processors for common tasks like mixing together sources.
-namespace soul::mixers
-{
-    //==============================================================================
-    /// Simple processor which adds two sources together using fixed gains for each source.
-    processor FixedSum (using SampleType, float gain1, float gain2)
-    {
-        input  stream SampleType in1, in2;
-        output stream SampleType out;
+/**
+    The `intrinsics` namespace contains low-level, commonly-used functions.
 
-        void run()
-        {
-            loop
-            {
-                out << in1 * gain1 + in2 * gain2;
-                advance();
-            }
-        }
-    }
+    This is a special-case namespace, as the functions inside it can be used without needing to
+    specify their namespace (i.e. you can just write `abs(x)`, no need to write
+    `soul::intrinsics::abs(x)`).
 
-    //==============================================================================
-    /// Simple processor which adds two sources together using streams to control the
-    /// gains to apply to each source.
-    processor DynamicSum (using SampleType)
-    {
-        input  stream SampleType in1, in2;
-        input  stream float gain1, gain2;
-        output stream SampleType out;
+    Many of these functions have reference implementations defined in this file, but which
+    will be substituted for more optimal implementations by a JIT engine if possible.
+    The `[[intrin]]` annotation is used as a hint to the performer back-end that this function
+    should be replaced by a native implementation if one is available. (Note that some of the
+    functions here have non-functional implementations and rely on the performer to use a native
+    implementation for them to work at all).
+*/
+namespace soul::intrinsics
+{
+    /// Familiar abs() function, accepting most scalar types.
+    T.removeReference abs<T> (T n)                         [[intrin: "abs"]]       { static_assert (T.isScalar, "abs() only works with scalar types"); return n < 0 ? -n : n; }
+    /// Returns the greater of two scalar values.
+    T.removeReference max<T>       (T a, T b)              [[intrin: "max"]]       { static_assert (T.isScalar, "max() only works with scalar types"); return a > b ? a : b; }
+    /// Returns the lesser of two scalar values.
+    T.removeReference min<T>       (T a, T b)              [[intrin: "min"]]       { static_assert (T.isScalar, "min() only works with scalar types"); return a < b ? a : b; }
+    /// Returns the lesser of two scalar values.
+    int32 min                      (int32 a, int32 b)      [[intrin: "min"]]       { return a < b ? a : b; }
 
-        void run()
-        {
-            loop
-            {
-                out << in1 * gain1 + in2 * gain2;
-                advance();
-            }
-        }
-    }
+    /// Clamps a scalar value to the nearest value within a given range.
+    T.removeReference clamp<T>     (T n, T low, T high)    [[intrin: "clamp"]]     { static_assert (T.isScalar, "clamp() only works with scalar types"); return n < low ? low : (n > high ? high : n); }
+)soul_code"
+R"soul_code(
 
-    //==============================================================================
-    /** Simple processor which mixes together two sources, using a stream of values
-        to indicate the ratio.
+    /// Performs a negative-number-aware modulo operation to wrap a number to a zero-based range.
+    T.removeReference wrap<T>      (T n, T range)          [[intrin: "wrap"]]      { static_assert (T.isScalar, "wrap() only works with scalar types");  if (range == 0) return 0; let x = n % range; if (x < 0) return x + range; return x; }
+    /// Performs a negative-number-aware integer modulo operation.
+    int32 wrap                     (int32 n, int32 range)  [[intrin: "wrap"]]      { if (range == 0) return 0; let x = n % range; if (x < 0) return x + range; return x; }
+    /// Performs a C++-compatible floor function on a scalar floating point value.
+    T.removeReference floor<T>     (T n)                   [[intrin: "floor"]]     { static_assert (T.isScalar && T.primitiveType.isFloat, "floor() only works with scalar floating point types");     let r = T (int64 (n)); return (r == n) ? n : (n >= 0 ? r : r - 1); }
+    /// Performs a C++-compatible ceil function on a scalar floating point value.
+    T.removeReference ceil<T>      (T n)                   [[intrin: "ceil"]]      { static_assert (T.isScalar && T.primitiveType.isFloat, "ceil() only works with scalar floating point types");      let r = T (int64 (n)); return (r == n) ? n : (n >= 0 ? r + 1 : r); }
+    /// Returns a linearly-interpolated value between two scalar values.
+    T.removeReference lerp<T>      (T start, T stop, T amount)                     { static_assert (T.isScalar && T.primitiveType.isFloat, "lerp() only works with scalar floating point types");      return start + (stop - start) * amount; }
 
-        The mixRange constant allows you to set the range of values that will be passed
-        in the mix stream, so e.g. mixRange = 1.0 means that mix will be in the range 0 to 1,
-        and mixRange = 100 means the values will be 0 to 100.
-        The mix stream is expected to contain values between 0 and mixRange,
-)soul_code"
-R"soul_code(
-
-        where mix = 0 produces 100% in1, and mix = mixRange produces 100% in2.
-    */
-    processor DynamicMix (using SampleType, float mixRange)
-    {
-        input  stream SampleType in1, in2;
-        input  stream float mix;
-        output stream SampleType out;
-
-        void run()
-        {
-            loop
-            {
-                out << lerp (in1, in2, mix * (1.0f / mixRange));
-                advance();
-            }
-        }
-    }
-}
-
-//==============================================================================
-/// Utility processors for common tasks like applying gain in various ways.
-namespace soul::gain
-{
-    //==============================================================================
-    /// Simple processor which applies a fixed gain to a signal.
-    processor FixedGain (using SampleType, float fixedGain)
-    {
-        input  stream SampleType in;
-        output stream SampleType out;
-
-        void run()
-        {
-            loop
-            {
-                out << in * fixedGain;
-                advance();
-            }
-        }
-    }
-
-    //==============================================================================
-    /// Simple processor which applies a changeable gain level to a signal.
-    processor DynamicGain (using SampleType)
-    {
-        input  stream SampleType in;
-        output stream SampleType out;
-        input  stream float gain;
-
-        void run()
-        {
-            loop
-            {
-                out << in * gain;
-                advance();
-            }
-        }
-    }
-
-    //==============================================================================
-    /// Converts an input event parameter in decibels to a smoothed stream of
-    /// raw gain levels.
-    processor SmoothedGainParameter (float slewRateSeconds)
-    {
-        input event float volume   [[ label: "Volume", unit: "dB", min: -85, max: 6 ]];
-        output stream float gain;
-
-        event volume (float targetDB)
-        {
-            targetGain = soul::dBtoGain (targetDB);
-)soul_code"
-R"soul_code(
-
-            let maxDelta = float (processor.period / slewRateSeconds);
-            remainingRampSamples = max (1, int (abs (targetGain - currentGain) / maxDelta));
-            increment = (targetGain - currentGain) / remainingRampSamples;
-        }
-
-        float targetGain, currentGain, increment;
-        int remainingRampSamples;
-
-        void run()
-        {
-            loop
-            {
-                if (remainingRampSamples != 0)
-                {
-                    if (--remainingRampSamples == 0)
-                        currentGain = targetGain;
-                    else
-                        currentGain += increment;
-                }
-
-                gain << currentGain;
-                advance();
-            }
-        }
-    }
-}
-
-//==============================================================================
-/// Generators for common envelope shapes.
-namespace soul::envelope
-{
-    /** Creates an envelope which applies convex attack and release curves based
-        on a stream of NoteOn and NoteOff events.
-
-        The envelope implements fixed-length attack and release ramps where the hold
-        level is based on the velocity of the triggering NoteOn event, multiplied
-        by the holdLevelMultiplier parameter.
-    */
-    processor FixedAttackReleaseEnvelope (float holdLevelMultiplier,
-                                          float attackTimeSeconds,
-                                          float releaseTimeSeconds)
-    {
-        input event (soul::note_events::NoteOn,
-                     soul::note_events::NoteOff) noteIn;
-
-        output stream float levelOut;
-
-        event noteIn (soul::note_events::NoteOn e)      { active = true; targetLevel = e.velocity; }
-        event noteIn (soul::note_events::NoteOff e)     { active = false; }
-
-        bool active = false;
-        float targetLevel;
-
-        void run()
-        {
-            let silenceThreshold = 0.00001f;
-
-            loop
-            {
-                // Waiting for note-on
-                while (! active)
-)soul_code"
-R"soul_code(
-
-                    advance();
-
-                float level;
-
-                // Attacking
-                if const (attackTimeSeconds <= 0)
-                {
-                    level = targetLevel;
-                }
-                else
-                {
-                    let attackSamples = int (processor.frequency * attackTimeSeconds);
-                    let attackMultiplier = float (pow (2.0, -1.0 / attackSamples) * pow (targetLevel + 2.0, 1.0 / attackSamples));
-
-                    for (var attackLevel = 2.0f; active && level < targetLevel; attackLevel *= attackMultiplier)
-                    {
-                        level = attackLevel - 2.0f;
-                        levelOut << level;
-                        advance();
-                    }
-                }
-
-                // Sustaining
-                while (active)
-                {
-                    levelOut << level;
-                    advance();
-                }
-
-                // Releasing
-                if const (releaseTimeSeconds > 0)
-                {
-                    let releaseMultiplier = float (pow (0.0001, processor.period / releaseTimeSeconds));
-
-                    while (! active && level > silenceThreshold)
-                    {
-                        levelOut << level;
-                        level *= releaseMultiplier;
-                        advance();
-                    }
-                }
-            }
-        }
-    }
-}
-)soul_code";
-
-    if (moduleName == "soul.intrinsics")  return R"soul_code(
-/** Title: Intrinsic functions
-*/
-
-/**
-    The `intrinsics` namespace contains low-level, commonly-used functions.
-
-    This is a special-case namespace, as the functions inside it can be used without needing to
-    specify their namespace (i.e. you can just write `abs(x)`, no need to write
-    `soul::intrinsics::abs(x)`).
-
-    Many of these functions have reference implementations defined in this file, but which
-    will be substituted for more optimal implementations by a JIT engine if possible.
-    The `[[intrin]]` annotation is used as a hint to the performer back-end that this function
-    should be replaced by a native implementation if one is available. (Note that some of the
-    functions here have non-functional implementations and rely on the performer to use a native
-    implementation for them to work at all).
-*/
-namespace soul::intrinsics
-{
-    /// Familiar abs() function, accepting most scalar types.
-    T.removeReference abs<T> (T n)                         [[intrin: "abs"]]       { static_assert (T.isScalar, "abs() only works with scalar types"); return n < 0 ? -n : n; }
-    /// Returns the greater of two scalar values.
-    T.removeReference max<T>       (T a, T b)              [[intrin: "max"]]       { static_assert (T.isScalar, "max() only works with scalar types"); return a > b ? a : b; }
-    /// Returns the lesser of two scalar values.
-    T.removeReference min<T>       (T a, T b)              [[intrin: "min"]]       { static_assert (T.isScalar, "min() only works with scalar types"); return a < b ? a : b; }
-    /// Returns the lesser of two scalar values.
-    int32 min                      (int32 a, int32 b)      [[intrin: "min"]]       { return a < b ? a : b; }
-
-    /// Clamps a scalar value to the nearest value within a given range.
-    T.removeReference clamp<T>     (T n, T low, T high)    [[intrin: "clamp"]]     { static_assert (T.isScalar, "clamp() only works with scalar types"); return n < low ? low : (n > high ? high : n); }
-)soul_code"
-R"soul_code(
-
-    /// Performs a negative-number-aware modulo operation to wrap a number to a zero-based range.
-    T.removeReference wrap<T>      (T n, T range)          [[intrin: "wrap"]]      { static_assert (T.isScalar, "wrap() only works with scalar types");  if (range == 0) return 0; let x = n % range; if (x < 0) return x + range; return x; }
-    /// Performs a negative-number-aware integer modulo operation.
-    int32 wrap                     (int32 n, int32 range)  [[intrin: "wrap"]]      { if (range == 0) return 0; let x = n % range; if (x < 0) return x + range; return x; }
-    /// Performs a C++-compatible floor function on a scalar floating point value.
-    T.removeReference floor<T>     (T n)                   [[intrin: "floor"]]     { static_assert (T.isScalar && T.primitiveType.isFloat, "floor() only works with scalar floating point types");     let r = T (int64 (n)); return (r == n) ? n : (n >= 0 ? r : r - 1); }
-    /// Performs a C++-compatible ceil function on a scalar floating point value.
-    T.removeReference ceil<T>      (T n)                   [[intrin: "ceil"]]      { static_assert (T.isScalar && T.primitiveType.isFloat, "ceil() only works with scalar floating point types");      let r = T (int64 (n)); return (r == n) ? n : (n >= 0 ? r + 1 : r); }
-    /// Returns a linearly-interpolated value between two scalar values.
-    T.removeReference lerp<T>      (T start, T stop, T amount)                     { static_assert (T.isScalar && T.primitiveType.isFloat, "lerp() only works with scalar floating point types");      return start + (stop - start) * amount; }
-
-    /// Performs a C++-compatible fmod function on some scalar floating point values.
-    T.removeReference fmod<T>      (T x, T y)              [[intrin: "fmod"]]      { static_assert (T.isScalar && T.primitiveType.isFloat, "fmod() only works with scalar floating point types");      return x - (y * T (int (x / y))); }
-    /// Performs a C++-compatible remainder function on some scalar floating point values.
+    /// Performs a C++-compatible fmod function on some scalar floating point values.
+    T.removeReference fmod<T>      (T x, T y)              [[intrin: "fmod"]]      { static_assert (T.isScalar && T.primitiveType.isFloat, "fmod() only works with scalar floating point types");      return x - (y * T (int (x / y))); }
+    /// Performs a C++-compatible remainder function on some scalar floating point values.
 )soul_code"
 R"soul_code(
 
@@ -962,33 +638,130 @@ R"soul_code(
 }
 )soul_code";
 
-    if (moduleName == "soul.timeline")  return R"soul_code(
-/** Title: Timeline event utilities
+    if (moduleName == "soul.audio.utils")  return R"soul_code(
+/** Title: Miscellaneous audio utilities
 
-    The `timeline` namespace contains various structs and functions which are used when
-    dealing with positions and tempos along a timeline.
+    This module is a collection of commonly-used audio helper functions and types.
 */
 
-/// The `timeline` namespace contains various structs and functions which are used when
-/// dealing with positions and tempos along a timeline.
-namespace soul::timeline
+namespace soul
 {
     //==============================================================================
-    /** Represents a simple time-signature. */
-    struct TimeSignature
-    {
-        int numerator;     // The top number of a time-signature, e.g. the 3 of 3/4.
-        int denominator;   // The bottom number of a time-signature, e.g. the 4 of 3/4.
-    }
+    /// Converts a decibel level to a gain factor.
+    float32 dBtoGain (float32 decibels)   { return decibels > -100.0f ? pow (10.0f, decibels * 0.05f) : 0.0f; }
+    /// Converts a decibel level to a gain factor.
+    float64 dBtoGain (float64 decibels)   { return decibels > -100.0  ? pow (10.0,  decibels * 0.05)  : 0.0; }
 
-    //==============================================================================
-    /** Represents a tempo in BPM. */
-    struct Tempo
-    {
-        float bpm;  // beats per minute
-    }
+    /// Converts a gain factor to a decibel level.
+    float32 gainTodB (float32 gain)       { return gain > 0 ? log10 (gain) * 20.0f : -100.0f; }
+    /// Converts a gain factor to a decibel level.
+    float64 gainTodB (float64 gain)       { return gain > 0 ? log10 (gain) * 20.0  : -100.0; }
 
-    //==============================================================================
+    /// Converts a MIDI note (usually in the range 0-127) to a frequency in Hz.
+    float32 noteNumberToFrequency (int note)            { return 440.0f * pow (2.0f, (note - 69) * (1.0f / 12.0f)); }
+    /// Converts a MIDI note (usually in the range 0-127) to a frequency in Hz.
+    float32 noteNumberToFrequency (float32 note)        { return 440.0f * pow (2.0f, (note - 69.0f) * (1.0f / 12.0f)); }
+    /// Converts a frequency in Hz to an equivalent MIDI note number.
+    float32 frequencyToNoteNumber (float32 frequency)   { return 69.0f + (12.0f / log (2.0f)) * log (frequency * (1.0f / 440.0f)); }
+
+    /// Returns the ratio by which a sample's playback must be sped-up in order to map
+    /// from its native sample-rate and note to a target sample-rate and note.
+    float64 getSpeedRatioForPitchedSample (float64 sourceSampleRate, float32 sourceMIDINote,
+                                           float64 targetSampleRate, float32 targetMIDINote)
+    {
+        return (sourceSampleRate * pow (2.0f, targetMIDINote * (1.0f / 12.0f)))
+             / (targetSampleRate * pow (2.0f, sourceMIDINote * (1.0f / 12.0f)));
+    }
+
+)soul_code"
+R"soul_code(
+
+    /// Returns the coefficient for a filter pole, based on a t60 decay time in seconds.
+    float64 tau2pole (float64 t60, float64 sampleRate)   { return pow (0.001,  1.0  / (t60 * sampleRate)); }
+    /// Returns the coefficient for a filter pole, based on a t60 decay time in seconds.
+    float32 tau2pole (float32 t60, float32 sampleRate)   { return pow (0.001f, 1.0f / (t60 * sampleRate)); }
+
+    /// Returns the t60 decay time in seconds for a filter pole coefficient in the range 0 to 1.
+    float64 pole2tau (float64 pole, float64 sampleRate)   { return -1.0 / (log (pole) * sampleRate); }
+    /// Returns the t60 decay time in seconds for a filter pole coefficient in the range 0 to 1.
+    float32 pole2tau (float32 pole, float32 sampleRate)   { return -1.0f / (log (pole) * sampleRate); }
+}
+
+//==============================================================================
+/// This namespace contains some handy stuctures to use when declaring `external`
+/// variables which are going to be loaded with data from audio files.
+namespace soul::audio_samples
+{
+    /// An `external` variable declared with the type `soul::audio_samples::Mono`
+    /// can be loaded with monoised data from an audio file.
+    struct Mono
+    {
+        float[] frames;
+        float64 sampleRate;
+    }
+
+    /// An `external` variable declared with the type `soul::audio_samples::Stereo`
+    /// can be loaded with stereo data from an audio file.
+    struct Stereo
+    {
+        float<2>[] frames;
+        float64 sampleRate;
+    }
+}
+
+/// This namespace contains various pan-related helper functions
+namespace soul::pan_law
+{
+    /// Applies a simple linear pan law to convert a pan position (-1.0 to 1.0) to
+    /// a (left, right) pair of stereo gains.
+    float<2> linear (float pan)
+    {
+        return (1.0f - pan,
+                1.0f + pan);
+    }
+
+    /// Applies a 3dB-centre pan law to convert a pan position (-1.0 to 1.0) to
+    /// a (left, right) pair of stereo gains.
+    float<2> centre3dB (float pan)
+    {
+)soul_code"
+R"soul_code(
+
+        let quarterPi = float (pi / 4);
+
+        return (sin ((1.0f - pan) * quarterPi),
+                sin ((1.0f + pan) * quarterPi));
+    }
+}
+)soul_code";
+
+    if (moduleName == "soul.timeline")  return R"soul_code(
+/** Title: Timeline event utilities
+
+    The `timeline` namespace contains various structs and functions which are used when
+    dealing with positions and tempos along a timeline.
+*/
+
+/// The `timeline` namespace contains various structs and functions which are used when
+/// dealing with positions and tempos along a timeline.
+namespace soul::timeline
+{
+    //==============================================================================
+    /** Represents a simple time-signature. */
+    struct TimeSignature
+    {
+        int numerator;     // The top number of a time-signature, e.g. the 3 of 3/4.
+        int denominator;   // The bottom number of a time-signature, e.g. the 4 of 3/4.
+    }
+
+    //==============================================================================
+    /** Represents a tempo in BPM. */
+    struct Tempo
+    {
+        float bpm;  // beats per minute
+    }
+
+    //==============================================================================
     /** */
     float quarterNotesPerBeat (TimeSignature timeSig)                                       { return 4.0f / timeSig.denominator; }
     /** */
@@ -1052,710 +825,630 @@ R"soul_code(
 }
 )soul_code";
 
-    if (moduleName == "soul.filters")  return R"soul_code(
-/** Title: Filters
-
-    This module contains a collection of filter implementations, including more traditional
-    biquad based filters and TPT variants, which are more suitable for modulation.
-
-    Notes:
-    - Filter coefficients are typically labelled a and b. Different literature uses different
-      conventions for what a and b mean. This code uses the following:
-        * `b`: feed-forward, numerator, zero, FIR coefficients.
-        * `a`: feed-back, denominator, pole, IIR coefficients.
-    - Although each filter comes with a Processor, they are designed so that their state,
-      coefficients and functions can be used independently.
-    - Each filter has a `State` struct and a `Coeffs` struct.
-    - `process()` functions generate an output y for an input x.
-    - `update()` functions take high level parameters such as mode, frequency, Q, mode and
-      update the filter coefficients.
-    - `reset()` functions reset the filter state/histories to 0.
-    - `clear()` functions clears filter coefficients.
-    - The filters are designed for channel-wise vectorisation, which can be achieved by
-      specialising the filter's namespace with a vector type.
-    - Some filters are suitable for modulation, others are not, check the comments at the top
-      of the namespace.
-*/
-
-namespace soul::filters (using SampleType = float32,
-                         using CoeffType  = float64,
-                         int updateInterval = 16)
+    if (moduleName == "soul.complex")  return R"soul_code(
+namespace soul::complex_lib::imp (using FloatType, int vectorSize)
 {
-    // Processor parameter min/max/defaults
-    let minFreqHz = 5.0f;
-    let maxFreqHz = 22000.0f;
-    let defaultFreqHz = 1000.0f;
-    let defaultQuality = 0.707107f; // 1.0 / sqrt (2.0) butterworth response
-    let defaultGain = 0.f;
-
-    /** The frequency upper-bound for update functions.
-        (Just below nyquist, e.g 0.49 * 44100 = ~22kHz).
-    */
-    let normalisedFreqLimit = 0.49;
-
-    //==============================================================================
-    /** Highpass filter for removing DC offset.
+    namespace complex_element = imp (FloatType, 1);
 
-            y[n] = x[n] - x[n-1] + b0 * y[n-1]
+    struct ComplexType
+    {
+        FloatType<vectorSize> real, imag;
+    }
 
-)soul_code"
-R"soul_code(
+    ComplexType negate (ComplexType v)
+    {
+        return ComplexType (-v.real, -v.imag);
+    }
 
-        https://ccrma.stanford.edu/~jos/fp/DC_Blocker.html
-    */
-    namespace dc_blocker
+    ComplexType conj (ComplexType v)
     {
-        /** Holds a set of filter coefficients. */
-        struct Coeffs
-        {
-            CoeffType b1;
-            CoeffType a0;
-        }
+        return ComplexType (v.real, -v.imag);
+    }
 
-        /** Holds the filter state. */
-        struct State
-        {
-            SampleType[1] x;
-            SampleType[1] y;
-        }
+    ComplexType add (ComplexType left, ComplexType right)
+    {
+        return ComplexType (left.real + right.real,
+                            left.imag + right.imag);
+    }
 
-        /** Resets a filter state. */
-        void reset (State& s)
-        {
-            s.x[0] = SampleType();
-            s.y[0] = SampleType();
-        }
+    ComplexType subtract (ComplexType left, ComplexType right)
+    {
+        return ComplexType (left.real - right.real,
+                            left.imag - right.imag);
+    }
 
-        /** Updates a set of coefficients for the given settings. */
-        void update (Coeffs& c, float64 sampleRate, float64 freqHz)
-        {
-            let w = pi * freqHz / sampleRate;
-            c.a0 = CoeffType (1.0 / (1.0 + w));
-            c.b1 = CoeffType ((1.0 - w) * c.a0);
-        }
+    ComplexType multiply (ComplexType left, ComplexType right)
+    {
+        return ComplexType (left.real * right.real - left.imag * right.imag,
+                            left.real * right.imag + left.imag * right.real);
+    }
 
-        SampleType process (State& s, SampleType x, Coeffs& c)
-        {
-            let y = SampleType (x - s.x[0] + c.a0 * s.y[0]);
-            s.x[0] = x;
-            s.y[0] = y;
-            return SampleType (c.b1 * y);
-        }
+    ComplexType divide (ComplexType left, ComplexType right)
+    {
+        let c = right.conj();
+        let result = multiply (left, c);
+        let scale = multiply (right, c).real;
 
-        processor Processor (float64 frequency = 30.0f)
-        {
-            input stream SampleType in;
-            output stream SampleType out;
+        return ComplexType (result.real / scale,
+                            result.imag / scale);
+    }
 
-            void run()
-            {
-                State s;
-                Coeffs c;
+    bool<vectorSize> equals (ComplexType left, ComplexType right)
+    {
+        var realComparison = left.real == right.real;
+        let imagComparison = left.imag == right.imag;
 
-                c.update (processor.frequency, frequency);
+        for (wrap<vectorSize> i)
+            realComparison[i] = realComparison[i] && imagComparison[i];
 
-                loop
-                {
-                    out << s.process (in, c);
-                    advance();
-                }
-            }
-        }
+        return realComparison;
     }
 
-    //==============================================================================
-    /** Biquadratic (two-pole-two-zero) IIR filter building block.
+    bool<vectorSize> notEquals (ComplexType left, ComplexType right)
+    {
+        var r = equals (left, right);
 
-        Direct Form I (DFI):
+        for (wrap<vectorSize> i)
+            r[i] = ! r[i];
 
-            y[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] - a1 * y[n-1] - a2 * y[n-2]
+        return r;
+    }
 
-        Transposed Direct Form II (TDFII):
-
-            y[n] = b0 * x[n] + s1
-              s1 = b1 * x[n] + a1 * y[n] + s2
-              s2 = b2 * x[n] + a2 * y[n]
-    */
-    namespace biquad
+    complex_element::ComplexType getElement (ComplexType c, int element)
     {
+        return complex_element::ComplexType (c.real.at (element),
+                                            c.imag.at (element));
+    }
+
 )soul_code"
 R"soul_code(
 
-        // Coefficients and related functions
+    complex_element::ComplexType setElement (ComplexType& c, int element, complex_element::ComplexType value)
+    {
+        c.real.at (element) = value.real;
+        c.imag.at (element) = value.imag;
 
-        /** Holds a set of filter coefficients. */
-        struct Coeffs
-        {
-            CoeffType<3> b, /**< feed-forward, numerator, zero, FIR coefficients */
-                         a; /**< feed-back, denominator, pole, IIR coefficients */
-        }
+        return value;
+    }
+}
+)soul_code";
 
-        /** Initialises a set of coefficients. */
-        void set (Coeffs &c,
-                  CoeffType b0, CoeffType b1, CoeffType b2,
-                  CoeffType a0, CoeffType a1, CoeffType a2)
-        {
-            c.b[0] = b0; c.b[1] = b1; c.b[2] = b2; c.a[0] = a0; c.a[1] = a1; c.a[2] = a2;
-        }
+    if (moduleName == "soul.notes")  return R"soul_code(
+/** Title: Musical note utilities
 
-        /** Sets the coefficients, normalising based on the first feedback coefficient v.a[0] */
-        void setNonNormalised (Coeffs &c, const Coeffs& v)
-        {
-            let oneOverA0 = 1.0 / v.a[0];
-            c.b = v.b * oneOverA0;
-            c.a = v.a * oneOverA0;
-            c.a[0] = v.a[0]; // keep original a0
-        }
+    This module contains various structs which can be used to model note-control events
+    coming from sources such as MIDI keyboards.
 
-        /** Sets the coefficients, assuming v is already normalised. */
-        void setNormalised (Coeffs &c, Coeffs v)
-        {
-            c = v;
-        }
+    The SOUL policy is to keep the use of actual MIDI to a minimum, so we encourage
+    incoming MIDI data to be converted into these strongly-typed structures, and to use
+    them internally, rather than attempting to work with MIDI bytes like it's the 1980s.
+*/
 
-        /** Clears a set of coefficients. */
-        void clear (Coeffs &c)
-        {
-            c.b = CoeffType();
-            c.a = CoeffType();
-        }
+/**
+    This namespace contains some types which are handy for representing synthesiser
+    note events. They do a similar job to MIDI events, but as strongly-typed structs
+    instead of a group of bytes. Things like the midi::MPEParser class generate them.
 
-        /** Holds the filter state. */
-        struct State
-        {
-            SampleType[2] x;
-            SampleType[2] y;
-        }
+    The events do contain a channel number, in the same way that MIDI does, but there
+    are no restrictions on its range.
+*/
+namespace soul::note_events
+{
+    /// Represents a note-on (key-down) event.
+    struct NoteOn
+    {
+        int channel;
+        float note;
+        float velocity;
+    }
 
-        /** Resets a filter state. */
-        void reset (State &s)
-        {
-            s.x[0] = SampleType();
-            s.x[1] = SampleType();
-            s.y[0] = SampleType();
-            s.y[1] = SampleType();
-        }
+    /// Represents a note-off (key-up) event.
+    struct NoteOff
+    {
+        int channel;
+        float note;
+        float velocity;
+    }
 
-        /** */
-        SampleType processDFI (State& s, SampleType x, Coeffs& c)
-        {
-            let y  = SampleType (c.b[0] * x
-                               + c.b[1] * s.x[0]
-                               + c.b[2] * s.x[1]
-                               - c.a[1] * s.y[0]
-                               - c.a[2] * s.y[1]);
+    /// Represents a change to the pitch that should be applied to any notes
+    /// being played on the channel specified.
+    struct PitchBend
+    {
+        int channel;
+        float bendSemitones;
+    }
+
+    /// Represents a change to the pressure that should be applied to any notes
+    /// being played on the channel specified.
+    struct Pressure
+    {
+        int channel;
+        float pressure;
+    }
+
+    /// Represents a change to the Y-axis parameter that should be applied to any notes
+    /// being played on the channel specified.
+    struct Slide
+    {
+        int channel;
+        float slide;
+    }
+
+    /// Represents a change to a user-defined control parameter that should be applied
+    /// to any notes being played on the channel specified.
+    struct Control
+    {
+        int channel;
+        int control;
+        float value;
+    }
+}
 
-            s.x[1] = s.x[0];
-            s.x[0] = x;
 )soul_code"
 R"soul_code(
 
-            s.y[1] = s.y[0];
-            s.y[0] = y;
-
-            return y;
-        }
+//==============================================================================
+/**
+    Simple voice allocation helpers, which take a single stream of input events,
+    and redirect them to an array of target voice processors.
+*/
+namespace soul::voice_allocators
+{
+    /** A simple voice-allocator which will find either an inactive voice, or the
+        least-recently used active voice if it needs to steal one.
+    */
+    processor Basic (int voiceCount)  [[ main: false ]]
+    {
+        input event (soul::note_events::NoteOn,
+                     soul::note_events::NoteOff,
+                     soul::note_events::PitchBend,
+                     soul::note_events::Pressure,
+                     soul::note_events::Slide,
+                     soul::note_events::Control) eventIn;
 
-        /** See https://www.earlevel.com/DigitalAudio/images/BiquadTDFII.gif */
-        SampleType processTDFII (State& s, SampleType x, Coeffs& c)
-        {
-            let y  = s.x[0] + SampleType (c.b[0]) * x;
-            s.x[0] = s.y[0] + SampleType (c.b[1]) * x - SampleType (c.a[1]) * y;
-            s.y[0] = SampleType (c.b[2]) * x - SampleType (c.a[2]) * y;
-            return y;
-        }
+        output event (soul::note_events::NoteOn,
+                      soul::note_events::NoteOff,
+                      soul::note_events::PitchBend,
+                      soul::note_events::Pressure,
+                      soul::note_events::Slide,
+                      soul::note_events::Control) voiceEventOut[voiceCount];
 
-        /** Like processTDFII, but optimised for c.b[2] and c.a[2] == 0. */
-        SampleType processOnePole (State& s, SampleType x, Coeffs& c)
+        event eventIn (soul::note_events::NoteOn e)
         {
-            let y  = s.x[0] + SampleType (c.b[0]) * x;
-            s.x[0] = SampleType (c.b[1]) * x - SampleType (c.a[1]) * y;
-            return y;
-        }
+            wrap<voiceCount> allocatedVoice = 0;
+            var allocatedVoiceAge = voiceInfo[allocatedVoice].voiceAge;
 
-        /** */
-        SampleType processCascadeDFI<StateArrayType, CoeffsArrayType> (SampleType x,
-                                                                       StateArrayType& s,
-                                                                       CoeffsArrayType& c)
-        {
-            static_assert (StateArrayType.isArray, "states argument is not an array");
-            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
-            static_assert (s.size == c.size, "states and coeffs arrays are not the same size");
+            // Find the oldest voice to reuse
+            for (int i = 1; i < voiceCount; ++i)
+            {
+                let age = voiceInfo.at(i).voiceAge;
 
-            var y = x;
+                if (age < allocatedVoiceAge)
+                {
+                    allocatedVoiceAge = age;
+                    allocatedVoice = wrap<voiceCount>(i);
+                }
+            }
 
-            for (wrap<s.size> i)
-                y = processDFI (s[i], y, c[i]);
+            // Send the note on to the voice
+            voiceEventOut[allocatedVoice] << e;
 
-            return y;
-        }
+            // If the voice was previously active, we're stealing it, so send a note off too
+            if (voiceInfo[allocatedVoice].active)
+            {
+                soul::note_events::NoteOff noteOff;
 
-        /** */
-        SampleType processCascadeTDFII<StateArrayType, CoeffsArrayType> (SampleType x,
-                                                                         StateArrayType& s,
-                                                                         CoeffsArrayType& c)
-        {
-            static_assert (StateArrayType.isArray, "states argument is not an array");
-            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
+                noteOff.channel = voiceInfo[allocatedVoice].channel;
 )soul_code"
 R"soul_code(
 
-            static_assert (s.size == c.size, "states and coeffs arrays are not the same size");
-
-            var y = x;
+                noteOff.note    = voiceInfo[allocatedVoice].note;
 
-            for (wrap<s.size> i)
-                y = processTDFII (s[i], y, c[i]);
+                voiceEventOut[allocatedVoice] << noteOff;
+            }
 
-            return y;
+            // Update the VoiceInfo for our chosen voice
+            voiceInfo[allocatedVoice].active   = true;
+            voiceInfo[allocatedVoice].channel  = e.channel;
+            voiceInfo[allocatedVoice].note     = e.note;
+            voiceInfo[allocatedVoice].voiceAge = nextAllocatedVoiceAge++;
         }
-    }
 
-    //==============================================================================
-    /**
-        First-order IIR filter.
+        event eventIn (soul::note_events::NoteOff e)
+        {
+            // Release all voices associated with this note/channel
+            wrap<voiceCount> voice = 0;
 
-            y[n] = b0 * x[n] - a1 * y[n-1]
+            loop (voiceCount)
+            {
+                if (voiceInfo[voice].channel == e.channel
+                     && voiceInfo[voice].note == e.note)
+                {
+                    // Mark the voice as being unused
+                    voiceInfo[voice].active   = false;
+                    voiceInfo[voice].voiceAge = nextUnallocatedVoiceAge++;
 
-        Coefficients derived from Pirkle.
-        This filter is not suitable for modulation.
-    */
-    namespace onepole
-    {
-        namespace biquad = soul::filters::biquad;
+                    voiceEventOut[voice] << e;
+                }
 
-        /** Constants for use in specifying the filter mode. */
-        namespace Mode
-        {
-            let lowpass  = 0;
-            let highpass = 1;
-            let allpass  = 2;
+                ++voice;
+            }
         }
 
-        /** Updates a set of coefficients for the given settings. */
-        void update (biquad::Coeffs& c, float64 sampleRate, int mode, float64 freqHz)
+        event eventIn (soul::note_events::PitchBend e)
         {
-            biquad::Coeffs nc; // normalised coefficients
-            nc.a[0] = 1.0;
+            // Forward the pitch bend to all notes on this channel
+            wrap<voiceCount> voice = 0;
 
-            let theta = twoPi * (freqHz / sampleRate);
+            loop (voiceCount)
+            {
+                if (voiceInfo[voice].channel == e.channel)
+                    voiceEventOut[voice] << e;
 
-            if (mode == Mode::lowpass)
+                ++voice;
+            }
+        }
+
+        event eventIn (soul::note_events::Pressure p)
+        {
+            // Forward the event to all notes on this channel
+            wrap<voiceCount> voice = 0;
+
+            loop (voiceCount)
             {
-                let gamma = cos (theta) / (1.0 + sin (theta));
+                if (voiceInfo[voice].channel == p.channel)
+                    voiceEventOut[voice] << p;
 
-                nc.b[0] = (1.0 - gamma) / 2.0;
-                nc.b[1] = (1.0 - gamma) / 2.0;
-                nc.a[1] = -gamma;
+                ++voice;
             }
-            else if (mode == Mode::highpass)
+        }
+
+        event eventIn (soul::note_events::Slide s)
+        {
+            // Forward the event to all notes on this channel
+            wrap<voiceCount> voice = 0;
+
+)soul_code"
+R"soul_code(
+
+            loop (voiceCount)
             {
-                let gamma = cos (theta) / (1.0 + sin (theta));
+                if (voiceInfo[voice].channel == s.channel)
+                    voiceEventOut[voice] << s;
 
-                nc.b[0] = (1.0 + gamma) / 2.0;
-                nc.b[1] = -(1.0 + gamma) / 2.0;
-                nc.a[1] = -gamma;
+                ++voice;
             }
-            else if (mode == Mode::allpass)
+        }
+
+        event eventIn (soul::note_events::Control c)
+        {
+            // Forward the event to all notes on this channel
+            wrap<voiceCount> voice = 0;
+
+            loop (voiceCount)
             {
-                let w = tan (theta * 0.5);
-                let alpha = (w - 1.0) / (w + 1.0);
+                if (voiceInfo[voice].channel == c.channel)
+                    voiceEventOut[voice] << c;
 
-                nc.b[0] = alpha;
-                nc.b[1] = 1.0;
-                nc.a[1] = alpha;
+                ++voice;
             }
+        }
 
-            c.setNormalised (nc);
+        struct VoiceInfo
+        {
+            bool active;
+            int channel;
+            float note;
+            int voiceAge;
         }
 
-        /** A processor to render a onepole filter. */
-        processor Processor (int initialMode = 0,
+        int nextAllocatedVoiceAge   = 1000000000;
+        int nextUnallocatedVoiceAge = 1;
+
+        VoiceInfo[voiceCount] voiceInfo;
+    }
+}
+)soul_code";
+
+    if (moduleName == "soul.oscillators")  return R"soul_code(
+/** Title: Oscillators
+
+    This module contains a collection of oscillator algorithms for generating
+    various wave-shapes. The collection covers low frequency designs and high quality alias
+    free algotithms.
+*/
+
+/**
+    The `oscillators` namespace is parameterised with a `SampleType` and `PhaseType`. The `SampleType` specifies
+    the output type, and can be either `float32` or `float64`. The `PhaseType` is used internally to track
+    phase position, so higher resolution data types can be used to reduce frequency inaccuracy for very critical
+    applications.
+
+    By default the `SampleType` and `PhaseType` are float32.
+*/
+namespace soul::oscillators (using SampleType = float32,
+                             using PhaseType  = float32)
+{
+    static_assert (SampleType.isFloat, "The SampleType must be a float");
+    static_assert (PhaseType.isFloat && ! PhaseType.isVector, "The PhaseType must be a float");
+
+    let minFreqHz = 0.0f;
+    let maxFreqHz = 22000.0f;
+    let defaultFreqHz = 1000.0f;
+
+    //==============================================================================
+    /// A unipolar ramp (phasor) oscillator.
+    /// This is a non-bandlimited oscillator that will cause aliasing, but is used internally by the BLEP oscillator.
+    namespace phasor
+    {
+        struct State
+        {
+            /// The phase uses a range 0 to 1.0
+            PhaseType phase;
+            /// The increment of phase per frame
+            PhaseType phaseIncrement;
+        }
+
+        /// Resets a phaser::State object
+        void reset (State& s)
+        {
+            s.phase = PhaseType();
+        }
+
+        /// Updates a phaser::State object for a new rate
+        void update (State& s, float64 samplePeriod, float64 freqHz)
+        {
+            s.phaseIncrement = PhaseType (samplePeriod * freqHz);
+        }
+
+        /// Increments a phaser::State object and returns the new phase
+        PhaseType process (State& s)
+        {
+            s.phase += s.phaseIncrement;
+
 )soul_code"
 R"soul_code(
 
-                             float initialFrequency = defaultFreqHz)
+            while (s.phase >= PhaseType (1))
+                s.phase -= PhaseType (1);
+
+            return s.phase;
+        }
+
+        /// A processor that produces a stream of phase values as its output.
+        processor Processor (float initialFrequency = 1000)
         {
-            input stream SampleType in;
             output stream SampleType out;
+            input event float frequencyIn [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz" ]];
+            event frequencyIn (float v) { s.update (processor.period, v); }
 
-            input event
+            State s;
+
+            void init()
             {
-                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                float modeIn      [[ name: "Mode",      min: 0,           max: 2,         init: 0,         text: "Lowpass|Highpass|Allpass"]];
+                s.update (processor.period, initialFrequency);
             }
 
-            event frequencyIn (float v)   { frequency = v;  recalc = true; }
-            event modeIn      (float v)   { mode = int (v); recalc = true; }
-
-            float frequency  = initialFrequency;
-            int   mode       = initialMode;
-            bool  recalc     = true;
-
             void run()
             {
-                biquad::State s;
-                biquad::Coeffs c;
-
                 loop
                 {
-                    if (recalc)
-                    {
-                        recalc = false;
-                        let clippedFrequency = clamp (float64 (frequency),
-                                                      float64 (minFreqHz),
-                                                      processor.frequency * normalisedFreqLimit);
-                        update (c, processor.frequency, mode, clippedFrequency);
-                    }
-
-                    loop (updateInterval)
-                    {
-                        out << s.processOnePole (in, c);
-                        advance();
-                    }
+                    out << SampleType (s.process());
+                    advance();
                 }
             }
         }
     }
 
     //==============================================================================
-    /** RBJ biquad EQ, 2nd Order IIR Filter.
-
-        This filter is not suitable for modulation.
-        See https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
-    */
-    namespace rbj_eq
+    /// A simple sinewave oscillator which receives input events to control its frequency.
+    processor Sine (float initialFrequency = 1000)
     {
-        namespace biquad = soul::filters::biquad;
-
-        /** Constants for use in specifying the filter mode. */
-        namespace Mode
-        {
-)soul_code"
-R"soul_code(
+        output stream SampleType out;
+        input event float frequencyIn  [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz" ]];
+        event frequencyIn (float v) { phaseIncrement = float (v * twoPi * processor.period); }
 
-            let lowpass   = 0;
-            let highpass  = 1;
-            let bandpass  = 2;
-            let lowShelf  = 3;
-            let highShelf = 4;
-            let peaking   = 5;
-            let notch     = 6;
-            let allpass   = 7;
-        }
+        var phaseIncrement = float (initialFrequency * twoPi * processor.period);
 
-        /** Updates a set of coefficients for the given settings. */
-        void update (biquad::Coeffs& c,
-                     float64 sampleRate, int mode, float64 freqHz,
-                     float64 quality, float64 gaindB)
+        void run()
         {
-            biquad::Coeffs nnc; // non-normalised coefficients
-
-            let theta = twoPi * (freqHz / sampleRate);
-            let sinTheta = sin (theta);
-            let cosTheta = cos (theta);
-            let Q = max (quality, 0.001);
-            let alpha = sinTheta / (2.0 * Q);
+            float phase;
 
-            if (mode == Mode::lowpass)
+            loop
             {
-                nnc.b[0] = (1.0 - cosTheta) / 2.0;
-                nnc.b[1] =  1.0 - cosTheta;
-                nnc.b[2] = (1.0 - cosTheta) / 2.0;
-                nnc.a[0] =  1.0 + alpha;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] =  1.0 - alpha;
+                out << sin (phase);
+                phase = addModulo2Pi (phase, phaseIncrement);
+                advance();
             }
-            else if (mode == Mode::highpass)
-            {
-                nnc.b[0] = (1.0 + cosTheta) / 2.0;
-                nnc.b[1] = -(1.0 + cosTheta);
-                nnc.b[2] = (1.0 + cosTheta) / 2.0;
-                nnc.a[0] =  1.0 + alpha;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] =  1.0 - alpha;
-            }
-            else if (mode == Mode::bandpass) // (constant 0 dB peak gain)
-            {
-                nnc.b[0] = alpha;
-                nnc.b[1] = 0.0;
-                nnc.b[2] = -alpha;
-                nnc.a[0] =  1.0 + alpha;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] =  1.0 - alpha;
-            }
-            else if (mode == Mode::lowShelf)
-            {
-                let A = pow (10.0, gaindB / 40.0);
-                nnc.b[0] = A * ((A + 1) - (A - 1) * cosTheta + 2 * sqrt (A) * alpha);
+        }
+    }
+
+    //==============================================================================
+    /// A semi band-limited oscillator with sawtooth, square and triangle wave shapes
+    /// using the PolyBLEP (Polynomial Band-Limited Step) technique.
+    /// You may want to oversample this oscillator, in order to reduce aliasing.
+    ///
 )soul_code"
 R"soul_code(
 
-                nnc.b[1] = 2.0 * A * ( (A - 1) - (A + 1) * cosTheta);
-                nnc.b[2] = A * ((A + 1) - (A - 1) * cosTheta - 2 * sqrt (A) * alpha);
-                nnc.a[0] = (A + 1) + (A - 1) * cosTheta + 2 * sqrt (A) * alpha;
-                nnc.a[1] = -2.0 * ( (A - 1) + (A + 1) * cosTheta);
-                nnc.a[2] = (A + 1) + (A - 1) * cosTheta - 2 * sqrt (A) * alpha;
-            }
-            else if (mode == Mode::highShelf)
-            {
-                let A = pow (10.0, gaindB / 40.0);
-                nnc.b[0] = A * ((A + 1) + (A - 1) * cosTheta + 2.0 * sqrt (A) * alpha);
-                nnc.b[1] = -2.0 * A * ( (A - 1) + (A + 1) * cosTheta);
-                nnc.b[2] = A * ((A + 1) + (A - 1) * cosTheta - 2.0 * sqrt (A) * alpha);
-                nnc.a[0] = (A + 1) - (A - 1) * cosTheta + 2.0 * sqrt (A) * alpha;
-                nnc.a[1] = 2.0 * ( (A - 1) - (A + 1) * cosTheta);
-                nnc.a[2] = (A + 1) - (A - 1) * cosTheta - 2.0 * sqrt (A) * alpha;
-            }
-            else if (mode == Mode::peaking)
+    namespace poly_blep
+    {
+        /// Contains different wave-shaping functions.
+        namespace shapers
+        {
+            /// Generates a polyblep
+            PhaseType polyblep (PhaseType phase, PhaseType phaseIncrement)
             {
-                let A = pow (10.0, gaindB / 40.0);
-                nnc.b[0] = 1.0 + alpha * A;
-                nnc.b[1] = -2.0 * cosTheta;
-                nnc.b[2] = 1.0 - alpha * A;
-                nnc.a[0] = 1.0 + alpha / A;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] = 1.0 - alpha / A;
+                if (phase < phaseIncrement)
+                {
+                    phase /= phaseIncrement;
+                    return (phase + phase) - (phase * phase) - PhaseType (1);
+                }
+
+                if (phase > PhaseType (1) - phaseIncrement)
+                {
+                    phase = (phase - PhaseType (1)) / phaseIncrement;
+                    return (phase * phase) + (phase + phase) + PhaseType (1);
+                }
+
+                return PhaseType (0);
             }
-            else if (mode == Mode::notch)
+
+            /// Generates a sawtooth wave from a phasor state
+            PhaseType sawtooth (phasor::State& s)
             {
-                nnc.b[0] = 1.0;
-                nnc.b[1] = -2.0 * cosTheta;
-                nnc.b[2] = 1.0;
-                nnc.a[0] = 1.0 + alpha;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] = 1.0 - alpha;
+                return PhaseType (-1) + (PhaseType (2) * s.phase) - polyblep (s.phase, s.phaseIncrement);
             }
-            else if (mode == Mode::allpass)
+
+            /// Generates a square wave from a phasor state
+            PhaseType square (phasor::State& s)
             {
-                nnc.b[0] = 1.0 - alpha;
-                nnc.b[1] = -2.0 * cosTheta;
-                nnc.b[2] = 1.0 + alpha;
-                nnc.a[0] = 1.0 + alpha;
-                nnc.a[1] = -2.0 * cosTheta;
-                nnc.a[2] = 1.0 - alpha;
+                return (s.phase < PhaseType (0.5) ? PhaseType (-1) : PhaseType (1))
+                        - polyblep (s.phase, s.phaseIncrement)
+                        + polyblep (fmod (s.phase + PhaseType (0.5), PhaseType (1)), s.phaseIncrement);
             }
+        }
 
-)soul_code"
-R"soul_code(
-
-            c.setNonNormalised (nnc);
+        /// Contains constants for different wave-shapes
+        namespace Shape
+        {
+            let sawtooth = 0;
+            let triangle = 1;
+            let square   = 2;
         }
 
-        /** */
-        processor Processor (int initialMode = 0,
-                             float initialFrequency = defaultFreqHz,
-                             float initialQuality   = defaultQuality,
-                             float initialGain      = defaultGain)
+        /// A processor which generates a dynamically adjustable wave-shape.
+        processor Processor (int initialShape = 0,
+                            float initialFrequency = 1000)
         {
-            input stream SampleType in;
             output stream SampleType out;
+            input event float shapeIn       [[ name: "Shape",     min: 0,         max: 2,         init: 0,    text: "Sawtooth|Triangle|Square"]];
+)soul_code"
+R"soul_code(
 
-            input event
-            {
-                float modeIn      [[ name: "Mode",      min: 0,           max: 7,         init: 0,         text: "Lowpass|Highpass|Bandpass|LowShelf|HighShelf|Peaking|Notch|Allpass"]];
-                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                float qualityIn   [[ name: "Q",         min: 0.,          max: 10.0,      init: defaultQuality]];
-                float gainIn      [[ name: "Gain",      min: -36.0,       max: 36.0,      init: defaultGain, unit: "dB"]];
-            }
+            input event float frequencyIn   [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
 
-            event frequencyIn (float v) { frequency = v;   recalc = true; }
-            event qualityIn   (float v) { quality = v;     recalc = true; }
-            event gainIn      (float v) { gain = v;        recalc = true; }
-            event modeIn      (float v) { mode = int (v);  recalc = true; }
+            event shapeIn (float v)        { shape = wrap<3> (floor (v)); }
+            event frequencyIn (float v)    { s.update (processor.period, v); }
 
-            float  frequency = initialFrequency;
-            float  quality   = initialQuality;
-            float  gain      = initialGain;
-            int    mode      = initialMode;
-            bool   recalc    = true;
+            phasor::State s;
+            var shape = wrap<3> (initialShape);
+
+            void init()
+            {
+                s.update (processor.period, initialFrequency);
+            }
 
             void run()
             {
-                biquad::State s;
-                biquad::Coeffs c;
+                PhaseType y = PhaseType (0);
+                PhaseType triAccumulator = PhaseType (0);
 
                 loop
                 {
-                    if (recalc)
+                    if (shape == Shape::sawtooth)
                     {
-                        recalc = false;
-                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
-                        c.update (processor.frequency, mode, clippedFrequency, quality, gain);
+                        y = shapers::sawtooth (s);
                     }
-
-)soul_code"
-R"soul_code(
-
-                    loop (updateInterval)
+                    else if (shape == Shape::triangle)
                     {
-                        out << s.processTDFII (in, c);
-                        advance();
+                        // leaky integrator
+                        let coefficient = PhaseType (1.0 - (0.25 * s.phaseIncrement));
+                        triAccumulator = s.phaseIncrement * shapers::square (s) + coefficient * triAccumulator;
+                        y = triAccumulator * PhaseType (4);
+                    }
+                    else if (shape == Shape::square)
+                    {
+                        y = shapers::square (s);
                     }
+
+                    s.process();
+
+                    out << SampleType (y);
+
+                    advance();
                 }
             }
         }
     }
 
     //==============================================================================
-    /**
-        Generic second-order-section cascade biquad processors.
-    */
-    namespace sos_cascade
+    /// A quadrature sinusoidal oscillator producing sine and cosine outputs simultaneously.
+    /// The `updateInterval` defines the samples between updates to the frequency taking effect.
+    /// https://vicanek.de/articles/QuadOsc.pdf
+    ///
+    namespace quadrature (int updateInterval = 16)
     {
-        namespace biquad = soul::filters::biquad;
-
-        /** Supply an array of coefficients for each SOS. The size of the array should be a multiple of 6,
-            and the coefficients are expected to be normalised already
-        */
-        processor Processor (const CoeffType[] coeffs)
+        struct State
         {
-            input stream SampleType in;
-            output stream SampleType out;
-
-            let numSOS = size (coeffs) / 6;
-            biquad::State[numSOS] s;
-            biquad::Coeffs[numSOS] c;
-
-            void init()
-            {
-                static_assert (size (coeffs) % 6 == 0, "coeffs is not a multiple of 6");
-
-                wrap<numSOS> section = 0;
-                wrap<coeffs.size> coeffIdx = 0;
-
-                loop (numSOS)
-                {
-                    // TODO: replace with dynamic array slice
-                    biquad::set (c[section], coeffs[wrap<coeffs.size> (coeffIdx + 0)],
-                                             coeffs[wrap<coeffs.size> (coeffIdx + 1)],
-                                             coeffs[wrap<coeffs.size> (coeffIdx + 2)],
-                                             coeffs[wrap<coeffs.size> (coeffIdx + 3)],
-                                             coeffs[wrap<coeffs.size> (coeffIdx + 4)],
-                                             coeffs[wrap<coeffs.size> (coeffIdx + 5)]);
-                    section++;
-                    coeffIdx += 6;
-                }
-            }
+            SampleType u, v;
+        }
 
-            void run()
-            {
-                loop
-                {
-                    out << biquad::processCascadeTDFII (in, s, c);
+        struct Coeffs
+        {
+            SampleType k1, k2;
 )soul_code"
 R"soul_code(
 
-                    advance();
-                }
-            }
         }
-    }
-
-    //==============================================================================
-    /**
-        N-th order Butterworth filter, made by cascading multiple second order sections.
-
-        This filter is not suitable for modulation.
-    */
-    namespace butterworth
-    {
-        namespace biquad = soul::filters::biquad;
-        namespace onepole = soul::filters::onepole;
-        namespace rbj = soul::filters::rbj_eq;
 
-        /** Constants for use in specifying the filter mode. */
-        namespace Mode
+        /// Resets a quadrature::State object.
+        void reset (State& s)
         {
-            let lowpass  = 0;
-            let highpass = 1;
+            s.u = SampleType (1);
+            s.v = SampleType();
         }
 
-        /** Updates a set of coefficients for the given settings. */
-        void update<CoeffsArrayType> (CoeffsArrayType& coeffs, float64 sampleRate, int order, int mode, float64 freqHz)
+        /// Updates a quadrature::State object for a new rate.
+        void update (Coeffs& c, float64 freqHz, float64 sampleRate)
         {
-            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
-
-            biquad::Coeffs nc; // normalised coefficients
-
-            bool oddOrder = (order % 2) == 1;
-
-            if (oddOrder)
-            {
-                onepole::update (nc, sampleRate, mode, freqHz);
-                coeffs.at (0).setNormalised (nc);
-
-                for (int i=0; i<order/2; i++)
-                {
-                    let Q = 1.0 / (2.0 * cos ((CoeffType (i) + 1.0) * pi / order));
-                    rbj::update (nc, sampleRate, mode, freqHz, Q, 0.);
-                    coeffs.at (i+1).setNormalised (nc);
-                }
-            }
-            else
-            {
-                for (wrap<coeffs.size> i)
-                {
-                    let Q = 1.0 / (2.0 * cos ((2.0 * CoeffType (i) + 1.0) * pi / (order * 2.0)));
-                    rbj::update (nc, sampleRate, mode, freqHz, Q, 0.);
-                    coeffs.at (i).setNormalised (nc);
-                }
-            }
+            let w = twoPi * (freqHz / sampleRate);
+            c.k1 = SampleType (tan (0.5 * w));
+            c.k2 = SampleType (2.0 * c.k1 / (1.0 + c.k1 * c.k1));
         }
 
-        /** Butterworth processor.
-            The order must be > 0
-        */
-        processor Processor (int order,
-)soul_code"
-R"soul_code(
+        /// Generates the next samples for a quadrature::State object.
+        SampleType[2] process (State& s, Coeffs& c)
+        {
+            let tmp = s.u - c.k1 * s.v;
+            s.v = s.v + c.k2 * tmp;
+            s.u = tmp - c.k1 * s.v;
+            return SampleType[2] (s.v, s.u);
+        }
 
-                             int initialMode = 0,
-                             float initialFrequency = defaultFreqHz)
+        /// A processor that generates a pair of sine/cosine output streams.
+        processor Processor (float initialFrequency = 1000)
         {
-            input stream SampleType in;
-            output stream SampleType out;
+            output stream SampleType sineOut;
+            output stream SampleType cosineOut;
 
-            input event
-            {
-                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                float modeIn      [[ name: "Mode",      min: 0,           max: 1,         init: 0,         text: "Lowpass|Highpass"]];
-            }
+            input event float frequencyIn [[ name: "Frequency", min: -maxFreqHz, max: maxFreqHz, init: 0.0, unit: "Hz"]]; // Default meta data allows negative frequencies
 
             event frequencyIn (float v) { frequency = v; recalc = true; }
-            event modeIn      (float v) { mode = int (v); recalc = true; clear = true; }
 
-            float frequency = initialFrequency;
-            int mode = initialMode;
-            bool recalc = true;
-            bool clear = true;
+            float frequency  = initialFrequency;
+            bool  recalc     = true;
 
             void run()
             {
-                let numSOS = (order / 2) + (order % 2);
-                biquad::State[numSOS] s;
-                biquad::Coeffs[numSOS] c;
+                State s;
+                Coeffs c;
+
+                s.reset();
 
                 loop
                 {
                     if (recalc)
                     {
-                        if (clear) // mode change requires clearing histories
-                        {
-                            for (wrap<s.size> i)
-                            {
-                                biquad::reset (s[i]);
-                            }
-                        }
-
                         recalc = false;
-                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
-                        update (c, processor.frequency, order, mode, clippedFrequency);
+                        c.update (frequency, processor.frequency);
                     }
 
                     loop (updateInterval)
                     {
-                        out << biquad::processCascadeTDFII (in, s, c);
+                        let y = s.process (c);
+                        sineOut << y[0];
+                        cosineOut << y[1];
                         advance();
                     }
                 }
@@ -1763,1112 +1456,988 @@ R"soul_code(
         }
     }
 
-    //==============================================================================
 )soul_code"
 R"soul_code(
 
-    /** Analytic filter / IIR Hilbert transformer.
+    //==============================================================================
+    ///
+    /// A tempo-syncable LFO with some common shapes and options for uni-polar or bi-polar output.
+    /// Unipolar LFO shapes run between 0 and 1, whilst Bipolar run between -1 and 1.
+    ///
+    namespace lfo
+    {
+        /// Various LFO shape generator functions.
+        namespace shapers
+        {
+            SampleType rampUp           (PhaseType phase) { return (phase * 2.0f) - 1.0f; }
+            SampleType rampUpUnipolar   (PhaseType phase) { return phase; }
+            SampleType rampDown         (PhaseType phase) { return ((1.0f - phase) * 2.0f) - 1.0f; }
+            SampleType rampDownUnipolar (PhaseType phase) { return (1.0f - phase); }
+            SampleType triangle         (PhaseType phase) { return (2.0f * (1.0f - abs ((wrap (phase + 0.25f, 1.0f) * 2.0f) -1.0f))) - 1.0f; }
+            SampleType triangleUnipolar (PhaseType phase) { return 1.0f - abs((phase * 2.0f) - 1.0f ); }
+            SampleType square           (PhaseType phase) { return (float (phase > 0.5f) * 2.0f) - 1.0f; }
+            SampleType squareUnipolar   (PhaseType phase) { return float (phase > 0.5f); }
+            SampleType sine             (PhaseType phase) { return sin (phase * float32 (twoPi)); }
+            SampleType sineUnipolar     (PhaseType phase) { return (sin (phase * float32 (twoPi)) + 1.0f) * 0.5f; }
+        }
 
-        https://dsp.stackexchange.com/a/59157
+        /// A set of constants to specify different LFO shapes.
+        namespace Shape
+        {
+            let triangle      = 0;
+            let square        = 1;
+            let rampUp        = 2;
+            let rampDown      = 3;
+            let sine          = 4;
+            let sampleAndHold = 5;
+        }
 
-        Increasing numFilters will increase the accuracy of the quadrature output across the
-        pass band but introduce more delay with respect to the input signal.
-        The filter passband is from transitionBandwidthHz to nyquist - transitionBandwidthHz.
-    */
-    namespace analytic (int numFilters = 6,
-                        float transitionBandwidthHz = 20.0f)
-    {
-        /** Polyphase IIR Designer.
-            Based on HIIR http://ldesoras.free.fr/prod.html#src_hiir
-        */
-        namespace polyphase_iir_design
+        /// Polarity control constants.
+        namespace Polarity
         {
-            let numCoefficients = numFilters * 2;
-            let order = numCoefficients * 2 + 1;
+            let unipolar = 0;
+            let bipolar  = 1;
+        }
+
+        /// Functions for applying a smoothing filter on a changing value.
+        namespace smoother
+        {
+            struct State
+)soul_code"
+R"soul_code(
 
-            /** Holds a set of filter coefficients. */
-            struct Coeffs
             {
-                float64[numCoefficients] coeffs;
+                float currentValue;
+                float targetValue;
+                float increment;
+                int steps;
             }
 
-            /** */
-            Coeffs compute (float64 transition)
+            /// Resets a smoother::State object
+            void reset (State& state, float initialValue)
             {
-                Coeffs c;
-
-                let p = computeTransitionParam (transition);
-
-                for (wrap<numCoefficients> i)
-                    c.coeffs.at (i) = computeCoeff (i, p);
-
-                return c;
+                state.currentValue = initialValue;
+                state.targetValue = initialValue;
+                state.increment = 0.0f;
+                state.steps = 0;
             }
 
-            struct TransitionParams
+            /// Updates a smoother::State object with a new target value and the
+            /// number of steps to reach the target
+            void setTarget (State& state, float targetValue, int steps)
             {
-                float64 k, q;
+                state.targetValue = targetValue;
+                state.increment = (state.targetValue - state.currentValue) / steps;
+                state.steps = steps;
             }
 
-            TransitionParams computeTransitionParam (float64 transition)
+            /// Advances the state of a smoother and returns the new smoothed value
+            float tick (State& state)
             {
-                var k = tan ((1.0 - transition * 2.0) * (pi / 4));
-                k *= k;
-                let kksqrt = pow (1.0 - k * k, 0.25);
-                let e = 0.5 * (1.0 - kksqrt) / (1 + kksqrt);
-                let e2 = e * e;
-                let e4 = e2 * e2;
-                let q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+                if (state.steps == 0)
+                    return state.currentValue;
 
-                return TransitionParams (k, q);
+                state.currentValue += state.increment;
+                state.steps--;
+
+                if (state.steps == 0)
+                    state.currentValue = state.targetValue;
+
+                return state.currentValue;
             }
+        }
 
-            float64 computeAccNum (float64 q, int c)
-            {
-                float64 result, i = 0, j = 1;
+        /// A processor which implements an LFO with events to control its parameters.
+        /// Changes to the frequency and depth are smoothed, but expect discontinuities if the shape or polarity
+        /// are updated.
+        processor Processor (int initialShape = 0,
+                             int initialPolarity = 0,
+                             float initialDepth = 1.0f,
+                             float initialFrequency = 1.0f)
+        {
+            output stream SampleType out;
 
-                loop
-                {
+            input event
+            {
+                soul::timeline::Position positionIn;
+                soul::timeline::TransportState transportStateIn;
 )soul_code"
 R"soul_code(
 
-                    let next = pow (q, float64 (i * (i + 1))) * sin ((i * 2 + 1) * c * pi / order) * j;
-                    result += next;
-
-                    if (abs (next) < 1e-100)
-                        return result;
+                soul::timeline::Tempo tempoIn;
 
-                    j = -j;
-                    i++;
-                }
+                float rateHzIn     [[ name: "Rate (Hz)",     min: 0.01,  max: 40.0,   init: 1.,   unit: "hz", step: 0.01 ]];
+                float rateTempoIn  [[ name: "Rate (Beats)",  min: 0.001, max: 32,     init: 0,    unit: "beat", step: 0.001]];
+                float depthIn      [[ name: "Depth",         min: 0,     max: 100,    init: 100,  unit: "%",  step: 1 ]];
+                float shapeIn      [[ name: "Shape",         min: 0,     max: 5,      init: 0,    text: "Triangle|Square|Ramp Up|Ramp Down|Sine|Sample & Hold"]];
+                float polarityIn   [[ name: "Polarity",      min: 0,     max: 1,      init: 0,    text: "Unipolar|Bipolar"]];
+                float rateModeIn   [[ name: "Rate Mode",     min: 0,     max: 1,      init: 0,    text: "Hz|Tempo"]];
+                float syncIn       [[ name: "Timeline Sync", min: 0,     max: 1,      init: 0,    text: "Off|On"]];
             }
 
-            float64 computeAccDen (float64 q, int c)
-            {
-                float64 result, i = 1.0, j = -1.0;
-
-                loop
-                {
-                    let next = pow (q, (i * i)) * cos (i * 2 * c * pi / order) * j;
-                    result += next;
-
-                    if (abs (next) < 1e-100)
-                        return result;
+            event positionIn (soul::timeline::Position v)             { qnPos = v.currentQuarterNote; }
+            event transportStateIn (soul::timeline::TransportState v) { transportRunning = v.state > 0; }
+            event tempoIn (soul::timeline::Tempo v)                   { qnPhaseIncrement = (v.bpm / 60.0f) * float (processor.period); }
 
-                    j = -j;
-                    i = i + 1.0;
-                }
+            event rateHzIn (float v)
+            {
+                if (! qnMode)
+                    phaseIncrement = PhaseType (v * processor.period);
             }
 
-            float64 computeCoeff (int index, TransitionParams params)
-            {
-                let num = computeAccNum (params.q, index + 1)  * pow (params.q, 0.25);
-                let den = computeAccDen (params.q, index + 1) + 0.5;
-                let ww = num / den;
-                let wwsq = ww * ww;
+            event rateTempoIn (float v)   { qnScalar = v; }
+            event depthIn (float v)       { depth.setTarget (v * 0.01f, smoothingSamples); }
+            event shapeIn (float v)       { shape = int (floor (v)); }
+            event polarityIn (float v)    { polarity = (v < 0.5f) ? Polarity::unipolar : Polarity::bipolar; }
+            event rateModeIn (float v)    { qnMode = v > 0.5f; }
+            event syncIn (float v)        { timelineSync = v > 0.5f; }
 
-                let x = sqrt ((1 - wwsq * params.k) * (1.0 - wwsq / params.k)) / (1.0 + wwsq);
-                return (1.0 - x) / (1.0 + x);
-            }
-        }
+            PhaseType phase;
+)soul_code"
+R"soul_code(
 
-        /** Parallel 2nd-order all-pass.
+            var phaseIncrement = float32 (initialFrequency * processor.period);
+            int shape = initialShape;
+            int polarity = initialPolarity;
+            smoother::State depth;
 
-                y[n] = c * (x[n] + y[n - 2]) - x[n - 2]
-        */
-        namespace dual_apf
-        {
-            /** Holds the filter state. */
-            struct State
-            {
-                SampleType[2] x1, y1, x2, y2;
-                CoeffType[2] c;
-            }
+            let smoothingSamples = int (processor.frequency * 0.02);
+            bool transportRunning = false;
+            bool qnMode = false;
+            bool timelineSync = false;
+            float64 qnScalar = 1.0;
+            float64 qnPos = 0.0;
+            float32 qnPhaseIncrement = (120.0f / 60.0f) * (1.0f / 44100.0f); // Default = 1qn @ 120bpm / 44.1 sr
 
-            /** */
-            SampleType[2] process (State& s, SampleType[2] x)
+            PhaseType prevPhase = 1.0f;
+            soul::random::RandomNumberState rng;
+            SampleType noiseSample;
+
+            SampleType getNoiseSample()
             {
-                let y = SampleType[2] (SampleType (s.c[0]) * (x[0] + s.y2[0]) - s.x2[0],
-                                       SampleType (s.c[1]) * (x[1] + s.y2[1]) - s.x2[1]);
-                s.x2 = s.x1;
-                s.x1 = x;
-                s.y2 = s.y1;
-                s.y1 = y;
+                if (phase < prevPhase)
+                    noiseSample = SampleType (polarity == Polarity::bipolar ? rng.getNextBipolar()
+                                                                            : rng.getNextUnipolar());
 
-                return y;
+                prevPhase = phase;
+                return noiseSample;
             }
-        }
 
+            SampleType getNextSample()
+            {
+                if (polarity == Polarity::bipolar)
+                {
+                    if (shape == Shape::triangle)      return shapers::triangle (phase);
+                    if (shape == Shape::square)        return shapers::square (phase);
+                    if (shape == Shape::rampUp)        return shapers::rampUp (phase);
+                    if (shape == Shape::rampDown)      return shapers::rampDown (phase);
+                    if (shape == Shape::sine)          return shapers::sine (phase);
+                    if (shape == Shape::sampleAndHold) return getNoiseSample();
+                }
+                else
+                {
+                    if (shape == Shape::triangle)      return shapers::triangleUnipolar (phase);
+                    if (shape == Shape::square)        return shapers::squareUnipolar (phase);
 )soul_code"
 R"soul_code(
 
-        /** Holds the filter state. */
-        struct State
-        {
-            dual_apf::State[numFilters] apfs;
-            SampleType[1] x;
-        }
-
-        /** Updates a filter state with the given sample rate. */
-        void update (State& s, float64 sampleRate)
-        {
-            let design = polyphase_iir_design::compute (2.0 * (transitionBandwidthHz / sampleRate));
-
-            for (wrap<numFilters> i)
-            {
-                s.apfs.at (i).c[0] = design.coeffs.at (i * 2);
-                s.apfs.at (i).c[1] = design.coeffs.at (i * 2 + 1);
-            }
-        }
-
-        /** */
-        SampleType[2] process (State& s, SampleType x)
-        {
-            var y = SampleType[2] (x, s.x[0]);
+                    if (shape == Shape::rampUp)        return shapers::rampUpUnipolar (phase);
+                    if (shape == Shape::rampDown)      return shapers::rampDownUnipolar (phase);
+                    if (shape == Shape::sine)          return shapers::sineUnipolar (phase);
+                    if (shape == Shape::sampleAndHold) return getNoiseSample();
+                }
 
-            for (wrap<numFilters> i)
-            {
-                y = s.apfs[i].process (y);
+                return SampleType();
             }
 
-            s.x[0] = x;
-            return y;
-        }
-
-        /** */
-        processor Processor
-        {
-            input stream SampleType in;
-            output stream SampleType realOut;
-            output stream SampleType imagOut;
-
-            State s;
-
             void init()
             {
-                s.update (processor.frequency);
+                depth.reset (initialDepth * 0.01f);
             }
 
             void run()
             {
+                rng.reset (processor.id + 10);
+
                 loop
                 {
-                    let y = s.process (in);
-                    realOut << y[0];
-                    imagOut << y[1];
+                    out << getNextSample() * depth.tick();
+
+                    if (qnMode)
+                    {
+                        if (timelineSync && transportRunning)
+                        {
+                            let oneOverQNScalar = 1.0 / qnScalar;
+                            qnPos += qnPhaseIncrement;
+                            phase = float32 (fmod (qnPos, oneOverQNScalar) / oneOverQNScalar);
+                        }
+                        else // freewheel
+                        {
+                            phase += (qnPhaseIncrement * float32 (qnScalar));
+
+                            while (phase >= 1.0f)
+                                phase -= 1.0f;
+                        }
+                    }
+                    else
+                    {
+                        phase += phaseIncrement;
+
+                        while (phase >= 1.0f)
+                            phase -= 1.0f;
+                    }
+
                     advance();
                 }
             }
         }
     }
+}
+)soul_code";
 
-    //==============================================================================
-    /** Complex Resonator filter.
+    if (moduleName == "soul.midi")  return R"soul_code(
+/** Title: MIDI utilities
 
-        See https://ccrma.stanford.edu/~jos/smac03maxjos/smac03maxjos.pdf
-        This filter is suitable for modulation
-    */
-    namespace complex_resonator
+    In general, the SOUL policy towards MIDI is to avoid it as much as is humanly possible,
+    so most of these helper functions are concerned with converting MIDI messages to
+    `soul::note_events` types, and then the other libraries use these strongly-typed
+    events to model note actions, rather than dealing with raw MIDI events.
+*/
+
+/// Various MIDI-related types and functions.
+namespace soul::midi
+{
+    /// This type is used to represent a packed short MIDI message. When you create
+    /// an input event endpoint and would like it to receive MIDI, this is the type
+    /// that you should use for it.
+    struct Message
     {
-        /** Holds the filter state. */
-        struct State
-        {
-            SampleType yReal;
-            SampleType yImag;
-        }
+        int midiBytes;  /**< Format: (byte[0] << 16) | (byte[1] << 8) | byte[2] */
+    }
 
-        /** Holds a set of filter coefficients. */
-        struct Coeffs
-        {
-            complex64 v;
-        }
+    /// Extracts the first MIDI byte from a Message object
+    int getByte1 (Message m)     { return (m.midiBytes >> 16) & 0xff; }
+    /// Extracts the second MIDI byte from a Message object
+    int getByte2 (Message m)     { return (m.midiBytes >> 8) & 0xff; }
+    /// Extracts the third MIDI byte from a Message object
+    int getByte3 (Message m)     { return m.midiBytes & 0xff; }
 
-)soul_code"
-R"soul_code(
+    /// This event processor receives incoming MIDI events, parses them as MPE,
+    /// and then emits a stream of note events using the types in soul::note_events.
+    /// A synthesiser can then handle the resulting events without needing to go
+    /// near any actual MIDI or MPE data.
+    ///
+    processor MPEParser  [[ main: false ]]
+    {
+        input event Message parseMIDI;
 
-        complex64 cexp (complex64 c)
-        {
-            // TODO: if cexp becomes a global function, use that
-            let e = exp (c.real);
-            return complex64 (e * cos (c.imag), e * sin (c.imag));
-        }
+        output event (soul::note_events::NoteOn,
+                      soul::note_events::NoteOff,
+                      soul::note_events::PitchBend,
+                      soul::note_events::Pressure,
+                      soul::note_events::Slide,
+                      soul::note_events::Control) eventOut;
 
-        /** Updates a set of coefficients for the given settings. */
-        void update (Coeffs& c, float64 sampleRate, float64 freqHz, float64 t60)
-        {
-            let jImag = (0.0 + 1.0i);
-            let decayFactor = tau2pole (t60, sampleRate);
-            let oscCoef = cexp ((jImag * twoPi) * (freqHz / sampleRate));
-            c.v = decayFactor * oscCoef;
-        }
+        let MPESlideControllerID = 74;
 
-        /** */
-        SampleType[2] process (State& s, Coeffs& c, SampleType x)
+        event parseMIDI (Message message)
         {
-            let xReal = x;
-            let xImag = SampleType();
-            let vReal = SampleType (c.v.real);
-            let vImag = SampleType (c.v.imag);
-            let yReal = xReal + ((vReal * s.yReal) - (vImag * s.yImag));
-            let yImag = xImag + ((vReal * s.yImag) + (vImag * s.yReal));
-            s.yReal = yReal;
-            s.yImag = yImag;
-            return SampleType[2] (yReal, yImag);
-        }
+            let messageByte1 = message.getByte1();
+            let messageByte2 = message.getByte2();
+)soul_code"
+R"soul_code(
 
-        /** */
-        processor Processor (float initialFrequency = defaultFreqHz,
-                             float initialDecay = 1.0f,
-                             float initialGain = 1.0f)
-        {
-            input stream SampleType in;
-            output stream SampleType realOut;
-            output stream SampleType imagOut;
+            let messageByte3 = message.getByte3();
 
-            input event
+            let messageType  = messageByte1 & 0xf0;
+            let channel      = messageByte1 & 0x0f;
+
+            if (messageType == 0x80)
             {
-                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                float decayIn     [[ name: "Decay",     min: 0.01,        max: 10.0,      init: 1.0, unit: "Seconds"]];
-                float gainIn      [[ name: "Gain",      min: 0.01,        max: 10.0,      init: 1.0]];
+                eventOut << soul::note_events::NoteOff (channel, float (messageByte2), normaliseValue (messageByte3));
             }
+            else if (messageType == 0x90)
+            {
+                // Note on with zero velocity should be treated as a note off
+                if (messageByte3 == 0)
+                    eventOut << soul::note_events::NoteOff (channel, float (messageByte2), 0);
+                else
+                    eventOut << soul::note_events::NoteOn (channel, float (messageByte2), normaliseValue (messageByte3));
+            }
+            else if (messageType == 0xb0)
+            {
+                if (messageByte2 == MPESlideControllerID)
+                    eventOut << soul::note_events::Slide (channel, normaliseValue (messageByte3));
+                else
+                    eventOut << soul::note_events::Control (channel, messageByte2, normaliseValue (messageByte3));
+            }
+            else if (messageType == 0xd0)
+            {
+                eventOut << soul::note_events::Pressure (channel, normaliseValue (messageByte2));
+            }
+            else if (messageType == 0xe0)
+            {
+                eventOut << soul::note_events::PitchBend (channel, translateBendSemitones (messageByte3, messageByte2));
+            }
+        }
 
-            event frequencyIn (float v) { frequency = v; recalc = true; }
-            event decayIn     (float v) { decay = v; recalc = true; }
-)soul_code"
-R"soul_code(
-
-            event gainIn      (float v) { gain = v; recalc = true; }
+        float normaliseValue (int i)
+        {
+            return i * (1.0f / 127.0f);
+        }
 
-            float frequency = initialFrequency,
-                      decay = initialDecay,
-                       gain = initialGain;
-            bool recalc = true;
+        float translateBendSemitones (int msb, int lsb)
+        {
+            let value = msb * 128 + lsb;
+            let bendRange = 48.0f;
+            return float (value - 8192) / (8192.0f / bendRange);
+        }
+    }
+}
+)soul_code";
 
-            namespace DCBlocker = soul::filters::dc_blocker;
+    if (moduleName == "soul.frequency")  return R"soul_code(
+/**
+    Title: Frequency-domain utilities
+*/
 
-            void run()
-            {
-                State s;
-                Coeffs c;
+/// Discrete Fourier Transform functions.
+namespace soul::DFT
+{
+    /// Performs a real forward DFT from an input buffer to an output buffer.
+    void forward<SampleBuffer> (const SampleBuffer& inputData, SampleBuffer& outputData)
+    {
+        float64[SampleBuffer.size] twiddles;
+        createTwiddleTable (twiddles);
+        forward (inputData, outputData, twiddles);
+    }
 
-                DCBlocker::Coeffs dcc;
-                DCBlocker::State realDCBlocker, imagDCBlocker;
+    /// Performs a real forward DFT from an input buffer to an output buffer, using a table created
+    /// by createTwiddleTable() for the same size, so that the table isn't rebuilt on every call.
+    void forward<SampleBuffer, TableType> (const SampleBuffer& inputData, SampleBuffer& outputData, const TableType& twiddles)
+    {
+        static_assert (SampleBuffer.isFixedSizeArray || SampleBuffer.isVector, "The buffers for DFT::forward() must be fixed size arrays");
+        static_assert (SampleBuffer.elementType.isFloat && SampleBuffer.elementType.isPrimitive, "The element type for DFT::forward() must be floating point");
+        static_assert (TableType.size == SampleBuffer.size, "The twiddle table for DFT::forward() must be the same size as the buffers");
+        let harmonics = inputData.size / 2;
 
-                dcc.update (processor.frequency, 30.0f);
+        SampleBuffer inputImag, outputReal, outputImag;
 
-                loop
-                {
-                    if (recalc)
-                    {
-                        recalc = false;
-                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
-                        c.update (processor.frequency, clippedFrequency, decay);
-                    }
+        performComplex (inputData, inputImag, outputReal, outputImag, twiddles, 1.0f / float (harmonics));
 
-                    loop (updateInterval)
-                    {
-                        let y = s.process (c, in);
-                        realOut << realDCBlocker.process (y[0] * gain, dcc);
-                        imagOut << imagDCBlocker.process (y[1] * gain, dcc);
-                        advance();
-                    }
-                }
-            }
-        }
+        outputData[0:harmonics]             = outputReal[0:harmonics];
+        outputData[harmonics:harmonics * 2] = outputImag[0:harmonics];
     }
 
-    //==============================================================================
-    /**
-        This namespace contains a set of "Topology preserving transform" filters.
-    */
-    namespace tpt
+    /// Performs a real inverse DFT from an input buffer to an output buffer.
+    void inverse<SampleBuffer> (const SampleBuffer& inputData, SampleBuffer& outputData)
     {
-        //==============================================================================
-        /** "Topology preserving transform" one-pole filter.
+        float64[SampleBuffer.size] twiddles;
+        createTwiddleTable (twiddles);
+        inverse (inputData, outputData, twiddles);
+    }
 
-            Derived from work by Zavalishin and Pirkle.
-            This filter is suitable for modulation.
-        */
-        namespace onepole
-        {
-            /** Constants for use in specifying the filter mode. */
-            namespace Mode
-            {
-                let lowpass  = 0;
-                let highpass = 1;
-                let allpass  = 2;
-            }
+    /// Performs a real inverse DFT from an input buffer to an output buffer, using a table created
 )soul_code"
 R"soul_code(
 
+    /// by createTwiddleTable() for the same size, so that the table isn't rebuilt on every call.
+    void inverse<SampleBuffer, TableType> (const SampleBuffer& inputData, SampleBuffer& outputData, const TableType& twiddles)
+    {
+        static_assert (SampleBuffer.isFixedSizeArray || SampleBuffer.isVector, "The buffers for DFT::inverse() must be fixed size arrays");
+        static_assert (SampleBuffer.elementType.isFloat && SampleBuffer.elementType.isPrimitive, "The element type for DFT::inverse() must be floating point");
+        static_assert (TableType.size == SampleBuffer.size, "The twiddle table for DFT::inverse() must be the same size as the buffers");
+        let harmonics = inputData.size / 2;
 
-            /** Holds a set of filter coefficients. */
-            struct Coeffs
-            {
-                CoeffType b;
-            }
+        SampleBuffer inputReal, inputImag, outputReal;
 
-            /** Holds the filter state. */
-            struct State
-            {
-                SampleType z1;
-            }
+        inputReal[0:harmonics] = inputData[harmonics:harmonics * 2];
+        inputImag[0:harmonics] = inputData[0:harmonics];
 
-            /** Clears a set of coefficients. */
-            void clear (Coeffs& c)
-            {
-                c.b = CoeffType (1);
-            }
+        performComplex (inputReal, inputImag, outputReal, outputData, twiddles, 1.0f);
+    }
 
-            /** Resets a filter state. */
-            void reset (State& s)
-            {
-                s.z1 = SampleType();
-            }
+    /// Fills an array with the twiddle factors needed by forward(), inverse(), fft(), realFFT() and inverseRealFFT()
+    /// for a transform of the same size as the array. If you're performing lots of transforms,
+    /// you can create one table and reuse it, so that no sines or cosines need to be calculated.
+    void createTwiddleTable<TableType> (TableType& table)
+    {
+        static_assert (TableType.isFixedSizeArray, "The table for createTwiddleTable() must be a fixed size array");
+        static_assert (TableType.elementType.isFloat && TableType.elementType.isPrimitive, "The element type for createTwiddleTable() must be floating point");
 
-            /** Updates a set of coefficients for the given settings. */
-            void update (Coeffs& c, float64 sampleRate, float64 freqHz)
-            {
-                let wd = twoPi * freqHz;
-                let T  = 1.0 / sampleRate;
-                let wa = (2.0 / T) * tan (wd * T / 2.0);
-                let g  = wa * T / 2.0;
+        let size = int (TableType.size);
+        let half = size / 2;
 
-                c.b = CoeffType (g / (1.0 + g));
-            }
+        // The first half holds the cosines, and the second half the sines
+        for (int i = 0; i < half; ++i)
+        {
+            let angle = twoPi * i / size;
+            table.at (i)        = TableType.elementType (cos (angle));
+            table.at (half + i) = TableType.elementType (sin (angle));
+        }
+)soul_code"
+R"soul_code(
 
-            /** */
-            SampleType processLPF (State& s, SampleType x, Coeffs& c)
-            {
-                let vn = (x - s.z1) * SampleType (c.b);
-                let lpf = vn + s.z1;
-                s.z1 = vn + lpf;
-                return lpf;
-            }
+    }
 
-            /** */
-            SampleType processHPF (State& s, SampleType x, Coeffs& c)
-            {
-                return x - processLPF (s, x, c);
-            }
+    /// Performs an in-place complex FFT on a pair of buffers holding the real and imaginary parts
+    /// of the data, using a table created by createTwiddleTable() for the same size. The size must
+    /// be a power of 2. The forward transform is unscaled, and the inverse one is scaled by 1 / size.
+    void fft<BufferType, TableType> (BufferType& real, BufferType& imag, const TableType& twiddles, bool isInverse)
+    {
+        static_assert (TableType.size == BufferType.size, "The twiddle table for fft() must be the same size as the buffers");
+        performFFT (real, imag, twiddles, isInverse);
+    }
 
-            /** */
-            SampleType processAPF (State& s, SampleType x, Coeffs& c)
-            {
-                let lpf = processLPF (s, x, c);
-                let hpf = x - lpf;
-                return lpf - hpf;
-            }
+    /// Performs a forward FFT of a buffer of real values, using a table created by createTwiddleTable()
+    /// for the same size. This is roughly twice as fast as a complex fft() with an empty imaginary part.
+    /// The first size / 2 + 1 elements of the output buffers are filled with the real and imaginary parts
+    /// of the bins from DC up to the Nyquist frequency, and the rest are set to zero.
+    void realFFT<BufferType, TableType> (const BufferType& inputData, BufferType& outputReal, BufferType& outputImag, const TableType& twiddles)
+    {
+        static_assert (TableType.size == BufferType.size, "The twiddle table for realFFT() must be the same size as the buffers");
+        static_assert (BufferType.size >= 4, "The size for realFFT() must be at least 4");
 
-            /** */
-            processor Processor (int initialMode = 0,
-                                 float initialFrequency = defaultFreqHz)
-            {
-                input stream SampleType in;
-                output stream SampleType out;
+        let size = int (BufferType.size);
+        let half = size / 2;
+        let tableHalf = int (TableType.size / 2);
 
-                input event
-                {
+        // The even and odd samples are packed into a complex buffer of half the size
+        BufferType.elementType[half] packedReal, packedImag;
+
+        for (int i = 0; i < half; ++i)
+        {
+            packedReal.at (i) = inputData.at (2 * i);
+            packedImag.at (i) = inputData.at (2 * i + 1);
+        }
+
+        performFFT (packedReal, packedImag, twiddles, false);
+
+        outputReal = BufferType();
+        outputImag = BufferType();
+
+        // DC and Nyquist only depend on the first packed bin
 )soul_code"
 R"soul_code(
 
-                    float frequencyIn [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                    float modeIn      [[ name: "Mode",      min: 0,         max: 2,         init: 0,         text: "Lowpass|Highpass|Allpass"]];
-                }
+        outputReal.at (0)    = packedReal.at (0) + packedImag.at (0);
+        outputReal.at (half) = packedReal.at (0) - packedImag.at (0);
 
-                event frequencyIn (float v) { frequency = v; recalc = true; }
-                event modeIn      (float v) { mode = int (v); recalc = true; }
+        for (int k = 1; k < half; ++k)
+        {
+            let j = half - k;
 
-                float frequency = initialFrequency;
-                int mode = initialMode;
-                bool recalc = true;
+            // Separate the transforms of the even and odd samples, then combine them
+            let evenReal = (packedReal.at (k) + packedReal.at (j)) * 0.5f;
+            let evenImag = (packedImag.at (k) - packedImag.at (j)) * 0.5f;
+            let oddReal  = (packedImag.at (k) + packedImag.at (j)) * 0.5f;
+            let oddImag  = (packedReal.at (j) - packedReal.at (k)) * 0.5f;
 
-                void run()
-                {
-                    State s;
-                    Coeffs c;
-                    c.clear ();
+            let twiddleReal = BufferType.elementType (twiddles.at (k));
+            let twiddleImag = -BufferType.elementType (twiddles.at (tableHalf + k));
 
-                    loop
-                    {
-                        if (recalc)
-                        {
-                            recalc = false;
-                            let clippedFrequency = clamp (float64 (frequency),
-                                                          float64 (minFreqHz),
-                                                          processor.frequency * normalisedFreqLimit);
-                            c.update (processor.frequency, clippedFrequency);
-                        }
+            outputReal.at (k) = evenReal + oddReal * twiddleReal - oddImag * twiddleImag;
+            outputImag.at (k) = evenImag + oddReal * twiddleImag + oddImag * twiddleReal;
+        }
+    }
 
-                        loop (16)
-                        {
-                            if (mode == Mode::lowpass)        out << s.processLPF (in, c);
-                            else if (mode == Mode::highpass)  out << s.processHPF (in, c);
-                            else if (mode == Mode::allpass)   out << s.processAPF (in, c);
+    /// Performs the inverse of realFFT(), taking the real and imaginary parts of the bins from DC up
+    /// to the Nyquist frequency, and producing a buffer of real values. The result is scaled by
+    /// 1 / size, so passing the output of realFFT() to this function will recreate the original input.
+    void inverseRealFFT<BufferType, TableType> (const BufferType& inputReal, const BufferType& inputImag, BufferType& outputData, const TableType& twiddles)
+    {
+        static_assert (TableType.size == BufferType.size, "The twiddle table for inverseRealFFT() must be the same size as the buffers");
+        static_assert (BufferType.size >= 4, "The size for inverseRealFFT() must be at least 4");
 
-                            advance();
-                        }
-                    }
-                }
-            }
-        }
+        let size = int (BufferType.size);
+        let half = size / 2;
+        let tableHalf = int (TableType.size / 2);
 
-        //==============================================================================
-        /** "Topology preserving transform" multi-mode state variable filter (SVF).
+        BufferType.elementType[half] packedReal, packedImag;
 
-            Derived from work by Zavalishin and Pirkle.
-            This filter is suitable for modulation.
-        */
-        namespace svf
+        for (int k = 0; k < half; ++k)
         {
+            let j = half - k;
+
+            let evenReal = (inputReal.at (k) + inputReal.at (j)) * 0.5f;
 )soul_code"
 R"soul_code(
 
-            /** Constants for use in specifying the filter mode. */
-            namespace Mode
-            {
-                let lowpass  = 0;
-                let highpass = 1;
-                let bandpass = 2;
-            }
+            let evenImag = (inputImag.at (k) - inputImag.at (j)) * 0.5f;
+            let diffReal = (inputReal.at (k) - inputReal.at (j)) * 0.5f;
+            let diffImag = (inputImag.at (k) + inputImag.at (j)) * 0.5f;
 
-            /** Holds a set of filter coefficients. */
-            struct Coeffs
-            {
-                CoeffType a0;
-                CoeffType a;
-                CoeffType p;
-            }
+            let twiddleReal = BufferType.elementType (twiddles.at (k));
+            let twiddleImag = BufferType.elementType (twiddles.at (tableHalf + k));
 
-            /** Holds the filter state. */
-            struct State
-            {
-                SampleType[2] z;
-            }
+            let oddReal = diffReal * twiddleReal - diffImag * twiddleImag;
+            let oddImag = diffReal * twiddleImag + diffImag * twiddleReal;
 
-            /** Resets a filter state. */
-            void reset (State& s)
-            {
-                s.z[0] = SampleType();
-                s.z[1] = SampleType();
-            }
+            packedReal.at (k) = evenReal - oddImag;
+            packedImag.at (k) = evenImag + oddReal;
+        }
 
-            /** Updates a set of coefficients for the given settings. */
-            void update (Coeffs& c, float64 sampleRate, float64 freqHz, float64 quality)
-            {
-                let Q = max (quality, 0.001);
-                let wd = twoPi * freqHz;
-                let T  = 1.0 / sampleRate;
-                let wa = (2.0 / T) * tan (wd * T / 2.0);
-                let g  = wa * T / 2.0;
-                let R = 1.0 / (2.0 * Q);
-                c.a0 = 1.0 / (1.0 + 2.0 * R * g + g * g);
-                c.a = g;
-                c.p = 2.0 * R + g;
-            }
+        performFFT (packedReal, packedImag, twiddles, true);
 
-            /** */
-            SampleType[3] process (State& s, SampleType x, Coeffs& c)
-            {
-                let hpf = SampleType (c.a0 * (x - c.p * s.z[0] - s.z[1]));
-                let bpf = SampleType (c.a * hpf + s.z[0]);
-                let lpf = SampleType (c.a * bpf + s.z[1]);
+        for (int i = 0; i < half; ++i)
+        {
+            outputData.at (2 * i)     = packedReal.at (i);
+            outputData.at (2 * i + 1) = packedImag.at (i);
+        }
+    }
 
-                s.z[0] = SampleType (c.a * hpf + bpf);
-                s.z[1] = SampleType (c.a * bpf + lpf);
+    /// A processor which convolves its input with a fixed impulse response, using FFTs of the given
+    /// size and the overlap-add method. The input is processed in blocks of
+    /// (fftSize + 1 - size (impulseResponse)) frames, and the output is delayed by one block.
+    processor OverlapAddConvolver (int fftSize, const float[] impulseResponse)
+    {
+        input stream float in;
+        output stream float out;
 
-                return SampleType[3] (lpf, hpf, bpf);
-            }
+        let impulseLength = size (impulseResponse);
+        let blockSize = fftSize + 1 - impulseLength;
+
+        float[fftSize] twiddles, impulseReal, impulseImag, pendingOutput;
+
+        void init()
+        {
+            static_assert ((fftSize & (fftSize - 1)) == 0, "The fftSize for OverlapAddConvolver must be a power of 2");
+            static_assert (blockSize > 0, "The fftSize for OverlapAddConvolver must be larger than the impulse response");
+
+            createTwiddleTable (twiddles);
+
+            float[fftSize] paddedImpulse;
+
+            for (wrap<impulseLength> i)
+                paddedImpulse.at (i) = impulseResponse[i];
+
+            realFFT (paddedImpulse, impulseReal, impulseImag, twiddles);
+        }
 
-            /** */
-            processor Processor (float initialFrequency = defaultFreqHz,
-                                 float initialQuality = defaultQuality)
-            {
-                input stream SampleType in;
 )soul_code"
 R"soul_code(
 
-                output stream SampleType lowpassOut, bandpassOut, highpassOut;
+        void run()
+        {
+            loop
+            {
+                float[fftSize] block, spectrumReal, spectrumImag;
 
-                input event
+                for (int i = 0; i < blockSize; ++i)
                 {
-                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                    float qualityIn   [[ name: "Q",         min: 0.01,        max: 100.0,     init: defaultQuality]];
+                    block.at (i) = in;
+                    out << pendingOutput.at (i);
+                    advance();
                 }
 
-                event frequencyIn (float v) { frequency = v; recalc = true; }
-                event qualityIn   (float v) { quality = v; recalc = true; }
-
-                float frequency = initialFrequency,
-                        quality = initialQuality;
-                bool recalc = true;
+                realFFT (block, spectrumReal, spectrumImag, twiddles);
 
-                void run()
+                for (int k = 0; k <= fftSize / 2; ++k)
                 {
-                    State s;
-                    Coeffs c;
+                    let real = spectrumReal.at (k) * impulseReal.at (k) - spectrumImag.at (k) * impulseImag.at (k);
+                    let imag = spectrumReal.at (k) * impulseImag.at (k) + spectrumImag.at (k) * impulseReal.at (k);
+                    spectrumReal.at (k) = real;
+                    spectrumImag.at (k) = imag;
+                }
 
-                    loop
-                    {
-                        if (recalc)
-                        {
-                            recalc = false;
-                            let clippedFrequency = clamp (float64 (frequency),
-                                                          float64 (minFreqHz),
-                                                          processor.frequency * normalisedFreqLimit);
-                            c.update (processor.frequency, clippedFrequency, quality);
-                        }
+                inverseRealFFT (spectrumReal, spectrumImag, block, twiddles);
 
-                        loop (updateInterval)
-                        {
-                            let y = s.process (in, c);
-                            lowpassOut  << y[0];
-                            highpassOut << y[1];
-                            bandpassOut << y[2];
-                            advance();
-                        }
-                    }
-                }
+                // Drop the frames that have just been sent, and add the new block's tail to what's left
+                for (int i = 0; i < fftSize; ++i)
+                    pendingOutput.at (i) = (i + blockSize < fftSize ? pendingOutput.at (i + blockSize) : 0.0f) + block.at (i);
             }
         }
+    }
 
-        //==============================================================================
-        /**
-            N-th order Butterworth filter, made by cascading TPT filters.
-            This filter is suitable for modulation
-        */
-        namespace butterworth
+    // For internal use by the other functions: performs a complex DFT. This uses an FFT when the
+    // size is a power of 2, and otherwise an O(N^2) loop which reads its sines and cosines from the table.
+    void performComplex<SampleBuffer, TableType> (const SampleBuffer& inputReal,
+                                                  const SampleBuffer& inputImag,
+                                                  SampleBuffer& outputReal,
+                                                  SampleBuffer& outputImag,
+                                                  const TableType& twiddles,
+                                                  SampleBuffer.elementType scaleFactor)
+    {
+        let size = int (SampleBuffer.size);
+
+        if const ((size & (size - 1)) == 0)
         {
 )soul_code"
 R"soul_code(
 
-            namespace onepole = soul::filters::tpt::onepole;
-            namespace svf = soul::filters::tpt::svf;
+            // This is a transform of (inputImag + i * inputReal), with the imaginary part of the result negated
+            float64[size] real, imag;
 
-            /** Constants for use in specifying the filter mode. */
-            namespace Mode
+            for (int i = 0; i < size; ++i)
             {
-                let lowpass  = 0;
-                let highpass = 1;
+                real.at (i) = inputImag.at (i);
+                imag.at (i) = inputReal.at (i);
             }
 
-            /** Updates a set of coefficients for the given settings. */
-            void update<SVFCoeffsArrayType> (SVFCoeffsArrayType& svfCoeffs,
-                                             onepole::Coeffs& onepoleCoeffs,
-                                             float64 sampleRate, int order, float64 freqHz)
+            performFFT (real, imag, twiddles, false);
+
+            for (int i = 0; i < size; ++i)
             {
-                static_assert (SVFCoeffsArrayType.isArray, "coeffs argument is not an array");
+                outputReal.at (i) = SampleBuffer.elementType (real.at (i)) * scaleFactor;
+                outputImag.at (i) = SampleBuffer.elementType (-imag.at (i)) * scaleFactor;
+            }
+        }
+        else
+        {
+            let half = size / 2;
 
-                bool oddOrder = (order % 2) == 1;
+            for (int i = 0; i < size; ++i)
+            {
+                float64 sumReal, sumImag;
 
-                if (oddOrder)
+                for (int j = 0; j < size; ++j)
                 {
-                    onepole::update (onepoleCoeffs, sampleRate, freqHz);
+                    // The angle is 2 * pi * i * j / size, and the table only holds its first half
+                    let index = (i * j) % size;
+                    let cosAngle = float64 (index < half ? twiddles.at (index) : -twiddles.at (index - half));
+                    let sinAngle = float64 (index < half ? twiddles.at (half + index) : -twiddles.at (index));
 
-                    for (wrap<svfCoeffs.size> i)
-                    {
-                        let Q = 1.0 / (2.0 * cos ((CoeffType (i) + 1.0) * pi / order));
-                        svf::update (svfCoeffs.at (i), sampleRate, freqHz, Q);
-                    }
-                }
-                else
-                {
-                    for (wrap<svfCoeffs.size> i)
-                    {
-                        let Q = 1.0 / (2.0 * cos ((2.0 * CoeffType (i) + 1.0) * pi / (order * 2.0)));
-                        svf::update (svfCoeffs.at (i), sampleRate, freqHz, Q);
-                    }
+                    sumReal += inputImag.at(j) * cosAngle + inputReal.at(j) * sinAngle;
+                    sumImag += inputImag.at(j) * sinAngle - inputReal.at(j) * cosAngle;
                 }
+
+                outputImag.at(i) = SampleBuffer.elementType (sumImag) * scaleFactor;
+                outputReal.at(i) = SampleBuffer.elementType (sumReal) * scaleFactor;
             }
+        }
+    }
 
-            /** */
-            SampleType process<StateArrayType, CoeffsArrayType> (SampleType x,
-                                                                 StateArrayType& svfStates,
-                                                                 CoeffsArrayType& svfCoeffs,
-                                                                 onepole::State& onepoleState,
-                                                                 onepole::Coeffs& onepoleCoeffs,
+    // For internal use by the other functions: performs an in-place radix-2 FFT. The twiddle table
+    // can be any power-of-2 multiple of the buffer size, which lets the real-valued transforms use
+    // a half-size complex FFT with the table for their full size.
+    void performFFT<BufferType, TableType> (BufferType& real, BufferType& imag, const TableType& twiddles, bool isInverse)
+    {
 )soul_code"
 R"soul_code(
 
-                                                                 int mode, bool oddOrder)
-            {
-                static_assert (StateArrayType.isArray, "states argument is not an array");
-                static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
-                static_assert (svfStates.size == svfCoeffs.size, "states and coeffs arrays are not the same size");
+        static_assert (BufferType.isFixedSizeArray || BufferType.isVector, "The buffers for fft() must be fixed size arrays");
+        static_assert (BufferType.elementType.isFloat && BufferType.elementType.isPrimitive, "The element type for fft() must be floating point");
+        static_assert ((BufferType.size & (BufferType.size - 1)) == 0, "The size for fft() must be a power of 2");
+        static_assert (TableType.size % BufferType.size == 0, "The twiddle table for fft() must be a multiple of the buffer size");
 
-                var y = x;
+        let size = int (BufferType.size);
+        let tableStride = int (TableType.size / BufferType.size);
+        let tableHalf = int (TableType.size / 2);
 
-                if (oddOrder)
-                {
-                    if (mode == Mode::lowpass)
-                        y = onepoleState.processLPF (y, onepoleCoeffs);
-                    else if (mode == Mode::highpass)
-                        y = onepoleState.processHPF (y, onepoleCoeffs);
-                }
+        // Put the data into bit-reversed order
+        var j = 0;
 
-                for (wrap<svfStates.size> i)
-                    y = svf::process (svfStates[i], y, svfCoeffs[i])[wrap<2> (mode)]; // TODO: tidy this
+        for (int i = 1; i < size; ++i)
+        {
+            var bit = size / 2;
 
-                return y;
+            while ((j & bit) != 0)
+            {
+                j -= bit;
+                bit /= 2;
             }
 
-            /* Butterworth processor.
-               The order must be > 1
-            */
-            processor Processor (int order,
-                                 int initialMode = 0,
-                                 float initialFrequency = defaultFreqHz)
+            j += bit;
+
+            if (i < j)
             {
-                input stream SampleType in;
-                output stream SampleType out;
+                let tempReal = real.at (i);
+                let tempImag = imag.at (i);
+                real.at (i) = real.at (j);
+                imag.at (i) = imag.at (j);
+                real.at (j) = tempReal;
+                imag.at (j) = tempImag;
+            }
+        }
 
-                input event
-                {
-                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                    float modeIn      [[ name: "Mode",      min: 0,           max: 1,         init: 0,         text: "Lowpass|Highpass"]];
-                }
+        for (int length = 2; length <= size; length *= 2)
+        {
+            let halfLength = length / 2;
+            let tableStep = (size / length) * tableStride;
 
-                event frequencyIn (float v)   { frequency = v; recalc = true; }
-                event modeIn      (float v)   { mode = int (v); recalc = true; }
+            for (int start = 0; start < size; start += length)
+            {
+                for (int k = 0; k < halfLength; ++k)
+                {
+                    let twiddleReal = BufferType.elementType (twiddles.at (k * tableStep));
+                    let sine = BufferType.elementType (twiddles.at (tableHalf + k * tableStep));
+                    let twiddleImag = isInverse ? sine : -sine;
 
-                float  frequency  = initialFrequency;
-                int    mode       = initialMode;
-                bool   recalc     = true;
+                    let a = start + k;
+                    let b = a + halfLength;
 
-                void run()
-                {
-                    let numSVFs = order / 2;
+                    let tempReal = real.at (b) * twiddleReal - imag.at (b) * twiddleImag;
 )soul_code"
 R"soul_code(
 
-                    let oddOrder = (order % 2) == 1;
-
-                    svf::State[numSVFs] svfStates;
-                    svf::Coeffs[numSVFs] svfCoeffs;
-                    onepole::State onepoleState;
-                    onepole::Coeffs onepoleCoeffs;
-
-                    loop
-                    {
-                        if (recalc)
-                        {
-                            recalc = false;
-                            let clippedFrequency = clamp (float64 (frequency),
-                                                          float64 (minFreqHz),
-                                                          processor.frequency * normalisedFreqLimit);
-                            update (svfCoeffs, onepoleCoeffs, processor.frequency, order, clippedFrequency);
-                        }
+                    let tempImag = real.at (b) * twiddleImag + imag.at (b) * twiddleReal;
 
-                        loop (updateInterval)
-                        {
-                            out << process (in, svfStates, svfCoeffs, onepoleState, onepoleCoeffs, mode, oddOrder);
-                            advance();
-                        }
-                    }
+                    real.at (b) = real.at (a) - tempReal;
+                    imag.at (b) = imag.at (a) - tempImag;
+                    real.at (a) += tempReal;
+                    imag.at (a) += tempImag;
                 }
             }
         }
 
-        //==============================================================================
-        /**
-            4th-order Linkwitz-Riley crossover filter, which outputs two bands of audio.
-
-            The channels should sum together to produce a flat response.
-            This filter is suitable for modulation.
-        */
-        namespace crossover
+        if (isInverse)
         {
-            namespace SVF = soul::filters::tpt::svf;
-
-            /** Holds the filter state. */
-            struct State
-            {
-                SVF::State svf1, svf2;
-            }
+            let scale = BufferType.elementType (1.0 / size);
 
-            /** Holds a set of filter coefficients. */
-            struct Coeffs
+            for (int i = 0; i < size; ++i)
             {
-                SVF::Coeffs svf1, svf2;
+                real.at (i) *= scale;
+                imag.at (i) *= scale;
             }
+        }
+    }
+}
+)soul_code";
 
-            /** */
-            processor Processor (float initialFrequency = defaultFreqHz)
-            {
-                input stream float32 in;
-                output stream float32 lowOut;
-)soul_code"
-R"soul_code(
-
-                output stream float32 highOut;
-
-                input event float frequencyIn [[ name: "Split Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-
-                event frequencyIn (float v) { frequency = v; recalc = true; }
+    if (moduleName == "soul.noise")  return R"soul_code(
+/** Title: RNGs and noise-generators
 
-                float frequency = initialFrequency;
-                bool recalc = true;
+    This module contains a range of simple RNG and noise generating functions and processors.
+*/
 
-                /** Updates a set of coefficients for the given settings. */
-                void update (Coeffs& c, float64 sampleRate, float64 freqHz)
-                {
-                    c.svf1.update (sampleRate, freqHz, defaultQuality);
-                    c.svf2.update (sampleRate, freqHz, defaultQuality);
-                }
+/** This namespace contains some random number generation helpers.
+    We're assuming that nobody's going to be using these RNGs for security-critical cryptographic
+    applications. All the algorithms here are chosen to be fast, and definitely not cryptographically
+    strong!
+*/
+namespace soul::random
+{
+    /// State for a Park-Miller random number generator.
+    struct RandomNumberState
+    {
+        /** The current seed.
+            Top tip: when generating a seed, you might want to use the `processor.id` constant,
+            to make sure that each instance of a processor has a differently-seeded RNG. If you
+            want the RNG to be different each time the program runs, you could also throw the
+            `processor.session` constant into the mix too.
+        */
+        int64 seed;
+    }
 
-                SampleType[2] process (State& s, SampleType x, Coeffs& c)
-                {
-                    let svf1 = s.svf1.process (x, c.svf1);
-                    let lpf1 = svf1[0], hpf1 = svf1[1], bpf1 = svf1[2];
-                    let apf1 = lpf1 - SampleType (sqrt (2.0)) * bpf1 + hpf1;
-                    let svf2 = s.svf2.process (lpf1, c.svf2);
-                    let lpf2 = svf2[0];
+    /// Resets an RNG state object with the given seed value.
+    void reset (RandomNumberState& state, int64 seed)
+    {
+        state.seed = seed;
+    }
 
-                    return SampleType[2] (lpf2, apf1 - lpf2);
-                }
+    /// Returns the next number in the full 32-bit integer range.
+    int32 getNextInt32 (RandomNumberState& state)
+    {
+        let s = (state.seed * 48271) % 0x7fffffff;
+        state.seed = s + 1;
+        return int32 (s);
+    }
 
-                void run()
-                {
-                    State s;
-                    Coeffs c;
+    /// Advances the given RNG state and returns a value 0 to 1.
+    float getNextUnipolar (RandomNumberState& state)
+    {
+        return float (getNextInt32 (state)) * (1.0f / 2147483647.0f);
+    }
 
-                    loop
-                    {
-                        if (recalc)
-                        {
-                            recalc = false;
-                            let clippedFrequency = clamp (float64 (frequency),
-                                                          float64 (minFreqHz),
-                                                          processor.frequency * normalisedFreqLimit);
-                            update (c, processor.frequency, clippedFrequency);
-                        }
+    /// Advances the given RNG state and returns a value -1 to 1.
+    float getNextBipolar (RandomNumberState& state)
+    {
+        return (float (getNextInt32 (state)) * (2.0f / 2147483647.0f)) - 1.0f;
+    }
+}
+
+/// This namespace contains generators for various flavours of noise.
+namespace soul::noise
+{
+    /// White noise generator
+    processor White
+    {
+        output stream float out;
+
+        void run()
+        {
+            var rng = random::RandomNumberState (processor.id + 10);
 
-                        loop (16)
-                        {
-                            let y = s.process (in, c);
-                            lowOut  << y[0];
-                            highOut << y[1];
 )soul_code"
 R"soul_code(
 
-                            advance();
-                        }
-                    }
-                }
+            loop
+            {
+                out << rng.getNextBipolar();
+                advance();
             }
         }
+    }
 
-        //==============================================================================
-        /** SVF EQ.
-
-            Based on the work of Andy Simper:
-            https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+    /// Brown noise generator
+    processor Brown
+    {
+        output stream float out;
 
-            This filter is suitable for modulation.
-        */
-        namespace simper_eq
+        void run()
         {
-            /** Constants for use in specifying the filter mode. */
-            namespace Mode
-            {
-                let lowpass   = 0;
-                let highpass  = 1;
-                let bandpass  = 2;
-                let lowShelf  = 3;
-                let highShelf = 4;
-                let peaking   = 5;
-                let notch     = 6;
-                let allpass   = 7;
-                let bell      = 8;
-            }
+            let limit = 32.0f;
+            float runningTotal;
+            var rng = random::RandomNumberState (processor.id + 20);
 
-            /** Holds a set of filter coefficients. */
-            struct Coeffs
+            loop
             {
-                CoeffType a1, a2, a3;
-                CoeffType m0, m1, m2;
-            }
+                let white = rng.getNextBipolar();
+                runningTotal += white;
 
-            /** Holds the filter state. */
-            struct State
-            {
-                SampleType ic1eq, ic2eq;
-            }
+                if (runningTotal > limit || runningTotal < -limit)
+                    runningTotal -= white;
 
-            /** Resets a filter state. */
-            void reset (State& s)
-            {
-                s.ic1eq = SampleType();
-                s.ic2eq = SampleType();
+                runningTotal *= 0.998f;
+                out << runningTotal * (1.0f / limit);
+                advance();
             }
+        }
+    }
 
-            /** Updates a set of coefficients for the given settings. */
-            void update (Coeffs& c, float64 sampleRate, int mode, float64 freqHz, float64 quality, float64 gain)
+    /// Pink noise generator
+    processor Pink
+    {
+        output stream float out;
+
+        void run()
+        {
+            let pinkBits = 12;
+            int counter;
+            float[pinkBits] values;
+            float total;
+            var rng = random::RandomNumberState (processor.id + 30);
+
+            loop
             {
-                let w = tan (pi * freqHz / sampleRate);
-                let k = 1.0 / clamp (quality, 0.01, 100.0);
+                let white = rng.getNextBipolar();
+                ++counter;
 
-                if (mode == Mode::lowpass)
+                for (int bit = 0; bit < pinkBits; ++bit)
                 {
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 0.0;
-                    c.m1 = 0.0;
-                    c.m2 = 1.0;
+                    if (((counter >> bit) & 1) != 0)
+                    {
+                        let index = wrap<pinkBits> (bit);
+                        total -= values[index];
+                        values[index] = white;
+                        total += white;
+                        break;
+                    }
+                }
+
+                out << total * (1.0f / float (pinkBits - 1));
+                advance();
+            }
+        }
+    }
+}
+)soul_code";
+
+    if (moduleName == "soul.filters")  return R"soul_code(
+/** Title: Filters
+
+    This module contains a collection of filter implementations, including more traditional
+    biquad based filters and TPT variants, which are more suitable for modulation.
+
+    Notes:
+    - Filter coefficients are typically labelled a and b. Different literature uses different
+      conventions for what a and b mean. This code uses the following:
+        * `b`: feed-forward, numerator, zero, FIR coefficients.
+        * `a`: feed-back, denominator, pole, IIR coefficients.
+    - Although each filter comes with a Processor, they are designed so that their state,
+      coefficients and functions can be used independently.
+    - Each filter has a `State` struct and a `Coeffs` struct.
+    - `process()` functions generate an output y for an input x.
+    - `update()` functions take high level parameters such as mode, frequency, Q, mode and
+      update the filter coefficients.
+    - `reset()` functions reset the filter state/histories to 0.
+    - `clear()` functions clears filter coefficients.
+    - The filters are designed for channel-wise vectorisation, which can be achieved by
+      specialising the filter's namespace with a vector type.
+    - Some filters are suitable for modulation, others are not, check the comments at the top
+      of the namespace.
+*/
+
+namespace soul::filters (using SampleType = float32,
+                         using CoeffType  = float64,
+                         int updateInterval = 16)
+{
+    // Processor parameter min/max/defaults
+    let minFreqHz = 5.0f;
+    let maxFreqHz = 22000.0f;
+    let defaultFreqHz = 1000.0f;
+    let defaultQuality = 0.707107f; // 1.0 / sqrt (2.0) butterworth response
+    let defaultGain = 0.f;
+
+    /** The frequency upper-bound for update functions.
+        (Just below nyquist, e.g 0.49 * 44100 = ~22kHz).
+    */
+    let normalisedFreqLimit = 0.49;
+
+    //==============================================================================
+    /** Highpass filter for removing DC offset.
+
+            y[n] = x[n] - x[n-1] + b0 * y[n-1]
+
 )soul_code"
 R"soul_code(
 
-                }
-                else if (mode == Mode::highpass)
-                {
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = -k;
-                    c.m2 = -1.0;
-                }
-                else if (mode == Mode::bandpass)
-                {
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 0.0;
-                    c.m1 = 1.0;
-                    c.m2 = 0.0;
-                }
-                else if (mode == Mode::lowShelf)
-                {
-                    let A = pow (10.0, gain / 40.0);
-                    let g = w / sqrt (A);
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = k * (A - 1.0);
-                    c.m2 = (A * A - 1.0);
-                }
-                else if (mode == Mode::highShelf)
-                {
-                    let A = pow (10.0, gain / 40.0);
-                    let g = w / sqrt (A);
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = A * A;
-                    c.m1 = k * (1.0 - A) * A;
-                    c.m2 = (1.0 - A * A);
-                }
-                else if (mode == Mode::peaking)
-                {
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = -k;
-                    c.m2 = -2.0;
-                }
-                else if (mode == Mode::notch)
-                {
-                    let g = w;
-)soul_code"
-R"soul_code(
-
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = -k;
-                    c.m2 = 0.0;
-                }
-                else if (mode == Mode::allpass)
-                {
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = -2.0 * k;
-                    c.m2 = 0.0;
-                }
-                else if (mode == Mode::bell)
-                {
-                    let A = pow (10.0, gain / 40.0);
-                    let g = w;
-                    c.a1 = 1.0 / (1.0 + g * (g + k));
-                    c.a2 = g * c.a1;
-                    c.a3 = g * c.a2;
-                    c.m0 = 1.0;
-                    c.m1 = k * (A * A - 1.0);
-                    c.m2 = 0.0;
-                }
-            }
-
-            /** */
-            SampleType process (State& s, SampleType x, Coeffs& c)
-            {
-                let v0 = x;
-                let v3 = v0 - s.ic2eq;
-                let v1 = SampleType (c.a1 * s.ic1eq + c.a2 * v3);
-                let v2 = SampleType (s.ic2eq + c.a2 * s.ic1eq + c.a3 * v3);
-                s.ic1eq = SampleType (2.0 * v1 - s.ic1eq);
-                s.ic2eq = SampleType (2.0 * v2 - s.ic2eq);
-                return    SampleType (c.m0 * v0 + c.m1 * v1 + c.m2 * v2);
-            }
-
-            /** */
-            processor Processor (int initialMode = 0,
-                                 float initialFrequency = defaultFreqHz,
-                                 float initialQuality = defaultQuality,
-                                 float initialGain = defaultGain)
-            {
-                input stream SampleType in;
-                output stream SampleType out;
-
-                input event
-                {
-)soul_code"
-R"soul_code(
-
-                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-                    float qualityIn   [[ name: "Q",         min: 0.001,       max: 100.0,     init: defaultQuality ]];
-                    float gainIn      [[ name: "Gain",      min: -36.0,       max: 36.0,      init: 0.0,           unit: "dB"]];
-                    float modeIn      [[ name: "Mode",      min: 0,           max: 8,         init: 0,             text: "Lowpass|Highpass|Bandpass|LowShelf|HighShelf|Peaking|Notch|Allpass|Bell"]];
-                }
-
-                event frequencyIn (float v) { frequency = v; recalc = true; }
-                event qualityIn   (float v) { quality = v; recalc = true; }
-                event gainIn      (float v) { gain = v; recalc = true; }
-                event modeIn      (float v) { mode = int (v); recalc = true; }
-
-                float frequency = initialFrequency,
-                        quality = initialQuality,
-                           gain = initialGain;
-                int mode = initialMode;
-                bool recalc = true;
-
-                void run()
-                {
-                    State s;
-                    Coeffs c;
-
-                    loop
-                    {
-                        if (recalc)
-                        {
-                            recalc = false;
-                            let clippedFrequency = clamp (float64 (frequency),
-                                                          float64 (minFreqHz),
-                                                          processor.frequency * normalisedFreqLimit);
-                            c.update (processor.frequency, mode, clippedFrequency, quality, gain);
-                        }
-
-                        loop (updateInterval)
-                        {
-                            out << s.process (in, c);
-                            advance();
-                        }
-                    }
-                }
-            }
+        https://ccrma.stanford.edu/~jos/fp/DC_Blocker.html
+    */
+    namespace dc_blocker
+    {
+        /** Holds a set of filter coefficients. */
+        struct Coeffs
+        {
+            CoeffType b1;
+            CoeffType a0;
         }
 
-)soul_code"
-R"soul_code(
-
-    } // (namespace tpt)
-}
-)soul_code";
-
-    if (moduleName == "soul.oscillators")  return R"soul_code(
-/** Title: Oscillators
-
-    This module contains a collection of oscillator algorithms for generating
-    various wave-shapes. The collection covers low frequency designs and high quality alias
-    free algotithms.
-*/
-
-/**
-    The `oscillators` namespace is parameterised with a `SampleType` and `PhaseType`. The `SampleType` specifies
-    the output type, and can be either `float32` or `float64`. The `PhaseType` is used internally to track
-    phase position, so higher resolution data types can be used to reduce frequency inaccuracy for very critical
-    applications.
-
-    By default the `SampleType` and `PhaseType` are float32.
-*/
-namespace soul::oscillators (using SampleType = float32,
-                             using PhaseType  = float32)
-{
-    static_assert (SampleType.isFloat, "The SampleType must be a float");
-    static_assert (PhaseType.isFloat && ! PhaseType.isVector, "The PhaseType must be a float");
-
-    let minFreqHz = 0.0f;
-    let maxFreqHz = 22000.0f;
-    let defaultFreqHz = 1000.0f;
-
-    //==============================================================================
-    /// A unipolar ramp (phasor) oscillator.
-    /// This is a non-bandlimited oscillator that will cause aliasing, but is used internally by the BLEP oscillator.
-    namespace phasor
-    {
+        /** Holds the filter state. */
         struct State
         {
-            /// The phase uses a range 0 to 1.0
-            PhaseType phase;
-            /// The increment of phase per frame
-            PhaseType phaseIncrement;
+            SampleType[1] x;
+            SampleType[1] y;
         }
 
-        /// Resets a phaser::State object
+        /** Resets a filter state. */
         void reset (State& s)
         {
-            s.phase = PhaseType();
+            s.x[0] = SampleType();
+            s.y[0] = SampleType();
         }
 
-        /// Updates a phaser::State object for a new rate
-        void update (State& s, float64 samplePeriod, float64 freqHz)
+        /** Updates a set of coefficients for the given settings. */
+        void update (Coeffs& c, float64 sampleRate, float64 freqHz)
         {
-            s.phaseIncrement = PhaseType (samplePeriod * freqHz);
+            let w = pi * freqHz / sampleRate;
+            c.a0 = CoeffType (1.0 / (1.0 + w));
+            c.b1 = CoeffType ((1.0 - w) * c.a0);
         }
 
-        /// Increments a phaser::State object and returns the new phase
-        PhaseType process (State& s)
+        SampleType process (State& s, SampleType x, Coeffs& c)
         {
-            s.phase += s.phaseIncrement;
-
-)soul_code"
-R"soul_code(
-
-            while (s.phase >= PhaseType (1))
-                s.phase -= PhaseType (1);
-
-            return s.phase;
+            let y = SampleType (x - s.x[0] + c.a0 * s.y[0]);
+            s.x[0] = x;
+            s.y[0] = y;
+            return SampleType (c.b1 * y);
         }
 
-        /// A processor that produces a stream of phase values as its output.
-        processor Processor (float initialFrequency = 1000)
+        processor Processor (float64 frequency = 30.0f)
         {
+            input stream SampleType in;
             output stream SampleType out;
-            input event float frequencyIn [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz" ]];
-            event frequencyIn (float v) { s.update (processor.period, v); }
-
-            State s;
-
-            void init()
-            {
-                s.update (processor.period, initialFrequency);
-            }
 
             void run()
             {
+                State s;
+                Coeffs c;
+
+                c.update (processor.frequency, frequency);
+
                 loop
                 {
-                    out << SampleType (s.process());
+                    out << s.process (in, c);
                     advance();
                 }
             }
@@ -2876,866 +2445,1624 @@ R"soul_code(
     }
 
     //==============================================================================
-    /// A simple sinewave oscillator which receives input events to control its frequency.
-    processor Sine (float initialFrequency = 1000)
-    {
-        output stream SampleType out;
-        input event float frequencyIn  [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz" ]];
-        event frequencyIn (float v) { phaseIncrement = float (v * twoPi * processor.period); }
+    /** Biquadratic (two-pole-two-zero) IIR filter building block.
 
-        var phaseIncrement = float (initialFrequency * twoPi * processor.period);
+        Direct Form I (DFI):
 
-        void run()
-        {
-            float phase;
+            y[n] = b0 * x[n] + b1 * x[n-1] + b2 * x[n-2] - a1 * y[n-1] - a2 * y[n-2]
 
-            loop
-            {
-                out << sin (phase);
-                phase = addModulo2Pi (phase, phaseIncrement);
-                advance();
-            }
-        }
-    }
+        Transposed Direct Form II (TDFII):
 
-    //==============================================================================
-    /// A semi band-limited oscillator with sawtooth, square and triangle wave shapes
-    /// using the PolyBLEP (Polynomial Band-Limited Step) technique.
-    /// You may want to oversample this oscillator, in order to reduce aliasing.
-    ///
+            y[n] = b0 * x[n] + s1
+              s1 = b1 * x[n] + a1 * y[n] + s2
+              s2 = b2 * x[n] + a2 * y[n]
+    */
+    namespace biquad
+    {
 )soul_code"
 R"soul_code(
 
-    namespace poly_blep
-    {
-        /// Contains different wave-shaping functions.
-        namespace shapers
-        {
-            /// Generates a polyblep
-            PhaseType polyblep (PhaseType phase, PhaseType phaseIncrement)
-            {
-                if (phase < phaseIncrement)
-                {
-                    phase /= phaseIncrement;
-                    return (phase + phase) - (phase * phase) - PhaseType (1);
-                }
-
-                if (phase > PhaseType (1) - phaseIncrement)
-                {
-                    phase = (phase - PhaseType (1)) / phaseIncrement;
-                    return (phase * phase) + (phase + phase) + PhaseType (1);
-                }
-
-                return PhaseType (0);
-            }
-
-            /// Generates a sawtooth wave from a phasor state
-            PhaseType sawtooth (phasor::State& s)
-            {
-                return PhaseType (-1) + (PhaseType (2) * s.phase) - polyblep (s.phase, s.phaseIncrement);
-            }
+        // Coefficients and related functions
 
-            /// Generates a square wave from a phasor state
-            PhaseType square (phasor::State& s)
-            {
-                return (s.phase < PhaseType (0.5) ? PhaseType (-1) : PhaseType (1))
-                        - polyblep (s.phase, s.phaseIncrement)
-                        + polyblep (fmod (s.phase + PhaseType (0.5), PhaseType (1)), s.phaseIncrement);
-            }
+        /** Holds a set of filter coefficients. */
+        struct Coeffs
+        {
+            CoeffType<3> b, /**< feed-forward, numerator, zero, FIR coefficients */
+                         a; /**< feed-back, denominator, pole, IIR coefficients */
         }
 
-        /// Contains constants for different wave-shapes
-        namespace Shape
+        /** Initialises a set of coefficients. */
+        void set (Coeffs &c,
+                  CoeffType b0, CoeffType b1, CoeffType b2,
+                  CoeffType a0, CoeffType a1, CoeffType a2)
         {
-            let sawtooth = 0;
-            let triangle = 1;
-            let square   = 2;
+            c.b[0] = b0; c.b[1] = b1; c.b[2] = b2; c.a[0] = a0; c.a[1] = a1; c.a[2] = a2;
         }
 
-        /// A processor which generates a dynamically adjustable wave-shape.
-        processor Processor (int initialShape = 0,
-                            float initialFrequency = 1000)
+        /** Sets the coefficients, normalising based on the first feedback coefficient v.a[0] */
+        void setNonNormalised (Coeffs &c, const Coeffs& v)
         {
-            output stream SampleType out;
-            input event float shapeIn       [[ name: "Shape",     min: 0,         max: 2,         init: 0,    text: "Sawtooth|Triangle|Square"]];
-)soul_code"
-R"soul_code(
-
-            input event float frequencyIn   [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
-
-            event shapeIn (float v)        { shape = wrap<3> (floor (v)); }
-            event frequencyIn (float v)    { s.update (processor.period, v); }
-
-            phasor::State s;
-            var shape = wrap<3> (initialShape);
-
-            void init()
-            {
-                s.update (processor.period, initialFrequency);
-            }
-
-            void run()
-            {
-                PhaseType y = PhaseType (0);
-                PhaseType triAccumulator = PhaseType (0);
-
-                loop
-                {
-                    if (shape == Shape::sawtooth)
-                    {
-                        y = shapers::sawtooth (s);
-                    }
-                    else if (shape == Shape::triangle)
-                    {
-                        // leaky integrator
-                        let coefficient = PhaseType (1.0 - (0.25 * s.phaseIncrement));
-                        triAccumulator = s.phaseIncrement * shapers::square (s) + coefficient * triAccumulator;
-                        y = triAccumulator * PhaseType (4);
-                    }
-                    else if (shape == Shape::square)
-                    {
-                        y = shapers::square (s);
-                    }
-
-                    s.process();
+            let oneOverA0 = 1.0 / v.a[0];
+            c.b = v.b * oneOverA0;
+            c.a = v.a * oneOverA0;
+            c.a[0] = v.a[0]; // keep original a0
+        }
 
-                    out << SampleType (y);
+        /** Sets the coefficients, assuming v is already normalised. */
+        void setNormalised (Coeffs &c, Coeffs v)
+        {
+            c = v;
+        }
 
-                    advance();
-                }
-            }
+        /** Clears a set of coefficients. */
+        void clear (Coeffs &c)
+        {
+            c.b = CoeffType();
+            c.a = CoeffType();
         }
-    }
 
-    //==============================================================================
-    /// A quadrature sinusoidal oscillator producing sine and cosine outputs simultaneously.
-    /// The `updateInterval` defines the samples between updates to the frequency taking effect.
-    /// https://vicanek.de/articles/QuadOsc.pdf
-    ///
-    namespace quadrature (int updateInterval = 16)
-    {
+        /** Holds the filter state. */
         struct State
         {
-            SampleType u, v;
+            SampleType[2] x;
+            SampleType[2] y;
         }
 
-        struct Coeffs
+        /** Resets a filter state. */
+        void reset (State &s)
         {
-            SampleType k1, k2;
+            s.x[0] = SampleType();
+            s.x[1] = SampleType();
+            s.y[0] = SampleType();
+            s.y[1] = SampleType();
+        }
+
+        /** */
+        SampleType processDFI (State& s, SampleType x, Coeffs& c)
+        {
+            let y  = SampleType (c.b[0] * x
+                               + c.b[1] * s.x[0]
+                               + c.b[2] * s.x[1]
+                               - c.a[1] * s.y[0]
+                               - c.a[2] * s.y[1]);
+
+            s.x[1] = s.x[0];
+            s.x[0] = x;
 )soul_code"
 R"soul_code(
 
-        }
+            s.y[1] = s.y[0];
+            s.y[0] = y;
 
-        /// Resets a quadrature::State object.
-        void reset (State& s)
-        {
-            s.u = SampleType (1);
-            s.v = SampleType();
+            return y;
         }
 
-        /// Updates a quadrature::State object for a new rate.
-        void update (Coeffs& c, float64 freqHz, float64 sampleRate)
+        /** See https://www.earlevel.com/DigitalAudio/images/BiquadTDFII.gif */
+        SampleType processTDFII (State& s, SampleType x, Coeffs& c)
         {
-            let w = twoPi * (freqHz / sampleRate);
-            c.k1 = SampleType (tan (0.5 * w));
-            c.k2 = SampleType (2.0 * c.k1 / (1.0 + c.k1 * c.k1));
+            let y  = s.x[0] + SampleType (c.b[0]) * x;
+            s.x[0] = s.y[0] + SampleType (c.b[1]) * x - SampleType (c.a[1]) * y;
+            s.y[0] = SampleType (c.b[2]) * x - SampleType (c.a[2]) * y;
+            return y;
         }
 
-        /// Generates the next samples for a quadrature::State object.
-        SampleType[2] process (State& s, Coeffs& c)
+        /** Like processTDFII, but optimised for c.b[2] and c.a[2] == 0. */
+        SampleType processOnePole (State& s, SampleType x, Coeffs& c)
         {
-            let tmp = s.u - c.k1 * s.v;
-            s.v = s.v + c.k2 * tmp;
-            s.u = tmp - c.k1 * s.v;
-            return SampleType[2] (s.v, s.u);
+            let y  = s.x[0] + SampleType (c.b[0]) * x;
+            s.x[0] = SampleType (c.b[1]) * x - SampleType (c.a[1]) * y;
+            return y;
         }
 
-        /// A processor that generates a pair of sine/cosine output streams.
-        processor Processor (float initialFrequency = 1000)
+        /** */
+        SampleType processCascadeDFI<StateArrayType, CoeffsArrayType> (SampleType x,
+                                                                       StateArrayType& s,
+                                                                       CoeffsArrayType& c)
         {
-            output stream SampleType sineOut;
-            output stream SampleType cosineOut;
+            static_assert (StateArrayType.isArray, "states argument is not an array");
+            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
+            static_assert (s.size == c.size, "states and coeffs arrays are not the same size");
 
-            input event float frequencyIn [[ name: "Frequency", min: -maxFreqHz, max: maxFreqHz, init: 0.0, unit: "Hz"]]; // Default meta data allows negative frequencies
+            var y = x;
 
-            event frequencyIn (float v) { frequency = v; recalc = true; }
+            for (wrap<s.size> i)
+                y = processDFI (s[i], y, c[i]);
 
-            float frequency  = initialFrequency;
-            bool  recalc     = true;
+            return y;
+        }
 
-            void run()
-            {
-                State s;
-                Coeffs c;
+        /** */
+        SampleType processCascadeTDFII<StateArrayType, CoeffsArrayType> (SampleType x,
+                                                                         StateArrayType& s,
+                                                                         CoeffsArrayType& c)
+        {
+            static_assert (StateArrayType.isArray, "states argument is not an array");
+            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
+)soul_code"
+R"soul_code(
 
-                s.reset();
+            static_assert (s.size == c.size, "states and coeffs arrays are not the same size");
 
-                loop
-                {
-                    if (recalc)
-                    {
-                        recalc = false;
-                        c.update (frequency, processor.frequency);
-                    }
+            var y = x;
 
-                    loop (updateInterval)
-                    {
-                        let y = s.process (c);
-                        sineOut << y[0];
-                        cosineOut << y[1];
-                        advance();
-                    }
-                }
-            }
+            for (wrap<s.size> i)
+                y = processTDFII (s[i], y, c[i]);
+
+            return y;
         }
     }
 
-)soul_code"
-R"soul_code(
-
     //==============================================================================
-    ///
-    /// A tempo-syncable LFO with some common shapes and options for uni-polar or bi-polar output.
-    /// Unipolar LFO shapes run between 0 and 1, whilst Bipolar run between -1 and 1.
-    ///
-    namespace lfo
+    /**
+        First-order IIR filter.
+
+            y[n] = b0 * x[n] - a1 * y[n-1]
+
+        Coefficients derived from Pirkle.
+        This filter is not suitable for modulation.
+    */
+    namespace onepole
     {
-        /// Various LFO shape generator functions.
-        namespace shapers
-        {
-            SampleType rampUp           (PhaseType phase) { return (phase * 2.0f) - 1.0f; }
-            SampleType rampUpUnipolar   (PhaseType phase) { return phase; }
-            SampleType rampDown         (PhaseType phase) { return ((1.0f - phase) * 2.0f) - 1.0f; }
-            SampleType rampDownUnipolar (PhaseType phase) { return (1.0f - phase); }
-            SampleType triangle         (PhaseType phase) { return (2.0f * (1.0f - abs ((wrap (phase + 0.25f, 1.0f) * 2.0f) -1.0f))) - 1.0f; }
-            SampleType triangleUnipolar (PhaseType phase) { return 1.0f - abs((phase * 2.0f) - 1.0f ); }
-            SampleType square           (PhaseType phase) { return (float (phase > 0.5f) * 2.0f) - 1.0f; }
-            SampleType squareUnipolar   (PhaseType phase) { return float (phase > 0.5f); }
-            SampleType sine             (PhaseType phase) { return sin (phase * float32 (twoPi)); }
-            SampleType sineUnipolar     (PhaseType phase) { return (sin (phase * float32 (twoPi)) + 1.0f) * 0.5f; }
-        }
+        namespace biquad = soul::filters::biquad;
 
-        /// A set of constants to specify different LFO shapes.
-        namespace Shape
+        /** Constants for use in specifying the filter mode. */
+        namespace Mode
         {
-            let triangle      = 0;
-            let square        = 1;
-            let rampUp        = 2;
-            let rampDown      = 3;
-            let sine          = 4;
-            let sampleAndHold = 5;
+            let lowpass  = 0;
+            let highpass = 1;
+            let allpass  = 2;
         }
 
-        /// Polarity control constants.
-        namespace Polarity
+        /** Updates a set of coefficients for the given settings. */
+        void update (biquad::Coeffs& c, float64 sampleRate, int mode, float64 freqHz)
         {
-            let unipolar = 0;
-            let bipolar  = 1;
-        }
+            biquad::Coeffs nc; // normalised coefficients
+            nc.a[0] = 1.0;
 
-        /// Functions for applying a smoothing filter on a changing value.
-        namespace smoother
-        {
-            struct State
-)soul_code"
-R"soul_code(
+            let theta = twoPi * (freqHz / sampleRate);
 
+            if (mode == Mode::lowpass)
             {
-                float currentValue;
-                float targetValue;
-                float increment;
-                int steps;
-            }
+                let gamma = cos (theta) / (1.0 + sin (theta));
 
-            /// Resets a smoother::State object
-            void reset (State& state, float initialValue)
-            {
-                state.currentValue = initialValue;
-                state.targetValue = initialValue;
-                state.increment = 0.0f;
-                state.steps = 0;
+                nc.b[0] = (1.0 - gamma) / 2.0;
+                nc.b[1] = (1.0 - gamma) / 2.0;
+                nc.a[1] = -gamma;
             }
-
-            /// Updates a smoother::State object with a new target value and the
-            /// number of steps to reach the target
-            void setTarget (State& state, float targetValue, int steps)
+            else if (mode == Mode::highpass)
             {
-                state.targetValue = targetValue;
-                state.increment = (state.targetValue - state.currentValue) / steps;
-                state.steps = steps;
-            }
+                let gamma = cos (theta) / (1.0 + sin (theta));
 
-            /// Advances the state of a smoother and returns the new smoothed value
-            float tick (State& state)
+                nc.b[0] = (1.0 + gamma) / 2.0;
+                nc.b[1] = -(1.0 + gamma) / 2.0;
+                nc.a[1] = -gamma;
+            }
+            else if (mode == Mode::allpass)
             {
-                if (state.steps == 0)
-                    return state.currentValue;
-
-                state.currentValue += state.increment;
-                state.steps--;
-
-                if (state.steps == 0)
-                    state.currentValue = state.targetValue;
+                let w = tan (theta * 0.5);
+                let alpha = (w - 1.0) / (w + 1.0);
 
-                return state.currentValue;
+                nc.b[0] = alpha;
+                nc.b[1] = 1.0;
+                nc.a[1] = alpha;
             }
+
+            c.setNormalised (nc);
         }
 
-        /// A processor which implements an LFO with events to control its parameters.
-        /// Changes to the frequency and depth are smoothed, but expect discontinuities if the shape or polarity
-        /// are updated.
-        processor Processor (int initialShape = 0,
-                             int initialPolarity = 0,
-                             float initialDepth = 1.0f,
-                             float initialFrequency = 1.0f)
+        /** A processor to render a onepole filter. */
+        processor Processor (int initialMode = 0,
+)soul_code"
+R"soul_code(
+
+                             float initialFrequency = defaultFreqHz)
         {
+            input stream SampleType in;
             output stream SampleType out;
 
             input event
             {
-                soul::timeline::Position positionIn;
-                soul::timeline::TransportState transportStateIn;
-)soul_code"
-R"soul_code(
-
-                soul::timeline::Tempo tempoIn;
-
-                float rateHzIn     [[ name: "Rate (Hz)",     min: 0.01,  max: 40.0,   init: 1.,   unit: "hz", step: 0.01 ]];
-                float rateTempoIn  [[ name: "Rate (Beats)",  min: 0.001, max: 32,     init: 0,    unit: "beat", step: 0.001]];
-                float depthIn      [[ name: "Depth",         min: 0,     max: 100,    init: 100,  unit: "%",  step: 1 ]];
-                float shapeIn      [[ name: "Shape",         min: 0,     max: 5,      init: 0,    text: "Triangle|Square|Ramp Up|Ramp Down|Sine|Sample & Hold"]];
-                float polarityIn   [[ name: "Polarity",      min: 0,     max: 1,      init: 0,    text: "Unipolar|Bipolar"]];
-                float rateModeIn   [[ name: "Rate Mode",     min: 0,     max: 1,      init: 0,    text: "Hz|Tempo"]];
-                float syncIn       [[ name: "Timeline Sync", min: 0,     max: 1,      init: 0,    text: "Off|On"]];
+                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                float modeIn      [[ name: "Mode",      min: 0,           max: 2,         init: 0,         text: "Lowpass|Highpass|Allpass"]];
             }
 
-            event positionIn (soul::timeline::Position v)             { qnPos = v.currentQuarterNote; }
-            event transportStateIn (soul::timeline::TransportState v) { transportRunning = v.state > 0; }
-            event tempoIn (soul::timeline::Tempo v)                   { qnPhaseIncrement = (v.bpm / 60.0f) * float (processor.period); }
+            event frequencyIn (float v)   { frequency = v;  recalc = true; }
+            event modeIn      (float v)   { mode = int (v); recalc = true; }
 
-            event rateHzIn (float v)
+            float frequency  = initialFrequency;
+            int   mode       = initialMode;
+            bool  recalc     = true;
+
+            void run()
             {
-                if (! qnMode)
-                    phaseIncrement = PhaseType (v * processor.period);
+                biquad::State s;
+                biquad::Coeffs c;
+
+                loop
+                {
+                    if (recalc)
+                    {
+                        recalc = false;
+                        let clippedFrequency = clamp (float64 (frequency),
+                                                      float64 (minFreqHz),
+                                                      processor.frequency * normalisedFreqLimit);
+                        update (c, processor.frequency, mode, clippedFrequency);
+                    }
+
+                    loop (updateInterval)
+                    {
+                        out << s.processOnePole (in, c);
+                        advance();
+                    }
+                }
             }
+        }
+    }
 
-            event rateTempoIn (float v)   { qnScalar = v; }
-            event depthIn (float v)       { depth.setTarget (v * 0.01f, smoothingSamples); }
-            event shapeIn (float v)       { shape = int (floor (v)); }
-            event polarityIn (float v)    { polarity = (v < 0.5f) ? Polarity::unipolar : Polarity::bipolar; }
-            event rateModeIn (float v)    { qnMode = v > 0.5f; }
-            event syncIn (float v)        { timelineSync = v > 0.5f; }
+    //==============================================================================
+    /** RBJ biquad EQ, 2nd Order IIR Filter.
 
-            PhaseType phase;
+        This filter is not suitable for modulation.
+        See https://webaudio.github.io/Audio-EQ-Cookbook/audio-eq-cookbook.html
+    */
+    namespace rbj_eq
+    {
+        namespace biquad = soul::filters::biquad;
+
+        /** Constants for use in specifying the filter mode. */
+        namespace Mode
+        {
 )soul_code"
 R"soul_code(
 
-            var phaseIncrement = float32 (initialFrequency * processor.period);
-            int shape = initialShape;
-            int polarity = initialPolarity;
-            smoother::State depth;
+            let lowpass   = 0;
+            let highpass  = 1;
+            let bandpass  = 2;
+            let lowShelf  = 3;
+            let highShelf = 4;
+            let peaking   = 5;
+            let notch     = 6;
+            let allpass   = 7;
+        }
 
-            let smoothingSamples = int (processor.frequency * 0.02);
-            bool transportRunning = false;
-            bool qnMode = false;
-            bool timelineSync = false;
-            float64 qnScalar = 1.0;
-            float64 qnPos = 0.0;
-            float32 qnPhaseIncrement = (120.0f / 60.0f) * (1.0f / 44100.0f); // Default = 1qn @ 120bpm / 44.1 sr
+        /** Updates a set of coefficients for the given settings. */
+        void update (biquad::Coeffs& c,
+                     float64 sampleRate, int mode, float64 freqHz,
+                     float64 quality, float64 gaindB)
+        {
+            biquad::Coeffs nnc; // non-normalised coefficients
 
-            PhaseType prevPhase = 1.0f;
-            soul::random::RandomNumberState rng;
-            SampleType noiseSample;
+            let theta = twoPi * (freqHz / sampleRate);
+            let sinTheta = sin (theta);
+            let cosTheta = cos (theta);
+            let Q = max (quality, 0.001);
+            let alpha = sinTheta / (2.0 * Q);
 
-            SampleType getNoiseSample()
+            if (mode == Mode::lowpass)
             {
-                if (phase < prevPhase)
-                    noiseSample = SampleType (polarity == Polarity::bipolar ? rng.getNextBipolar()
-                                                                            : rng.getNextUnipolar());
-
-                prevPhase = phase;
-                return noiseSample;
+                nnc.b[0] = (1.0 - cosTheta) / 2.0;
+                nnc.b[1] =  1.0 - cosTheta;
+                nnc.b[2] = (1.0 - cosTheta) / 2.0;
+                nnc.a[0] =  1.0 + alpha;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] =  1.0 - alpha;
             }
-
-            SampleType getNextSample()
+            else if (mode == Mode::highpass)
             {
-                if (polarity == Polarity::bipolar)
-                {
-                    if (shape == Shape::triangle)      return shapers::triangle (phase);
-                    if (shape == Shape::square)        return shapers::square (phase);
-                    if (shape == Shape::rampUp)        return shapers::rampUp (phase);
-                    if (shape == Shape::rampDown)      return shapers::rampDown (phase);
-                    if (shape == Shape::sine)          return shapers::sine (phase);
-                    if (shape == Shape::sampleAndHold) return getNoiseSample();
-                }
-                else
-                {
-                    if (shape == Shape::triangle)      return shapers::triangleUnipolar (phase);
-                    if (shape == Shape::square)        return shapers::squareUnipolar (phase);
+                nnc.b[0] = (1.0 + cosTheta) / 2.0;
+                nnc.b[1] = -(1.0 + cosTheta);
+                nnc.b[2] = (1.0 + cosTheta) / 2.0;
+                nnc.a[0] =  1.0 + alpha;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] =  1.0 - alpha;
+            }
+            else if (mode == Mode::bandpass) // (constant 0 dB peak gain)
+            {
+                nnc.b[0] = alpha;
+                nnc.b[1] = 0.0;
+                nnc.b[2] = -alpha;
+                nnc.a[0] =  1.0 + alpha;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] =  1.0 - alpha;
+            }
+            else if (mode == Mode::lowShelf)
+            {
+                let A = pow (10.0, gaindB / 40.0);
+                nnc.b[0] = A * ((A + 1) - (A - 1) * cosTheta + 2 * sqrt (A) * alpha);
 )soul_code"
 R"soul_code(
 
-                    if (shape == Shape::rampUp)        return shapers::rampUpUnipolar (phase);
-                    if (shape == Shape::rampDown)      return shapers::rampDownUnipolar (phase);
-                    if (shape == Shape::sine)          return shapers::sineUnipolar (phase);
-                    if (shape == Shape::sampleAndHold) return getNoiseSample();
-                }
-
-                return SampleType();
+                nnc.b[1] = 2.0 * A * ( (A - 1) - (A + 1) * cosTheta);
+                nnc.b[2] = A * ((A + 1) - (A - 1) * cosTheta - 2 * sqrt (A) * alpha);
+                nnc.a[0] = (A + 1) + (A - 1) * cosTheta + 2 * sqrt (A) * alpha;
+                nnc.a[1] = -2.0 * ( (A - 1) + (A + 1) * cosTheta);
+                nnc.a[2] = (A + 1) + (A - 1) * cosTheta - 2 * sqrt (A) * alpha;
+            }
+            else if (mode == Mode::highShelf)
+            {
+                let A = pow (10.0, gaindB / 40.0);
+                nnc.b[0] = A * ((A + 1) + (A - 1) * cosTheta + 2.0 * sqrt (A) * alpha);
+                nnc.b[1] = -2.0 * A * ( (A - 1) + (A + 1) * cosTheta);
+                nnc.b[2] = A * ((A + 1) + (A - 1) * cosTheta - 2.0 * sqrt (A) * alpha);
+                nnc.a[0] = (A + 1) - (A - 1) * cosTheta + 2.0 * sqrt (A) * alpha;
+                nnc.a[1] = 2.0 * ( (A - 1) - (A + 1) * cosTheta);
+                nnc.a[2] = (A + 1) - (A - 1) * cosTheta - 2.0 * sqrt (A) * alpha;
+            }
+            else if (mode == Mode::peaking)
+            {
+                let A = pow (10.0, gaindB / 40.0);
+                nnc.b[0] = 1.0 + alpha * A;
+                nnc.b[1] = -2.0 * cosTheta;
+                nnc.b[2] = 1.0 - alpha * A;
+                nnc.a[0] = 1.0 + alpha / A;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] = 1.0 - alpha / A;
+            }
+            else if (mode == Mode::notch)
+            {
+                nnc.b[0] = 1.0;
+                nnc.b[1] = -2.0 * cosTheta;
+                nnc.b[2] = 1.0;
+                nnc.a[0] = 1.0 + alpha;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] = 1.0 - alpha;
+            }
+            else if (mode == Mode::allpass)
+            {
+                nnc.b[0] = 1.0 - alpha;
+                nnc.b[1] = -2.0 * cosTheta;
+                nnc.b[2] = 1.0 + alpha;
+                nnc.a[0] = 1.0 + alpha;
+                nnc.a[1] = -2.0 * cosTheta;
+                nnc.a[2] = 1.0 - alpha;
             }
 
-            void init()
+)soul_code"
+R"soul_code(
+
+            c.setNonNormalised (nnc);
+        }
+
+        /** */
+        processor Processor (int initialMode = 0,
+                             float initialFrequency = defaultFreqHz,
+                             float initialQuality   = defaultQuality,
+                             float initialGain      = defaultGain)
+        {
+            input stream SampleType in;
+            output stream SampleType out;
+
+            input event
             {
-                depth.reset (initialDepth * 0.01f);
+                float modeIn      [[ name: "Mode",      min: 0,           max: 7,         init: 0,         text: "Lowpass|Highpass|Bandpass|LowShelf|HighShelf|Peaking|Notch|Allpass"]];
+                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                float qualityIn   [[ name: "Q",         min: 0.,          max: 10.0,      init: defaultQuality]];
+                float gainIn      [[ name: "Gain",      min: -36.0,       max: 36.0,      init: defaultGain, unit: "dB"]];
             }
 
+            event frequencyIn (float v) { frequency = v;   recalc = true; }
+            event qualityIn   (float v) { quality = v;     recalc = true; }
+            event gainIn      (float v) { gain = v;        recalc = true; }
+            event modeIn      (float v) { mode = int (v);  recalc = true; }
+
+            float  frequency = initialFrequency;
+            float  quality   = initialQuality;
+            float  gain      = initialGain;
+            int    mode      = initialMode;
+            bool   recalc    = true;
+
             void run()
             {
-                rng.reset (processor.id + 10);
+                biquad::State s;
+                biquad::Coeffs c;
 
                 loop
                 {
-                    out << getNextSample() * depth.tick();
-
-                    if (qnMode)
+                    if (recalc)
                     {
-                        if (timelineSync && transportRunning)
-                        {
-                            let oneOverQNScalar = 1.0 / qnScalar;
-                            qnPos += qnPhaseIncrement;
-                            phase = float32 (fmod (qnPos, oneOverQNScalar) / oneOverQNScalar);
-                        }
-                        else // freewheel
-                        {
-                            phase += (qnPhaseIncrement * float32 (qnScalar));
-
-                            while (phase >= 1.0f)
-                                phase -= 1.0f;
-                        }
+                        recalc = false;
+                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
+                        c.update (processor.frequency, mode, clippedFrequency, quality, gain);
                     }
-                    else
-                    {
-                        phase += phaseIncrement;
 
-                        while (phase >= 1.0f)
-                            phase -= 1.0f;
-                    }
+)soul_code"
+R"soul_code(
 
-                    advance();
+                    loop (updateInterval)
+                    {
+                        out << s.processTDFII (in, c);
+                        advance();
+                    }
                 }
             }
         }
     }
-}
-)soul_code";
-
-    if (moduleName == "soul.frequency")  return R"soul_code(
-/**
-    Title: Frequency-domain utilities
-*/
 
-/// Discrete Fourier Transform functions.
-namespace soul::DFT
-{
-    /// Performs a real forward DFT from an input buffer to an output buffer.
-    void forward<SampleBuffer> (const SampleBuffer& inputData, SampleBuffer& outputData)
+    //==============================================================================
+    /**
+        Generic second-order-section cascade biquad processors.
+    */
+    namespace sos_cascade
     {
-        static_assert (SampleBuffer.isFixedSizeArray || SampleBuffer.isVector, "The buffers for DFT::forward() must be fixed size arrays");
-        static_assert (SampleBuffer.elementType.isFloat && SampleBuffer.elementType.isPrimitive, "The element type for DFT::forward() must be floating point");
-        let harmonics = inputData.size / 2;
+        namespace biquad = soul::filters::biquad;
 
-        SampleBuffer inputImag, outputReal, outputImag;
+        /** Supply an array of coefficients for each SOS. The size of the array should be a multiple of 6,
+            and the coefficients are expected to be normalised already
+        */
+        processor Processor (const CoeffType[] coeffs)
+        {
+            input stream SampleType in;
+            output stream SampleType out;
 
-        performComplex (inputData, inputImag, outputReal, outputImag, 1.0f / float (harmonics));
+            let numSOS = size (coeffs) / 6;
+            biquad::State[numSOS] s;
+            biquad::Coeffs[numSOS] c;
 
-        outputData[0:harmonics]             = outputReal[0:harmonics];
-        outputData[harmonics:harmonics * 2] = outputImag[0:harmonics];
-    }
+            void init()
+            {
+                static_assert (size (coeffs) % 6 == 0, "coeffs is not a multiple of 6");
 
-    /// Performs a real inverse DFT from an input buffer to an output buffer.
-    void inverse<SampleBuffer> (const SampleBuffer& inputData, SampleBuffer& outputData)
-    {
-        static_assert (SampleBuffer.isFixedSizeArray || SampleBuffer.isVector, "The buffers for DFT::inverse() must be fixed size arrays");
-        static_assert (SampleBuffer.elementType.isFloat && SampleBuffer.elementType.isPrimitive, "The element type for DFT::inverse() must be floating point");
-        let harmonics = inputData.size / 2;
+                wrap<numSOS> section = 0;
+                wrap<coeffs.size> coeffIdx = 0;
 
-        SampleBuffer inputReal, inputImag, outputReal;
+                loop (numSOS)
+                {
+                    // TODO: replace with dynamic array slice
+                    biquad::set (c[section], coeffs[wrap<coeffs.size> (coeffIdx + 0)],
+                                             coeffs[wrap<coeffs.size> (coeffIdx + 1)],
+                                             coeffs[wrap<coeffs.size> (coeffIdx + 2)],
+                                             coeffs[wrap<coeffs.size> (coeffIdx + 3)],
+                                             coeffs[wrap<coeffs.size> (coeffIdx + 4)],
+                                             coeffs[wrap<coeffs.size> (coeffIdx + 5)]);
+                    section++;
+                    coeffIdx += 6;
+                }
+            }
 
-        inputReal[0:harmonics] = inputData[harmonics:harmonics * 2];
-        inputImag[0:harmonics] = inputData[0:harmonics];
+            void run()
+            {
+                loop
+                {
+                    out << biquad::processCascadeTDFII (in, s, c);
+)soul_code"
+R"soul_code(
 
-        performComplex (inputReal, inputImag, outputReal, outputData, 1.0f);
+                    advance();
+                }
+            }
+        }
     }
 
-    // For internal use by the other functions: performs a O(N^2) complex DFT.
-    void performComplex<SampleBuffer> (const SampleBuffer& inputReal,
-                                       const SampleBuffer& inputImag,
-                                       SampleBuffer& outputReal,
-)soul_code"
-R"soul_code(
+    //==============================================================================
+    /**
+        N-th order Butterworth filter, made by cascading multiple second order sections.
 
-                                       SampleBuffer& outputImag,
-                                       SampleBuffer.elementType scaleFactor)
+        This filter is not suitable for modulation.
+    */
+    namespace butterworth
     {
-        let size = SampleBuffer.size;
+        namespace biquad = soul::filters::biquad;
+        namespace onepole = soul::filters::onepole;
+        namespace rbj = soul::filters::rbj_eq;
 
-        for (int i = 0; i < size; ++i)
+        /** Constants for use in specifying the filter mode. */
+        namespace Mode
         {
-            float64 sumReal, sumImag;
-
-            for (int j = 0; j < size; ++j)
-            {
-                let angle = SampleBuffer.elementType (twoPi * j * i / size);
-                let sinAngle = sin (angle);
-                let cosAngle = cos (angle);
-
-                sumReal += inputImag.at(j) * cosAngle + inputReal.at(j) * sinAngle;
-                sumImag += inputImag.at(j) * sinAngle - inputReal.at(j) * cosAngle;
-            }
-
-            outputImag.at(i) = SampleBuffer.elementType (sumImag) * scaleFactor;
-            outputReal.at(i) = SampleBuffer.elementType (sumReal) * scaleFactor;
+            let lowpass  = 0;
+            let highpass = 1;
         }
-    }
-}
-)soul_code";
 
-    if (moduleName == "soul.notes")  return R"soul_code(
-/** Title: Musical note utilities
+        /** Updates a set of coefficients for the given settings. */
+        void update<CoeffsArrayType> (CoeffsArrayType& coeffs, float64 sampleRate, int order, int mode, float64 freqHz)
+        {
+            static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
 
-    This module contains various structs which can be used to model note-control events
-    coming from sources such as MIDI keyboards.
+            biquad::Coeffs nc; // normalised coefficients
 
-    The SOUL policy is to keep the use of actual MIDI to a minimum, so we encourage
-    incoming MIDI data to be converted into these strongly-typed structures, and to use
-    them internally, rather than attempting to work with MIDI bytes like it's the 1980s.
-*/
+            bool oddOrder = (order % 2) == 1;
 
-/**
-    This namespace contains some types which are handy for representing synthesiser
-    note events. They do a similar job to MIDI events, but as strongly-typed structs
-    instead of a group of bytes. Things like the midi::MPEParser class generate them.
-
-    The events do contain a channel number, in the same way that MIDI does, but there
-    are no restrictions on its range.
-*/
-namespace soul::note_events
-{
-    /// Represents a note-on (key-down) event.
-    struct NoteOn
-    {
-        int channel;
-        float note;
-        float velocity;
-    }
-
-    /// Represents a note-off (key-up) event.
-    struct NoteOff
-    {
-        int channel;
-        float note;
-        float velocity;
-    }
-
-    /// Represents a change to the pitch that should be applied to any notes
-    /// being played on the channel specified.
-    struct PitchBend
-    {
-        int channel;
-        float bendSemitones;
-    }
-
-    /// Represents a change to the pressure that should be applied to any notes
-    /// being played on the channel specified.
-    struct Pressure
-    {
-        int channel;
-        float pressure;
-    }
-
-    /// Represents a change to the Y-axis parameter that should be applied to any notes
-    /// being played on the channel specified.
-    struct Slide
-    {
-        int channel;
-        float slide;
-    }
-
-    /// Represents a change to a user-defined control parameter that should be applied
-    /// to any notes being played on the channel specified.
-    struct Control
-    {
-        int channel;
-        int control;
-        float value;
-    }
-}
-
-)soul_code"
-R"soul_code(
-
-//==============================================================================
-/**
-    Simple voice allocation helpers, which take a single stream of input events,
-    and redirect them to an array of target voice processors.
-*/
-namespace soul::voice_allocators
-{
-    /** A simple voice-allocator which will find either an inactive voice, or the
-        least-recently used active voice if it needs to steal one.
-    */
-    processor Basic (int voiceCount)  [[ main: false ]]
-    {
-        input event (soul::note_events::NoteOn,
-                     soul::note_events::NoteOff,
-                     soul::note_events::PitchBend,
-                     soul::note_events::Pressure,
-                     soul::note_events::Slide,
-                     soul::note_events::Control) eventIn;
-
-        output event (soul::note_events::NoteOn,
-                      soul::note_events::NoteOff,
-                      soul::note_events::PitchBend,
-                      soul::note_events::Pressure,
-                      soul::note_events::Slide,
-                      soul::note_events::Control) voiceEventOut[voiceCount];
-
-        event eventIn (soul::note_events::NoteOn e)
-        {
-            wrap<voiceCount> allocatedVoice = 0;
-            var allocatedVoiceAge = voiceInfo[allocatedVoice].voiceAge;
-
-            // Find the oldest voice to reuse
-            for (int i = 1; i < voiceCount; ++i)
+            if (oddOrder)
             {
-                let age = voiceInfo.at(i).voiceAge;
+                onepole::update (nc, sampleRate, mode, freqHz);
+                coeffs.at (0).setNormalised (nc);
 
-                if (age < allocatedVoiceAge)
+                for (int i=0; i<order/2; i++)
                 {
-                    allocatedVoiceAge = age;
-                    allocatedVoice = wrap<voiceCount>(i);
+                    let Q = 1.0 / (2.0 * cos ((CoeffType (i) + 1.0) * pi / order));
+                    rbj::update (nc, sampleRate, mode, freqHz, Q, 0.);
+                    coeffs.at (i+1).setNormalised (nc);
                 }
             }
-
-            // Send the note on to the voice
-            voiceEventOut[allocatedVoice] << e;
-
-            // If the voice was previously active, we're stealing it, so send a note off too
-            if (voiceInfo[allocatedVoice].active)
+            else
             {
-                soul::note_events::NoteOff noteOff;
+                for (wrap<coeffs.size> i)
+                {
+                    let Q = 1.0 / (2.0 * cos ((2.0 * CoeffType (i) + 1.0) * pi / (order * 2.0)));
+                    rbj::update (nc, sampleRate, mode, freqHz, Q, 0.);
+                    coeffs.at (i).setNormalised (nc);
+                }
+            }
+        }
 
-                noteOff.channel = voiceInfo[allocatedVoice].channel;
+        /** Butterworth processor.
+            The order must be > 0
+        */
+        processor Processor (int order,
 )soul_code"
 R"soul_code(
 
-                noteOff.note    = voiceInfo[allocatedVoice].note;
+                             int initialMode = 0,
+                             float initialFrequency = defaultFreqHz)
+        {
+            input stream SampleType in;
+            output stream SampleType out;
 
-                voiceEventOut[allocatedVoice] << noteOff;
+            input event
+            {
+                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                float modeIn      [[ name: "Mode",      min: 0,           max: 1,         init: 0,         text: "Lowpass|Highpass"]];
             }
 
-            // Update the VoiceInfo for our chosen voice
-            voiceInfo[allocatedVoice].active   = true;
-            voiceInfo[allocatedVoice].channel  = e.channel;
-            voiceInfo[allocatedVoice].note     = e.note;
-            voiceInfo[allocatedVoice].voiceAge = nextAllocatedVoiceAge++;
-        }
+            event frequencyIn (float v) { frequency = v; recalc = true; }
+            event modeIn      (float v) { mode = int (v); recalc = true; clear = true; }
 
-        event eventIn (soul::note_events::NoteOff e)
-        {
-            // Release all voices associated with this note/channel
-            wrap<voiceCount> voice = 0;
+            float frequency = initialFrequency;
+            int mode = initialMode;
+            bool recalc = true;
+            bool clear = true;
 
-            loop (voiceCount)
+            void run()
             {
-                if (voiceInfo[voice].channel == e.channel
-                     && voiceInfo[voice].note == e.note)
+                let numSOS = (order / 2) + (order % 2);
+                biquad::State[numSOS] s;
+                biquad::Coeffs[numSOS] c;
+
+                loop
                 {
-                    // Mark the voice as being unused
-                    voiceInfo[voice].active   = false;
-                    voiceInfo[voice].voiceAge = nextUnallocatedVoiceAge++;
+                    if (recalc)
+                    {
+                        if (clear) // mode change requires clearing histories
+                        {
+                            for (wrap<s.size> i)
+                            {
+                                biquad::reset (s[i]);
+                            }
+                        }
 
-                    voiceEventOut[voice] << e;
-                }
+                        recalc = false;
+                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
+                        update (c, processor.frequency, order, mode, clippedFrequency);
+                    }
 
-                ++voice;
+                    loop (updateInterval)
+                    {
+                        out << biquad::processCascadeTDFII (in, s, c);
+                        advance();
+                    }
+                }
             }
         }
+    }
 
-        event eventIn (soul::note_events::PitchBend e)
-        {
-            // Forward the pitch bend to all notes on this channel
-            wrap<voiceCount> voice = 0;
+    //==============================================================================
+)soul_code"
+R"soul_code(
 
-            loop (voiceCount)
-            {
-                if (voiceInfo[voice].channel == e.channel)
-                    voiceEventOut[voice] << e;
+    /** Analytic filter / IIR Hilbert transformer.
 
-                ++voice;
-            }
-        }
+        https://dsp.stackexchange.com/a/59157
 
-        event eventIn (soul::note_events::Pressure p)
+        Increasing numFilters will increase the accuracy of the quadrature output across the
+        pass band but introduce more delay with respect to the input signal.
+        The filter passband is from transitionBandwidthHz to nyquist - transitionBandwidthHz.
+    */
+    namespace analytic (int numFilters = 6,
+                        float transitionBandwidthHz = 20.0f)
+    {
+        /** Polyphase IIR Designer.
+            Based on HIIR http://ldesoras.free.fr/prod.html#src_hiir
+        */
+        namespace polyphase_iir_design
         {
-            // Forward the event to all notes on this channel
-            wrap<voiceCount> voice = 0;
+            let numCoefficients = numFilters * 2;
+            let order = numCoefficients * 2 + 1;
 
-            loop (voiceCount)
+            /** Holds a set of filter coefficients. */
+            struct Coeffs
             {
-                if (voiceInfo[voice].channel == p.channel)
-                    voiceEventOut[voice] << p;
-
-                ++voice;
+                float64[numCoefficients] coeffs;
             }
-        }
 
-        event eventIn (soul::note_events::Slide s)
-        {
-            // Forward the event to all notes on this channel
-            wrap<voiceCount> voice = 0;
+            /** */
+            Coeffs compute (float64 transition)
+            {
+                Coeffs c;
 
-)soul_code"
-R"soul_code(
+                let p = computeTransitionParam (transition);
 
-            loop (voiceCount)
-            {
-                if (voiceInfo[voice].channel == s.channel)
-                    voiceEventOut[voice] << s;
+                for (wrap<numCoefficients> i)
+                    c.coeffs.at (i) = computeCoeff (i, p);
 
-                ++voice;
+                return c;
             }
-        }
 
-        event eventIn (soul::note_events::Control c)
-        {
-            // Forward the event to all notes on this channel
-            wrap<voiceCount> voice = 0;
-
-            loop (voiceCount)
+            struct TransitionParams
             {
-                if (voiceInfo[voice].channel == c.channel)
-                    voiceEventOut[voice] << c;
+                float64 k, q;
+            }
 
-                ++voice;
+            TransitionParams computeTransitionParam (float64 transition)
+            {
+                var k = tan ((1.0 - transition * 2.0) * (pi / 4));
+                k *= k;
+                let kksqrt = pow (1.0 - k * k, 0.25);
+                let e = 0.5 * (1.0 - kksqrt) / (1 + kksqrt);
+                let e2 = e * e;
+                let e4 = e2 * e2;
+                let q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+                return TransitionParams (k, q);
             }
-        }
 
-        struct VoiceInfo
-        {
-            bool active;
-            int channel;
-            float note;
-            int voiceAge;
-        }
+            float64 computeAccNum (float64 q, int c)
+            {
+                float64 result, i = 0, j = 1;
 
-        int nextAllocatedVoiceAge   = 1000000000;
-        int nextUnallocatedVoiceAge = 1;
+                loop
+                {
+)soul_code"
+R"soul_code(
 
-        VoiceInfo[voiceCount] voiceInfo;
-    }
-}
-)soul_code";
+                    let next = pow (q, float64 (i * (i + 1))) * sin ((i * 2 + 1) * c * pi / order) * j;
+                    result += next;
 
-    if (moduleName == "soul.midi")  return R"soul_code(
-/** Title: MIDI utilities
+                    if (abs (next) < 1e-100)
+                        return result;
 
-    In general, the SOUL policy towards MIDI is to avoid it as much as is humanly possible,
-    so most of these helper functions are concerned with converting MIDI messages to
-    `soul::note_events` types, and then the other libraries use these strongly-typed
-    events to model note actions, rather than dealing with raw MIDI events.
-*/
+                    j = -j;
+                    i++;
+                }
+            }
 
-/// Various MIDI-related types and functions.
-namespace soul::midi
-{
-    /// This type is used to represent a packed short MIDI message. When you create
-    /// an input event endpoint and would like it to receive MIDI, this is the type
-    /// that you should use for it.
-    struct Message
-    {
-        int midiBytes;  /**< Format: (byte[0] << 16) | (byte[1] << 8) | byte[2] */
-    }
+            float64 computeAccDen (float64 q, int c)
+            {
+                float64 result, i = 1.0, j = -1.0;
 
-    /// Extracts the first MIDI byte from a Message object
-    int getByte1 (Message m)     { return (m.midiBytes >> 16) & 0xff; }
-    /// Extracts the second MIDI byte from a Message object
-    int getByte2 (Message m)     { return (m.midiBytes >> 8) & 0xff; }
-    /// Extracts the third MIDI byte from a Message object
-    int getByte3 (Message m)     { return m.midiBytes & 0xff; }
+                loop
+                {
+                    let next = pow (q, (i * i)) * cos (i * 2 * c * pi / order) * j;
+                    result += next;
 
-    /// This event processor receives incoming MIDI events, parses them as MPE,
-    /// and then emits a stream of note events using the types in soul::note_events.
-    /// A synthesiser can then handle the resulting events without needing to go
-    /// near any actual MIDI or MPE data.
-    ///
-    processor MPEParser  [[ main: false ]]
-    {
-        input event Message parseMIDI;
+                    if (abs (next) < 1e-100)
+                        return result;
 
-        output event (soul::note_events::NoteOn,
-                      soul::note_events::NoteOff,
-                      soul::note_events::PitchBend,
-                      soul::note_events::Pressure,
-                      soul::note_events::Slide,
-                      soul::note_events::Control) eventOut;
+                    j = -j;
+                    i = i + 1.0;
+                }
+            }
 
-        let MPESlideControllerID = 74;
+            float64 computeCoeff (int index, TransitionParams params)
+            {
+                let num = computeAccNum (params.q, index + 1)  * pow (params.q, 0.25);
+                let den = computeAccDen (params.q, index + 1) + 0.5;
+                let ww = num / den;
+                let wwsq = ww * ww;
 
-        event parseMIDI (Message message)
+                let x = sqrt ((1 - wwsq * params.k) * (1.0 - wwsq / params.k)) / (1.0 + wwsq);
+                return (1.0 - x) / (1.0 + x);
+            }
+        }
+
+        /** Parallel 2nd-order all-pass.
+
+                y[n] = c * (x[n] + y[n - 2]) - x[n - 2]
+        */
+        namespace dual_apf
         {
-            let messageByte1 = message.getByte1();
-            let messageByte2 = message.getByte2();
+            /** Holds the filter state. */
+            struct State
+            {
+                SampleType[2] x1, y1, x2, y2;
+                CoeffType[2] c;
+            }
+
+            /** */
+            SampleType[2] process (State& s, SampleType[2] x)
+            {
+                let y = SampleType[2] (SampleType (s.c[0]) * (x[0] + s.y2[0]) - s.x2[0],
+                                       SampleType (s.c[1]) * (x[1] + s.y2[1]) - s.x2[1]);
+                s.x2 = s.x1;
+                s.x1 = x;
+                s.y2 = s.y1;
+                s.y1 = y;
+
+                return y;
+            }
+        }
+
 )soul_code"
 R"soul_code(
 
-            let messageByte3 = message.getByte3();
+        /** Holds the filter state. */
+        struct State
+        {
+            dual_apf::State[numFilters] apfs;
+            SampleType[1] x;
+        }
 
-            let messageType  = messageByte1 & 0xf0;
-            let channel      = messageByte1 & 0x0f;
+        /** Updates a filter state with the given sample rate. */
+        void update (State& s, float64 sampleRate)
+        {
+            let design = polyphase_iir_design::compute (2.0 * (transitionBandwidthHz / sampleRate));
 
-            if (messageType == 0x80)
-            {
-                eventOut << soul::note_events::NoteOff (channel, float (messageByte2), normaliseValue (messageByte3));
-            }
-            else if (messageType == 0x90)
+            for (wrap<numFilters> i)
             {
-                // Note on with zero velocity should be treated as a note off
-                if (messageByte3 == 0)
-                    eventOut << soul::note_events::NoteOff (channel, float (messageByte2), 0);
-                else
-                    eventOut << soul::note_events::NoteOn (channel, float (messageByte2), normaliseValue (messageByte3));
+                s.apfs.at (i).c[0] = design.coeffs.at (i * 2);
+                s.apfs.at (i).c[1] = design.coeffs.at (i * 2 + 1);
             }
-            else if (messageType == 0xb0)
+        }
+
+        /** */
+        SampleType[2] process (State& s, SampleType x)
+        {
+            var y = SampleType[2] (x, s.x[0]);
+
+            for (wrap<numFilters> i)
             {
-                if (messageByte2 == MPESlideControllerID)
-                    eventOut << soul::note_events::Slide (channel, normaliseValue (messageByte3));
-                else
-                    eventOut << soul::note_events::Control (channel, messageByte2, normaliseValue (messageByte3));
+                y = s.apfs[i].process (y);
             }
-            else if (messageType == 0xd0)
+
+            s.x[0] = x;
+            return y;
+        }
+
+        /** */
+        processor Processor
+        {
+            input stream SampleType in;
+            output stream SampleType realOut;
+            output stream SampleType imagOut;
+
+            State s;
+
+            void init()
             {
-                eventOut << soul::note_events::Pressure (channel, normaliseValue (messageByte2));
+                s.update (processor.frequency);
             }
-            else if (messageType == 0xe0)
+
+            void run()
             {
-                eventOut << soul::note_events::PitchBend (channel, translateBendSemitones (messageByte3, messageByte2));
+                loop
+                {
+                    let y = s.process (in);
+                    realOut << y[0];
+                    imagOut << y[1];
+                    advance();
+                }
             }
         }
+    }
 
-        float normaliseValue (int i)
+    //==============================================================================
+    /** Complex Resonator filter.
+
+        See https://ccrma.stanford.edu/~jos/smac03maxjos/smac03maxjos.pdf
+        This filter is suitable for modulation
+    */
+    namespace complex_resonator
+    {
+        /** Holds the filter state. */
+        struct State
         {
-            return i * (1.0f / 127.0f);
+            SampleType yReal;
+            SampleType yImag;
         }
 
-        float translateBendSemitones (int msb, int lsb)
+        /** Holds a set of filter coefficients. */
+        struct Coeffs
         {
-            let value = msb * 128 + lsb;
-            let bendRange = 48.0f;
-            return float (value - 8192) / (8192.0f / bendRange);
+            complex64 v;
         }
-    }
+
+)soul_code"
+R"soul_code(
+
+        complex64 cexp (complex64 c)
+        {
+            // TODO: if cexp becomes a global function, use that
+            let e = exp (c.real);
+            return complex64 (e * cos (c.imag), e * sin (c.imag));
+        }
+
+        /** Updates a set of coefficients for the given settings. */
+        void update (Coeffs& c, float64 sampleRate, float64 freqHz, float64 t60)
+        {
+            let jImag = (0.0 + 1.0i);
+            let decayFactor = tau2pole (t60, sampleRate);
+            let oscCoef = cexp ((jImag * twoPi) * (freqHz / sampleRate));
+            c.v = decayFactor * oscCoef;
+        }
+
+        /** */
+        SampleType[2] process (State& s, Coeffs& c, SampleType x)
+        {
+            let xReal = x;
+            let xImag = SampleType();
+            let vReal = SampleType (c.v.real);
+            let vImag = SampleType (c.v.imag);
+            let yReal = xReal + ((vReal * s.yReal) - (vImag * s.yImag));
+            let yImag = xImag + ((vReal * s.yImag) + (vImag * s.yReal));
+            s.yReal = yReal;
+            s.yImag = yImag;
+            return SampleType[2] (yReal, yImag);
+        }
+
+        /** */
+        processor Processor (float initialFrequency = defaultFreqHz,
+                             float initialDecay = 1.0f,
+                             float initialGain = 1.0f)
+        {
+            input stream SampleType in;
+            output stream SampleType realOut;
+            output stream SampleType imagOut;
+
+            input event
+            {
+                float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                float decayIn     [[ name: "Decay",     min: 0.01,        max: 10.0,      init: 1.0, unit: "Seconds"]];
+                float gainIn      [[ name: "Gain",      min: 0.01,        max: 10.0,      init: 1.0]];
+            }
+
+            event frequencyIn (float v) { frequency = v; recalc = true; }
+            event decayIn     (float v) { decay = v; recalc = true; }
+)soul_code"
+R"soul_code(
+
+            event gainIn      (float v) { gain = v; recalc = true; }
+
+            float frequency = initialFrequency,
+                      decay = initialDecay,
+                       gain = initialGain;
+            bool recalc = true;
+
+            namespace DCBlocker = soul::filters::dc_blocker;
+
+            void run()
+            {
+                State s;
+                Coeffs c;
+
+                DCBlocker::Coeffs dcc;
+                DCBlocker::State realDCBlocker, imagDCBlocker;
+
+                dcc.update (processor.frequency, 30.0f);
+
+                loop
+                {
+                    if (recalc)
+                    {
+                        recalc = false;
+                        let clippedFrequency = clamp (float64 (frequency), float64 (minFreqHz), processor.frequency * normalisedFreqLimit);
+                        c.update (processor.frequency, clippedFrequency, decay);
+                    }
+
+                    loop (updateInterval)
+                    {
+                        let y = s.process (c, in);
+                        realOut << realDCBlocker.process (y[0] * gain, dcc);
+                        imagOut << imagDCBlocker.process (y[1] * gain, dcc);
+                        advance();
+                    }
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    /**
+        This namespace contains a set of "Topology preserving transform" filters.
+    */
+    namespace tpt
+    {
+        //==============================================================================
+        /** "Topology preserving transform" one-pole filter.
+
+            Derived from work by Zavalishin and Pirkle.
+            This filter is suitable for modulation.
+        */
+        namespace onepole
+        {
+            /** Constants for use in specifying the filter mode. */
+            namespace Mode
+            {
+                let lowpass  = 0;
+                let highpass = 1;
+                let allpass  = 2;
+            }
+)soul_code"
+R"soul_code(
+
+
+            /** Holds a set of filter coefficients. */
+            struct Coeffs
+            {
+                CoeffType b;
+            }
+
+            /** Holds the filter state. */
+            struct State
+            {
+                SampleType z1;
+            }
+
+            /** Clears a set of coefficients. */
+            void clear (Coeffs& c)
+            {
+                c.b = CoeffType (1);
+            }
+
+            /** Resets a filter state. */
+            void reset (State& s)
+            {
+                s.z1 = SampleType();
+            }
+
+            /** Updates a set of coefficients for the given settings. */
+            void update (Coeffs& c, float64 sampleRate, float64 freqHz)
+            {
+                let wd = twoPi * freqHz;
+                let T  = 1.0 / sampleRate;
+                let wa = (2.0 / T) * tan (wd * T / 2.0);
+                let g  = wa * T / 2.0;
+
+                c.b = CoeffType (g / (1.0 + g));
+            }
+
+            /** */
+            SampleType processLPF (State& s, SampleType x, Coeffs& c)
+            {
+                let vn = (x - s.z1) * SampleType (c.b);
+                let lpf = vn + s.z1;
+                s.z1 = vn + lpf;
+                return lpf;
+            }
+
+            /** */
+            SampleType processHPF (State& s, SampleType x, Coeffs& c)
+            {
+                return x - processLPF (s, x, c);
+            }
+
+            /** */
+            SampleType processAPF (State& s, SampleType x, Coeffs& c)
+            {
+                let lpf = processLPF (s, x, c);
+                let hpf = x - lpf;
+                return lpf - hpf;
+            }
+
+            /** */
+            processor Processor (int initialMode = 0,
+                                 float initialFrequency = defaultFreqHz)
+            {
+                input stream SampleType in;
+                output stream SampleType out;
+
+                input event
+                {
+)soul_code"
+R"soul_code(
+
+                    float frequencyIn [[ name: "Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                    float modeIn      [[ name: "Mode",      min: 0,         max: 2,         init: 0,         text: "Lowpass|Highpass|Allpass"]];
+                }
+
+                event frequencyIn (float v) { frequency = v; recalc = true; }
+                event modeIn      (float v) { mode = int (v); recalc = true; }
+
+                float frequency = initialFrequency;
+                int mode = initialMode;
+                bool recalc = true;
+
+                void run()
+                {
+                    State s;
+                    Coeffs c;
+                    c.clear ();
+
+                    loop
+                    {
+                        if (recalc)
+                        {
+                            recalc = false;
+                            let clippedFrequency = clamp (float64 (frequency),
+                                                          float64 (minFreqHz),
+                                                          processor.frequency * normalisedFreqLimit);
+                            c.update (processor.frequency, clippedFrequency);
+                        }
+
+                        loop (16)
+                        {
+                            if (mode == Mode::lowpass)        out << s.processLPF (in, c);
+                            else if (mode == Mode::highpass)  out << s.processHPF (in, c);
+                            else if (mode == Mode::allpass)   out << s.processAPF (in, c);
+
+                            advance();
+                        }
+                    }
+                }
+            }
+        }
+
+        //==============================================================================
+        /** "Topology preserving transform" multi-mode state variable filter (SVF).
+
+            Derived from work by Zavalishin and Pirkle.
+            This filter is suitable for modulation.
+        */
+        namespace svf
+        {
+)soul_code"
+R"soul_code(
+
+            /** Constants for use in specifying the filter mode. */
+            namespace Mode
+            {
+                let lowpass  = 0;
+                let highpass = 1;
+                let bandpass = 2;
+            }
+
+            /** Holds a set of filter coefficients. */
+            struct Coeffs
+            {
+                CoeffType a0;
+                CoeffType a;
+                CoeffType p;
+            }
+
+            /** Holds the filter state. */
+            struct State
+            {
+                SampleType[2] z;
+            }
+
+            /** Resets a filter state. */
+            void reset (State& s)
+            {
+                s.z[0] = SampleType();
+                s.z[1] = SampleType();
+            }
+
+            /** Updates a set of coefficients for the given settings. */
+            void update (Coeffs& c, float64 sampleRate, float64 freqHz, float64 quality)
+            {
+                let Q = max (quality, 0.001);
+                let wd = twoPi * freqHz;
+                let T  = 1.0 / sampleRate;
+                let wa = (2.0 / T) * tan (wd * T / 2.0);
+                let g  = wa * T / 2.0;
+                let R = 1.0 / (2.0 * Q);
+                c.a0 = 1.0 / (1.0 + 2.0 * R * g + g * g);
+                c.a = g;
+                c.p = 2.0 * R + g;
+            }
+
+            /** */
+            SampleType[3] process (State& s, SampleType x, Coeffs& c)
+            {
+                let hpf = SampleType (c.a0 * (x - c.p * s.z[0] - s.z[1]));
+                let bpf = SampleType (c.a * hpf + s.z[0]);
+                let lpf = SampleType (c.a * bpf + s.z[1]);
+
+                s.z[0] = SampleType (c.a * hpf + bpf);
+                s.z[1] = SampleType (c.a * bpf + lpf);
+
+                return SampleType[3] (lpf, hpf, bpf);
+            }
+
+            /** */
+            processor Processor (float initialFrequency = defaultFreqHz,
+                                 float initialQuality = defaultQuality)
+            {
+                input stream SampleType in;
+)soul_code"
+R"soul_code(
+
+                output stream SampleType lowpassOut, bandpassOut, highpassOut;
+
+                input event
+                {
+                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                    float qualityIn   [[ name: "Q",         min: 0.01,        max: 100.0,     init: defaultQuality]];
+                }
+
+                event frequencyIn (float v) { frequency = v; recalc = true; }
+                event qualityIn   (float v) { quality = v; recalc = true; }
+
+                float frequency = initialFrequency,
+                        quality = initialQuality;
+                bool recalc = true;
+
+                void run()
+                {
+                    State s;
+                    Coeffs c;
+
+                    loop
+                    {
+                        if (recalc)
+                        {
+                            recalc = false;
+                            let clippedFrequency = clamp (float64 (frequency),
+                                                          float64 (minFreqHz),
+                                                          processor.frequency * normalisedFreqLimit);
+                            c.update (processor.frequency, clippedFrequency, quality);
+                        }
+
+                        loop (updateInterval)
+                        {
+                            let y = s.process (in, c);
+                            lowpassOut  << y[0];
+                            highpassOut << y[1];
+                            bandpassOut << y[2];
+                            advance();
+                        }
+                    }
+                }
+            }
+        }
+
+        //==============================================================================
+        /**
+            N-th order Butterworth filter, made by cascading TPT filters.
+            This filter is suitable for modulation
+        */
+        namespace butterworth
+        {
+)soul_code"
+R"soul_code(
+
+            namespace onepole = soul::filters::tpt::onepole;
+            namespace svf = soul::filters::tpt::svf;
+
+            /** Constants for use in specifying the filter mode. */
+            namespace Mode
+            {
+                let lowpass  = 0;
+                let highpass = 1;
+            }
+
+            /** Updates a set of coefficients for the given settings. */
+            void update<SVFCoeffsArrayType> (SVFCoeffsArrayType& svfCoeffs,
+                                             onepole::Coeffs& onepoleCoeffs,
+                                             float64 sampleRate, int order, float64 freqHz)
+            {
+                static_assert (SVFCoeffsArrayType.isArray, "coeffs argument is not an array");
+
+                bool oddOrder = (order % 2) == 1;
+
+                if (oddOrder)
+                {
+                    onepole::update (onepoleCoeffs, sampleRate, freqHz);
+
+                    for (wrap<svfCoeffs.size> i)
+                    {
+                        let Q = 1.0 / (2.0 * cos ((CoeffType (i) + 1.0) * pi / order));
+                        svf::update (svfCoeffs.at (i), sampleRate, freqHz, Q);
+                    }
+                }
+                else
+                {
+                    for (wrap<svfCoeffs.size> i)
+                    {
+                        let Q = 1.0 / (2.0 * cos ((2.0 * CoeffType (i) + 1.0) * pi / (order * 2.0)));
+                        svf::update (svfCoeffs.at (i), sampleRate, freqHz, Q);
+                    }
+                }
+            }
+
+            /** */
+            SampleType process<StateArrayType, CoeffsArrayType> (SampleType x,
+                                                                 StateArrayType& svfStates,
+                                                                 CoeffsArrayType& svfCoeffs,
+                                                                 onepole::State& onepoleState,
+                                                                 onepole::Coeffs& onepoleCoeffs,
+)soul_code"
+R"soul_code(
+
+                                                                 int mode, bool oddOrder)
+            {
+                static_assert (StateArrayType.isArray, "states argument is not an array");
+                static_assert (CoeffsArrayType.isArray, "coeffs argument is not an array");
+                static_assert (svfStates.size == svfCoeffs.size, "states and coeffs arrays are not the same size");
+
+                var y = x;
+
+                if (oddOrder)
+                {
+                    if (mode == Mode::lowpass)
+                        y = onepoleState.processLPF (y, onepoleCoeffs);
+                    else if (mode == Mode::highpass)
+                        y = onepoleState.processHPF (y, onepoleCoeffs);
+                }
+
+                for (wrap<svfStates.size> i)
+                    y = svf::process (svfStates[i], y, svfCoeffs[i])[wrap<2> (mode)]; // TODO: tidy this
+
+                return y;
+            }
+
+            /* Butterworth processor.
+               The order must be > 1
+            */
+            processor Processor (int order,
+                                 int initialMode = 0,
+                                 float initialFrequency = defaultFreqHz)
+            {
+                input stream SampleType in;
+                output stream SampleType out;
+
+                input event
+                {
+                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                    float modeIn      [[ name: "Mode",      min: 0,           max: 1,         init: 0,         text: "Lowpass|Highpass"]];
+                }
+
+                event frequencyIn (float v)   { frequency = v; recalc = true; }
+                event modeIn      (float v)   { mode = int (v); recalc = true; }
+
+                float  frequency  = initialFrequency;
+                int    mode       = initialMode;
+                bool   recalc     = true;
+
+                void run()
+                {
+                    let numSVFs = order / 2;
+)soul_code"
+R"soul_code(
+
+                    let oddOrder = (order % 2) == 1;
+
+                    svf::State[numSVFs] svfStates;
+                    svf::Coeffs[numSVFs] svfCoeffs;
+                    onepole::State onepoleState;
+                    onepole::Coeffs onepoleCoeffs;
+
+                    loop
+                    {
+                        if (recalc)
+                        {
+                            recalc = false;
+                            let clippedFrequency = clamp (float64 (frequency),
+                                                          float64 (minFreqHz),
+                                                          processor.frequency * normalisedFreqLimit);
+                            update (svfCoeffs, onepoleCoeffs, processor.frequency, order, clippedFrequency);
+                        }
+
+                        loop (updateInterval)
+                        {
+                            out << process (in, svfStates, svfCoeffs, onepoleState, onepoleCoeffs, mode, oddOrder);
+                            advance();
+                        }
+                    }
+                }
+            }
+        }
+
+        //==============================================================================
+        /**
+            4th-order Linkwitz-Riley crossover filter, which outputs two bands of audio.
+
+            The channels should sum together to produce a flat response.
+            This filter is suitable for modulation.
+        */
+        namespace crossover
+        {
+            namespace SVF = soul::filters::tpt::svf;
+
+            /** Holds the filter state. */
+            struct State
+            {
+                SVF::State svf1, svf2;
+            }
+
+            /** Holds a set of filter coefficients. */
+            struct Coeffs
+            {
+                SVF::Coeffs svf1, svf2;
+            }
+
+            /** */
+            processor Processor (float initialFrequency = defaultFreqHz)
+            {
+                input stream float32 in;
+                output stream float32 lowOut;
+)soul_code"
+R"soul_code(
+
+                output stream float32 highOut;
+
+                input event float frequencyIn [[ name: "Split Frequency", min: minFreqHz, max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+
+                event frequencyIn (float v) { frequency = v; recalc = true; }
+
+                float frequency = initialFrequency;
+                bool recalc = true;
+
+                /** Updates a set of coefficients for the given settings. */
+                void update (Coeffs& c, float64 sampleRate, float64 freqHz)
+                {
+                    c.svf1.update (sampleRate, freqHz, defaultQuality);
+                    c.svf2.update (sampleRate, freqHz, defaultQuality);
+                }
+
+                SampleType[2] process (State& s, SampleType x, Coeffs& c)
+                {
+                    let svf1 = s.svf1.process (x, c.svf1);
+                    let lpf1 = svf1[0], hpf1 = svf1[1], bpf1 = svf1[2];
+                    let apf1 = lpf1 - SampleType (sqrt (2.0)) * bpf1 + hpf1;
+                    let svf2 = s.svf2.process (lpf1, c.svf2);
+                    let lpf2 = svf2[0];
+
+                    return SampleType[2] (lpf2, apf1 - lpf2);
+                }
+
+                void run()
+                {
+                    State s;
+                    Coeffs c;
+
+                    loop
+                    {
+                        if (recalc)
+                        {
+                            recalc = false;
+                            let clippedFrequency = clamp (float64 (frequency),
+                                                          float64 (minFreqHz),
+                                                          processor.frequency * normalisedFreqLimit);
+                            update (c, processor.frequency, clippedFrequency);
+                        }
+
+                        loop (16)
+                        {
+                            let y = s.process (in, c);
+                            lowOut  << y[0];
+                            highOut << y[1];
+)soul_code"
+R"soul_code(
+
+                            advance();
+                        }
+                    }
+                }
+            }
+        }
+
+        //==============================================================================
+        /** SVF EQ.
+
+            Based on the work of Andy Simper:
+            https://cytomic.com/files/dsp/SvfLinearTrapOptimised2.pdf
+
+            This filter is suitable for modulation.
+        */
+        namespace simper_eq
+        {
+            /** Constants for use in specifying the filter mode. */
+            namespace Mode
+            {
+                let lowpass   = 0;
+                let highpass  = 1;
+                let bandpass  = 2;
+                let lowShelf  = 3;
+                let highShelf = 4;
+                let peaking   = 5;
+                let notch     = 6;
+                let allpass   = 7;
+                let bell      = 8;
+            }
+
+            /** Holds a set of filter coefficients. */
+            struct Coeffs
+            {
+                CoeffType a1, a2, a3;
+                CoeffType m0, m1, m2;
+            }
+
+            /** Holds the filter state. */
+            struct State
+            {
+                SampleType ic1eq, ic2eq;
+            }
+
+            /** Resets a filter state. */
+            void reset (State& s)
+            {
+                s.ic1eq = SampleType();
+                s.ic2eq = SampleType();
+            }
+
+            /** Updates a set of coefficients for the given settings. */
+            void update (Coeffs& c, float64 sampleRate, int mode, float64 freqHz, float64 quality, float64 gain)
+            {
+                let w = tan (pi * freqHz / sampleRate);
+                let k = 1.0 / clamp (quality, 0.01, 100.0);
+
+                if (mode == Mode::lowpass)
+                {
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 0.0;
+                    c.m1 = 0.0;
+                    c.m2 = 1.0;
+)soul_code"
+R"soul_code(
+
+                }
+                else if (mode == Mode::highpass)
+                {
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = -k;
+                    c.m2 = -1.0;
+                }
+                else if (mode == Mode::bandpass)
+                {
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 0.0;
+                    c.m1 = 1.0;
+                    c.m2 = 0.0;
+                }
+                else if (mode == Mode::lowShelf)
+                {
+                    let A = pow (10.0, gain / 40.0);
+                    let g = w / sqrt (A);
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = k * (A - 1.0);
+                    c.m2 = (A * A - 1.0);
+                }
+                else if (mode == Mode::highShelf)
+                {
+                    let A = pow (10.0, gain / 40.0);
+                    let g = w / sqrt (A);
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = A * A;
+                    c.m1 = k * (1.0 - A) * A;
+                    c.m2 = (1.0 - A * A);
+                }
+                else if (mode == Mode::peaking)
+                {
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = -k;
+                    c.m2 = -2.0;
+                }
+                else if (mode == Mode::notch)
+                {
+                    let g = w;
+)soul_code"
+R"soul_code(
+
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = -k;
+                    c.m2 = 0.0;
+                }
+                else if (mode == Mode::allpass)
+                {
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = -2.0 * k;
+                    c.m2 = 0.0;
+                }
+                else if (mode == Mode::bell)
+                {
+                    let A = pow (10.0, gain / 40.0);
+                    let g = w;
+                    c.a1 = 1.0 / (1.0 + g * (g + k));
+                    c.a2 = g * c.a1;
+                    c.a3 = g * c.a2;
+                    c.m0 = 1.0;
+                    c.m1 = k * (A * A - 1.0);
+                    c.m2 = 0.0;
+                }
+            }
+
+            /** */
+            SampleType process (State& s, SampleType x, Coeffs& c)
+            {
+                let v0 = x;
+                let v3 = v0 - s.ic2eq;
+                let v1 = SampleType (c.a1 * s.ic1eq + c.a2 * v3);
+                let v2 = SampleType (s.ic2eq + c.a2 * s.ic1eq + c.a3 * v3);
+                s.ic1eq = SampleType (2.0 * v1 - s.ic1eq);
+                s.ic2eq = SampleType (2.0 * v2 - s.ic2eq);
+                return    SampleType (c.m0 * v0 + c.m1 * v1 + c.m2 * v2);
+            }
+
+            /** */
+            processor Processor (int initialMode = 0,
+                                 float initialFrequency = defaultFreqHz,
+                                 float initialQuality = defaultQuality,
+                                 float initialGain = defaultGain)
+            {
+                input stream SampleType in;
+                output stream SampleType out;
+
+                input event
+                {
+)soul_code"
+R"soul_code(
+
+                    float frequencyIn [[ name: "Frequency", min: minFreqHz,   max: maxFreqHz, init: defaultFreqHz, unit: "Hz"]];
+                    float qualityIn   [[ name: "Q",         min: 0.001,       max: 100.0,     init: defaultQuality ]];
+                    float gainIn      [[ name: "Gain",      min: -36.0,       max: 36.0,      init: 0.0,           unit: "dB"]];
+                    float modeIn      [[ name: "Mode",      min: 0,           max: 8,         init: 0,             text: "Lowpass|Highpass|Bandpass|LowShelf|HighShelf|Peaking|Notch|Allpass|Bell"]];
+                }
+
+                event frequencyIn (float v) { frequency = v; recalc = true; }
+                event qualityIn   (float v) { quality = v; recalc = true; }
+                event gainIn      (float v) { gain = v; recalc = true; }
+                event modeIn      (float v) { mode = int (v); recalc = true; }
+
+                float frequency = initialFrequency,
+                        quality = initialQuality,
+                           gain = initialGain;
+                int mode = initialMode;
+                bool recalc = true;
+
+                void run()
+                {
+                    State s;
+                    Coeffs c;
+
+                    loop
+                    {
+                        if (recalc)
+                        {
+                            recalc = false;
+                            let clippedFrequency = clamp (float64 (frequency),
+                                                          float64 (minFreqHz),
+                                                          processor.frequency * normalisedFreqLimit);
+                            c.update (processor.frequency, mode, clippedFrequency, quality, gain);
+                        }
+
+                        loop (updateInterval)
+                        {
+                            out << s.process (in, c);
+                            advance();
+                        }
+                    }
+                }
+            }
+        }
+
+)soul_code"
+R"soul_code(
+
+    } // (namespace tpt)
 }
 )soul_code";
 
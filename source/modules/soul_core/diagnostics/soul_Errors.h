@@ -129,6 +129,7 @@ namespace soul
     X(noSampleRateForEndpoint,              "No endpoint specifies a valid sample rate") \
     X(onlyOneTypeInTopLevelInputs,          "Top level input endpoints can only declare one type") \
     X(wrongTypeForEndpoint,                 "This type is not supported by the endpoint") \
+    X(ambiguousTypeForEndpoint,             "The type $Q0$ matches more than one of the endpoint's types") \
     X(cannotWriteTypeToEndpoint,            "Cannot write type $0$ to endpoint which takes $1$") \
     X(incompatibleEndpointType,             "Incompatible endpoint type") \
     X(endpointIndexOutOfRange,              "Endpoint index out of range") \
@@ -322,6 +323,7 @@ namespace soul
 #define SOUL_ERRORS_RUNTIME(X) \
     X(customRuntimeError,                   "$0$") \
     X(failedToLoadProgram,                  "Failed to load program") \
+    X(invalidBinaryProgram,                 "The binary program data is invalid or was written by an incompatible version") \
     X(cannotOverwriteFile,                  "Cannot overwrite existing file $Q0$") \
     X(cannotCreateOutputFile,               "Cannot create output file $Q0$") \
     X(cannotCreateFolder,                   "Cannot create folder $Q0$") \
@@ -37,6 +37,9 @@ ScopedTimer::ScopedTimer (std::string desc) noexcept  : description (std::move (
 
 ScopedTimer::~ScopedTimer()
 {
+    if (auto collector = ScopedTimingCollector::getCurrent())
+        collector->timings.push_back ({ description, getElapsedSeconds() });
+
     SOUL_LOG (description, [&] { return getElapsedTimeDescription(); });
 }
 
@@ -50,6 +53,24 @@ std::string ScopedTimer::getElapsedTimeDescription() const
     return getDescriptionOfTimeInSeconds (getElapsedSeconds());
 }
 
+//==============================================================================
+static thread_local ScopedTimingCollector* currentTimingCollector = nullptr;
+
+ScopedTimingCollector::ScopedTimingCollector()  : previous (currentTimingCollector)
+{
+    currentTimingCollector = this;
+}
+
+ScopedTimingCollector::~ScopedTimingCollector()
+{
+    currentTimingCollector = previous;
+}
+
+ScopedTimingCollector* ScopedTimingCollector::getCurrent()
+{
+    return currentTimingCollector;
+}
+
 //==============================================================================
 CPULoadMeasurer::CPULoadMeasurer() { reset(); }
 
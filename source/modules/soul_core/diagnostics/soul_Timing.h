@@ -38,8 +38,36 @@ private:
     clock::time_point start = clock::now();
 };
 
+#define SOUL_CONCAT_INNER(a, b)  a ## b
+#define SOUL_CONCAT(a, b)        SOUL_CONCAT_INNER(a, b)
+
 #define SOUL_LOG_TIME_OF_SCOPE(description) \
-    const ScopedTimer timer_ ## __LINE__ (description);
+    const ScopedTimer SOUL_CONCAT (timer_, __LINE__) (description);
+
+//==============================================================================
+/** While one of these exists, any ScopedTimer that finishes on the same thread will
+    also add its description and time to this object's list, so that a caller can
+    get at the numbers as well as the log messages.
+*/
+struct ScopedTimingCollector  final
+{
+    ScopedTimingCollector();
+    ~ScopedTimingCollector();
+
+    struct Timing
+    {
+        std::string description;
+        double seconds;
+    };
+
+    std::vector<Timing> timings;
+
+    /** Returns the collector that's currently active on this thread, or nullptr. */
+    static ScopedTimingCollector* getCurrent();
+
+private:
+    ScopedTimingCollector* const previous;
+};
 
 // Helper method to read the bela audio load
 float getBelaLoadFromString (const std::string& input);
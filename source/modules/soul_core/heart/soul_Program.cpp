@@ -285,10 +285,23 @@ Program Program::createFromHEART (CompileMessageList& messageList, CodeLocation
     return {};
 }
 
+Program Program::createFromBinary (CompileMessageList& messageList, const void* data, size_t size)
+{
+    try
+    {
+        CompileMessageHandler handler (messageList);
+        return heart::BinaryFormat::read (data, size);
+    }
+    catch (AbortCompilationException) {}
+
+    return {};
+}
+
 Program Program::clone() const                                                          { return pimpl->clone(); }
 bool Program::isEmpty() const                                                           { return getModules().empty(); }
 Program::operator bool() const                                                          { return ! isEmpty(); }
 std::string Program::toHEART() const                                                    { return heart::Printer::getDump (*this); }
+std::vector<uint8_t> Program::toBinary() const                                          { return heart::BinaryFormat::write (*this); }
 const std::vector<pool_ref<Module>>& Program::getModules() const                        { return pimpl->modules; }
 void Program::removeModule (Module& module)                                             { return pimpl->removeModule (module); }
 
@@ -315,11 +328,7 @@ std::string Program::stripRootNamespaceFromQualifiedPath (std::string path)
 
 std::string Program::getHash() const
 {
-    choc::text::CodePrinter dump;
-    heart::Printer::print (*this, dump);
-    HashBuilder hash;
-    hash << dump.toString();
-    return hash.toString();
+    return heart::BinaryFormat::getHash (*this);
 }
 
 Module& Program::getMainProcessor() const
@@ -55,6 +55,19 @@ public:
     */
     static Program createFromHEART (CompileMessageList&, CodeLocation heartCode);
 
+    /** Creates a compact binary representation of this program, which can be reloaded
+        much more quickly than HEART code.
+        @see createFromBinary()
+    */
+    std::vector<uint8_t> toBinary() const;
+
+    /** Recreates a program from data that was emitted by toBinary().
+        The data is read in-place and only needs to stay valid for the duration of this
+        call, so it can point directly into a memory-mapped file.
+        @see toBinary()
+    */
+    static Program createFromBinary (CompileMessageList&, const void* data, size_t size);
+
     //==============================================================================
     /** Return true if the program contains no modules. */
     bool isEmpty() const;
@@ -73,6 +73,7 @@ struct heart
 
     struct Parser;
     struct Printer;
+    struct BinaryFormat;
     struct Checker;
     struct Utilities;
 
@@ -0,0 +1,1585 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/**
+    A compact binary encoding of a Program, which can be reloaded without any of the
+    tokenising and name-lookup that the HEART parser has to do.
+
+    After a header containing a magic number and version, the data holds the string
+    dictionary, then the declarations of all the modules, structs and functions (so that
+    everything after them can refer to these by index), then the module contents and
+    function bodies, and finally the constant table. Integers are written as packed
+    variable-length values, and a variable is written in full the first time it's
+    encountered, with later references to it just using its index.
+
+    The raw data of each constant table item is 8-byte aligned relative to the start of the
+    block, and the reader never copies the block as a whole, so a cached program can be
+    loaded straight from a memory-mapped file. Numbers are stored in the native byte order,
+    so the data is only intended to be reloaded on the same kind of machine.
+*/
+struct heart::BinaryFormat
+{
+    static constexpr uint32_t formatVersion = 2;
+
+    static std::vector<uint8_t> write (const Program& program)
+    {
+        ByteArrayOutput out;
+        Writer<ByteArrayOutput> (program, out).write();
+        return std::move (out.bytes);
+    }
+
+    /** Returns a hash of everything that write() would produce for this program.
+        The program is walked directly and fed into the hash as it goes, so none of the
+        encoded data (or the much larger HEART text) ever needs to be allocated.
+    */
+    static std::string getHash (const Program& program)
+    {
+        HashOutput out;
+        Writer<HashOutput> (program, out).write();
+        return out.hash.toString();
+    }
+
+    /** Recreates a program from data created by write(). This throws a compile error if
+        the data is invalid or was written by a different version of the format.
+    */
+    static Program read (const void* data, size_t size)
+    {
+        return Reader (data, size).read();
+    }
+
+private:
+    static constexpr uint8_t magicNumber[] = { 'S', 'O', 'U', 'L', 'H', 'B', 'I', 'N' };
+    static constexpr size_t constantDataAlignment = 8;
+
+    enum class TypeTag  : uint8_t
+    {
+        invalid,
+        primitive,
+        vector,
+        fixedSizeArray,
+        unsizedArray,
+        wrappedInt,
+        clampedInt,
+        structure,
+        stringLiteral
+    };
+
+    enum class ExpressionTag  : uint8_t
+    {
+        none,
+        constant,
+        variable,
+        newVariable,
+        arrayElement,
+        structElement,
+        typeCast,
+        aggregateInitialiserList,
+        unaryOperator,
+        binaryOperator,
+        pureFunctionCall,
+        processorProperty
+    };
+
+    enum class StatementTag  : uint8_t
+    {
+        assignFromValue,
+        functionCall,
+        readStream,
+        writeStream,
+        advanceClock
+    };
+
+    enum class TerminatorTag  : uint8_t
+    {
+        branch,
+        branchIf,
+        returnVoid,
+        returnValue
+    };
+
+    enum class ModuleTag  : uint8_t
+    {
+        processor,
+        graph,
+        namespace_
+    };
+
+    static constexpr uint64_t noIndex = 0;
+
+    //==============================================================================
+    struct ByteArrayOutput
+    {
+        void write (const void* data, size_t size)
+        {
+            auto d = static_cast<const uint8_t*> (data);
+            bytes.insert (bytes.end(), d, d + size);
+        }
+
+        size_t size() const     { return bytes.size(); }
+
+        std::vector<uint8_t> bytes;
+    };
+
+    struct HashOutput
+    {
+        void write (const void* data, size_t size)
+        {
+            hash << ArrayView<char> (static_cast<const char*> (data), size);
+            totalSize += size;
+        }
+
+        size_t size() const     { return totalSize; }
+
+        HashBuilder hash;
+        size_t totalSize = 0;
+    };
+
+    //==============================================================================
+    template <typename Output>
+    struct Writer
+    {
+        Writer (const Program& p, Output& o) : program (p), out (o) {}
+
+        void write()
+        {
+            writeRaw (magicNumber, sizeof (magicNumber));
+            writeUnsigned (formatVersion);
+
+            writeStringDictionary (program.getStringDictionary());
+            writeDeclarations();
+
+            for (auto s : structs)
+                writeStructMembers (*s);
+
+            for (auto& m : program.getModules())
+                writeModuleContent (m);
+
+            for (auto& m : program.getModules())
+                writeFunctions (m);
+
+            writeConstantTable();
+        }
+
+    private:
+        const Program& program;
+        Output& out;
+        pool_ptr<const Module> module;
+        pool_ptr<const heart::Function> function;
+
+        std::vector<const Structure*> structs;
+        std::unordered_map<const Structure*, uint64_t> structIndexes;
+        std::unordered_map<const heart::Function*, uint64_t> functionIndexes;
+        std::unordered_map<const heart::Variable*, uint64_t> variableIndexes;
+        std::unordered_map<const heart::Block*, uint64_t> blockIndexes;
+
+        //==============================================================================
+        void writeRaw (const void* data, size_t size)   { out.write (data, size); }
+        void writeByte (uint8_t b)                      { out.write (std::addressof (b), 1); }
+        void writeBool (bool b)               { writeByte (b ? 1 : 0); }
+        void writeDouble (double d)           { writeRaw (std::addressof (d), sizeof (d)); }
+
+        template <typename TagType>
+        void writeTag (TagType t)             { writeByte (static_cast<uint8_t> (t)); }
+
+        void writeUnsigned (uint64_t n)
+        {
+            while (n >= 0x80)
+            {
+                writeByte (static_cast<uint8_t> (n | 0x80));
+                n >>= 7;
+            }
+
+            writeByte (static_cast<uint8_t> (n));
+        }
+
+        void writeSigned (int64_t n)
+        {
+            writeUnsigned ((static_cast<uint64_t> (n) << 1) ^ static_cast<uint64_t> (n >> 63));
+        }
+
+        void writeString (std::string_view s)
+        {
+            writeUnsigned (s.length());
+            writeRaw (s.data(), s.length());
+        }
+
+        void writeIdentifier (Identifier i)
+        {
+            writeString (i.isValid() ? std::string_view (i) : std::string_view());
+        }
+
+        template <typename IntType>
+        void writeOptional (const std::optional<IntType>& n)
+        {
+            writeBool (n.has_value());
+
+            if (n.has_value())
+                writeSigned (static_cast<int64_t> (*n));
+        }
+
+        template <typename IndexMap, typename KeyType>
+        void writeIndex (const IndexMap& indexes, KeyType key)
+        {
+            auto i = indexes.find (key);
+            SOUL_ASSERT (i != indexes.end());
+            writeUnsigned (i->second);
+        }
+
+        template <typename Array, typename Item>
+        void writeIndexInArray (const Array& array, const Item& item)
+        {
+            for (size_t i = 0; i < array.size(); ++i)
+            {
+                if (array[i] == item)
+                {
+                    writeUnsigned (i + 1);
+                    return;
+                }
+            }
+
+            writeUnsigned (noIndex);
+        }
+
+        //==============================================================================
+        void writeType (const Type& t)
+        {
+            writeBool (t.isConst());
+            writeBool (t.isReference());
+
+            if (t.isStringLiteral())         { writeTag (TypeTag::stringLiteral); return; }
+            if (t.isStruct())                { writeTag (TypeTag::structure); writeIndex (structIndexes, t.getStruct().get()); return; }
+            if (t.isWrapped())               { writeTag (TypeTag::wrappedInt); writeUnsigned (static_cast<uint64_t> (t.getBoundedIntLimit())); return; }
+            if (t.isClamped())               { writeTag (TypeTag::clampedInt); writeUnsigned (static_cast<uint64_t> (t.getBoundedIntLimit())); return; }
+            if (t.isPrimitive())             { writeTag (TypeTag::primitive); writeTag (t.getPrimitiveType().type); return; }
+
+            if (t.isVector())
+            {
+                writeTag (TypeTag::vector);
+                writeTag (t.getVectorElementType().type);
+                writeUnsigned (t.getVectorSize());
+                return;
+            }
+
+            if (t.isArray())
+            {
+                writeTag (t.isUnsizedArray() ? TypeTag::unsizedArray : TypeTag::fixedSizeArray);
+                writeType (t.getArrayElementType().withConstAndRefFlags (false, false));
+
+                if (t.isFixedSizeArray())
+                    writeUnsigned (t.getArraySize());
+
+                return;
+            }
+
+            writeTag (TypeTag::invalid);
+        }
+
+        void writeValue (const Value& v)
+        {
+            writeType (v.getType());
+
+            // Large zero-initialised aggregates are common, so these are stored with a zero size
+            if (v.isZero())
+            {
+                writeUnsigned (0);
+                return;
+            }
+
+            writeUnsigned (v.getPackedDataSize());
+            writeRaw (v.getPackedData(), v.getPackedDataSize());
+        }
+
+        void writeAnnotation (const Annotation& a)
+        {
+            auto names = a.getNames();
+            writeUnsigned (names.size());
+
+            if (names.empty())
+                return;
+
+            // The string literals in an annotation's values refer to its own dictionary
+            writeStringDictionary (a.getDictionary());
+
+            for (auto& name : names)
+            {
+                writeString (name);
+                writeValue (a.getValue (name));
+            }
+        }
+
+        //==============================================================================
+        void writeStringDictionary (const StringDictionary& dictionary)
+        {
+            auto& strings = dictionary.getStrings();
+            writeUnsigned (strings.size());
+
+            for (auto& s : strings)
+            {
+                writeUnsigned (s.handle.handle);
+                writeString (s.text);
+            }
+        }
+
+        void writeDeclarations()
+        {
+            writeUnsigned (program.getModules().size());
+
+            for (auto& m : program.getModules())
+            {
+                writeTag (m->isProcessor() ? ModuleTag::processor
+                                           : (m->isGraph() ? ModuleTag::graph : ModuleTag::namespace_));
+                writeString (m->shortName);
+                writeString (m->fullName);
+                writeString (m->originalFullName);
+                writeAnnotation (m->annotation);
+                writeDouble (m->sampleRate);
+                writeUnsigned (m->latency);
+
+                writeUnsigned (m->structs.size());
+
+                for (auto& s : m->structs.get())
+                {
+                    structIndexes[s.get()] = structs.size();
+                    structs.push_back (s.get());
+                    writeString (s->getName());
+                }
+
+                writeUnsigned (m->functions.size());
+
+                for (auto& f : m->functions.get())
+                {
+                    auto index = functionIndexes.size();
+                    functionIndexes[std::addressof (f.get())] = index;
+                    writeIdentifier (f->name);
+                    writeBool (f->functionType.isEvent());
+                }
+            }
+        }
+
+        void writeStructMembers (const Structure& s)
+        {
+            writeUnsigned (s.getNumMembers());
+
+            for (auto& m : s.getMembers())
+            {
+                writeType (m.type);
+                writeString (m.name);
+            }
+        }
+
+        void writeIODeclaration (const heart::IODeclaration& io)
+        {
+            writeIdentifier (io.name);
+            writeUnsigned (io.index);
+            writeTag (io.endpointType);
+            writeUnsigned (io.dataTypes.size());
+
+            for (auto& t : io.dataTypes)
+                writeType (t);
+
+            writeOptional (io.arraySize);
+            writeAnnotation (io.annotation);
+        }
+
+        void writeEndpointReference (const heart::EndpointReference& e)
+        {
+            writeIndexInArray (module->processorInstances, e.processor);
+            writeString (e.endpointName);
+            writeOptional (e.endpointIndex);
+        }
+
+        void writeModuleContent (const Module& m)
+        {
+            module = m;
+
+            writeUnsigned (m.inputs.size());
+
+            for (auto& i : m.inputs)
+                writeIODeclaration (i);
+
+            writeUnsigned (m.outputs.size());
+
+            for (auto& o : m.outputs)
+                writeIODeclaration (o);
+
+            writeUnsigned (m.processorInstances.size());
+
+            for (auto& p : m.processorInstances)
+            {
+                writeString (p->instanceName);
+                writeString (p->sourceName);
+                writeUnsigned (p->arraySize);
+                writeBool (p->clockMultiplier.hasValue());
+                writeDouble (p->clockMultiplier.getRatio());
+            }
+
+            writeUnsigned (m.connections.size());
+
+            for (auto& c : m.connections)
+            {
+                writeEndpointReference (c->source);
+                writeEndpointReference (c->dest);
+                writeTag (c->interpolationType);
+                writeOptional (c->delayLength);
+            }
+
+            writeUnsigned (m.stateVariables.size());
+
+            for (auto& v : m.stateVariables.get())
+                writeVariable (v);
+        }
+
+        //==============================================================================
+        void writeVariable (const heart::Variable& v)
+        {
+            auto existing = variableIndexes.find (std::addressof (v));
+
+            if (existing != variableIndexes.end())
+            {
+                writeTag (ExpressionTag::variable);
+                writeUnsigned (existing->second);
+                return;
+            }
+
+            auto index = variableIndexes.size();
+            variableIndexes[std::addressof (v)] = index;
+
+            writeTag (ExpressionTag::newVariable);
+            writeType (v.type);
+            writeIdentifier (v.name);
+            writeTag (v.role);
+            writeSigned (v.externalHandle);
+            writeAnnotation (v.annotation);
+            writeExpression (v.initialValue);
+        }
+
+        void writeExpression (pool_ptr<heart::Expression> e)
+        {
+            if (e == nullptr)
+            {
+                writeTag (ExpressionTag::none);
+                return;
+            }
+
+            if (auto c = cast<heart::Constant> (e))
+            {
+                writeTag (ExpressionTag::constant);
+                writeValue (c->value);
+                return;
+            }
+
+            if (auto v = cast<heart::Variable> (e))
+                return writeVariable (*v);
+
+            if (auto a = cast<heart::ArrayElement> (e))
+            {
+                writeTag (ExpressionTag::arrayElement);
+                writeExpression (a->parent);
+                writeExpression (a->dynamicIndex);
+                writeUnsigned (a->fixedStartIndex);
+                writeUnsigned (a->fixedEndIndex);
+                writeBool (a->isRangeTrusted);
+                writeBool (a->suppressWrapWarning);
+                return;
+            }
+
+            if (auto s = cast<heart::StructElement> (e))
+            {
+                writeTag (ExpressionTag::structElement);
+                writeExpression (s->parent);
+                writeString (s->memberName);
+                return;
+            }
+
+            if (auto t = cast<heart::TypeCast> (e))
+            {
+                writeTag (ExpressionTag::typeCast);
+                writeType (t->destType);
+                writeExpression (t->source);
+                return;
+            }
+
+            if (auto l = cast<heart::AggregateInitialiserList> (e))
+            {
+                writeTag (ExpressionTag::aggregateInitialiserList);
+                writeType (l->type);
+                writeExpressionList (l->items);
+                return;
+            }
+
+            if (auto u = cast<heart::UnaryOperator> (e))
+            {
+                writeTag (ExpressionTag::unaryOperator);
+                writeTag (u->operation);
+                writeExpression (u->source);
+                return;
+            }
+
+            if (auto b = cast<heart::BinaryOperator> (e))
+            {
+                writeTag (ExpressionTag::binaryOperator);
+                writeTag (b->operation);
+                writeExpression (b->lhs);
+                writeExpression (b->rhs);
+                return;
+            }
+
+            if (auto f = cast<heart::PureFunctionCall> (e))
+            {
+                writeTag (ExpressionTag::pureFunctionCall);
+                writeIndex (functionIndexes, std::addressof (f->function));
+                writeExpressionList (f->arguments);
+                return;
+            }
+
+            if (auto p = cast<heart::ProcessorProperty> (e))
+            {
+                writeTag (ExpressionTag::processorProperty);
+                writeTag (p->property);
+                return;
+            }
+
+            SOUL_ASSERT_FALSE;
+        }
+
+        template <typename ListType>
+        void writeExpressionList (const ListType& list)
+        {
+            writeUnsigned (list.size());
+
+            for (auto& e : list)
+                writeExpression (e.get());
+        }
+
+        //==============================================================================
+        void writeFunctions (const Module& m)
+        {
+            module = m;
+
+            for (auto& f : m.functions.get())
+                writeFunction (f);
+        }
+
+        void writeFunction (const heart::Function& f)
+        {
+            function = f;
+            blockIndexes.clear();
+
+            writeType (f.returnType);
+            writeTag (f.functionType.type);
+            writeTag (f.intrinsicType);
+            writeBool (f.isExported);
+            writeBool (f.hasNoBody);
+            writeAnnotation (f.annotation);
+
+            writeUnsigned (f.parameters.size());
+
+            for (auto& p : f.parameters)
+                writeVariable (p);
+
+            writeIndexInArray (f.parameters, f.stateParameter);
+            writeIndexInArray (f.parameters, f.ioParameter);
+
+            writeUnsigned (f.blocks.size());
+
+            for (auto& b : f.blocks)
+            {
+                auto index = blockIndexes.size();
+                blockIndexes[std::addressof (b.get())] = index;
+                writeIdentifier (b->name);
+                writeBool (b->doNotOptimiseAway);
+            }
+
+            for (auto& b : f.blocks)
+                writeBlock (b);
+        }
+
+        void writeBlock (const heart::Block& b)
+        {
+            writeUnsigned (b.parameters.size());
+
+            for (auto& p : b.parameters)
+                writeVariable (p);
+
+            size_t numStatements = 0;
+
+            for (auto s : b.statements)
+            {
+                ignoreUnused (s);
+                ++numStatements;
+            }
+
+            writeUnsigned (numStatements);
+
+            for (auto s : b.statements)
+                writeStatement (*s);
+
+            SOUL_ASSERT (b.isTerminated());
+            writeTerminator (*b.terminator);
+        }
+
+        void writeStatement (const heart::Statement& s)
+        {
+            if (auto a = cast<const heart::AssignFromValue> (s))
+            {
+                writeTag (StatementTag::assignFromValue);
+                writeExpression (a->target);
+                writeExpression (a->source);
+                return;
+            }
+
+            if (auto f = cast<const heart::FunctionCall> (s))
+            {
+                writeTag (StatementTag::functionCall);
+                writeExpression (f->target);
+                writeIndex (functionIndexes, std::addressof (f->getFunction()));
+                writeExpressionList (f->arguments);
+                return;
+            }
+
+            if (auto r = cast<const heart::ReadStream> (s))
+            {
+                writeTag (StatementTag::readStream);
+                writeExpression (r->target);
+                writeIndexInArray (module->inputs, r->source);
+                writeExpression (r->element);
+                return;
+            }
+
+            if (auto w = cast<const heart::WriteStream> (s))
+            {
+                writeTag (StatementTag::writeStream);
+                writeIndexInArray (module->outputs, w->target);
+                writeExpression (w->element);
+                writeExpression (w->value);
+                return;
+            }
+
+            if (is_type<const heart::AdvanceClock> (s))
+            {
+                writeTag (StatementTag::advanceClock);
+                return;
+            }
+
+            SOUL_ASSERT_FALSE;
+        }
+
+        void writeTerminator (const heart::Terminator& t)
+        {
+            if (auto b = cast<const heart::Branch> (t))
+            {
+                writeTag (TerminatorTag::branch);
+                writeIndex (blockIndexes, std::addressof (b->target.get()));
+                writeExpressionList (b->targetArgs);
+                return;
+            }
+
+            if (auto b = cast<const heart::BranchIf> (t))
+            {
+                writeTag (TerminatorTag::branchIf);
+                writeExpression (b->condition);
+
+                for (int i = 0; i < 2; ++i)
+                {
+                    writeIndex (blockIndexes, std::addressof (b->targets[i].get()));
+                    writeExpressionList (b->targetArgs[i]);
+                }
+
+                return;
+            }
+
+            if (is_type<const heart::ReturnVoid> (t))
+            {
+                writeTag (TerminatorTag::returnVoid);
+                return;
+            }
+
+            if (auto r = cast<const heart::ReturnValue> (t))
+            {
+                writeTag (TerminatorTag::returnValue);
+                writeExpression (r->returnValue);
+                return;
+            }
+
+            SOUL_ASSERT_FALSE;
+        }
+
+        //==============================================================================
+        void writeConstantTable()
+        {
+            auto& constants = program.getConstantTable();
+            writeUnsigned (constants.size());
+
+            for (auto& c : constants)
+            {
+                writeSigned (c.handle);
+                writeType (c.value->getType());
+                writeUnsigned (c.value->getPackedDataSize());
+
+                while (out.size() % constantDataAlignment != 0)
+                    writeByte (0);
+
+                writeRaw (c.value->getPackedData(), c.value->getPackedDataSize());
+            }
+        }
+    };
+
+    //==============================================================================
+    struct Reader
+    {
+        Reader (const void* data, size_t size)
+            : start (static_cast<const uint8_t*> (data)), position (start), end (start + size)
+        {
+        }
+
+        Program read()
+        {
+            if (size_t (end - position) < sizeof (magicNumber)
+                 || memcmp (position, magicNumber, sizeof (magicNumber)) != 0)
+                fail();
+
+            position += sizeof (magicNumber);
+
+            if (readUnsigned() != formatVersion)
+                fail();
+
+            readStringDictionary (program.getStringDictionary());
+            readDeclarations();
+
+            for (auto& s : structs)
+                readStructMembers (*s);
+
+            for (auto& m : program.getModules())
+                readModuleContent (m);
+
+            for (auto& m : program.getModules())
+                readFunctions (m);
+
+            readConstantTable();
+
+            if (position != end)
+                fail();
+
+            return program;
+        }
+
+    private:
+        Program program;
+        const uint8_t* const start;
+        const uint8_t* position;
+        const uint8_t* const end;
+
+        pool_ptr<Module> module;
+        std::vector<StructurePtr> structs;
+        std::vector<pool_ref<heart::Function>> functions;
+        std::vector<pool_ref<heart::Variable>> variables;
+        std::vector<pool_ref<heart::Block>> blocks;
+
+        [[noreturn]] static void fail()
+        {
+            CodeLocation().throwError (Errors::invalidBinaryProgram());
+        }
+
+        template <typename Type, typename... Args>
+        Type& allocate (Args&&... args)         { return program.getAllocator().allocate<Type> (std::forward<Args> (args)...); }
+
+        //==============================================================================
+        const uint8_t* readRaw (size_t size)
+        {
+            if (size > size_t (end - position))
+                fail();
+
+            auto data = position;
+            position += size;
+            return data;
+        }
+
+        uint8_t readByte()                      { return *readRaw (1); }
+
+        bool readBool()
+        {
+            auto b = readByte();
+
+            if (b > 1)
+                fail();
+
+            return b != 0;
+        }
+
+        double readDouble()
+        {
+            double d;
+            memcpy (std::addressof (d), readRaw (sizeof (d)), sizeof (d));
+            return d;
+        }
+
+        template <typename TagType>
+        TagType readTag (TagType lastValidTag)
+        {
+            auto t = readByte();
+
+            if (t > static_cast<uint8_t> (lastValidTag))
+                fail();
+
+            return static_cast<TagType> (t);
+        }
+
+        uint64_t readUnsigned()
+        {
+            uint64_t n = 0;
+
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                auto b = readByte();
+                n |= static_cast<uint64_t> (b & 0x7f) << shift;
+
+                if ((b & 0x80) == 0)
+                    return n;
+            }
+
+            fail();
+        }
+
+        int64_t readSigned()
+        {
+            auto n = readUnsigned();
+            return static_cast<int64_t> (n >> 1) ^ -static_cast<int64_t> (n & 1);
+        }
+
+        template <typename IntType>
+        IntType readUnsigned (uint64_t maxValue)
+        {
+            auto n = readUnsigned();
+
+            if (n > maxValue)
+                fail();
+
+            return static_cast<IntType> (n);
+        }
+
+        size_t readSize()
+        {
+            // Every item in a list takes at least one byte, so this can't exceed the remaining data
+            return readUnsigned<size_t> (static_cast<uint64_t> (end - position));
+        }
+
+        std::string readString()
+        {
+            auto length = readSize();
+            auto data = reinterpret_cast<const char*> (readRaw (length));
+            return std::string (data, length);
+        }
+
+        Identifier readIdentifier()
+        {
+            auto s = readString();
+
+            if (s.empty())
+                return {};
+
+            return program.getAllocator().get (s);
+        }
+
+        template <typename IntType>
+        std::optional<IntType> readOptional()
+        {
+            if (! readBool())
+                return {};
+
+            auto n = readSigned();
+
+            if (n < 0 && ! std::is_signed<IntType>::value)
+                fail();
+
+            return static_cast<IntType> (n);
+        }
+
+        template <typename Array>
+        auto& readIndexIn (Array& array)
+        {
+            auto index = readUnsigned();
+
+            if (index >= array.size())
+                fail();
+
+            return array[static_cast<size_t> (index)].get();
+        }
+
+        template <typename ObjectType, typename Array>
+        pool_ptr<ObjectType> readOptionalIndexIn (Array& array)
+        {
+            auto index = readUnsigned();
+
+            if (index == noIndex)
+                return {};
+
+            if (index > array.size())
+                fail();
+
+            return array[static_cast<size_t> (index - 1)].get();
+        }
+
+        //==============================================================================
+        PrimitiveType readPrimitiveType()
+        {
+            return PrimitiveType (readTag (PrimitiveType::bool_));
+        }
+
+        Type readType()
+        {
+            auto isConst = readBool();
+            auto isRef = readBool();
+            auto type = readTypeWithoutFlags();
+
+            if (! type.isValid() && (isConst || isRef))
+                fail();
+
+            return type.withConstAndRefFlags (isConst, isRef);
+        }
+
+        Type readTypeWithoutFlags()
+        {
+            auto tag = readTag (TypeTag::stringLiteral);
+
+            switch (tag)
+            {
+                case TypeTag::invalid:          return {};
+                case TypeTag::stringLiteral:    return Type::createStringLiteral();
+                case TypeTag::structure:        return Type::createStruct (readStruct());
+                case TypeTag::wrappedInt:       return Type::createWrappedInt (readBoundedIntLimit());
+                case TypeTag::clampedInt:       return Type::createClampedInt (readBoundedIntLimit());
+
+                case TypeTag::primitive:
+                {
+                    auto primitive = readPrimitiveType();
+
+                    if (! primitive.isValid())
+                        fail();
+
+                    return Type (primitive);
+                }
+
+                case TypeTag::vector:
+                {
+                    auto elementType = readPrimitiveType();
+                    auto size = readUnsigned<Type::ArraySize> (Type::maxVectorSize);
+
+                    if (! (elementType.canBeVectorElementType() && Type::isLegalVectorSize ((int64_t) size)))
+                        fail();
+
+                    return Type::createVector (elementType, size);
+                }
+
+                case TypeTag::unsizedArray:
+                case TypeTag::fixedSizeArray:
+                {
+                    auto elementType = readType();
+
+                    if (! elementType.canBeArrayElementType())
+                        fail();
+
+                    if (tag == TypeTag::unsizedArray)
+                        return elementType.createUnsizedArray();
+
+                    auto size = readUnsigned<Type::ArraySize> (Type::maxArraySize - 1);
+
+                    if (! Type::canBeSafelyCastToArraySize ((int64_t) size))
+                        fail();
+
+                    return elementType.createArray (size);
+                }
+            }
+
+            fail();
+        }
+
+        Structure& readStruct()
+        {
+            auto index = readUnsigned();
+
+            if (index >= structs.size())
+                fail();
+
+            return *structs[static_cast<size_t> (index)];
+        }
+
+        Type::BoundedIntSize readBoundedIntLimit()
+        {
+            auto limit = readUnsigned<Type::BoundedIntSize> (static_cast<uint64_t> (std::numeric_limits<Type::BoundedIntSize>::max()));
+
+            if (! Type::isLegalBoundedIntSize (limit))
+                fail();
+
+            return limit;
+        }
+
+        Value readValue()
+        {
+            auto type = readType();
+            auto size = readSize();
+
+            if (! type.isValid())
+                fail();
+
+            if (size == 0)
+                return Value::zeroInitialiser (std::move (type));
+
+            if (size != type.getPackedSizeInBytes())
+                fail();
+
+            return Value::createFromRawData (std::move (type), readRaw (size), size);
+        }
+
+        Annotation readAnnotation()
+        {
+            Annotation a;
+            auto numProperties = readSize();
+
+            if (numProperties == 0)
+                return a;
+
+            StringDictionary dictionary;
+            auto handles = readStringDictionary (dictionary);
+
+            for (; numProperties > 0; --numProperties)
+            {
+                auto name = readString();
+                auto value = readValue();
+
+                if (name.empty() || a.hasValue (name) || ! value.isValid())
+                    fail();
+
+                checkStringLiterals (value, {}, handles);
+                a.set (name, std::move (value), dictionary);
+            }
+
+            return a;
+        }
+
+        static bool canContainStringLiterals (const Type& type)
+        {
+            if (type.isStringLiteral())
+                return true;
+
+            if (type.isFixedSizeArray())
+                return canContainStringLiterals (type.getArrayElementType());
+
+            if (type.isStruct())
+                for (size_t i = 0; i < type.getStructRef().getNumMembers(); ++i)
+                    if (canContainStringLiterals (type.getStructRef().getMemberType (i)))
+                        return true;
+
+            return false;
+        }
+
+        /** Makes sure that every string literal in a value refers to one of the given handles */
+        static void checkStringLiterals (const Value& v, SubElementPath path, const std::unordered_set<uint32_t>& handles)
+        {
+            auto value = v.getSubElement (path);
+            auto& type = value.getType();
+
+            if (! canContainStringLiterals (type))
+                return;
+
+            if (type.isStringLiteral())
+            {
+                auto handle = value.getStringLiteral().handle;
+
+                if (handle != 0 && handles.find (handle) == handles.end())
+                    fail();
+            }
+            else if (type.isFixedSizeArray())
+            {
+                for (size_t i = 0; i < type.getArraySize(); ++i)
+                    checkStringLiterals (v, path + i, handles);
+            }
+            else
+            {
+                for (size_t i = 0; i < type.getStructRef().getNumMembers(); ++i)
+                    checkStringLiterals (v, path + i, handles);
+            }
+        }
+
+        //==============================================================================
+        std::unordered_set<uint32_t> readStringDictionary (StringDictionary& dictionary)
+        {
+            std::unordered_set<uint32_t> handlesUsed;
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto handle = readUnsigned<uint32_t> (std::numeric_limits<uint32_t>::max());
+                auto text = readString();
+
+                if (handle == 0 || text.empty() || ! handlesUsed.insert (handle).second)
+                    fail();
+
+                dictionary.addItem ({ StringDictionary::Handle { handle }, std::move (text) });
+            }
+
+            return handlesUsed;
+        }
+
+        void readDeclarations()
+        {
+            for (auto numModules = readSize(); numModules > 0; --numModules)
+            {
+                auto moduleType = readTag (ModuleTag::namespace_);
+                auto shortName = readString();
+                auto fullName = readString();
+
+                if (fullName.empty() || program.findModuleWithName (fullName) != nullptr)
+                    fail();
+
+                auto& m = moduleType == ModuleTag::processor ? program.addProcessor()
+                                                             : (moduleType == ModuleTag::graph ? program.addGraph()
+                                                                                               : program.addNamespace());
+                m.shortName = std::move (shortName);
+                m.fullName = std::move (fullName);
+                m.originalFullName = readString();
+                m.annotation = readAnnotation();
+                m.sampleRate = readDouble();
+                m.latency = readUnsigned<uint32_t> (std::numeric_limits<uint32_t>::max());
+
+                for (auto numStructs = readSize(); numStructs > 0; --numStructs)
+                {
+                    auto name = readString();
+
+                    if (name.empty() || m.structs.find (name) != nullptr)
+                        fail();
+
+                    structs.push_back (m.structs.add (name));
+                }
+
+                for (auto numFunctions = readSize(); numFunctions > 0; --numFunctions)
+                {
+                    auto name = readString();
+                    auto isEvent = readBool();
+
+                    if (name.empty() || m.functions.find (name) != nullptr
+                         || (isEvent && heart::isReservedFunctionName (name)))
+                        fail();
+
+                    functions.push_back (m.functions.add (name, isEvent));
+                }
+            }
+        }
+
+        void readStructMembers (Structure& s)
+        {
+            for (auto numMembers = readSize(); numMembers > 0; --numMembers)
+            {
+                auto type = readType();
+                auto name = readString();
+
+                if (! type.isValid() || name.empty() || s.hasMemberWithName (name))
+                    fail();
+
+                s.addMember (std::move (type), std::move (name));
+            }
+        }
+
+        void readIODeclaration (heart::IODeclaration& io)
+        {
+            io.name = readIdentifier();
+            io.index = readUnsigned<uint32_t> (std::numeric_limits<uint32_t>::max());
+            io.endpointType = readTag (EndpointType::event);
+
+            for (auto numTypes = readSize(); numTypes > 0; --numTypes)
+                io.dataTypes.push_back (readType());
+
+            io.arraySize = readOptional<uint32_t>();
+            io.annotation = readAnnotation();
+
+            if (! io.name.isValid())
+                fail();
+        }
+
+        void readEndpointReference (heart::EndpointReference& e)
+        {
+            e.processor = readOptionalIndexIn<heart::ProcessorInstance> (module->processorInstances);
+            e.endpointName = readString();
+            e.endpointIndex = readOptional<size_t>();
+        }
+
+        void readModuleContent (Module& m)
+        {
+            module = m;
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto& io = allocate<heart::InputDeclaration> (CodeLocation());
+                readIODeclaration (io);
+                m.inputs.push_back (io);
+            }
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto& io = allocate<heart::OutputDeclaration> (CodeLocation());
+                readIODeclaration (io);
+                m.outputs.push_back (io);
+            }
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto& p = allocate<heart::ProcessorInstance> (CodeLocation());
+                p.instanceName = readString();
+                p.sourceName = readString();
+                p.arraySize = readUnsigned<uint32_t> (std::numeric_limits<uint32_t>::max());
+                auto hasClockMultiplier = readBool();
+                auto ratio = readDouble();
+
+                if (hasClockMultiplier)
+                {
+                    if (ratio >= 1.0)
+                        p.clockMultiplier.setMultiplier (CodeLocation(), Value::createInt64 (ratio));
+                    else if (ratio > 0)
+                        p.clockMultiplier.setDivider (CodeLocation(), Value::createInt64 (1.0 / ratio));
+                    else
+                        fail();
+                }
+
+                m.processorInstances.push_back (p);
+            }
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto& c = allocate<heart::Connection> (CodeLocation());
+                readEndpointReference (c.source);
+                readEndpointReference (c.dest);
+                c.interpolationType = readTag (InterpolationType::best);
+                c.delayLength = readOptional<int64_t>();
+                m.connections.push_back (c);
+            }
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto& v = readVariable();
+
+                if (! (v.isState() && v.name.isValid()))
+                    fail();
+
+                m.stateVariables.add (v);
+            }
+        }
+
+        //==============================================================================
+        heart::Variable& readVariable()
+        {
+            if (auto v = cast<heart::Variable> (readExpression()))
+                return *v;
+
+            fail();
+        }
+
+        heart::Variable& readNewVariable()
+        {
+            auto type = readType();
+            auto name = readIdentifier();
+            auto role = readTag (heart::Variable::Role::external);
+
+            if (! type.isValid())
+                fail();
+
+            auto& v = allocate<heart::Variable> (CodeLocation(), std::move (type), name, role);
+            variables.push_back (v);
+
+            v.externalHandle = static_cast<ConstantTable::Handle> (readSigned());
+            v.annotation = readAnnotation();
+            v.initialValue = readExpression();
+            return v;
+        }
+
+        heart::Expression& readNonNullExpression()
+        {
+            if (auto e = readExpression())
+                return *e;
+
+            fail();
+        }
+
+        pool_ptr<heart::Expression> readExpression()
+        {
+            switch (readTag (ExpressionTag::processorProperty))
+            {
+                case ExpressionTag::none:           return {};
+                case ExpressionTag::constant:       return allocate<heart::Constant> (CodeLocation(), readValue());
+                case ExpressionTag::variable:       return readIndexIn (variables);
+                case ExpressionTag::newVariable:    return readNewVariable();
+
+                case ExpressionTag::arrayElement:
+                {
+                    auto& parent = readNonNullExpression();
+                    auto dynamicIndex = readExpression();
+                    auto startIndex = readSize();
+                    auto endIndex = readSize();
+
+                    if (! parent.getType().isArrayOrVector() || startIndex >= endIndex)
+                        fail();
+
+                    auto& a = allocate<heart::ArrayElement> (CodeLocation(), parent, startIndex, endIndex);
+                    a.dynamicIndex = dynamicIndex;
+                    a.isRangeTrusted = readBool();
+                    a.suppressWrapWarning = readBool();
+                    return a;
+                }
+
+                case ExpressionTag::structElement:
+                {
+                    auto& parent = readNonNullExpression();
+                    auto member = readString();
+
+                    if (! (parent.getType().isStruct() && parent.getType().getStructRef().hasMemberWithName (member)))
+                        fail();
+
+                    return allocate<heart::StructElement> (CodeLocation(), parent, std::move (member));
+                }
+
+                case ExpressionTag::typeCast:
+                {
+                    auto destType = readType();
+                    return allocate<heart::TypeCast> (CodeLocation(), readNonNullExpression(), std::move (destType));
+                }
+
+                case ExpressionTag::aggregateInitialiserList:
+                {
+                    auto& l = allocate<heart::AggregateInitialiserList> (CodeLocation(), readType());
+                    readExpressionList (l.items);
+                    return l;
+                }
+
+                case ExpressionTag::unaryOperator:
+                {
+                    auto op = readTag (UnaryOp::Op::unknown);
+
+                    if (op == UnaryOp::Op::unknown)
+                        fail();
+
+                    return allocate<heart::UnaryOperator> (CodeLocation(), readNonNullExpression(), op);
+                }
+
+                case ExpressionTag::binaryOperator:
+                {
+                    auto op = readTag (BinaryOp::Op::unknown);
+
+                    if (op == BinaryOp::Op::unknown)
+                        fail();
+
+                    auto& lhs = readNonNullExpression();
+                    auto& rhs = readNonNullExpression();
+                    return allocate<heart::BinaryOperator> (CodeLocation(), lhs, rhs, op);
+                }
+
+                case ExpressionTag::pureFunctionCall:
+                {
+                    auto& f = allocate<heart::PureFunctionCall> (CodeLocation(), readIndexIn (functions));
+                    readExpressionList (f.arguments);
+                    return f;
+                }
+
+                case ExpressionTag::processorProperty:
+                {
+                    auto property = readTag (heart::ProcessorProperty::Property::latency);
+
+                    if (property == heart::ProcessorProperty::Property::none)
+                        fail();
+
+                    return allocate<heart::ProcessorProperty> (CodeLocation(), property);
+                }
+            }
+
+            fail();
+        }
+
+        template <typename ListType>
+        void readExpressionList (ListType& list)
+        {
+            for (auto num = readSize(); num > 0; --num)
+                list.push_back (readNonNullExpression());
+        }
+
+        //==============================================================================
+        void readFunctions (Module& m)
+        {
+            module = m;
+
+            for (auto& f : m.functions.get())
+                readFunction (f);
+        }
+
+        void readFunction (heart::Function& f)
+        {
+            blocks.clear();
+
+            f.returnType = readType();
+            f.functionType = heart::FunctionType { readTag (heart::FunctionType::Type::intrinsic) };
+            f.intrinsicType = readTag (IntrinsicType::readLinearInterpolated);
+            f.isExported = readBool();
+            f.hasNoBody = readBool();
+            f.annotation = readAnnotation();
+
+            for (auto num = readSize(); num > 0; --num)
+                f.parameters.push_back (readVariable());
+
+            f.stateParameter = readOptionalIndexIn<heart::Variable> (f.parameters);
+            f.ioParameter = readOptionalIndexIn<heart::Variable> (f.parameters);
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto name = readIdentifier();
+
+                if (! (name.isValid() && name.toString()[0] == '@'))
+                    fail();
+
+                auto& b = allocate<heart::Block> (name);
+                b.doNotOptimiseAway = readBool();
+                blocks.push_back (b);
+                f.blocks.push_back (b);
+            }
+
+            for (auto& b : blocks)
+                readBlock (b);
+        }
+
+        void readBlock (heart::Block& b)
+        {
+            for (auto num = readSize(); num > 0; --num)
+                b.parameters.push_back (readVariable());
+
+            LinkedList<heart::Statement>::Iterator last;
+
+            for (auto num = readSize(); num > 0; --num)
+                last = b.statements.insertAfter (last, readStatement());
+
+            b.terminator = readTerminator();
+        }
+
+        heart::Statement& readStatement()
+        {
+            switch (readTag (StatementTag::advanceClock))
+            {
+                case StatementTag::assignFromValue:
+                {
+                    auto& target = readNonNullExpression();
+                    auto& source = readNonNullExpression();
+                    return allocate<heart::AssignFromValue> (CodeLocation(), target, source);
+                }
+
+                case StatementTag::functionCall:
+                {
+                    auto target = readExpression();
+                    auto& f = readIndexIn (functions);
+                    auto& call = allocate<heart::FunctionCall> (CodeLocation(), target, f);
+                    readExpressionList (call.arguments);
+                    return call;
+                }
+
+                case StatementTag::readStream:
+                {
+                    auto& target = readNonNullExpression();
+                    auto& r = allocate<heart::ReadStream> (CodeLocation(), target, readEndpoint<heart::InputDeclaration> (module->inputs));
+                    r.element = readExpression();
+                    return r;
+                }
+
+                case StatementTag::writeStream:
+                {
+                    auto& output = readEndpoint<heart::OutputDeclaration> (module->outputs);
+                    auto element = readExpression();
+                    auto& value = readNonNullExpression();
+                    return allocate<heart::WriteStream> (CodeLocation(), output, element, value);
+                }
+
+                case StatementTag::advanceClock:
+                    return allocate<heart::AdvanceClock> (CodeLocation());
+            }
+
+            fail();
+        }
+
+        template <typename EndpointType, typename Array>
+        EndpointType& readEndpoint (Array& endpoints)
+        {
+            if (auto e = readOptionalIndexIn<EndpointType> (endpoints))
+                return *e;
+
+            fail();
+        }
+
+        heart::Terminator& readTerminator()
+        {
+            switch (readTag (TerminatorTag::returnValue))
+            {
+                case TerminatorTag::branch:
+                {
+                    auto& b = allocate<heart::Branch> (readIndexIn (blocks));
+                    readExpressionList (b.targetArgs);
+                    return b;
+                }
+
+                case TerminatorTag::branchIf:
+                {
+                    auto& condition = readNonNullExpression();
+                    auto& trueBlock = readIndexIn (blocks);
+                    heart::Branch::ArgListType trueArgs;
+                    readExpressionList (trueArgs);
+                    auto& falseBlock = readIndexIn (blocks);
+
+                    auto& b = allocate<heart::BranchIf> (condition, trueBlock, falseBlock);
+                    b.targetArgs[0] = std::move (trueArgs);
+                    readExpressionList (b.targetArgs[1]);
+                    return b;
+                }
+
+                case TerminatorTag::returnVoid:     return allocate<heart::ReturnVoid>();
+                case TerminatorTag::returnValue:    return allocate<heart::ReturnValue> (readNonNullExpression());
+            }
+
+            fail();
+        }
+
+        //==============================================================================
+        void readConstantTable()
+        {
+            std::unordered_set<ConstantTable::Handle> handlesUsed;
+
+            for (auto num = readSize(); num > 0; --num)
+            {
+                auto handle = static_cast<ConstantTable::Handle> (readSigned());
+                auto type = readType();
+                auto size = readSize();
+
+                while ((size_t) (position - start) % constantDataAlignment != 0)
+                    readByte();
+
+                if (handle <= 0 || ! handlesUsed.insert (handle).second
+                     || ! type.isValid() || size != type.getPackedSizeInBytes())
+                    fail();
+
+                program.getConstantTable().addItem ({ handle, std::make_unique<Value> (Value::createFromRawData (std::move (type), readRaw (size), size)) });
+            }
+        }
+    };
+};
+
+} // namespace soul
@@ -0,0 +1,428 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/** The rate of a processor relative to the rate of the main processor. Because clock
+    multipliers are always powers of two, this can be held as an exact fraction.
+*/
+struct ClockRatio
+{
+    int64_t numerator = 1, denominator = 1;
+
+    ClockRatio operator* (const heart::ClockMultiplier& m) const
+    {
+        auto ratio = m.getRatio();
+        ClockRatio r { numerator, denominator };
+
+        if (ratio >= 1.0)
+            r.numerator *= (int64_t) std::lround (ratio);
+        else
+            r.denominator *= (int64_t) std::lround (1.0 / ratio);
+
+        auto divisor = std::gcd (r.numerator, r.denominator);
+        return { r.numerator / divisor, r.denominator / divisor };
+    }
+
+    bool operator== (const ClockRatio& other) const     { return numerator == other.numerator && denominator == other.denominator; }
+    bool operator!= (const ClockRatio& other) const     { return ! operator== (other); }
+
+    double toDouble() const                             { return (double) numerator / (double) denominator; }
+
+    /** Converts a frame position at the main rate to a frame position at this rate, rounding up. */
+    int64_t getLocalFrame (int64_t mainFrame) const     { return (mainFrame * numerator + denominator - 1) / denominator; }
+};
+
+//==============================================================================
+/**
+    Lowers the graphs in a linked program into a flat schedule that a backend can
+    render directly.
+
+    Every processor instance becomes a node, with its clock ratio relative to the main
+    processor, and every connection is traced through the intermediate graphs to become
+    a direct route between two nodes, with the total delay along the way, and the kind
+    of interpolation needed if the two ends run at different rates. The nodes are then
+    sorted so that each one comes after all the nodes it reads from without a delay.
+
+    The input and output endpoints of the main processor are represented by two extra
+    nodes with no module, which are the first and last in the list.
+*/
+struct FlattenedGraph
+{
+    struct Node
+    {
+        Module* module = nullptr;   // null for the input and output boundaries
+        std::string path;           // e.g. "voices[2].osc", or empty for the main processor
+        CodeLocation location;
+        ClockRatio ratio;
+        int32_t instanceID = 0;
+    };
+
+    struct Route
+    {
+        uint32_t sourceNode, sourceOutput, destNode, destInput;
+        int32_t sourceElement, destElement;
+        int64_t delay;                      // in frames at the destination's rate
+        InterpolationType interpolation;    // for a stream whose ends run at different rates, otherwise none
+        CodeLocation location;
+    };
+
+    /** Flattens the graph (or lone processor) that is the program's main processor. */
+    static FlattenedGraph build (Program& program, Module& mainModule)
+    {
+        FlattenedGraph g (program, mainModule);
+        g.createNodesAndRoutes();
+        g.sortNodes();
+        return g;
+    }
+
+    const heart::IODeclaration& getSource (const Route& r) const
+    {
+        if (r.sourceNode == inputBoundary)
+            return mainModule->inputs[r.sourceOutput];
+
+        return nodes[r.sourceNode].module->outputs[r.sourceOutput];
+    }
+
+    const heart::IODeclaration& getDest (const Route& r) const
+    {
+        if (r.destNode == outputBoundary)
+            return mainModule->outputs[r.destInput];
+
+        return nodes[r.destNode].module->inputs[r.destInput];
+    }
+
+    /** Returns the name of a node that can be shown to the user. */
+    std::string getNodeName (uint32_t node) const
+    {
+        if (node == inputBoundary)   return "input";
+        if (node == outputBoundary)  return "output";
+
+        auto& path = nodes[node].path;
+        return path.empty() ? mainModule->originalFullName : mainModule->originalFullName + "." + path;
+    }
+
+    /** True if the route's source is processed after its destination, so that the data
+        can only be read on a later frame. These are always routes with a delay.
+    */
+    bool isFeedback (const Route& r) const     { return orderPositions[r.sourceNode] >= orderPositions[r.destNode]; }
+
+    /** The size of the sinc kernels that the backends use for streams resampled with InterpolationType::sinc. */
+    static constexpr int numSincZeroCrossings = 16;
+
+    std::vector<Node> nodes;
+    std::vector<Route> routes;
+    std::vector<uint32_t> processingOrder;
+    uint32_t inputBoundary = 0, outputBoundary = 0;
+
+private:
+    FlattenedGraph (Program& p, Module& main) : program (std::addressof (p)), mainModule (std::addressof (main)) {}
+
+    struct Terminal
+    {
+        int32_t node;       // -1 if this is a junction, i.e. an endpoint of one of the intermediate graphs
+        uint32_t index;     // the endpoint or junction index
+
+        bool operator== (const Terminal& other) const   { return node == other.node && index == other.index; }
+    };
+
+    struct Edge
+    {
+        Terminal source, dest;
+        int32_t sourceElement, destElement;
+        int64_t delay;
+        InterpolationType interpolation;
+        CodeLocation location;
+    };
+
+    struct ModulePorts
+    {
+        std::vector<Terminal> inputs, outputs;
+    };
+
+    Program* program;
+    Module* mainModule;
+    std::vector<Edge> edges;
+    std::vector<uint32_t> orderPositions;
+    uint32_t numJunctions = 0;
+
+    //==============================================================================
+    void createNodesAndRoutes()
+    {
+        inputBoundary = (uint32_t) nodes.size();
+        nodes.push_back ({});
+
+        auto mainPorts = expand (*mainModule, {}, mainModule->location, {}, (int32_t) program->getModuleID (*mainModule, 1));
+
+        outputBoundary = (uint32_t) nodes.size();
+        nodes.push_back ({});
+
+        for (uint32_t i = 0; i < mainPorts.inputs.size(); ++i)
+            edges.push_back ({ { (int32_t) inputBoundary, i }, mainPorts.inputs[i], -1, -1, 0, InterpolationType::none, mainModule->location });
+
+        for (uint32_t i = 0; i < mainPorts.outputs.size(); ++i)
+            edges.push_back ({ mainPorts.outputs[i], { (int32_t) outputBoundary, i }, -1, -1, 0, InterpolationType::none, mainModule->location });
+
+        for (auto& e : edges)
+            if (e.source.node >= 0)
+                traceEdge (e, e.dest, e.destElement, e.delay, e.interpolation, 0);
+
+        edges.clear();
+    }
+
+    ModulePorts expand (Module& module, const std::string& path, const CodeLocation& location,
+                        ClockRatio ratio, int32_t instanceID)
+    {
+        ModulePorts ports;
+
+        if (module.isProcessor())
+        {
+            auto node = (int32_t) nodes.size();
+            nodes.push_back ({ std::addressof (module), path, location, ratio, instanceID });
+
+            for (uint32_t i = 0; i < module.inputs.size(); ++i)    ports.inputs.push_back ({ node, i });
+            for (uint32_t i = 0; i < module.outputs.size(); ++i)   ports.outputs.push_back ({ node, i });
+
+            return ports;
+        }
+
+        for (size_t i = 0; i < module.inputs.size(); ++i)    ports.inputs.push_back ({ -1, numJunctions++ });
+        for (size_t i = 0; i < module.outputs.size(); ++i)   ports.outputs.push_back ({ -1, numJunctions++ });
+
+        std::unordered_map<const heart::ProcessorInstance*, std::vector<ModulePorts>> instances;
+
+        for (auto& instance : module.processorInstances)
+        {
+            auto& subModule = program->getModuleWithName (instance->sourceName);
+            auto firstID = program->getModuleID (subModule, instance->arraySize);
+            auto& instancePorts = instances[std::addressof (instance.get())];
+
+            for (uint32_t i = 0; i < instance->arraySize; ++i)
+                instancePorts.push_back (expand (subModule,
+                                                 (path.empty() ? std::string() : path + ".") + instance->instanceName
+                                                    + (instance->arraySize > 1 ? "[" + std::to_string (i) + "]" : std::string()),
+                                                 instance->location, ratio * instance->clockMultiplier, (int32_t) (firstID + i)));
+        }
+
+        auto getTerminals = [&] (const heart::EndpointReference& ref, bool isSource, const CodeLocation& errorLocation)
+        {
+            std::vector<Terminal> terminals;
+
+            if (ref.processor == nullptr)
+            {
+                if (isSource)
+                {
+                    for (size_t i = 0; i < module.inputs.size(); ++i)
+                        if (module.inputs[i]->name.toString() == ref.endpointName)
+                            terminals.push_back (ports.inputs[i]);
+                }
+                else
+                {
+                    for (size_t i = 0; i < module.outputs.size(); ++i)
+                        if (module.outputs[i]->name.toString() == ref.endpointName)
+                            terminals.push_back (ports.outputs[i]);
+                }
+            }
+            else
+            {
+                auto& subModule = program->getModuleWithName (ref.processor->sourceName);
+
+                for (auto& instancePorts : instances[ref.processor.get()])
+                {
+                    if (isSource)
+                    {
+                        for (size_t i = 0; i < subModule.outputs.size(); ++i)
+                            if (subModule.outputs[i]->name.toString() == ref.endpointName)
+                                terminals.push_back (instancePorts.outputs[i]);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < subModule.inputs.size(); ++i)
+                            if (subModule.inputs[i]->name.toString() == ref.endpointName)
+                                terminals.push_back (instancePorts.inputs[i]);
+                    }
+                }
+            }
+
+            if (terminals.empty())
+                errorLocation.throwError (isSource ? Errors::cannotFindSource (ref.endpointName)
+                                                   : Errors::cannotFindDestination (ref.endpointName));
+
+            return terminals;
+        };
+
+        auto getArraySize = [&] (const heart::EndpointReference& ref, bool isSource) -> size_t
+        {
+            auto& owner = ref.processor == nullptr ? module : program->getModuleWithName (ref.processor->sourceName);
+
+            if ((ref.processor == nullptr) == isSource)
+            {
+                for (auto& io : owner.inputs)
+                    if (io->name.toString() == ref.endpointName)
+                        return io->arraySize.value_or (0);
+            }
+            else
+            {
+                for (auto& io : owner.outputs)
+                    if (io->name.toString() == ref.endpointName)
+                        return io->arraySize.value_or (0);
+            }
+
+            return 0;
+        };
+
+        for (auto& c : module.connections)
+        {
+            auto sources = getTerminals (c->source, true, c->location);
+            auto dests   = getTerminals (c->dest, false, c->location);
+            auto sourceElement = c->source.endpointIndex.has_value() ? (int32_t) *c->source.endpointIndex : -1;
+            auto destElement   = c->dest.endpointIndex.has_value()   ? (int32_t) *c->dest.endpointIndex : -1;
+            auto delay = c->delayLength.value_or (0);
+            auto interpolation = c->interpolationType;
+
+            if (sources.size() == dests.size())
+            {
+                for (size_t i = 0; i < sources.size(); ++i)
+                    edges.push_back ({ sources[i], dests[i], sourceElement, destElement, delay, interpolation, c->location });
+            }
+            else if (sources.size() == 1 && sourceElement < 0 && getArraySize (c->source, true) == dests.size())
+            {
+                // An array endpoint feeding an array of processors sends each element to the matching instance
+                for (size_t i = 0; i < dests.size(); ++i)
+                    edges.push_back ({ sources[0], dests[i], (int32_t) i, destElement, delay, interpolation, c->location });
+            }
+            else if (dests.size() == 1 && destElement < 0 && getArraySize (c->dest, false) == sources.size())
+            {
+                for (size_t i = 0; i < sources.size(); ++i)
+                    edges.push_back ({ sources[i], dests[0], sourceElement, (int32_t) i, delay, interpolation, c->location });
+            }
+            else
+            {
+                for (auto& s : sources)
+                    for (auto& d : dests)
+                        edges.push_back ({ s, d, sourceElement, destElement, delay, interpolation, c->location });
+            }
+        }
+
+        return ports;
+    }
+
+    void traceEdge (const Edge& first, Terminal dest, int32_t destElement, int64_t delay,
+                    InterpolationType interpolation, int depth)
+    {
+        if (depth > 1000)
+            first.location.throwError (Errors::feedbackInGraph ("connections"));
+
+        if (dest.node >= 0)
+            return addRoute (first, dest, destElement, delay, interpolation);
+
+        for (auto& e : edges)
+            if (e.source == dest)
+                traceEdge (first, e.dest, e.destElement >= 0 ? e.destElement : destElement, delay + e.delay,
+                           e.interpolation != InterpolationType::none ? e.interpolation : interpolation, depth + 1);
+    }
+
+    void addRoute (const Edge& first, Terminal dest, int32_t destElement, int64_t delay, InterpolationType interpolation)
+    {
+        Route r { (uint32_t) first.source.node, first.source.index, (uint32_t) dest.node, dest.index,
+                  first.sourceElement, destElement, delay, InterpolationType::none, first.location };
+
+        auto& source = getSource (r);
+        auto& target = getDest (r);
+
+        if (source.endpointType != target.endpointType)
+            first.location.throwError (Errors::cannotConnect (source.name.toString(), source.getTypesDescription(),
+                                                              target.name.toString(), target.getTypesDescription()));
+
+        if (source.isStreamEndpoint() && nodes[r.sourceNode].ratio != nodes[r.destNode].ratio)
+            r.interpolation = getResamplingInterpolation (interpolation, nodes[r.sourceNode].ratio, nodes[r.destNode].ratio);
+
+        routes.push_back (std::move (r));
+    }
+
+    // Picks the interpolator to use where a stream crosses between two rates. If none was
+    // requested, oversampled streams use sinc in both directions, while streams going into an
+    // undersampled processor are latched, and those coming out of one are linear-interpolated.
+    static InterpolationType getResamplingInterpolation (InterpolationType requested, ClockRatio sourceRatio, ClockRatio destRatio)
+    {
+        switch (requested)
+        {
+            case InterpolationType::latch:   return InterpolationType::latch;
+            case InterpolationType::linear:
+            case InterpolationType::fast:    return InterpolationType::linear;
+            case InterpolationType::sinc:
+            case InterpolationType::best:    return InterpolationType::sinc;
+            case InterpolationType::none:
+            default:                         break;
+        }
+
+        if (std::max (sourceRatio.toDouble(), destRatio.toDouble()) > 1.0)
+            return InterpolationType::sinc;
+
+        return sourceRatio.toDouble() < destRatio.toDouble() ? InterpolationType::linear : InterpolationType::latch;
+    }
+
+    //==============================================================================
+    void sortNodes()
+    {
+        std::vector<uint32_t> numDependencies (nodes.size());
+        orderPositions.resize (nodes.size());
+
+        for (auto& r : routes)
+            if (r.delay == 0)
+                ++numDependencies[r.destNode];
+
+        for (size_t next = 0; processingOrder.size() < nodes.size();)
+        {
+            bool found = false;
+
+            for (uint32_t i = 0; i < nodes.size(); ++i)
+            {
+                if (numDependencies[i] == 0)
+                {
+                    numDependencies[i] = std::numeric_limits<uint32_t>::max();
+                    orderPositions[i] = (uint32_t) processingOrder.size();
+                    processingOrder.push_back (i);
+                    found = true;
+                }
+            }
+
+            for (; next < processingOrder.size(); ++next)
+                for (auto& r : routes)
+                    if (r.delay == 0 && r.sourceNode == processingOrder[next])
+                        --numDependencies[r.destNode];
+
+            if (! found)
+            {
+                std::vector<std::string> names;
+
+                for (uint32_t i = 0; i < nodes.size(); ++i)
+                    if (numDependencies[i] != std::numeric_limits<uint32_t>::max())
+                        names.push_back (getNodeName (i));
+
+                CodeLocation().throwError (Errors::feedbackInGraph (joinStrings (names, " -> ")));
+            }
+        }
+    }
+};
+
+} // namespace soul
@@ -201,7 +201,7 @@ struct Optimisations
 
     static void garbageCollectStringDictionary (Program& program)
     {
-        std::vector<StringDictionary::Handle> handlesUsed;
+        std::unordered_set<uint32_t> handlesUsed;
 
         for (auto& m : program.getModules())
             for (auto f : m->functions.get())
@@ -212,17 +212,11 @@ struct Optimisations
                                              const auto& type = c->value.getType();
 
                                              if (type.isStringLiteral())
-                                             {
-                                                 auto handle = c->value.getStringLiteral();
-
-                                                 if (! contains (handlesUsed, handle))
-                                                     handlesUsed.push_back (handle);
-                                             }
+                                                 handlesUsed.insert (c->value.getStringLiteral().handle);
                                          }
                                      });
 
-        removeIf (program.getStringDictionary().strings,
-                  [&] (const StringDictionary::Item& item) { return ! contains (handlesUsed, item.handle); });
+        program.getStringDictionary().removeUnusedStrings (handlesUsed);
     }
 
 
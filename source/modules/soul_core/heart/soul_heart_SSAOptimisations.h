@@ -0,0 +1,845 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/**
+    Dataflow optimisations which treat a HEART function as being in SSA form.
+
+    A constant-role variable that is written exactly once is an SSA value, and block
+    parameters play the part of phi nodes, so HEART needs no conversion before these
+    passes can run over it. Because HEART statements hold whole expression trees, the
+    CSE and LICM passes first split every pure operator out into a temporary SSA value
+    of its own, and afterwards any temporary that's only read once by a later statement
+    in the same block is folded back into it. The passes that are used depend on the
+    optimisation level:
+
+      1: conditional constant propagation (including through block parameters and
+         into branch conditions, removing any blocks which become unreachable), and
+         copy propagation
+      2: the above, plus common-subexpression elimination within each block
+      3: the above, plus loop-invariant code motion
+
+    A level of -1 selects defaultOptimisationLevel, and 0 disables them all.
+*/
+struct SSAOptimisations
+{
+    static constexpr int defaultOptimisationLevel = 2;
+
+    static void optimise (Program& program, int optimisationLevel)
+    {
+        auto level = optimisationLevel < 0 ? defaultOptimisationLevel : optimisationLevel;
+
+        if (level <= 0)
+            return;
+
+        for (auto& m : program.getModules())
+            for (auto f : m->functions.get())
+                if (! (f->hasNoBody || f->blocks.empty()))
+                    optimise (m, f, program.getAllocator(), level);
+    }
+
+    static void optimise (Module& module, heart::Function& f, heart::Allocator& allocator, int level)
+    {
+        std::vector<pool_ref<heart::Variable>> temporaries;
+
+        if (level >= 2)
+            splitIntoTemporaries (module, f, temporaries);
+
+        for (;;)
+        {
+            bool anyChanged = propagateConstants (module, f);
+
+            if (foldConstantBranches (module, f))
+            {
+                Optimisations::optimiseFunctionBlocks (f, allocator);
+                anyChanged = true;
+            }
+
+            anyChanged = propagateBlockParameters (module, f) || anyChanged;
+            anyChanged = propagateCopies (f) || anyChanged;
+
+            if (level >= 2)
+                anyChanged = eliminateCommonSubexpressions (f) || anyChanged;
+
+            if (level >= 3)
+                anyChanged = hoistLoopInvariants (f) || anyChanged;
+
+            if (! anyChanged)
+                break;
+        }
+
+        if (! temporaries.empty())
+            mergeSingleUseTemporaries (f, temporaries);
+    }
+
+private:
+    //==============================================================================
+    // NB: these rely on the variables' readWriteCount being up-to-date
+    static bool isSSAValue (const heart::Variable& v)
+    {
+        return v.isConstant() && v.readWriteCount.numWrites == 1 && ! v.getType().isReference();
+    }
+
+    static pool_ptr<heart::Variable> getSSAValue (pool_ptr<heart::Expression> e)
+    {
+        if (auto v = cast<heart::Variable> (e))
+            if (isSSAValue (*v))
+                return v;
+
+        return {};
+    }
+
+    static bool isFunctionParameter (heart::Function& f, heart::Variable& v)
+    {
+        return v.isParameter() && ! v.getType().isReference() && contains (f.parameters, v);
+    }
+
+    /** True for a variable whose value can only be changed by a statement in this function */
+    static bool isLocalValue (heart::Variable& v)
+    {
+        return (v.isFunctionLocal() || v.isParameter()) && ! v.getType().isReference();
+    }
+
+    static void replaceReads (heart::Function& f, heart::Variable& v, heart::Expression& replacement)
+    {
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& value, AccessType mode)
+        {
+            if (mode == AccessType::read && value == v)
+                value = replacement;
+        });
+    }
+
+    /** Constants can't stand in for a variable which is the parent of an element access */
+    static bool isUsedAsAggregate (heart::Function& f, heart::Variable& v)
+    {
+        bool result = false;
+
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& value, AccessType)
+        {
+            if (auto a = cast<heart::ArrayElement> (value))
+                result = result || a->parent == v;
+            else if (auto s = cast<heart::StructElement> (value))
+                result = result || s->parent == v;
+        });
+
+        return result;
+    }
+
+    template <typename VisitorFn>
+    static void visitVariablesWritten (heart::Statement& s, VisitorFn&& visit)
+    {
+        s.visitExpressions ([&] (pool_ref<heart::Expression>& value, AccessType mode)
+        {
+            if (mode != AccessType::read)
+                if (auto v = cast<heart::Variable> (value))
+                    visit (*v);
+        });
+
+        if (auto a = cast<heart::Assignment> (s))
+            if (a->target != nullptr)
+                if (auto v = a->target->getRootVariable())
+                    visit (*v);
+    }
+
+    static bool isOperator (heart::Expression& e)
+    {
+        return is_type<heart::UnaryOperator> (e) || is_type<heart::BinaryOperator> (e) || is_type<heart::TypeCast> (e);
+    }
+
+    /** Evaluates an expression which is built only from constants. Unlike
+        Expression::getAsConstant(), a divide-by-zero just fails rather than
+        throwing a compile error, because the code may never actually run.
+    */
+    static Value evaluate (heart::Expression& e)
+    {
+        if (auto c = cast<heart::Constant> (e))
+            return c->value;
+
+        if (auto t = cast<heart::TypeCast> (e))
+        {
+            auto value = evaluate (t->source);
+
+            if (value.isValid())
+                return value.tryCastToType (t->destType);
+
+            return {};
+        }
+
+        if (auto u = cast<heart::UnaryOperator> (e))
+        {
+            auto value = evaluate (u->source);
+
+            if (value.isValid() && UnaryOp::apply (value, u->operation))
+                return value;
+
+            return {};
+        }
+
+        if (auto b = cast<heart::BinaryOperator> (e))
+        {
+            auto lhs = evaluate (b->lhs);
+
+            if (lhs.isValid())
+            {
+                auto rhs = evaluate (b->rhs);
+
+                if (rhs.isValid())
+                {
+                    bool failed = false;
+
+                    if (BinaryOp::apply (lhs, rhs, b->operation, [&] (CompileMessage) { failed = true; }) && ! failed)
+                        return lhs;
+                }
+            }
+        }
+
+        return {};
+    }
+
+    //==============================================================================
+    static bool propagateConstants (Module& module, heart::Function& f)
+    {
+        f.rebuildVariableUseCounts();
+        bool anyChanged = false;
+
+        for (auto b : f.blocks)
+        {
+            for (auto s : b->statements)
+            {
+                if (auto a = cast<heart::AssignFromValue> (*s))
+                {
+                    if (auto target = getSSAValue (a->target))
+                    {
+                        if (target->readWriteCount.numReads != 0 && target->getType().isPrimitive())
+                        {
+                            auto value = evaluate (a->source);
+
+                            if (value.isValid() && value.getType().isEqual (target->getType(), Type::ignoreConst)
+                                 && ! isUsedAsAggregate (f, *target))
+                            {
+                                replaceReads (f, *target, module.allocate<heart::Constant> (a->source->location, value));
+                                target->readWriteCount.numReads = 0;
+                                anyChanged = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        f.visitExpressions ([&] (pool_ref<heart::Expression>& e, AccessType mode)
+        {
+            if (mode == AccessType::read && isOperator (e))
+            {
+                auto value = evaluate (e);
+
+                if (value.isValid() && value.getType().isPrimitive()
+                     && value.getType().isEqual (e->getType(), Type::ignoreConst))
+                {
+                    e = module.allocate<heart::Constant> (e->location, value);
+                    anyChanged = true;
+                }
+            }
+        });
+
+        return anyChanged;
+    }
+
+    static bool foldConstantBranches (Module& module, heart::Function& f)
+    {
+        bool anyChanged = false;
+
+        for (auto b : f.blocks)
+        {
+            if (auto branchIf = cast<heart::BranchIf> (b->terminator))
+            {
+                auto condition = evaluate (branchIf->condition);
+
+                if (condition.isValid())
+                {
+                    auto index = condition.getAsBool() ? 0 : 1;
+                    auto& branch = module.allocate<heart::Branch> (branchIf->targets[index]);
+                    branch.targetArgs = branchIf->targetArgs[index];
+                    b->terminator = branch;
+                    anyChanged = true;
+                }
+            }
+        }
+
+        return anyChanged;
+    }
+
+    //==============================================================================
+    static heart::Branch::ArgListType* getArgumentsPassedTo (heart::Terminator& t, heart::Block& dest)
+    {
+        if (auto branch = cast<heart::Branch> (t))
+            return branch->target == dest ? std::addressof (branch->targetArgs) : nullptr;
+
+        if (auto branchIf = cast<heart::BranchIf> (t))
+            for (int i = 0; i < 2; ++i)
+                if (branchIf->targets[i] == dest)
+                    return std::addressof (branchIf->targetArgs[i]);
+
+        return nullptr;
+    }
+
+    /** Returns the constant that every predecessor passes for a block parameter, if they all agree */
+    static Value getConstantArgument (heart::Block& b, size_t parameterIndex)
+    {
+        Value result;
+
+        for (auto pred : b.predecessors)
+        {
+            auto args = getArgumentsPassedTo (*pred->terminator, b);
+
+            if (args == nullptr || parameterIndex >= args->size())
+                return {};
+
+            auto c = cast<heart::Constant> ((*args)[parameterIndex]);
+
+            if (c == nullptr)
+                return {};
+
+            if (! result.isValid())
+                result = c->value;
+            else if (! (result == c->value))
+                return {};
+        }
+
+        return result;
+    }
+
+    static bool propagateBlockParameters (Module& module, heart::Function& f)
+    {
+        f.rebuildBlockPredecessors();
+        bool anyChanged = false;
+
+        for (auto b : f.blocks)
+        {
+            if (b == f.blocks.front() || b->predecessors.empty())
+                continue;
+
+            for (auto i = b->parameters.size(); i > 0;)
+            {
+                --i;
+                auto& param = b->parameters[i].get();
+
+                if (! param.getType().isPrimitive())
+                    continue;
+
+                auto value = getConstantArgument (b, i);
+
+                if (value.isValid() && value.getType().isEqual (param.getType(), Type::ignoreConst)
+                     && ! isUsedAsAggregate (f, param))
+                {
+                    replaceReads (f, param, module.allocate<heart::Constant> (param.location, value));
+
+                    for (auto pred : b->predecessors)
+                    {
+                        auto args = getArgumentsPassedTo (*pred->terminator, b);
+                        args->erase (args->begin() + i);
+                    }
+
+                    b->parameters.erase (b->parameters.begin() + static_cast<std::ptrdiff_t> (i));
+                    anyChanged = true;
+                }
+            }
+        }
+
+        return anyChanged;
+    }
+
+    //==============================================================================
+    /** Replaces reads of a value which is a copy of another SSA value or of an unmodified
+        function parameter with reads of the original.
+    */
+    static bool propagateCopies (heart::Function& f)
+    {
+        f.rebuildVariableUseCounts();
+        bool anyChanged = false;
+
+        for (auto b : f.blocks)
+        {
+            b->statements.removeMatches ([&] (heart::Statement& s)
+            {
+                if (auto a = cast<heart::AssignFromValue> (s))
+                {
+                    if (auto target = getSSAValue (a->target))
+                    {
+                        if (auto source = cast<heart::Variable> (a->source))
+                        {
+                            if (source != target
+                                 && source->getType().isEqual (target->getType(), Type::ignoreConst)
+                                 && (isSSAValue (*source)
+                                      || (isFunctionParameter (f, *source) && source->readWriteCount.numWrites == 0)))
+                            {
+                                replaceReads (f, *target, *source);
+                                anyChanged = true;
+                                return true;
+                            }
+                        }
+                    }
+                }
+
+                return false;
+            });
+        }
+
+        return anyChanged;
+    }
+
+    //==============================================================================
+    /** Gives each pure operator in the function a temporary of its own, assigned by a new
+        statement just before the one that uses it, so that the values which CSE and LICM
+        work on are visible as separate statements.
+    */
+    static void splitIntoTemporaries (Module& module, heart::Function& f, std::vector<pool_ref<heart::Variable>>& temporaries)
+    {
+        for (auto b : f.blocks)
+        {
+            LinkedList<heart::Statement>::Iterator last;
+
+            auto split = [&] (pool_ref<heart::Expression>& value, AccessType mode, pool_ptr<heart::Expression> rootValue)
+            {
+                if (mode == AccessType::read && value != rootValue && isOperator (value) && isPureValueExpression (value))
+                {
+                    auto& temp = module.allocate<heart::Variable> (value->location, value->getType(), Identifier(),
+                                                                   heart::Variable::Role::constant);
+                    last = b->statements.insertAfter (last, module.allocate<heart::AssignFromValue> (value->location, temp, value));
+                    temporaries.push_back (temp);
+                    value = temp;
+                }
+            };
+
+            for (auto s : b->statements)
+            {
+                auto assignment = cast<heart::AssignFromValue> (*s);
+                auto rootValue = assignment != nullptr ? pool_ptr<heart::Expression> (assignment->source) : pool_ptr<heart::Expression>();
+
+                s->visitExpressions ([&] (pool_ref<heart::Expression>& value, AccessType mode) { split (value, mode, rootValue); });
+                last = s;
+            }
+
+            if (b->terminator != nullptr)
+                b->terminator->visitExpressions ([&] (pool_ref<heart::Expression>& value, AccessType mode) { split (value, mode, {}); });
+        }
+    }
+
+    /** Puts back any temporary that's read only once, by a later statement in the block
+        where it's assigned, so that nothing is left split up unless it's shared or hoisted.
+    */
+    static void mergeSingleUseTemporaries (heart::Function& f, const std::vector<pool_ref<heart::Variable>>& temporaries)
+    {
+        struct PendingValue
+        {
+            pool_ref<heart::Variable> variable;
+            pool_ref<heart::Expression> value;
+            pool_ref<heart::Statement> assignment;
+        };
+
+        f.rebuildVariableUseCounts();
+
+        for (auto b : f.blocks)
+        {
+            std::vector<PendingValue> pending;
+            std::vector<pool_ref<heart::Statement>> statementsToRemove;
+
+            auto merge = [&] (pool_ref<heart::Expression>& value, AccessType mode)
+            {
+                if (mode == AccessType::read)
+                {
+                    for (auto p = pending.begin(); p != pending.end(); ++p)
+                    {
+                        if (value == p->variable)
+                        {
+                            value = p->value;
+                            statementsToRemove.push_back (p->assignment);
+                            pending.erase (p);
+                            break;
+                        }
+                    }
+                }
+            };
+
+            for (auto s : b->statements)
+            {
+                s->visitExpressions (merge);
+
+                visitVariablesWritten (*s, [&] (heart::Variable& written)
+                {
+                    removeIf (pending, [&] (PendingValue& p) { return p.value->readsVariable (written); });
+                });
+
+                if (auto a = cast<heart::AssignFromValue> (*s))
+                {
+                    if (auto target = cast<heart::Variable> (a->target))
+                    {
+                        if (contains (temporaries, *target) && target->readWriteCount.numWrites == 1)
+                        {
+                            if (target->readWriteCount.numReads == 0)
+                                statementsToRemove.push_back (*s);
+                            else if (target->readWriteCount.numReads == 1)
+                                pending.push_back ({ *target, a->source, *s });
+                        }
+                    }
+                }
+            }
+
+            if (b->terminator != nullptr)
+                b->terminator->visitExpressions (merge);
+
+            if (! statementsToRemove.empty())
+                b->statements.removeMatches ([&] (heart::Statement& s) { return contains (statementsToRemove, s); });
+        }
+    }
+
+    //==============================================================================
+    /** True for an expression built only from operators, constants and local values, whose
+        result therefore depends on nothing except the variables it reads.
+    */
+    static bool isPureValueExpression (heart::Expression& e)
+    {
+        if (is_type<heart::Constant> (e))                return true;
+        if (auto v = cast<heart::Variable> (e))          return isLocalValue (*v);
+        if (auto u = cast<heart::UnaryOperator> (e))     return isPureValueExpression (u->source);
+        if (auto t = cast<heart::TypeCast> (e))          return isPureValueExpression (t->source);
+
+        if (auto b = cast<heart::BinaryOperator> (e))
+            return isPureValueExpression (b->lhs) && isPureValueExpression (b->rhs);
+
+        return false;
+    }
+
+    static bool areIdentical (heart::Expression& a, heart::Expression& b)
+    {
+        if (std::addressof (a) == std::addressof (b))
+            return true;
+
+        if (auto c1 = cast<heart::Constant> (a))
+            if (auto c2 = cast<heart::Constant> (b))
+                return c1->value == c2->value;
+
+        if (auto u1 = cast<heart::UnaryOperator> (a))
+            if (auto u2 = cast<heart::UnaryOperator> (b))
+                return u1->operation == u2->operation && areIdentical (u1->source, u2->source);
+
+        if (auto t1 = cast<heart::TypeCast> (a))
+            if (auto t2 = cast<heart::TypeCast> (b))
+                return t1->destType.isIdentical (t2->destType) && areIdentical (t1->source, t2->source);
+
+        if (auto b1 = cast<heart::BinaryOperator> (a))
+            if (auto b2 = cast<heart::BinaryOperator> (b))
+                return b1->operation == b2->operation
+                        && areIdentical (b1->lhs, b2->lhs)
+                        && areIdentical (b1->rhs, b2->rhs);
+
+        return false;
+    }
+
+    static bool isCandidateForReuse (heart::AssignFromValue& a)
+    {
+        return isOperator (a.source) && isPureValueExpression (a.source);
+    }
+
+    /** Within each block, replaces the calculation of a value which an earlier statement has
+        already put into a variable that's still unmodified with a copy of that variable.
+    */
+    static bool eliminateCommonSubexpressions (heart::Function& f)
+    {
+        struct AvailableValue
+        {
+            pool_ref<heart::Variable> variable;
+            pool_ref<heart::Expression> value;
+        };
+
+        bool anyChanged = false;
+
+        for (auto b : f.blocks)
+        {
+            std::vector<AvailableValue> available;
+
+            for (auto s : b->statements)
+            {
+                auto a = cast<heart::AssignFromValue> (*s);
+
+                if (a != nullptr && isCandidateForReuse (*a))
+                {
+                    for (auto& v : available)
+                    {
+                        if (areIdentical (v.value, a->source)
+                             && v.variable->getType().isEqual (a->target->getType(), Type::ignoreConst))
+                        {
+                            a->source = v.variable.get();
+                            anyChanged = true;
+                            break;
+                        }
+                    }
+                }
+
+                visitVariablesWritten (*s, [&] (heart::Variable& written)
+                {
+                    removeIf (available, [&] (AvailableValue& v)
+                    {
+                        return v.variable == written || v.value->readsVariable (written);
+                    });
+                });
+
+                if (a != nullptr && isCandidateForReuse (*a))
+                    if (auto target = cast<heart::Variable> (a->target))
+                        if (isLocalValue (*target) && ! a->source->readsVariable (*target))
+                            available.push_back ({ *target, a->source });
+            }
+        }
+
+        return anyChanged;
+    }
+    //==============================================================================
+    using BlockSet = std::vector<bool>;
+
+    static size_t getBlockIndex (heart::Function& f, heart::Block& b)
+    {
+        for (size_t i = 0; i < f.blocks.size(); ++i)
+            if (f.blocks[i] == b)
+                return i;
+
+        SOUL_ASSERT_FALSE;
+        return 0;
+    }
+
+    /** Returns, for each block, the set of blocks which dominate it */
+    static std::vector<BlockSet> findDominators (heart::Function& f)
+    {
+        auto numBlocks = f.blocks.size();
+        std::vector<BlockSet> dominators (numBlocks, BlockSet (numBlocks, true));
+        std::vector<std::vector<size_t>> predecessors (numBlocks);
+
+        for (size_t i = 0; i < numBlocks; ++i)
+            for (auto pred : f.blocks[i]->predecessors)
+                predecessors[i].push_back (getBlockIndex (f, pred));
+
+        dominators[0] = BlockSet (numBlocks, false);
+        dominators[0][0] = true;
+
+        for (bool anyChanged = true; anyChanged;)
+        {
+            anyChanged = false;
+
+            for (size_t i = 1; i < numBlocks; ++i)
+            {
+                BlockSet newSet (numBlocks, ! predecessors[i].empty());
+
+                for (auto pred : predecessors[i])
+                    for (size_t j = 0; j < numBlocks; ++j)
+                        newSet[j] = newSet[j] && dominators[pred][j];
+
+                newSet[i] = true;
+
+                if (newSet != dominators[i])
+                {
+                    dominators[i] = std::move (newSet);
+                    anyChanged = true;
+                }
+            }
+        }
+
+        return dominators;
+    }
+
+    /** Returns the blocks in the natural loop headed by the given block, or an empty set if
+        it's not the target of any back-edges.
+    */
+    static BlockSet findLoopBlocks (heart::Function& f, size_t header, const std::vector<BlockSet>& dominators)
+    {
+        BlockSet loop;
+        std::vector<size_t> blocksToVisit;
+
+        for (auto pred : f.blocks[header]->predecessors)
+        {
+            auto predIndex = getBlockIndex (f, pred);
+
+            if (dominators[predIndex][header])
+            {
+                if (loop.empty())
+                {
+                    loop = BlockSet (f.blocks.size(), false);
+                    loop[header] = true;
+                }
+
+                blocksToVisit.push_back (predIndex);
+            }
+        }
+
+        while (! blocksToVisit.empty())
+        {
+            auto index = blocksToVisit.back();
+            blocksToVisit.pop_back();
+
+            if (! loop[index])
+            {
+                loop[index] = true;
+
+                for (auto pred : f.blocks[index]->predecessors)
+                    blocksToVisit.push_back (getBlockIndex (f, pred));
+            }
+        }
+
+        return loop;
+    }
+
+    /** Finds the single block outside the loop which jumps unconditionally to its header */
+    static pool_ptr<heart::Block> findPreheader (heart::Function& f, size_t header, const BlockSet& loop)
+    {
+        pool_ptr<heart::Block> preheader;
+
+        for (auto pred : f.blocks[header]->predecessors)
+        {
+            if (! loop[getBlockIndex (f, pred)])
+            {
+                if (preheader != nullptr || ! is_type<heart::Branch> (pred->terminator))
+                    return {};
+
+                preheader = pred;
+            }
+        }
+
+        return preheader;
+    }
+
+    /** True if evaluating the expression can't fail, so it's safe to execute it even on a
+        path where the loop body is never entered.
+    */
+    static bool canBeSpeculated (heart::Expression& e)
+    {
+        if (auto b = cast<heart::BinaryOperator> (e))
+        {
+            if (b->operation == BinaryOp::Op::divide || b->operation == BinaryOp::Op::modulo)
+                if (! (b->getType().isPrimitive() && b->getType().isFloatingPoint()))
+                    return false;
+
+            return canBeSpeculated (b->lhs) && canBeSpeculated (b->rhs);
+        }
+
+        if (auto u = cast<heart::UnaryOperator> (e))  return canBeSpeculated (u->source);
+        if (auto t = cast<heart::TypeCast> (e))       return canBeSpeculated (t->source);
+
+        return true;
+    }
+
+    static bool readsAnyOf (heart::Expression& e, const std::vector<pool_ref<heart::Variable>>& variables)
+    {
+        for (auto& v : variables)
+            if (e.readsVariable (v))
+                return true;
+
+        return false;
+    }
+
+    static bool canBeHoisted (heart::Statement& s, const std::vector<pool_ref<heart::Variable>>& variablesWrittenInLoop)
+    {
+        if (auto a = cast<heart::AssignFromValue> (s))
+            if (auto target = getSSAValue (a->target))
+                return isCandidateForReuse (*a)
+                        && canBeSpeculated (a->source)
+                        && ! readsAnyOf (a->source, variablesWrittenInLoop);
+
+        return false;
+    }
+
+    /** Moves statements whose results can't change between iterations of a loop into the
+        block which precedes it. Only loops with a single, unconditional entry are handled.
+    */
+    static bool hoistLoopInvariants (heart::Function& f)
+    {
+        f.rebuildBlockPredecessors();
+        f.rebuildVariableUseCounts();
+
+        auto dominators = findDominators (f);
+        bool anyChanged = false;
+
+        for (size_t header = 0; header < f.blocks.size(); ++header)
+        {
+            auto loop = findLoopBlocks (f, header, dominators);
+
+            if (loop.empty())
+                continue;
+
+            auto preheader = findPreheader (f, header, loop);
+
+            if (preheader == nullptr)
+                continue;
+
+            std::vector<pool_ref<heart::Variable>> variablesWrittenInLoop;
+
+            for (size_t i = 0; i < f.blocks.size(); ++i)
+            {
+                if (loop[i])
+                {
+                    for (auto& p : f.blocks[i]->parameters)
+                        variablesWrittenInLoop.push_back (p);
+
+                    for (auto s : f.blocks[i]->statements)
+                        visitVariablesWritten (*s, [&] (heart::Variable& v) { variablesWrittenInLoop.push_back (v); });
+                }
+            }
+
+            // Each statement that gets hoisted may allow others which use its result to follow it
+            for (bool anyHoisted = true; anyHoisted;)
+            {
+                anyHoisted = false;
+
+                for (size_t i = 0; i < f.blocks.size(); ++i)
+                {
+                    if (! loop[i])
+                        continue;
+
+                    std::vector<pool_ref<heart::Statement>> statementsToHoist;
+
+                    for (auto s : f.blocks[i]->statements)
+                    {
+                        if (canBeHoisted (*s, variablesWrittenInLoop))
+                        {
+                            statementsToHoist.push_back (*s);
+                            auto& target = *cast<heart::AssignFromValue> (*s)->target->getRootVariable();
+                            removeIf (variablesWrittenInLoop, [&] (pool_ref<heart::Variable>& v) { return v == target; });
+                        }
+                    }
+
+                    if (statementsToHoist.empty())
+                        continue;
+
+                    f.blocks[i]->statements.removeMatches ([&] (heart::Statement& s) { return contains (statementsToHoist, s); });
+
+                    for (auto& s : statementsToHoist)
+                        preheader->statements.insertAfter (preheader->statements.getLast(), s);
+
+                    anyHoisted = true;
+                    anyChanged = true;
+                }
+            }
+        }
+
+        return anyChanged;
+    }
+};
+
+} // namespace soul
@@ -309,6 +309,52 @@ struct heart::Utilities
         return {};
     }
 
+    /** Finds which of an event endpoint's types a value of the given type corresponds to.
+        Different structs can share a layout (e.g. NoteOn and NoteOff), and the same struct
+        can be represented by different objects in different modules, so structs are matched
+        by their fully-qualified name as well as layout, and only other types can fall back
+        to a layout match. If more than one type matches, it's ambiguous and an error is thrown.
+    */
+    static std::optional<size_t> findMatchingEndpointType (const Program& program, const Type& type,
+                                                           const std::vector<Type>& endpointTypes,
+                                                           const CodeLocation& location)
+    {
+        std::vector<size_t> matches;
+
+        auto findMatches = [&] (auto&& isMatch)
+        {
+            for (size_t i = 0; i < endpointTypes.size(); ++i)
+                if (isMatch (endpointTypes[i]))
+                    matches.push_back (i);
+
+            return ! matches.empty();
+        };
+
+        auto layoutsMatch = [&] (const Type& t)
+        {
+            return type.isEqual (t, Type::ignoreReferences | Type::ignoreConst
+                                     | Type::ignoreVectorSize1 | Type::duckTypeStructures);
+        };
+
+        auto isExactMatch = [&] (const Type& t)  { return type.isEqual (t, Type::ignoreReferences | Type::ignoreConst); };
+
+        auto isSameStruct = [&] (const Type& t)
+        {
+            return t.isStruct() && layoutsMatch (t)
+                    && program.getFullyQualifiedStructName (t.getStructRef()) == program.getFullyQualifiedStructName (type.getStructRef());
+        };
+
+        auto isSameLayout = [&] (const Type& t)  { return ! t.isStruct() && layoutsMatch (t); };
+
+        if (! (findMatches (isExactMatch) || (type.isStruct() ? findMatches (isSameStruct) : findMatches (isSameLayout))))
+            return {};
+
+        if (matches.size() > 1)
+            location.throwError (Errors::ambiguousTypeForEndpoint (type.getDescription()));
+
+        return matches.front();
+    }
+
     static Type replaceUsesOfStruct (Type type, Structure& oldStruct, Structure& newStruct)
     {
         if (type.isArray())
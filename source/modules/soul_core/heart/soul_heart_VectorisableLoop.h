@@ -0,0 +1,165 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/**
+    Finds a per-sample loop in a run() function whose iterations are independent of
+    each other, so that a backend can choose to process a block of frames at a time.
+
+    The loop must be a single block which reads and writes streams, then advances and
+    branches back to itself. Within it, the only variables that may be written are
+    function locals, each assigned once and not read before that assignment, so nothing
+    is carried from one frame to the next. Everything else that it reads (state, value
+    inputs, locals from before the loop) can't change until run() is next suspended,
+    so can be treated as constant across any frames that are processed together.
+*/
+struct VectorisableLoop
+{
+    static std::optional<VectorisableLoop> find (heart::Function& f)
+    {
+        if (! f.functionType.isRun())
+            return {};
+
+        for (auto& b : f.blocks)
+            if (isSelfContainedLoop (b))
+                return check (b);
+
+        return {};
+    }
+
+    /** Returns true if the expression's value may be different for each frame. */
+    bool isPerFrame (heart::Expression& e) const
+    {
+        for (auto& v : perFrameVariables)
+            if (e.readsVariable (v))
+                return true;
+
+        return false;
+    }
+
+    heart::Block& block;
+    std::vector<pool_ref<heart::Variable>> perFrameVariables;
+
+private:
+    VectorisableLoop (heart::Block& b) : block (b) {}
+
+    static bool isSelfContainedLoop (heart::Block& b)
+    {
+        if (auto branch = cast<heart::Branch> (b.terminator))
+            return std::addressof (branch->target.get()) == std::addressof (b)
+                    && branch->targetArgs.empty() && b.parameters.empty();
+
+        return false;
+    }
+
+    static std::optional<VectorisableLoop> check (heart::Block& b)
+    {
+        VectorisableLoop loop (b);
+        bool hasAdvanced = false;
+
+        for (auto s : b.statements)
+        {
+            // the advance must be the last statement
+            if (hasAdvanced)
+                return {};
+
+            if (is_type<heart::AdvanceClock> (*s))
+            {
+                hasAdvanced = true;
+                continue;
+            }
+
+            if (! loop.addStatement (*s))
+                return {};
+        }
+
+        if (! hasAdvanced)
+            return {};
+
+        return loop;
+    }
+
+    bool addStatement (heart::Statement& s)
+    {
+        if (auto r = cast<heart::ReadStream> (s))
+            return ! r->source->isEventEndpoint() && isConstantIndex (r->element) && addTarget (r->target);
+
+        if (auto a = cast<heart::AssignFromValue> (s))
+            return isDefined (a->source) && addTarget (a->target);
+
+        if (auto w = cast<heart::WriteStream> (s))
+            return w->target->isStreamEndpoint() && isConstantIndex (w->element) && isDefined (w->value);
+
+        if (auto call = cast<heart::FunctionCall> (s))
+        {
+            auto& f = call->getFunction();
+
+            if (call->mayHaveSideEffects() || heart::Utilities::findFirstAdvanceCall (f) != nullptr)
+                return false;
+
+            for (size_t i = 0; i < call->arguments.size(); ++i)
+                if (f.parameters[i]->type.isReference() || ! isDefined (call->arguments[i]))
+                    return false;
+
+            return call->target == nullptr || addTarget (call->target);
+        }
+
+        return false;
+    }
+
+    bool addTarget (pool_ptr<heart::Expression> target)
+    {
+        if (auto v = cast<heart::Variable> (target))
+        {
+            if (v->isFunctionLocal() && ! v->type.isReference() && ! isPerFrame (*v))
+            {
+                perFrameVariables.push_back (*v);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // A value computed in this loop is only available once it has been assigned, and if any
+    // variable is read before that, it's holding a value from the previous frame.
+    bool isDefined (heart::Expression& e) const
+    {
+        for (auto s : block.statements)
+        {
+            if (auto a = cast<heart::Assignment> (*s))
+                if (auto v = cast<heart::Variable> (a->target))
+                    if (e.readsVariable (*v) && ! isPerFrame (*v))
+                        return false;
+        }
+
+        return true;
+    }
+
+    static bool isConstantIndex (pool_ptr<heart::Expression> index)
+    {
+        return index == nullptr || index->getAsConstant().isValid();
+    }
+};
+
+} // namespace soul
@@ -0,0 +1,834 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#if ! SOUL_INSIDE_CORE_CPP
+ #error "Don't add this cpp file to your build, it gets included indirectly by soul_core.cpp"
+#endif
+
+#include "soul_InterpreterBytecode.h"
+#include "soul_InterpreterCompiler.h"
+#include "soul_InterpreterProcessor.h"
+#include "soul_InterpreterGraph.h"
+
+namespace soul::interpreter
+{
+
+//==============================================================================
+class InterpreterPerformer  : public Performer
+{
+public:
+    InterpreterPerformer() = default;
+    ~InterpreterPerformer() override { unload(); }
+
+    bool load (CompileMessageList& messageList, const Program& programToLoad) noexcept override
+    {
+        unload();
+
+        try
+        {
+            CompileMessageHandler handler (messageList);
+            auto& mainProcessor = programToLoad.getMainProcessor();
+
+            for (auto& i : mainProcessor.inputs)   inputDetails.push_back (i->getDetails());
+            for (auto& o : mainProcessor.outputs)  outputDetails.push_back (o->getDetails());
+
+            for (auto& i : mainProcessor.inputs)   inputAttachments.push_back ({ canAttachBuffer (i) });
+            for (auto& o : mainProcessor.outputs)  outputAttachments.push_back ({ canAttachBuffer (o) });
+
+            for (auto& v : programToLoad.getExternalVariables())
+                externals.push_back ({ programToLoad.getExternalVariableName (v), v->type.getExternalType(),
+                                       v->annotation.toExternalValue() });
+
+            externalValues.resize (externals.size());
+            program = programToLoad;
+            return true;
+        }
+        catch (AbortCompilationException) {}
+
+        unload();
+        return false;
+    }
+
+    void unload() noexcept override
+    {
+        unlink();
+        program = {};
+        inputDetails.clear();
+        outputDetails.clear();
+        inputAttachments.clear();
+        outputAttachments.clear();
+        externals.clear();
+        externalValues.clear();
+        activeEndpoints.clear();
+    }
+
+    ArrayView<const EndpointDetails> getInputEndpoints() noexcept override      { return inputDetails; }
+    ArrayView<const EndpointDetails> getOutputEndpoints() noexcept override     { return outputDetails; }
+    ArrayView<const ExternalVariable> getExternalVariables() noexcept override  { return externals; }
+
+    bool setExternalVariable (const char* name, const choc::value::ValueView& value) noexcept override
+    {
+        for (size_t i = 0; i < externals.size(); ++i)
+        {
+            if (externals[i].name == name)
+            {
+                externalValues[i] = choc::value::Value (value);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool link (CompileMessageList& messageList, const BuildSettings& settings, LinkerCache*) noexcept override
+    {
+        if (! isLoaded())
+            return false;
+
+        unlink();
+
+        try
+        {
+            CompileMessageHandler handler (messageList);
+            checkBuildSettings (settings);
+            buildSettings = settings;
+            blockSize = settings.maxBlockSize != 0 ? settings.maxBlockSize : defaultBlockSize;
+
+            linkedProgram = program.clone();
+            resolveExternals();
+
+            auto& mainProcessor = linkedProgram.getMainProcessor();
+            latency = DelayCompensation::apply (mainProcessor);
+
+            {
+                SOUL_LOG_TIME_OF_SCOPE ("interpreter: compile modules");
+
+                for (auto& m : linkedProgram.getModules())
+                    if (m->isProcessor())
+                        modules.push_back (ModuleCompiler::compile (linkedProgram, m, arrayStorage));
+            }
+
+            {
+                SOUL_LOG_TIME_OF_SCOPE ("interpreter: build graph");
+                graph = std::make_unique<Graph> (linkedProgram, modules, blockSize, std::max (blockSize, minEventQueueSize));
+                graph->build (mainProcessor);
+            }
+
+            createEndpointStates (mainProcessor);
+            linked = true;
+            reset();
+            return true;
+        }
+        catch (AbortCompilationException) {}
+
+        unlink();
+        return false;
+    }
+
+    bool isLoaded() noexcept override     { return ! program.isEmpty(); }
+    bool isLinked() noexcept override     { return linked; }
+
+    void reset() noexcept override
+    {
+        if (! linked)
+            return;
+
+        graph->reset (buildSettings.sampleRate, buildSettings.sessionID);
+
+        for (auto& i : inputs)
+        {
+            i.framesProvided = false;
+            i.isSparse = false;
+            i.sparseFramesRemaining = 0;
+            std::fill (i.sparseValue.begin(), i.sparseValue.end(), 0.0);
+        }
+
+        numFramesPrepared = 0;
+        xruns = 0;
+    }
+
+    EndpointHandle getEndpointHandle (const EndpointID& endpointID) noexcept override
+    {
+        for (uint32_t i = 0; i < inputDetails.size(); ++i)
+        {
+            if (inputDetails[i].endpointID == endpointID)
+            {
+                appendIfNotPresent (activeEndpoints, endpointID);
+                return EndpointHandle::create (inputDetails[i].endpointType, i + 1);
+            }
+        }
+
+        for (uint32_t i = 0; i < outputDetails.size(); ++i)
+        {
+            if (outputDetails[i].endpointID == endpointID)
+            {
+                appendIfNotPresent (activeEndpoints, endpointID);
+                return EndpointHandle::create (outputDetails[i].endpointType, outputHandleBase + i + 1);
+            }
+        }
+
+        return {};
+    }
+
+    bool isEndpointActive (const EndpointID& endpointID) noexcept override
+    {
+        return contains (activeEndpoints, endpointID);
+    }
+
+    //==============================================================================
+    void prepare (uint32_t numFramesToBeRendered) noexcept override
+    {
+        SOUL_ASSERT (linked && numFramesToBeRendered <= blockSize);
+        numFramesPrepared = std::min (numFramesToBeRendered, blockSize);
+        graph->removeOutputEvents();
+
+        for (auto& i : inputs)
+            i.framesProvided = false;
+    }
+
+    void setNextInputStreamFrames (EndpointHandle handle, const choc::value::ValueView& frameArray) noexcept override
+    {
+        if (auto input = getInput (handle))
+        {
+            if (! input->declaration.isStreamEndpoint())
+                return;
+
+            auto& frameType = input->externalTypes.front();
+            auto frameSize = (size_t) input->frameSize;
+            auto& sourceType = frameArray.getType();
+            auto numFrames = std::min (numFramesPrepared, isArrayOrVector (sourceType) ? sourceType.getNumElements() : 1u);
+
+            if (isArrayOrVector (sourceType) && sourceType.getElementType() == frameType)
+            {
+                memcpy (input->streamFrames.data(), frameArray.getRawData(), numFrames * frameSize);
+            }
+            else if (! convertToFrames (*input, frameArray, numFrames))
+            {
+                ++xruns;
+                return;
+            }
+
+            if (numFrames < numFramesPrepared)
+            {
+                memset (input->streamFrames.data() + numFrames * frameSize, 0, (numFramesPrepared - numFrames) * frameSize);
+                ++xruns;
+            }
+
+            input->framesProvided = true;
+            input->isSparse = false;
+        }
+    }
+
+    void setSparseInputStreamTarget (EndpointHandle handle, const choc::value::ValueView& targetFrameValue,
+                                     uint32_t numFramesToReachValue) noexcept override
+    {
+        if (auto input = getInput (handle))
+        {
+            if (! input->declaration.isStreamEndpoint() || ! input->frameFlatType.has_value())
+                return;
+
+            if (! convertValue (*input, 0, targetFrameValue, input->scratch.data()))
+                return;
+
+            auto& flat = *input->frameFlatType;
+            bool canRamp = flat.kind == ValueKind::f32 || flat.kind == ValueKind::f64;
+
+            if (! input->isSparse)
+                readElements (flat, input->streamFrames.data() + (numFramesPrepared > 0 ? (numFramesPrepared - 1) * input->frameSize : 0),
+                              input->sparseValue);
+
+            readElements (flat, input->scratch.data(), input->sparseTarget);
+
+            input->isSparse = true;
+            input->sparseFramesRemaining = canRamp ? numFramesToReachValue : 0;
+
+            if (input->sparseFramesRemaining == 0)
+                input->sparseValue = input->sparseTarget;
+
+            for (size_t i = 0; i < input->sparseTarget.size(); ++i)
+                input->sparseIncrement[i] = input->sparseFramesRemaining == 0 ? 0.0
+                                              : (input->sparseTarget[i] - input->sparseValue[i]) / input->sparseFramesRemaining;
+        }
+    }
+
+    void setInputValue (EndpointHandle handle, const choc::value::ValueView& newValue) noexcept override
+    {
+        if (auto input = getInput (handle))
+            if (input->declaration.isValueEndpoint())
+                if (! convertValue (*input, 0, newValue, graph->getInputValue (input->index)))
+                    ++xruns;
+    }
+
+    void addInputEvent (EndpointHandle handle, const choc::value::ValueView& eventData) noexcept override
+    {
+        if (auto input = getInput (handle))
+        {
+            if (! input->declaration.isEventEndpoint())
+                return;
+
+            for (uint32_t typeIndex = 0; typeIndex < input->externalTypes.size(); ++typeIndex)
+            {
+                if (input->externalTypes[typeIndex] == eventData.getType()
+                     || (typeIndex == input->externalTypes.size() - 1))
+                {
+                    auto typeToUse = input->externalTypes[typeIndex] == eventData.getType() ? typeIndex : 0u;
+
+                    if (convertValue (*input, typeToUse, eventData, input->scratch.data()))
+                        graph->addInputEvent (input->index, 0, typeToUse, input->scratch.data(),
+                                              getSizeInBytes (input->declaration.dataTypes[typeToUse]));
+                    else
+                        ++xruns;
+
+                    return;
+                }
+            }
+        }
+    }
+
+    choc::value::ValueView getOutputStreamFrames (EndpointHandle handle) noexcept override
+    {
+        if (auto output = getOutput (handle))
+            if (output->declaration.isStreamEndpoint())
+                return choc::value::ValueView (choc::value::Type::createArray (output->externalTypes.front(), numFramesPrepared),
+                                               const_cast<uint8_t*> (graph->getOutputStreamFrames (output->index)),
+                                               std::addressof (linkedProgram.getStringDictionary()));
+
+        return {};
+    }
+
+    choc::value::ValueView getOutputValue (EndpointHandle handle) noexcept override
+    {
+        if (auto output = getOutput (handle))
+            if (output->declaration.isValueEndpoint())
+                return choc::value::ValueView (output->externalTypes.front(),
+                                               const_cast<uint8_t*> (graph->getOutputValue (output->index)),
+                                               std::addressof (linkedProgram.getStringDictionary()));
+
+        return {};
+    }
+
+    void iterateOutputEvents (EndpointHandle handle, HandleNextOutputEventFn callback) noexcept override
+    {
+        if (auto output = getOutput (handle))
+        {
+            if (output->declaration.isEventEndpoint())
+            {
+                auto dictionary = std::addressof (linkedProgram.getStringDictionary());
+
+                graph->iterateOutputEvents (output->index, [&] (uint32_t frame, uint32_t typeIndex, const uint8_t* data)
+                {
+                    return callback (frame, choc::value::ValueView (output->externalTypes[typeIndex],
+                                                                    const_cast<uint8_t*> (data), dictionary));
+                });
+            }
+        }
+    }
+
+    //==============================================================================
+    uint32_t getEventRecordSize (EndpointHandle handle) noexcept override
+    {
+        if (auto details = findAttachment (handle).first)
+        {
+            if (isEvent (*details))
+            {
+                size_t maxDataSize = 0;
+
+                for (auto& t : details->dataTypes)
+                    maxDataSize = std::max (maxDataSize, t.getValueDataSize());
+
+                return (uint32_t) getAlignedSize<8> (sizeof (EventRecordHeader) + maxDataSize);
+            }
+        }
+
+        return 0;
+    }
+
+    bool attachStreamBuffer (EndpointHandle handle, void* frames) noexcept override
+    {
+        auto [details, attachment] = findAttachment (handle);
+
+        if (details == nullptr || ! isStream (*details) || ! attachment->canAttach)
+            return false;
+
+        attachment->frames = static_cast<uint8_t*> (frames);
+        return true;
+    }
+
+    bool attachEventBuffer (EndpointHandle handle, EventBuffer* buffer) noexcept override
+    {
+        auto [details, attachment] = findAttachment (handle);
+
+        if (details == nullptr || ! isEvent (*details) || ! attachment->canAttach
+             || (buffer != nullptr && buffer->recordSize < getEventRecordSize (handle)))
+            return false;
+
+        attachment->events = buffer;
+        return true;
+    }
+
+    void advance() noexcept override
+    {
+        SOUL_ASSERT (linked);
+
+        for (auto& i : inputs)
+        {
+            auto& attachment = inputAttachments[i.index];
+
+            if (i.declaration.isEventEndpoint())
+            {
+                if (attachment.events != nullptr)
+                    dispatchAttachedEvents (i, *attachment.events);
+
+                continue;
+            }
+
+            if (! i.declaration.isStreamEndpoint())
+                continue;
+
+            if (attachment.frames != nullptr && ! i.framesProvided && ! i.isSparse)
+            {
+                graph->setInputStreamFrames (i.index, attachment.frames);
+                continue;
+            }
+
+            if (i.isSparse && ! i.framesProvided)
+            {
+                renderSparseFrames (i);
+                i.framesProvided = true;
+            }
+
+            graph->setInputStreamFrames (i.index, i.framesProvided ? i.streamFrames.data() : nullptr);
+        }
+
+        graph->render (numFramesPrepared);
+
+        for (auto& o : outputs)
+        {
+            auto& attachment = outputAttachments[o.index];
+
+            if (attachment.frames != nullptr)
+                memcpy (attachment.frames, graph->getOutputStreamFrames (o.index), (size_t) o.frameSize * numFramesPrepared);
+            else if (attachment.events != nullptr)
+                collectOutputEvents (o, *attachment.events);
+        }
+    }
+
+    uint32_t getLatency() noexcept override       { return latency; }
+    uint32_t getXRuns() noexcept override         { return xruns + (graph != nullptr ? graph->getXRuns() : 0); }
+    uint32_t getBlockSize() noexcept override     { return blockSize; }
+    bool hasError() noexcept override             { return false; }
+    const char* getError() noexcept override      { return nullptr; }
+
+private:
+    //==============================================================================
+    struct EndpointState
+    {
+        EndpointState (const heart::IODeclaration& io, uint32_t i) : declaration (io), index (i) {}
+
+        const heart::IODeclaration& declaration;
+        uint32_t index;
+        std::vector<choc::value::Type> externalTypes;
+        std::vector<bool> needsConversion;
+        std::optional<FlatType> frameFlatType;
+        uint32_t frameSize = 0;
+
+        // Used for input streams
+        std::vector<uint8_t> streamFrames, scratch;
+        bool framesProvided = false, isSparse = false;
+        std::vector<double> sparseValue, sparseTarget, sparseIncrement;
+        uint32_t sparseFramesRemaining = 0;
+    };
+
+    /** A buffer that the caller has attached to an endpoint. These are set up after loading,
+        so they're kept separately from the EndpointStates, which only exist while linked.
+    */
+    struct BufferAttachment
+    {
+        bool canAttach = false;
+        uint8_t* frames = nullptr;
+        EventBuffer* events = nullptr;
+    };
+
+    static constexpr uint32_t defaultBlockSize = 1024;
+    static constexpr uint32_t minEventQueueSize = 256;
+    static constexpr uint32_t outputHandleBase = 0x10000;
+
+    Program program, linkedProgram;
+    std::vector<EndpointDetails> inputDetails, outputDetails;
+    std::vector<BufferAttachment> inputAttachments, outputAttachments;
+    std::vector<ExternalVariable> externals;
+    std::vector<choc::value::Value> externalValues;
+    std::vector<EndpointID> activeEndpoints;
+
+    BuildSettings buildSettings;
+    UnsizedArrayStorage arrayStorage;
+    std::vector<std::unique_ptr<CompiledModule>> modules;
+    std::unique_ptr<Graph> graph;
+    std::vector<EndpointState> inputs, outputs;
+    uint32_t blockSize = 0, numFramesPrepared = 0, latency = 0, xruns = 0;
+    bool linked = false;
+
+    //==============================================================================
+    void unlink()
+    {
+        linked = false;
+        graph.reset();
+        modules.clear();
+        arrayStorage.blocks.clear();
+        inputs.clear();
+        outputs.clear();
+        linkedProgram = {};
+        numFramesPrepared = 0;
+        latency = 0;
+        xruns = 0;
+    }
+
+    static void checkBuildSettings (const BuildSettings& settings)
+    {
+        if (settings.maxBlockSize > 65536)
+            CodeLocation().throwError (Errors::unsupportedBlockSize());
+
+        if (settings.sampleRate <= 0 || settings.sampleRate > 48000.0 * 100)
+            CodeLocation().throwError (Errors::unsupportedSampleRate());
+    }
+
+    void resolveExternals()
+    {
+        for (auto& v : linkedProgram.getExternalVariables())
+        {
+            auto name = linkedProgram.getExternalVariableName (v);
+
+            for (size_t i = 0; i < externals.size(); ++i)
+            {
+                if (externals[i].name == name)
+                {
+                    if (externalValues[i].isVoid())
+                        v->location.throwError (Errors::unresolvedExternal (name));
+
+                    auto value = Value::fromExternalValue (v->type, externalValues[i],
+                                                           linkedProgram.getConstantTable(),
+                                                           linkedProgram.getStringDictionary());
+
+                    v->initialValue = linkedProgram.getAllocator().allocate<heart::Constant> (v->location, std::move (value));
+                }
+            }
+        }
+    }
+
+    static bool isArrayOrVector (const choc::value::Type& t)   { return t.isArray() || t.isVector(); }
+
+    static bool typeNeedsConversion (const Type& type)
+    {
+        if (type.isStringLiteral() || type.isUnsizedArray())
+            return true;
+
+        if (type.isStruct())
+        {
+            auto& s = type.getStructRef();
+
+            for (size_t i = 0; i < s.getNumMembers(); ++i)
+                if (typeNeedsConversion (s.getMemberType (i)))
+                    return true;
+        }
+
+        if (type.isFixedSizeArray())
+            return typeNeedsConversion (type.getArrayElementType());
+
+        return false;
+    }
+
+    void createEndpointStates (Module& mainProcessor)
+    {
+        auto initialise = [] (EndpointState& e)
+        {
+            auto& io = e.declaration;
+            uint32_t maxSize = 1;
+
+            for (auto& t : io.dataTypes)
+            {
+                auto type = io.isEventEndpoint() ? t : io.getFrameOrValueType();
+                e.externalTypes.push_back (type.getExternalType());
+                e.needsConversion.push_back (typeNeedsConversion (type));
+                maxSize = std::max (maxSize, getSizeInBytes (type));
+            }
+
+            e.scratch.resize (maxSize);
+
+            if (io.isStreamEndpoint())
+            {
+                e.frameSize = getSizeInBytes (io.getFrameType());
+                e.frameFlatType = getFlatType (io.getFrameType());
+
+                if (e.frameFlatType.has_value())
+                {
+                    e.sparseValue.resize (e.frameFlatType->numElements);
+                    e.sparseTarget.resize (e.frameFlatType->numElements);
+                    e.sparseIncrement.resize (e.frameFlatType->numElements);
+                }
+            }
+        };
+
+        for (uint32_t i = 0; i < mainProcessor.inputs.size(); ++i)
+        {
+            inputs.emplace_back (mainProcessor.inputs[i].get(), i);
+            initialise (inputs.back());
+
+            if (inputs.back().declaration.isStreamEndpoint())
+                inputs.back().streamFrames.resize ((size_t) inputs.back().frameSize * blockSize);
+        }
+
+        for (uint32_t i = 0; i < mainProcessor.outputs.size(); ++i)
+        {
+            outputs.emplace_back (mainProcessor.outputs[i].get(), i);
+            initialise (outputs.back());
+        }
+    }
+
+    static bool canAttachBuffer (const heart::IODeclaration& io)
+    {
+        if (io.isEventEndpoint())
+        {
+            for (auto& t : io.dataTypes)
+                if (typeNeedsConversion (t))
+                    return false;
+
+            return true;
+        }
+
+        return io.isStreamEndpoint() && ! typeNeedsConversion (io.getFrameType());
+    }
+
+    std::pair<const EndpointDetails*, BufferAttachment*> findAttachment (EndpointHandle handle)
+    {
+        auto raw = handle.getRawHandle();
+
+        if (raw > 0 && raw <= inputDetails.size())
+            return { std::addressof (inputDetails[raw - 1]), std::addressof (inputAttachments[raw - 1]) };
+
+        if (raw > outputHandleBase && raw <= outputHandleBase + outputDetails.size())
+            return { std::addressof (outputDetails[raw - outputHandleBase - 1]), std::addressof (outputAttachments[raw - outputHandleBase - 1]) };
+
+        return {};
+    }
+
+    void dispatchAttachedEvents (EndpointState& input, EventBuffer& buffer)
+    {
+        auto record = static_cast<const uint8_t*> (buffer.records);
+
+        for (uint32_t i = 0; i < buffer.numEvents; ++i, record += buffer.recordSize)
+        {
+            auto header = readUnaligned<EventRecordHeader> (record);
+
+            if (header.typeIndex < input.declaration.dataTypes.size() && header.frameOffset < numFramesPrepared)
+                graph->addInputEvent (input.index, header.frameOffset, header.typeIndex, record + sizeof (EventRecordHeader),
+                                      getSizeInBytes (input.declaration.dataTypes[header.typeIndex]));
+            else
+                ++xruns;
+        }
+
+        buffer.numEvents = 0;
+    }
+
+    void collectOutputEvents (EndpointState& output, EventBuffer& buffer)
+    {
+        buffer.numEvents = 0;
+
+        graph->iterateOutputEvents (output.index, [&] (uint32_t frame, uint32_t typeIndex, const uint8_t* data)
+        {
+            if (buffer.numEvents == buffer.capacity)
+            {
+                ++xruns;
+                return false;
+            }
+
+            auto record = static_cast<uint8_t*> (buffer.records) + (size_t) buffer.numEvents * buffer.recordSize;
+            writeUnaligned (record, EventRecordHeader { frame, typeIndex });
+            memcpy (record + sizeof (EventRecordHeader), data, getSizeInBytes (output.declaration.dataTypes[typeIndex]));
+            ++buffer.numEvents;
+            return true;
+        });
+    }
+
+    EndpointState* getInput (EndpointHandle handle)
+    {
+        auto raw = handle.getRawHandle();
+
+        if (linked && raw > 0 && raw <= inputs.size())
+            return std::addressof (inputs[raw - 1]);
+
+        return {};
+    }
+
+    EndpointState* getOutput (EndpointHandle handle)
+    {
+        auto raw = handle.getRawHandle();
+
+        if (linked && raw > outputHandleBase && raw <= outputHandleBase + outputs.size())
+            return std::addressof (outputs[raw - outputHandleBase - 1]);
+
+        return {};
+    }
+
+    //==============================================================================
+    /** Writes an external value into the packed layout that the program uses. */
+    bool convertValue (EndpointState& endpoint, uint32_t typeIndex, const choc::value::ValueView& source, uint8_t* dest)
+    {
+        if (! endpoint.needsConversion[typeIndex] && source.getType() == endpoint.externalTypes[typeIndex])
+        {
+            memcpy (dest, source.getRawData(), source.getType().getValueDataSize());
+            return true;
+        }
+
+        try
+        {
+            CompileMessageList messages;
+            CompileMessageHandler handler (messages);
+
+            auto& io = endpoint.declaration;
+            auto type = io.isEventEndpoint() ? io.dataTypes[typeIndex] : io.getFrameOrValueType();
+            auto value = Value::fromExternalValue (type, source, linkedProgram.getConstantTable(),
+                                                   linkedProgram.getStringDictionary());
+
+            memcpy (dest, value.getPackedData(), value.getPackedDataSize());
+            resolveUnsizedArrays (dest, type);
+            return true;
+        }
+        catch (AbortCompilationException) {}
+
+        return false;
+    }
+
+    void resolveUnsizedArrays (uint8_t* data, const Type& type)
+    {
+        if (type.isUnsizedArray())
+        {
+            auto handle = readUnaligned<ConstantTable::Handle> (data);
+            auto elementType = type.getArrayElementType();
+            auto elementSize = elementType.getPackedSizeInBytes();
+            uint8_t* array;
+
+            if (auto v = linkedProgram.getConstantTable().getValueForHandle (handle))
+            {
+                array = arrayStorage.allocate (v->getType().getArraySize(), elementSize);
+                memcpy (array, v->getPackedData(), v->getPackedDataSize());
+            }
+            else
+            {
+                array = arrayStorage.allocate (0, elementSize);
+            }
+
+            writeUnaligned (data, array);
+        }
+        else if (type.isStruct())
+        {
+            auto& s = type.getStructRef();
+
+            for (size_t i = 0; i < s.getNumMembers(); ++i)
+                resolveUnsizedArrays (data + getStructMemberOffset (s, i), s.getMemberType (i));
+        }
+        else if (type.isFixedSizeArray())
+        {
+            auto elementType = type.getArrayElementType();
+            auto elementSize = elementType.getPackedSizeInBytes();
+
+            for (size_t i = 0; i < type.getArraySize(); ++i)
+                resolveUnsizedArrays (data + i * elementSize, elementType);
+        }
+    }
+
+    bool convertToFrames (EndpointState& input, const choc::value::ValueView& frameArray, uint32_t numFrames)
+    {
+        if (! isArrayOrVector (frameArray.getType()))
+            return false;
+
+        for (uint32_t i = 0; i < numFrames; ++i)
+            if (! convertValue (input, 0, frameArray[i], input.streamFrames.data() + (size_t) i * input.frameSize))
+                return false;
+
+        return true;
+    }
+
+    //==============================================================================
+    static void readElements (const FlatType& flat, const uint8_t* source, std::vector<double>& dest)
+    {
+        for (uint32_t i = 0; i < flat.numElements; ++i)
+        {
+            switch (flat.kind)
+            {
+                case ValueKind::b8:   dest[i] = readUnaligned<b8>  (source + i * sizeof (b8)); break;
+                case ValueKind::i32:  dest[i] = readUnaligned<i32> (source + i * sizeof (i32)); break;
+                case ValueKind::i64:  dest[i] = (double) readUnaligned<i64> (source + i * sizeof (i64)); break;
+                case ValueKind::f32:  dest[i] = readUnaligned<f32> (source + i * sizeof (f32)); break;
+                case ValueKind::f64:  dest[i] = readUnaligned<f64> (source + i * sizeof (f64)); break;
+                default:              SOUL_ASSERT_FALSE; break;
+            }
+        }
+    }
+
+    static void writeElements (const FlatType& flat, uint8_t* dest, const std::vector<double>& source)
+    {
+        for (uint32_t i = 0; i < flat.numElements; ++i)
+        {
+            switch (flat.kind)
+            {
+                case ValueKind::b8:   writeUnaligned (dest + i * sizeof (b8),  (b8) (source[i] != 0 ? 1 : 0)); break;
+                case ValueKind::i32:  writeUnaligned (dest + i * sizeof (i32), (i32) source[i]); break;
+                case ValueKind::i64:  writeUnaligned (dest + i * sizeof (i64), (i64) source[i]); break;
+                case ValueKind::f32:  writeUnaligned (dest + i * sizeof (f32), (f32) source[i]); break;
+                case ValueKind::f64:  writeUnaligned (dest + i * sizeof (f64), (f64) source[i]); break;
+                default:              SOUL_ASSERT_FALSE; break;
+            }
+        }
+    }
+
+    void renderSparseFrames (EndpointState& input)
+    {
+        auto& flat = *input.frameFlatType;
+
+        for (uint32_t frame = 0; frame < numFramesPrepared; ++frame)
+        {
+            if (input.sparseFramesRemaining > 0)
+            {
+                if (--input.sparseFramesRemaining == 0)
+                    input.sparseValue = input.sparseTarget;
+                else
+                    for (size_t i = 0; i < input.sparseValue.size(); ++i)
+                        input.sparseValue[i] += input.sparseIncrement[i];
+            }
+
+            writeElements (flat, input.streamFrames.data() + (size_t) frame * input.frameSize, input.sparseValue);
+        }
+    }
+};
+
+} // namespace soul::interpreter
+
+namespace soul
+{
+
+InterpreterPerformerFactory::InterpreterPerformerFactory() = default;
+InterpreterPerformerFactory::~InterpreterPerformerFactory() = default;
+
+std::unique_ptr<Performer> InterpreterPerformerFactory::createPerformer()
+{
+    return std::make_unique<interpreter::InterpreterPerformer>();
+}
+
+} // namespace soul
@@ -0,0 +1,44 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul
+{
+
+//==============================================================================
+/**
+    A PerformerFactory whose performers execute a program with a portable interpreter.
+
+    When a program is linked, each processor's HEART functions are lowered to a compact
+    register-style bytecode in which every variable has been resolved to a fixed slot,
+    and the graph is flattened into a list of processor instances with direct routes
+    between them. This is much slower than a JIT, but needs no code generation at
+    runtime, so it can be used anywhere.
+*/
+class InterpreterPerformerFactory  : public PerformerFactory
+{
+public:
+    InterpreterPerformerFactory();
+    ~InterpreterPerformerFactory() override;
+
+    std::unique_ptr<Performer> createPerformer() override;
+};
+
+
+} // namespace soul
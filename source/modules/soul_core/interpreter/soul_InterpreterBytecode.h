@@ -0,0 +1,402 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul::interpreter
+{
+
+//==============================================================================
+/*  The interpreter's instruction set.
+
+    Each processor instance owns a single flat block of memory holding its state,
+    function frames, temporaries and constants, and every operand of an instruction
+    is a pre-resolved byte offset into that block. Typed operations come in a scalar
+    form, and a "_vec" form which loops over Instruction::size elements.
+*/
+using Offset = uint32_t;
+
+using b8  = uint8_t;
+using i32 = int32_t;
+using i64 = int64_t;
+using f32 = float;
+using f64 = double;
+
+/** The primitive element types that the interpreter operates on. */
+enum class ValueKind  : uint8_t
+{
+    b8, i32, i64, f32, f64
+};
+
+inline uint32_t getSizeOfKind (ValueKind k)
+{
+    switch (k)
+    {
+        case ValueKind::b8:   return 1;
+        case ValueKind::i32:  return 4;
+        case ValueKind::i64:  return 8;
+        case ValueKind::f32:  return 4;
+        case ValueKind::f64:  return 8;
+        default:              SOUL_ASSERT_FALSE; return 0;
+    }
+}
+
+#define SOUL_INTERPRETER_NUMERIC_TYPES(X, op)   X(op, i32) X(op, i64) X(op, f32) X(op, f64)
+#define SOUL_INTERPRETER_INTEGER_TYPES(X, op)   X(op, i32) X(op, i64)
+#define SOUL_INTERPRETER_FLOAT_TYPES(X, op)     X(op, f32) X(op, f64)
+
+/** (dest = source1 op source2), where all operands have the same type. */
+#define SOUL_INTERPRETER_BINARY_OPS(X) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, add) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, subtract) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, multiply) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, divide) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, modulo) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, min) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, max) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, wrap) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, bitwiseAnd) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, bitwiseOr) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, bitwiseXor) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, leftShift) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, rightShift) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, rightShiftUnsigned) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, pow) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, atan2) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, fmod) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, remainder) \
+    X(logicalAnd, b8) \
+    X(logicalOr, b8)
+
+/** (dest = source1 op source2), where the operands have the same type and the result is a bool. */
+#define SOUL_INTERPRETER_COMPARISON_OPS(X) \
+    X(equals, b8) \
+    X(notEquals, b8) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, equals) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, notEquals) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, lessThan) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, lessThanOrEqual) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, greaterThan) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, greaterThanOrEqual)
+
+/** (dest = op source1), where the result has the same type as the operand. */
+#define SOUL_INTERPRETER_UNARY_OPS(X) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, negate) \
+    SOUL_INTERPRETER_NUMERIC_TYPES (X, abs) \
+    SOUL_INTERPRETER_INTEGER_TYPES (X, bitwiseNot) \
+    X(logicalNot, b8) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, sqrt) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, exp) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, log) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, log10) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, sin) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, cos) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, tan) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, sinh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, cosh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, tanh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, asinh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, acosh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, atanh) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, asin) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, acos) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, atan) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, floor) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, ceil)
+
+/** (dest = op source1), where the result is a bool. */
+#define SOUL_INTERPRETER_TEST_OPS(X) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, isnan) \
+    SOUL_INTERPRETER_FLOAT_TYPES (X, isinf)
+
+/** (dest = source1 converted from the first type to the second). */
+#define SOUL_INTERPRETER_CAST_OPS(X) \
+    X(b8,  i32) X(b8,  i64) X(b8,  f32) X(b8,  f64) \
+    X(i32, b8)  X(i32, i64) X(i32, f32) X(i32, f64) \
+    X(i64, b8)  X(i64, i32) X(i64, f32) X(i64, f64) \
+    X(f32, b8)  X(f32, i32) X(f32, i64) X(f32, f64) \
+    X(f64, b8)  X(f64, i32) X(f64, i64) X(f64, f32)
+
+/** Accumulates a value into the current frame of an output stream. The writeStreamFrames forms
+    write a block of size frames, each with source3 elements, starting at the current frame.
+*/
+#define SOUL_INTERPRETER_STREAM_WRITE_OPS(X) \
+    X(writeStream, i32) X(writeStream, i64) X(writeStream, f32) X(writeStream, f64) \
+    X(writeStreamFrames, i32) X(writeStreamFrames, i64) X(writeStreamFrames, f32) X(writeStreamFrames, f64)
+
+#define SOUL_INTERPRETER_DECLARE_TYPED_OP(op, type)     op ## _ ## type, op ## _ ## type ## _vec,
+#define SOUL_INTERPRETER_DECLARE_CAST_OP(from, to)      cast_ ## from ## _ ## to, cast_ ## from ## _ ## to ## _vec,
+#define SOUL_INTERPRETER_DECLARE_SIMPLE_OP(op, type)    op ## _ ## type,
+
+enum class OpCode  : uint16_t
+{
+    nop,
+    jump,               // pc = param
+    branchIf,           // pc = source1 ? param : size
+    call,               // push the return address, pc = param
+    ret,                // pop the return address, or leave the interpreter loop if the stack is empty
+    finishRun,          // the run() function has returned, so the processor goes quiet
+    advance,            // move on to the next frame, suspending run() if the end of the chunk is reached
+    enterBlockLoop,     // pc = (at least size frames remain before run() must be suspended) ? pc + 1 : param
+    advanceBlock,       // move on by size frames, suspending run() if the end of the chunk is reached
+
+    copy,               // copy size bytes from source1 to dest
+    copy1,
+    copy4,
+    copy8,
+    zero,               // clear size bytes at dest
+    broadcast,          // copy the param-byte element at source1 into size consecutive elements at dest
+
+    loadIndirect,       // copy size bytes from (pointer at source1) + param to dest
+    storeIndirect,      // copy size bytes from source1 to (pointer at dest) + param
+    storePointer,       // write the absolute address of source1 into the pointer slot at dest
+    offsetPointer,      // dest = (pointer at source1) + param
+    elementAddress,     // dest = address of element (index at source2) in the array at source1, see ElementAddressFlags
+    getArraySize,       // dest (i32) = number of elements in the unsized array whose pointer is at source1
+
+    wrapToLimit,        // dest (i32) = source1 (i32) wrapped to the range 0..param
+    clampToLimit,       // dest (i32) = source1 (i32) clamped to the range 0..param
+
+    readStream,         // copy size bytes from (buffer pointer at source1) + (frame * param) + source2 to dest
+    writeStream_b8,     // copy size bytes from source1 to (buffer pointer at dest) + (frame * param) + source2
+    readStreamFrames,   // copy size frames of source3 bytes from (buffer pointer at source1) + (frame * param) + source2 to dest
+    writeStreamFrames_b8, // copy size frames of source3 bytes from source1 to (buffer pointer at dest) + (frame * param) + source2
+    writeEvent,         // emit an event on output param of type index flags, with an optional element index at source2
+
+    SOUL_INTERPRETER_BINARY_OPS (SOUL_INTERPRETER_DECLARE_TYPED_OP)
+    SOUL_INTERPRETER_COMPARISON_OPS (SOUL_INTERPRETER_DECLARE_TYPED_OP)
+    SOUL_INTERPRETER_UNARY_OPS (SOUL_INTERPRETER_DECLARE_TYPED_OP)
+    SOUL_INTERPRETER_TEST_OPS (SOUL_INTERPRETER_DECLARE_TYPED_OP)
+    SOUL_INTERPRETER_NUMERIC_TYPES (SOUL_INTERPRETER_DECLARE_SIMPLE_OP, clamp)
+    SOUL_INTERPRETER_CAST_OPS (SOUL_INTERPRETER_DECLARE_CAST_OP)
+    SOUL_INTERPRETER_STREAM_WRITE_OPS (SOUL_INTERPRETER_DECLARE_SIMPLE_OP)
+
+    numOpCodes
+};
+
+#undef SOUL_INTERPRETER_DECLARE_TYPED_OP
+#undef SOUL_INTERPRETER_DECLARE_CAST_OP
+#undef SOUL_INTERPRETER_DECLARE_SIMPLE_OP
+
+/** Flags used by OpCode::elementAddress */
+enum ElementAddressFlags  : uint16_t
+{
+    baseIsPointer   = 1,   // source1 holds a pointer to the array, rather than being the array itself
+    indexIsInt64    = 2,   // the index at source2 is an int64 rather than an int32
+    indexIsTrusted  = 4    // the index is known to be in range, so doesn't need wrapping
+};
+
+//==============================================================================
+struct Instruction
+{
+    OpCode opcode = OpCode::nop;
+    uint16_t flags = 0;
+    uint32_t size = 1;
+    Offset dest = 0, source1 = 0, source2 = 0, source3 = 0;
+    int64_t param = 0;
+};
+
+static_assert (sizeof (Instruction) == 32, "Instructions are expected to pack into 32 bytes");
+
+/** Unsized arrays are stored with their element count in the 8 bytes preceding the data. */
+inline int64_t getUnsizedArraySize (const void* data)
+{
+    return readUnaligned<int64_t> (static_cast<const uint8_t*> (data) - sizeof (int64_t));
+}
+
+//==============================================================================
+/** The semantics of each typed operation. Integer arithmetic wraps rather than
+    invoking undefined behaviour, and integer division or modulo by zero returns zero.
+*/
+struct Ops
+{
+    template <typename T> using Unsigned = std::make_unsigned_t<T>;
+
+    template <typename T> static T add (T a, T b)        { if constexpr (std::is_integral<T>::value) return (T) ((Unsigned<T>) a + (Unsigned<T>) b); else return a + b; }
+    template <typename T> static T subtract (T a, T b)   { if constexpr (std::is_integral<T>::value) return (T) ((Unsigned<T>) a - (Unsigned<T>) b); else return a - b; }
+    template <typename T> static T multiply (T a, T b)   { if constexpr (std::is_integral<T>::value) return (T) ((Unsigned<T>) a * (Unsigned<T>) b); else return a * b; }
+    template <typename T> static T negate (T a)          { if constexpr (std::is_integral<T>::value) return (T) (Unsigned<T> (0) - (Unsigned<T>) a); else return -a; }
+
+    template <typename T> static T divide (T a, T b)
+    {
+        if constexpr (std::is_integral<T>::value)
+        {
+            if (b == 0)   return 0;
+            if (b == -1)  return negate (a);
+        }
+
+        return a / b;
+    }
+
+    template <typename T> static T modulo (T a, T b)
+    {
+        if constexpr (std::is_integral<T>::value)
+            return (b == 0 || b == -1) ? 0 : a % b;
+        else
+            return std::fmod (a, b);
+    }
+
+    template <typename T> static T min (T a, T b)        { return a < b ? a : b; }
+    template <typename T> static T max (T a, T b)        { return a > b ? a : b; }
+    template <typename T> static T clamp (T n, T low, T high)   { return n < low ? low : (n > high ? high : n); }
+
+    template <typename T> static T wrap (T n, T range)
+    {
+        if (range == 0)
+            return 0;
+
+        auto x = modulo (n, range);
+        return x < 0 ? x + range : x;
+    }
+
+    template <typename T> static T abs (T a)             { return a < 0 ? negate (a) : a; }
+
+    template <typename T> static T bitwiseAnd (T a, T b) { return a & b; }
+    template <typename T> static T bitwiseOr  (T a, T b) { return a | b; }
+    template <typename T> static T bitwiseXor (T a, T b) { return a ^ b; }
+    template <typename T> static T bitwiseNot (T a)      { return ~a; }
+
+    template <typename T> static T leftShift (T a, T b)
+    {
+        return (b >= 0 && b < (T) (sizeof (T) * 8)) ? (T) (((Unsigned<T>) a) << b) : 0;
+    }
+
+    template <typename T> static T rightShift (T a, T b)
+    {
+        if (b >= 0 && b < (T) (sizeof (T) * 8))
+            return a >> b;
+
+        return a >= 0 ? 0 : -1;
+    }
+
+    template <typename T> static T rightShiftUnsigned (T a, T b)
+    {
+        return (b >= 0 && b < (T) (sizeof (T) * 8)) ? (T) (((Unsigned<T>) a) >> b) : 0;
+    }
+
+    static b8 logicalAnd (b8 a, b8 b)   { return (a != 0 && b != 0) ? 1 : 0; }
+    static b8 logicalOr  (b8 a, b8 b)   { return (a != 0 || b != 0) ? 1 : 0; }
+    static b8 logicalNot (b8 a)         { return a != 0 ? 0 : 1; }
+
+    template <typename T> static b8 equals (T a, T b)               { return a == b ? 1 : 0; }
+    template <typename T> static b8 notEquals (T a, T b)            { return a != b ? 1 : 0; }
+    template <typename T> static b8 lessThan (T a, T b)             { return a <  b ? 1 : 0; }
+    template <typename T> static b8 lessThanOrEqual (T a, T b)      { return a <= b ? 1 : 0; }
+    template <typename T> static b8 greaterThan (T a, T b)          { return a >  b ? 1 : 0; }
+    template <typename T> static b8 greaterThanOrEqual (T a, T b)   { return a >= b ? 1 : 0; }
+
+    template <typename T> static T pow (T a, T b)        { return std::pow (a, b); }
+    template <typename T> static T atan2 (T a, T b)      { return std::atan2 (a, b); }
+    template <typename T> static T fmod (T a, T b)       { return b != 0 ? std::fmod (a, b) : 0; }
+    template <typename T> static T remainder (T a, T b)  { return b != 0 ? std::remainder (a, b) : 0; }
+
+    template <typename T> static T sqrt (T a)            { return std::sqrt (a); }
+    template <typename T> static T exp (T a)             { return std::exp (a); }
+    template <typename T> static T log (T a)             { return std::log (a); }
+    template <typename T> static T log10 (T a)           { return std::log10 (a); }
+    template <typename T> static T sin (T a)             { return std::sin (a); }
+    template <typename T> static T cos (T a)             { return std::cos (a); }
+    template <typename T> static T tan (T a)             { return std::tan (a); }
+    template <typename T> static T sinh (T a)            { return std::sinh (a); }
+    template <typename T> static T cosh (T a)            { return std::cosh (a); }
+    template <typename T> static T tanh (T a)            { return std::tanh (a); }
+    template <typename T> static T asinh (T a)           { return std::asinh (a); }
+    template <typename T> static T acosh (T a)           { return std::acosh (a); }
+    template <typename T> static T atanh (T a)           { return std::atanh (a); }
+    template <typename T> static T asin (T a)            { return std::asin (a); }
+    template <typename T> static T acos (T a)            { return std::acos (a); }
+    template <typename T> static T atan (T a)            { return std::atan (a); }
+    template <typename T> static T floor (T a)           { return std::floor (a); }
+    template <typename T> static T ceil (T a)            { return std::ceil (a); }
+
+    template <typename T> static b8 isnan (T a)          { return std::isnan (a) ? 1 : 0; }
+    template <typename T> static b8 isinf (T a)          { return std::isinf (a) ? 1 : 0; }
+
+    template <typename Dest, typename Source>
+    static Dest cast (Source a)
+    {
+        if constexpr (std::is_same<Dest, b8>::value)
+            return a != 0 ? 1 : 0;
+        else if constexpr (std::is_same<Source, b8>::value)
+            return a != 0 ? (Dest) 1 : (Dest) 0;
+        else
+            return static_cast<Dest> (a);
+    }
+};
+
+//==============================================================================
+inline const char* getOpCodeName (OpCode op)
+{
+    #define SOUL_INTERPRETER_TYPED_OP_NAME(op, type) \
+        case OpCode::op ## _ ## type:           return #op "_" #type; \
+        case OpCode::op ## _ ## type ## _vec:   return #op "_" #type "_vec";
+    #define SOUL_INTERPRETER_CAST_OP_NAME(from, to) \
+        case OpCode::cast_ ## from ## _ ## to:          return "cast_" #from "_" #to; \
+        case OpCode::cast_ ## from ## _ ## to ## _vec:  return "cast_" #from "_" #to "_vec";
+    #define SOUL_INTERPRETER_SIMPLE_OP_NAME(op, type) \
+        case OpCode::op ## _ ## type:           return #op "_" #type;
+
+    switch (op)
+    {
+        case OpCode::nop:             return "nop";
+        case OpCode::jump:            return "jump";
+        case OpCode::branchIf:        return "branchIf";
+        case OpCode::call:            return "call";
+        case OpCode::ret:             return "ret";
+        case OpCode::finishRun:       return "finishRun";
+        case OpCode::advance:         return "advance";
+        case OpCode::enterBlockLoop:  return "enterBlockLoop";
+        case OpCode::advanceBlock:    return "advanceBlock";
+        case OpCode::copy:            return "copy";
+        case OpCode::copy1:           return "copy1";
+        case OpCode::copy4:           return "copy4";
+        case OpCode::copy8:           return "copy8";
+        case OpCode::zero:            return "zero";
+        case OpCode::broadcast:       return "broadcast";
+        case OpCode::loadIndirect:    return "loadIndirect";
+        case OpCode::storeIndirect:   return "storeIndirect";
+        case OpCode::storePointer:    return "storePointer";
+        case OpCode::offsetPointer:   return "offsetPointer";
+        case OpCode::elementAddress:  return "elementAddress";
+        case OpCode::getArraySize:    return "getArraySize";
+        case OpCode::wrapToLimit:     return "wrapToLimit";
+        case OpCode::clampToLimit:    return "clampToLimit";
+        case OpCode::readStream:      return "readStream";
+        case OpCode::writeStream_b8:  return "writeStream_b8";
+        case OpCode::readStreamFrames:      return "readStreamFrames";
+        case OpCode::writeStreamFrames_b8:  return "writeStreamFrames_b8";
+        case OpCode::writeEvent:      return "writeEvent";
+
+        SOUL_INTERPRETER_BINARY_OPS (SOUL_INTERPRETER_TYPED_OP_NAME)
+        SOUL_INTERPRETER_COMPARISON_OPS (SOUL_INTERPRETER_TYPED_OP_NAME)
+        SOUL_INTERPRETER_UNARY_OPS (SOUL_INTERPRETER_TYPED_OP_NAME)
+        SOUL_INTERPRETER_TEST_OPS (SOUL_INTERPRETER_TYPED_OP_NAME)
+        SOUL_INTERPRETER_NUMERIC_TYPES (SOUL_INTERPRETER_SIMPLE_OP_NAME, clamp)
+        SOUL_INTERPRETER_CAST_OPS (SOUL_INTERPRETER_CAST_OP_NAME)
+        SOUL_INTERPRETER_STREAM_WRITE_OPS (SOUL_INTERPRETER_SIMPLE_OP_NAME)
+
+        case OpCode::numOpCodes:
+        default:                      return "?";
+    }
+
+    #undef SOUL_INTERPRETER_TYPED_OP_NAME
+    #undef SOUL_INTERPRETER_CAST_OP_NAME
+    #undef SOUL_INTERPRETER_SIMPLE_OP_NAME
+}
+
+} // namespace soul::interpreter
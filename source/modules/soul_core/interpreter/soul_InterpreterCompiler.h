@@ -0,0 +1,1776 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul::interpreter
+{
+
+//==============================================================================
+/** Owns the content of any unsized arrays that the running program refers to.
+    Each block is preceded by its element count, and always has space for at least one
+    element, so that indexing an empty array is harmless.
+*/
+struct UnsizedArrayStorage
+{
+    uint8_t* allocate (uint64_t numElements, size_t elementSize)
+    {
+        auto dataSize = std::max ((size_t) 1, (size_t) numElements) * elementSize;
+        blocks.push_back (std::make_unique<uint64_t[]> (1 + (dataSize + 7) / 8));
+        auto block = blocks.back().get();
+        block[0] = numElements;
+        return reinterpret_cast<uint8_t*> (block + 1);
+    }
+
+    std::vector<std::unique_ptr<uint64_t[]>> blocks;
+};
+
+//==============================================================================
+/** Describes a type which can be treated as a flat sequence of primitive elements. */
+struct FlatType
+{
+    ValueKind kind;
+    uint32_t numElements;
+};
+
+inline std::optional<ValueKind> getValueKind (PrimitiveType p)
+{
+    if (p.isBool())       return ValueKind::b8;
+    if (p.isInteger32())  return ValueKind::i32;
+    if (p.isInteger64())  return ValueKind::i64;
+    if (p.isFloat32())    return ValueKind::f32;
+    if (p.isFloat64())    return ValueKind::f64;
+
+    return {};
+}
+
+inline std::optional<FlatType> getFlatType (const Type& type)
+{
+    if (type.isReference())
+        return getFlatType (type.removeReference());
+
+    if (type.isBoundedInt() || type.isStringLiteral())
+        return FlatType { ValueKind::i32, 1 };
+
+    if (type.isPrimitive() || type.isVector())
+        if (auto kind = getValueKind (type.getPrimitiveType()))
+            return FlatType { *kind, type.isVector() ? (uint32_t) type.getVectorSize() : 1u };
+
+    if (type.isFixedSizeArray())
+        if (auto element = getFlatType (type.getArrayElementType()))
+            return FlatType { element->kind, element->numElements * (uint32_t) type.getArraySize() };
+
+    return {};
+}
+
+inline uint32_t getSizeInBytes (const Type& type)
+{
+    return (uint32_t) type.removeReferenceIfPresent().getPackedSizeInBytes();
+}
+
+inline uint32_t getStructMemberOffset (const Structure& s, size_t memberIndex)
+{
+    size_t offset = 0;
+
+    for (size_t i = 0; i < memberIndex; ++i)
+        offset += s.getMemberType (i).getPackedSizeInBytes();
+
+    return (uint32_t) offset;
+}
+
+inline bool layoutsMatch (const Type& source, const Type& dest)
+{
+    return source.isEqual (dest, Type::ignoreReferences | Type::ignoreConst
+                                  | Type::ignoreVectorSize1 | Type::duckTypeStructures);
+}
+
+//==============================================================================
+/** The code, memory layout and initial state for one processor module. Any number
+    of processor instances can share one of these.
+*/
+struct CompiledModule
+{
+    CompiledModule (const Module& m) : module (m) {}
+
+    struct EventHandler
+    {
+        uint32_t entryPoint = 0;
+        std::optional<Offset> indexParameter;
+        Offset valueParameter = 0;
+        bool valueIsReference = false;
+    };
+
+    struct Endpoint
+    {
+        Offset bufferPointer = 0;   // a slot holding a pointer to the frames of a stream for the current chunk
+        Offset valueStorage = 0;    // the current content of a value endpoint
+        std::vector<std::optional<EventHandler>> eventHandlers;  // one per data type of an event input
+    };
+
+    const Module& module;
+    std::vector<Instruction> code;
+    std::vector<uint8_t> initialState;
+    std::optional<uint32_t> runFunction, systemInitFunction, userInitFunction;
+    std::optional<uint32_t> stateInitialisers;  // sets any state whose initial value isn't a constant
+    std::vector<Endpoint> inputs, outputs;
+    Offset frequency = 0, period = 0, id = 0, session = 0, latency = 0;
+    uint32_t maxCallDepth = 0;
+};
+
+//==============================================================================
+/** Lowers the HEART functions of a processor into interpreter bytecode, and lays
+    out all of its variables in a single block of memory.
+*/
+class ModuleCompiler
+{
+public:
+    static std::unique_ptr<CompiledModule> compile (const Program& program, const Module& module,
+                                                    UnsizedArrayStorage& arrayStorage)
+    {
+        SOUL_ASSERT (module.isProcessor());
+        ModuleCompiler c (program, module, arrayStorage);
+        return c.compileModule();
+    }
+
+private:
+    ModuleCompiler (const Program& p, const Module& m, UnsizedArrayStorage& s)
+        : program (p), module (m), arrayStorage (s), result (std::make_unique<CompiledModule> (m))
+    {}
+
+    //==============================================================================
+    struct Location
+    {
+        Offset offset = 0;          // either the value itself, or a slot holding a pointer to it
+        bool isPointer = false;
+        uint32_t pointerOffset = 0; // added to the pointer, if isPointer is set
+
+        Location withOffset (uint32_t n) const
+        {
+            auto l = *this;
+
+            if (isPointer)
+                l.pointerOffset += n;
+            else
+                l.offset += n;
+
+            return l;
+        }
+    };
+
+    struct FunctionInfo
+    {
+        std::vector<Offset> parameters;
+        Offset returnValue = 0;
+        std::optional<uint32_t> entryPoint;
+        std::unordered_map<uint32_t, std::vector<Offset>> freeTemporaries;
+    };
+
+    struct BlockFixup
+    {
+        size_t instruction;
+        const heart::Block* block;
+        bool isFalseTarget;
+    };
+
+    using ArgList = heart::FunctionCall::ArgListType;
+
+    const Program& program;
+    const Module& module;
+    UnsizedArrayStorage& arrayStorage;
+    std::unique_ptr<CompiledModule> result;
+
+    std::vector<uint8_t> memory;
+    std::vector<Instruction> code;
+    std::unordered_map<const heart::Variable*, Location> variables;
+    std::unordered_map<const heart::Function*, FunctionInfo> functions;
+    std::vector<heart::Function*> functionsToCompile;
+    std::vector<heart::Variable*> variablesToInitialise;
+    std::vector<std::pair<size_t, const heart::Function*>> callFixups;
+    std::vector<std::pair<uint32_t*, const heart::Function*>> entryPointFixups;
+    std::unordered_map<std::string, Offset> constants;
+    std::unordered_map<ConstantTable::Handle, uint8_t*> resolvedArrays;
+    std::vector<std::pair<uint32_t, Offset>> temporariesInUse;
+
+    const heart::Function* currentFunction = nullptr;
+    FunctionInfo* currentFunctionInfo = nullptr;
+    CodeLocation currentLocation;
+
+    //==============================================================================
+    std::unique_ptr<CompiledModule> compileModule()
+    {
+        result->frequency = allocate (sizeof (double));
+        result->period    = allocate (sizeof (double));
+        result->id        = allocate (sizeof (int32_t));
+        result->session   = allocate (sizeof (int32_t));
+        result->latency   = allocate (sizeof (int32_t));
+
+        for (auto& v : module.stateVariables.get())
+            getVariableLocation (v);
+
+        for (auto& input : module.inputs)
+            result->inputs.push_back (createEndpoint (input));
+
+        for (auto& output : module.outputs)
+            result->outputs.push_back (createEndpoint (output));
+
+        for (auto& f : module.functions.get())
+        {
+            if (f->functionType.isRun())          addEntryPoint (f, result->runFunction);
+            if (f->functionType.isSystemInit())   addEntryPoint (f, result->systemInitFunction);
+            if (f->functionType.isUserInit())     addEntryPoint (f, result->userInitFunction);
+        }
+
+        addEventHandlers();
+
+        while (! functionsToCompile.empty())
+        {
+            auto f = functionsToCompile.back();
+            functionsToCompile.pop_back();
+            compileFunction (*f);
+        }
+
+        compileStateInitialisers();
+
+        for (auto& fixup : callFixups)
+            code[fixup.first].param = *functions[fixup.second].entryPoint;
+
+        for (auto& e : entryPointFixups)
+            *e.first = *functions[e.second].entryPoint;
+
+        result->code = std::move (code);
+        result->initialState = std::move (memory);
+        result->maxCallDepth = (uint32_t) functions.size() + 1;
+        return std::move (result);
+    }
+
+    void addEntryPoint (heart::Function& f, std::optional<uint32_t>& entryPoint)
+    {
+        getFunctionInfo (f);
+        entryPoint = 0;
+        entryPointFixups.push_back ({ std::addressof (*entryPoint), std::addressof (f) });
+    }
+
+    CompiledModule::Endpoint createEndpoint (const heart::IODeclaration& io)
+    {
+        CompiledModule::Endpoint e;
+
+        if (io.isStreamEndpoint())
+            e.bufferPointer = allocate (sizeof (void*));
+        else if (io.isValueEndpoint())
+            e.valueStorage = allocate (getSizeInBytes (io.getValueType()));
+
+        return e;
+    }
+
+    void addEventHandlers()
+    {
+        for (size_t i = 0; i < module.inputs.size(); ++i)
+        {
+            auto& input = module.inputs[i].get();
+
+            if (! input.isEventEndpoint())
+                continue;
+
+            auto& handlers = result->inputs[i].eventHandlers;
+            handlers.resize (input.dataTypes.size());
+
+            for (auto& f : module.functions.get())
+            {
+                if (! f->functionType.isEvent() || f->parameters.empty()
+                     || f->name.toString() != heart::getEventFunctionName (input.name, f->parameters.front()->type))
+                    continue;
+
+                auto& valueParam = f->parameters.back().get();
+
+                if (auto typeIndex = heart::Utilities::findMatchingEndpointType (program, valueParam.type, input.dataTypes, f->location))
+                {
+                    auto& info = getFunctionInfo (f);
+                    handlers[*typeIndex] = CompiledModule::EventHandler();
+                    auto& handler = *handlers[*typeIndex];
+                    entryPointFixups.push_back ({ std::addressof (handler.entryPoint), f.getPointer() });
+                    handler.valueParameter = info.parameters.back();
+                    handler.valueIsReference = valueParam.type.isReference();
+
+                    if (f->parameters.size() > 1)
+                        handler.indexParameter = info.parameters.front();
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    Offset allocate (size_t size)
+    {
+        auto offset = (memory.size() + 7u) & ~(size_t) 7u;
+        memory.resize (offset + std::max ((size_t) 1, size));
+
+        if (memory.size() > std::numeric_limits<Offset>::max() / 2)
+            currentLocation.throwError (Errors::programStateTooLarge (getReadableDescriptionOfByteSize (memory.size()),
+                                                                      getReadableDescriptionOfByteSize (std::numeric_limits<Offset>::max() / 2)));
+
+        return (Offset) offset;
+    }
+
+    Offset allocateTemporary (uint32_t size)
+    {
+        auto& pool = currentFunctionInfo->freeTemporaries[size];
+        Offset offset;
+
+        if (pool.empty())
+        {
+            offset = allocate (size);
+        }
+        else
+        {
+            offset = pool.back();
+            pool.pop_back();
+        }
+
+        temporariesInUse.push_back ({ size, offset });
+        return offset;
+    }
+
+    void releaseTemporaries()
+    {
+        for (auto& t : temporariesInUse)
+            currentFunctionInfo->freeTemporaries[t.first].push_back (t.second);
+
+        temporariesInUse.clear();
+    }
+
+    void writeConstant (Offset dest, const Value& value)
+    {
+        auto size = value.getPackedDataSize();
+        SOUL_ASSERT (dest + size <= memory.size());
+        memcpy (memory.data() + dest, value.getPackedData(), size);
+        resolveUnsizedArrays (memory.data() + dest, value.getType());
+    }
+
+    // Replaces any constant-table handles with pointers to copies of the array data
+    void resolveUnsizedArrays (uint8_t* data, const Type& type)
+    {
+        if (type.isUnsizedArray())
+        {
+            auto handle = readUnaligned<ConstantTable::Handle> (data);
+            auto& resolved = resolvedArrays[handle];
+
+            if (resolved == nullptr)
+            {
+                auto elementType = type.getArrayElementType();
+                auto elementSize = elementType.getPackedSizeInBytes();
+
+                if (auto v = program.getConstantTable().getValueForHandle (handle))
+                {
+                    auto numElements = v->getType().getArraySize();
+                    resolved = arrayStorage.allocate (numElements, elementSize);
+                    memcpy (resolved, v->getPackedData(), v->getPackedDataSize());
+
+                    for (size_t i = 0; i < numElements; ++i)
+                        resolveUnsizedArrays (resolved + i * elementSize, elementType);
+                }
+                else
+                {
+                    resolved = arrayStorage.allocate (0, elementSize);
+                }
+            }
+
+            writeUnaligned (data, resolved);
+        }
+        else if (type.isStruct())
+        {
+            auto& s = type.getStructRef();
+
+            for (size_t i = 0; i < s.getNumMembers(); ++i)
+                resolveUnsizedArrays (data + getStructMemberOffset (s, i), s.getMemberType (i));
+        }
+        else if (type.isFixedSizeArray() && ! type.getArrayElementType().isPrimitiveOrVector())
+        {
+            auto elementType = type.getArrayElementType();
+            auto elementSize = elementType.getPackedSizeInBytes();
+
+            for (size_t i = 0; i < type.getArraySize(); ++i)
+                resolveUnsizedArrays (data + i * elementSize, elementType);
+        }
+    }
+
+    Offset getConstant (const Value& value)
+    {
+        auto size = (uint32_t) value.getPackedDataSize();
+        auto key = value.getType().getDescription()
+                     + std::string (static_cast<const char*> (value.getPackedData()), size);
+
+        auto found = constants.find (key);
+
+        if (found != constants.end())
+            return found->second;
+
+        auto offset = allocate (size);
+        writeConstant (offset, value);
+        constants[key] = offset;
+        return offset;
+    }
+
+    Offset getConstant (int32_t n)    { return getConstant (Value::createInt32 (n)); }
+
+    Offset getPropertyOffset (heart::ProcessorProperty::Property p)
+    {
+        switch (p)
+        {
+            case heart::ProcessorProperty::Property::frequency:  return result->frequency;
+            case heart::ProcessorProperty::Property::period:     return result->period;
+            case heart::ProcessorProperty::Property::id:         return result->id;
+            case heart::ProcessorProperty::Property::session:    return result->session;
+            case heart::ProcessorProperty::Property::latency:    return result->latency;
+            case heart::ProcessorProperty::Property::none:
+            default:                                             SOUL_ASSERT_FALSE; return 0;
+        }
+    }
+
+    //==============================================================================
+    FunctionInfo& getFunctionInfo (heart::Function& f)
+    {
+        auto found = functions.find (std::addressof (f));
+
+        if (found != functions.end())
+            return found->second;
+
+        auto& info = functions[std::addressof (f)];
+
+        for (auto& p : f.parameters)
+        {
+            auto offset = allocate (p->type.isReference() ? sizeof (void*) : getSizeInBytes (p->type));
+            info.parameters.push_back (offset);
+            variables[std::addressof (p.get())] = { offset, p->type.isReference(), 0 };
+        }
+
+        if (! f.returnType.isVoid())
+            info.returnValue = allocate (getSizeInBytes (f.returnType));
+
+        functionsToCompile.push_back (std::addressof (f));
+        return info;
+    }
+
+    Location getVariableLocation (heart::Variable& v)
+    {
+        auto found = variables.find (std::addressof (v));
+
+        if (found != variables.end())
+            return found->second;
+
+        if (v.type.isVoid() || ! v.type.isValid())
+            v.location.throwError (Errors::unsupportedType());
+
+        auto offset = allocate (getSizeInBytes (v.type));
+
+        if (v.isState() && v.initialValue != nullptr)
+        {
+            auto value = v.initialValue->getAsConstant();
+
+            if (value.isValid())
+            {
+                if (! layoutsMatch (value.getType(), v.type))
+                    value = value.castToTypeWithError (v.type.removeReferenceIfPresent().removeConstIfPresent(), v.location);
+
+                writeConstant (offset, value);
+            }
+            else
+            {
+                // This depends on something like processor.frequency, so can only be worked out once the
+                // instance has been given its sample rate
+                variablesToInitialise.push_back (std::addressof (v));
+            }
+        }
+
+        Location l { offset, false, 0 };
+        variables[std::addressof (v)] = l;
+        return l;
+    }
+
+    //==============================================================================
+    size_t emit (OpCode op, Offset dest = 0, Offset source1 = 0, Offset source2 = 0,
+                 uint32_t size = 1, int64_t param = 0, uint16_t flags = 0)
+    {
+        Instruction i;
+        i.opcode = op;
+        i.flags = flags;
+        i.size = size;
+        i.dest = dest;
+        i.source1 = source1;
+        i.source2 = source2;
+        i.param = param;
+        code.push_back (i);
+        return code.size() - 1;
+    }
+
+    void emitCopy (Offset dest, Offset source, uint32_t size)
+    {
+        if (dest == source || size == 0)
+            return;
+
+        if (size == 1)       emit (OpCode::copy1, dest, source);
+        else if (size == 4)  emit (OpCode::copy4, dest, source);
+        else if (size == 8)  emit (OpCode::copy8, dest, source);
+        else                 emit (OpCode::copy, dest, source, 0, size);
+    }
+
+    Offset moveTo (std::optional<Offset> dest, Offset source, uint32_t size)
+    {
+        if (! dest.has_value())
+            return source;
+
+        emitCopy (*dest, source, size);
+        return *dest;
+    }
+
+    Offset readLocation (Location l, uint32_t size, std::optional<Offset> dest)
+    {
+        if (! l.isPointer)
+            return moveTo (dest, l.offset, size);
+
+        auto target = dest.has_value() ? *dest : allocateTemporary (size);
+        emit (OpCode::loadIndirect, target, l.offset, 0, size, l.pointerOffset);
+        return target;
+    }
+
+    void writeLocation (Location l, Offset source, uint32_t size)
+    {
+        if (l.isPointer)
+            emit (OpCode::storeIndirect, l.offset, source, 0, size, l.pointerOffset);
+        else
+            emitCopy (l.offset, source, size);
+    }
+
+    void emitAddressOf (Offset pointerSlot, Location l)
+    {
+        if (l.isPointer)
+            emit (OpCode::offsetPointer, pointerSlot, l.offset, 0, 1, l.pointerOffset);
+        else
+            emit (OpCode::storePointer, pointerSlot, l.offset);
+    }
+
+    Offset loadPointer (Location l)
+    {
+        SOUL_ASSERT (l.isPointer);
+        auto slot = allocateTemporary (sizeof (void*));
+        emit (OpCode::loadIndirect, slot, l.offset, 0, sizeof (void*), l.pointerOffset);
+        return slot;
+    }
+
+    //==============================================================================
+    static std::optional<OpCode> findTypedOpCode (std::string_view name, ValueKind kind, bool isVector)
+    {
+        struct TypedOp { const char* name; ValueKind kind; OpCode scalar, vector; };
+
+        #define SOUL_INTERPRETER_TYPED_OP_ENTRY(op, type) \
+            { #op, ValueKind::type, OpCode::op ## _ ## type, OpCode::op ## _ ## type ## _vec },
+
+        static constexpr TypedOp ops[] =
+        {
+            SOUL_INTERPRETER_BINARY_OPS (SOUL_INTERPRETER_TYPED_OP_ENTRY)
+            SOUL_INTERPRETER_COMPARISON_OPS (SOUL_INTERPRETER_TYPED_OP_ENTRY)
+            SOUL_INTERPRETER_UNARY_OPS (SOUL_INTERPRETER_TYPED_OP_ENTRY)
+            SOUL_INTERPRETER_TEST_OPS (SOUL_INTERPRETER_TYPED_OP_ENTRY)
+        };
+
+        #undef SOUL_INTERPRETER_TYPED_OP_ENTRY
+
+        for (auto& op : ops)
+            if (op.kind == kind && name == op.name)
+                return isVector ? op.vector : op.scalar;
+
+        return {};
+    }
+
+    static OpCode getCastOpCode (ValueKind source, ValueKind dest, bool isVector)
+    {
+        #define SOUL_INTERPRETER_MATCH_CAST_OP(from, to) \
+            if (source == ValueKind::from && dest == ValueKind::to) \
+                return isVector ? OpCode::cast_ ## from ## _ ## to ## _vec : OpCode::cast_ ## from ## _ ## to;
+
+        SOUL_INTERPRETER_CAST_OPS (SOUL_INTERPRETER_MATCH_CAST_OP)
+        #undef SOUL_INTERPRETER_MATCH_CAST_OP
+
+        SOUL_ASSERT_FALSE;
+        return OpCode::nop;
+    }
+
+    static const char* getOperatorName (BinaryOp::Op op)
+    {
+        #define SOUL_INTERPRETER_BINARY_OP_NAME(name, symbol)  if (op == BinaryOp::Op::name) return #name;
+        SOUL_BINARY_OPS (SOUL_INTERPRETER_BINARY_OP_NAME)
+        #undef SOUL_INTERPRETER_BINARY_OP_NAME
+        return "";
+    }
+
+    static const char* getOperatorName (UnaryOp::Op op)
+    {
+        #define SOUL_INTERPRETER_UNARY_OP_NAME(name, symbol)  if (op == UnaryOp::Op::name) return #name;
+        SOUL_UNARY_OPS (SOUL_INTERPRETER_UNARY_OP_NAME)
+        #undef SOUL_INTERPRETER_UNARY_OP_NAME
+        return "";
+    }
+
+    //==============================================================================
+    void emitConvert (Offset dest, ValueKind destKind, Offset source, ValueKind sourceKind, uint32_t numElements)
+    {
+        if (destKind == sourceKind)
+            emitCopy (dest, source, numElements * getSizeOfKind (destKind));
+        else
+            emit (getCastOpCode (sourceKind, destKind, numElements > 1), dest, source, 0, numElements);
+    }
+
+    void emitCast (Offset dest, const Type& destType, Offset source, const Type& sourceType)
+    {
+        auto d = destType.removeReferenceIfPresent();
+        auto s = sourceType.removeReferenceIfPresent();
+
+        if (d.isBoundedInt())
+        {
+            auto sourceFlat = getFlatType (s);
+
+            if (! (sourceFlat.has_value() && sourceFlat->numElements == 1))
+                currentLocation.throwError (Errors::cannotCastBetween (s.getDescription(), d.getDescription()));
+
+            auto value = source;
+
+            if (sourceFlat->kind != ValueKind::i32)
+            {
+                value = allocateTemporary (sizeof (int32_t));
+                emitConvert (value, ValueKind::i32, source, sourceFlat->kind, 1);
+            }
+
+            emit (d.isWrapped() ? OpCode::wrapToLimit : OpCode::clampToLimit, dest, value, 0, 1, d.getBoundedIntLimit());
+            return;
+        }
+
+        if (layoutsMatch (s, d))
+            return emitCopy (dest, source, getSizeInBytes (d));
+
+        auto sourceFlat = getFlatType (s);
+        auto destFlat = getFlatType (d);
+
+        if (sourceFlat.has_value() && destFlat.has_value())
+        {
+            if (sourceFlat->numElements == destFlat->numElements)
+                return emitConvert (dest, destFlat->kind, source, sourceFlat->kind, destFlat->numElements);
+
+            if (sourceFlat->numElements == 1)
+            {
+                auto element = source;
+                auto elementSize = getSizeOfKind (destFlat->kind);
+
+                if (sourceFlat->kind != destFlat->kind)
+                {
+                    element = allocateTemporary (elementSize);
+                    emitConvert (element, destFlat->kind, source, sourceFlat->kind, 1);
+                }
+
+                emit (OpCode::broadcast, dest, element, 0, destFlat->numElements, elementSize);
+                return;
+            }
+        }
+
+        if (d.isFixedSizeArray() && s.isFixedSizeArray() && d.getArraySize() == s.getArraySize())
+        {
+            auto destElement = d.getArrayElementType();
+            auto sourceElement = s.getArrayElementType();
+            auto destElementSize = getSizeInBytes (destElement);
+            auto sourceElementSize = getSizeInBytes (sourceElement);
+
+            for (uint32_t i = 0; i < (uint32_t) d.getArraySize(); ++i)
+                emitCast (dest + i * destElementSize, destElement, source + i * sourceElementSize, sourceElement);
+
+            return;
+        }
+
+        currentLocation.throwError (Errors::cannotCastBetween (s.getDescription(), d.getDescription()));
+    }
+
+    static bool needsCast (const Type& source, const Type& dest)
+    {
+        if (dest.isBoundedInt())
+            return ! source.isEqual (dest, Type::ignoreReferences | Type::ignoreConst);
+
+        return ! layoutsMatch (source, dest);
+    }
+
+    //==============================================================================
+    // Returns the offset at which the value of the expression can be found. If a destination
+    // is supplied, the result will always be written there.
+    Offset compileExpression (heart::Expression& e, std::optional<Offset> dest = {})
+    {
+        if (auto c = cast<heart::Constant> (e))                   return moveTo (dest, getConstant (c->value), getSizeInBytes (c->getType()));
+        if (auto p = cast<heart::ProcessorProperty> (e))          return moveTo (dest, getPropertyOffset (p->property), getSizeInBytes (p->getType()));
+        if (auto b = cast<heart::BinaryOperator> (e))             return compileBinaryOperator (*b, dest);
+        if (auto u = cast<heart::UnaryOperator> (e))              return compileUnaryOperator (*u, dest);
+        if (auto t = cast<heart::TypeCast> (e))                   return compileTypeCast (*t, dest);
+        if (auto a = cast<heart::AggregateInitialiserList> (e))   return compileAggregate (*a, dest);
+
+        if (auto f = cast<heart::PureFunctionCall> (e))
+        {
+            auto r = compileFunctionCall (f->function, f->arguments, dest, true);
+            SOUL_ASSERT (r.has_value());
+            return *r;
+        }
+
+        return readLocation (getLocation (e), getSizeInBytes (e.getType()), dest);
+    }
+
+    Offset compileExpressionAs (heart::Expression& e, const Type& type)
+    {
+        if (! needsCast (e.getType(), type))
+            return compileExpression (e);
+
+        auto value = compileExpression (e);
+        auto target = allocateTemporary (getSizeInBytes (type));
+        emitCast (target, type, value, e.getType());
+        return target;
+    }
+
+    void compileExpressionInto (heart::Expression& e, Offset dest, const Type& type)
+    {
+        if (needsCast (e.getType(), type))
+            emitCast (dest, type, compileExpression (e), e.getType());
+        else
+            compileExpression (e, dest);
+    }
+
+    void compileAssignment (heart::Expression& target, heart::Expression& source)
+    {
+        const auto& targetType = target.getType();
+        auto location = getLocation (target);
+
+        if (location.isPointer)
+            writeLocation (location, compileExpressionAs (source, targetType), getSizeInBytes (targetType));
+        else
+            compileExpressionInto (source, location.offset, targetType);
+    }
+
+    void assignResult (heart::Expression& target, Offset value, const Type& valueType)
+    {
+        const auto& targetType = target.getType();
+        auto location = getLocation (target);
+
+        if (needsCast (valueType, targetType))
+        {
+            auto converted = allocateTemporary (getSizeInBytes (targetType));
+            emitCast (converted, targetType, value, valueType);
+            value = converted;
+        }
+
+        writeLocation (location, value, getSizeInBytes (targetType));
+    }
+
+    //==============================================================================
+    Location getLocation (heart::Expression& e)
+    {
+        if (auto v = cast<heart::Variable> (e))
+            return getVariableLocation (*v);
+
+        if (auto s = cast<heart::StructElement> (e))
+            return getLocation (s->parent).withOffset (getStructMemberOffset (s->getStruct(), s->getMemberIndex()));
+
+        if (auto a = cast<heart::ArrayElement> (e))
+            return getArrayElementLocation (*a);
+
+        return { compileExpression (e), false, 0 };
+    }
+
+    Location getArrayElementLocation (heart::ArrayElement& a)
+    {
+        auto parentType = a.parent->getType().removeReferenceIfPresent();
+        auto elementSize = parentType.isPrimitive() ? getSizeInBytes (parentType)
+                                                    : getSizeInBytes (parentType.getElementType());
+
+        if (! (a.isDynamic() || parentType.isUnsizedArray()))
+            return getLocation (a.parent).withOffset ((uint32_t) (a.fixedStartIndex * elementSize));
+
+        if (a.isSlice())
+            a.location.throwError (Errors::notYetImplemented ("Slices of dynamic arrays"));
+
+        auto arraySize = parentType.isUnsizedArray() ? 0u : (uint32_t) parentType.getArrayOrVectorSize();
+        uint16_t flags = 0;
+        Offset index;
+
+        if (a.isDynamic())
+        {
+            auto indexType = a.dynamicIndex->getType().removeReferenceIfPresent();
+
+            if (a.isRangeTrusted || (indexType.isBoundedInt() && arraySize != 0 && indexType.getBoundedIntLimit() <= (int64_t) arraySize))
+                flags |= indexIsTrusted;
+
+            if (indexType.isPrimitive() && indexType.isInteger64())
+            {
+                index = compileExpression (*a.dynamicIndex);
+                flags |= indexIsInt64;
+            }
+            else
+            {
+                index = compileExpressionAs (*a.dynamicIndex, PrimitiveType::int32);
+            }
+        }
+        else
+        {
+            index = getConstant ((int32_t) a.fixedStartIndex);
+        }
+
+        auto parentLocation = getLocation (a.parent);
+        Offset base = parentLocation.offset;
+
+        if (parentType.isUnsizedArray())
+        {
+            flags |= baseIsPointer;
+
+            if (parentLocation.isPointer)
+                base = loadPointer (parentLocation);
+        }
+        else if (parentLocation.isPointer)
+        {
+            flags |= baseIsPointer;
+
+            if (parentLocation.pointerOffset != 0)
+            {
+                base = allocateTemporary (sizeof (void*));
+                emitAddressOf (base, parentLocation);
+            }
+        }
+
+        auto slot = allocateTemporary (sizeof (void*));
+        emit (OpCode::elementAddress, slot, base, index, arraySize, elementSize, flags);
+        return { slot, true, 0 };
+    }
+
+    //==============================================================================
+    Offset compileBinaryOperator (heart::BinaryOperator& b, std::optional<Offset> dest)
+    {
+        auto types = BinaryOp::getTypes (b.operation, b.lhs->getType(), b.rhs->getType());
+        auto operandFlat = getFlatType (types.operandType);
+
+        if (! operandFlat.has_value())
+            b.location.throwError (Errors::unsupportedType());
+
+        auto op = findTypedOpCode (getOperatorName (b.operation), operandFlat->kind, operandFlat->numElements > 1);
+
+        if (! op.has_value())
+            b.location.throwError (Errors::illegalTypesForBinaryOperator (BinaryOp::getSymbol (b.operation),
+                                                                          b.lhs->getType().getDescription(),
+                                                                          b.rhs->getType().getDescription()));
+
+        auto lhs = compileExpressionAs (b.lhs, types.operandType);
+        auto rhs = compileExpressionAs (b.rhs, types.operandType);
+        auto target = dest.has_value() ? *dest : allocateTemporary (getSizeInBytes (types.resultType));
+        emit (*op, target, lhs, rhs, operandFlat->numElements);
+
+        if (types.resultType.isBoundedInt())
+            emit (types.resultType.isWrapped() ? OpCode::wrapToLimit : OpCode::clampToLimit,
+                  target, target, 0, 1, types.resultType.getBoundedIntLimit());
+
+        return target;
+    }
+
+    Offset compileUnaryOperator (heart::UnaryOperator& u, std::optional<Offset> dest)
+    {
+        const auto& type = u.getType();
+        auto flat = getFlatType (type);
+
+        if (! flat.has_value())
+            u.location.throwError (Errors::unsupportedType());
+
+        auto op = findTypedOpCode (getOperatorName (u.operation), flat->kind, flat->numElements > 1);
+
+        if (! op.has_value())
+            u.location.throwError (Errors::wrongTypeForUnary());
+
+        auto source = compileExpression (u.source);
+        auto target = dest.has_value() ? *dest : allocateTemporary (getSizeInBytes (type));
+        emit (*op, target, source, 0, flat->numElements);
+        return target;
+    }
+
+    Offset compileTypeCast (heart::TypeCast& t, std::optional<Offset> dest)
+    {
+        if (! needsCast (t.source->getType(), t.destType))
+            return compileExpression (t.source, dest);
+
+        auto source = compileExpression (t.source);
+        auto target = dest.has_value() ? *dest : allocateTemporary (getSizeInBytes (t.destType));
+        emitCast (target, t.destType, source, t.source->getType());
+        return target;
+    }
+
+    Offset compileAggregate (heart::AggregateInitialiserList& a, std::optional<Offset> dest)
+    {
+        auto constant = a.getAsConstant();
+
+        if (constant.isValid())
+            return moveTo (dest, getConstant (constant), getSizeInBytes (a.type));
+
+        // Build into a temporary, in case the items read from the destination
+        auto size = getSizeInBytes (a.type);
+        auto target = allocateTemporary (size);
+        const auto& type = a.type;
+
+        if (type.isStruct() || type.isFixedSizeArray() || type.isVector())
+        {
+            emit (OpCode::zero, target, 0, 0, size);
+
+            for (size_t i = 0; i < a.items.size(); ++i)
+            {
+                Type itemType;
+                uint32_t offset;
+
+                if (type.isStruct())
+                {
+                    itemType = type.getStructRef().getMemberType (i);
+                    offset = getStructMemberOffset (type.getStructRef(), i);
+                }
+                else
+                {
+                    itemType = type.getElementType();
+                    offset = (uint32_t) i * getSizeInBytes (itemType);
+                }
+
+                compileExpressionInto (a.items[i], target + offset, itemType);
+            }
+        }
+        else
+        {
+            SOUL_ASSERT (a.items.size() == 1);
+            compileExpressionInto (a.items.front(), target, type);
+        }
+
+        return moveTo (dest, target, size);
+    }
+
+    //==============================================================================
+    static bool containsFunctionCall (heart::Expression& e)
+    {
+        if (is_type<heart::PureFunctionCall> (e))
+            return true;
+
+        bool found = false;
+
+        e.visitExpressions ([&] (pool_ref<heart::Expression>& sub, AccessType)
+                            {
+                                if (is_type<heart::PureFunctionCall> (sub))
+                                    found = true;
+                            }, AccessType::read);
+
+        return found;
+    }
+
+    // If resultMustPersist is false, the result may be left in the callee's return slot,
+    // so must be consumed before any other call is made.
+    std::optional<Offset> compileFunctionCall (heart::Function& f, ArgList& args,
+                                               std::optional<Offset> dest, bool resultMustPersist)
+    {
+        if (f.intrinsicType != IntrinsicType::none)
+            if (auto r = compileIntrinsic (f, args, dest))
+                return r;
+
+        if (f.hasNoBody)
+            f.location.throwError (Errors::functionHasNoImplementation());
+
+        auto& info = getFunctionInfo (f);
+        SOUL_ASSERT (args.size() == f.parameters.size());
+
+        bool argumentsMayClobberParameters = false;
+
+        for (auto& arg : args)
+            if (containsFunctionCall (arg))
+                argumentsMayClobberParameters = true;
+
+        if (argumentsMayClobberParameters)
+        {
+            std::vector<Offset> values;
+
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                auto& paramType = f.parameters[i]->type;
+
+                if (paramType.isReference())
+                {
+                    auto pointer = allocateTemporary (sizeof (void*));
+                    emitAddressOf (pointer, getLocation (args[i]));
+                    values.push_back (pointer);
+                }
+                else
+                {
+                    auto value = allocateTemporary (getSizeInBytes (paramType));
+                    compileExpressionInto (args[i], value, paramType);
+                    values.push_back (value);
+                }
+            }
+
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                auto& paramType = f.parameters[i]->type;
+                emitCopy (info.parameters[i], values[i], paramType.isReference() ? (uint32_t) sizeof (void*)
+                                                                                 : getSizeInBytes (paramType));
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                auto& paramType = f.parameters[i]->type;
+
+                if (paramType.isReference())
+                    emitAddressOf (info.parameters[i], getLocation (args[i]));
+                else
+                    compileExpressionInto (args[i], info.parameters[i], paramType);
+            }
+        }
+
+        callFixups.push_back ({ emit (OpCode::call), std::addressof (f) });
+
+        if (f.returnType.isVoid())
+            return {};
+
+        auto size = getSizeInBytes (f.returnType);
+
+        if (dest.has_value())
+            return moveTo (dest, info.returnValue, size);
+
+        if (resultMustPersist)
+            return moveTo (allocateTemporary (size), info.returnValue, size);
+
+        return info.returnValue;
+    }
+
+    std::optional<Offset> compileIntrinsic (heart::Function& f, ArgList& args, std::optional<Offset> dest)
+    {
+        if (f.intrinsicType == IntrinsicType::get_array_size)
+        {
+            auto arrayType = f.parameters.front()->type.removeReferenceIfPresent();
+
+            if (arrayType.isFixedSizeArray())
+                return moveTo (dest, getConstant ((int32_t) arrayType.getArraySize()), sizeof (int32_t));
+
+            if (! arrayType.isUnsizedArray())
+                return {};
+
+            auto location = getLocation (args.front());
+            auto pointer = location.isPointer ? loadPointer (location) : location.offset;
+            auto target = dest.has_value() ? *dest : allocateTemporary (sizeof (int32_t));
+            emit (OpCode::getArraySize, target, pointer);
+            return target;
+        }
+
+        auto op = findIntrinsicOpCode (f, 1);
+
+        if (! op.has_value())
+            return {};
+
+        auto paramType = f.parameters.front()->type.removeReferenceIfPresent();
+        Offset operands[3] = {};
+
+        for (size_t i = 0; i < args.size(); ++i)
+            operands[i] = compileExpressionAs (args[i], paramType);
+
+        auto target = dest.has_value() ? *dest : allocateTemporary (getSizeInBytes (f.returnType));
+        auto index = emit (*op, target, operands[0], operands[1], getFlatType (paramType)->numElements);
+        code[index].source3 = operands[2];
+        return target;
+    }
+
+    // Finds an instruction which implements an intrinsic directly, when applied to the given
+    // number of consecutive values of its parameter type.
+    static std::optional<OpCode> findIntrinsicOpCode (heart::Function& f, uint32_t numValues)
+    {
+        if (f.intrinsicType == IntrinsicType::none || f.parameters.empty() || f.parameters.size() > 3)
+            return {};
+
+        auto paramType = f.parameters.front()->type.removeReferenceIfPresent();
+        auto flat = getFlatType (paramType);
+
+        if (! flat.has_value() || flat->kind == ValueKind::b8 || paramType.isBoundedInt())
+            return {};
+
+        for (auto& p : f.parameters)
+            if (! layoutsMatch (p->type, paramType))
+                return {};
+
+        auto numElements = flat->numElements * numValues;
+
+        if (f.intrinsicType == IntrinsicType::clamp)
+        {
+            if (numElements != 1)
+                return {};
+
+            #define SOUL_INTERPRETER_MATCH_CLAMP(opName, type)  if (flat->kind == ValueKind::type) return OpCode::opName ## _ ## type;
+            SOUL_INTERPRETER_NUMERIC_TYPES (SOUL_INTERPRETER_MATCH_CLAMP, clamp)
+            #undef SOUL_INTERPRETER_MATCH_CLAMP
+            return {};
+        }
+
+        if (f.parameters.size() > 2)
+            return {};
+
+        return findTypedOpCode (getIntrinsicName (f.intrinsicType), flat->kind, numElements > 1);
+    }
+
+    //==============================================================================
+    uint32_t getEndpointIndex (const heart::IODeclaration& io, bool isInput) const
+    {
+        if (isInput)
+        {
+            for (uint32_t i = 0; i < module.inputs.size(); ++i)
+                if (std::addressof (module.inputs[i].get()) == std::addressof (io))
+                    return i;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < module.outputs.size(); ++i)
+                if (std::addressof (module.outputs[i].get()) == std::addressof (io))
+                    return i;
+        }
+
+        SOUL_ASSERT_FALSE;
+        return 0;
+    }
+
+    // For stream and value endpoints, finds the type and frame offset of the element being accessed
+    std::pair<Type, uint32_t> getEndpointElement (const heart::IODeclaration& io, pool_ptr<heart::Expression> element)
+    {
+        if (element == nullptr)
+            return { io.getFrameOrValueType(), 0 };
+
+        auto index = element->getAsConstant();
+
+        if (! index.isValid())
+            element->location.throwError (Errors::notYetImplemented ("Dynamic endpoint indexes"));
+
+        auto elementType = io.dataTypes.front();
+        auto arraySize = (int64_t) io.arraySize.value_or (1);
+        auto i = index.getAsInt64();
+
+        if (i < 0 || i >= arraySize)
+            element->location.throwError (Errors::indexOutOfRange());
+
+        return { elementType, (uint32_t) i * getSizeInBytes (elementType) };
+    }
+
+    void compileReadStream (heart::ReadStream& r)
+    {
+        auto& input = r.source.get();
+
+        if (input.isEventEndpoint())
+            r.location.throwError (Errors::cannotReadFromEventInput());
+
+        auto& endpoint = result->inputs[getEndpointIndex (input, true)];
+        auto element = getEndpointElement (input, r.element);
+        auto size = getSizeInBytes (element.first);
+        auto value = allocateTemporary (size);
+
+        if (input.isStreamEndpoint())
+            emit (OpCode::readStream, value, endpoint.bufferPointer, element.second,
+                  size, getSizeInBytes (input.getFrameType()));
+        else
+            emitCopy (value, endpoint.valueStorage + element.second, size);
+
+        assignResult (*r.target, value, element.first);
+    }
+
+    void compileWriteStream (heart::WriteStream& w)
+    {
+        auto& output = w.target.get();
+        auto outputIndex = getEndpointIndex (output, false);
+        auto& endpoint = result->outputs[outputIndex];
+
+        if (output.isEventEndpoint())
+        {
+            auto valueType = w.value->getType();
+            auto typeIndex = heart::Utilities::findMatchingEndpointType (program, valueType, output.dataTypes, w.location);
+
+            for (size_t i = 0; i < output.dataTypes.size() && ! typeIndex.has_value(); ++i)
+                if (TypeRules::canSilentlyCastTo (output.dataTypes[i], valueType))
+                    typeIndex = i;
+
+            if (! typeIndex.has_value())
+                w.location.throwError (Errors::wrongTypeForEndpoint());
+
+            auto value = compileExpressionAs (w.value, output.dataTypes[*typeIndex]);
+            Offset index = 0;
+
+            if (w.element != nullptr)
+                index = compileExpressionAs (*w.element, PrimitiveType::int32);
+
+            emit (OpCode::writeEvent, 0, value, index, w.element != nullptr ? 1 : 0,
+                  outputIndex, (uint16_t) *typeIndex);
+            return;
+        }
+
+        auto element = getEndpointElement (output, w.element);
+
+        if (output.isValueEndpoint())
+            return compileExpressionInto (w.value, endpoint.valueStorage + element.second, element.first);
+
+        auto flat = getFlatType (element.first);
+
+        if (! flat.has_value())
+            w.location.throwError (Errors::illegalTypeForEndpoint());
+
+        auto value = compileExpressionAs (w.value, element.first);
+        auto frameSize = getSizeInBytes (output.getFrameType());
+
+        switch (flat->kind)
+        {
+            case ValueKind::i32:  emit (OpCode::writeStream_i32, endpoint.bufferPointer, value, element.second, flat->numElements, frameSize); break;
+            case ValueKind::i64:  emit (OpCode::writeStream_i64, endpoint.bufferPointer, value, element.second, flat->numElements, frameSize); break;
+            case ValueKind::f32:  emit (OpCode::writeStream_f32, endpoint.bufferPointer, value, element.second, flat->numElements, frameSize); break;
+            case ValueKind::f64:  emit (OpCode::writeStream_f64, endpoint.bufferPointer, value, element.second, flat->numElements, frameSize); break;
+            case ValueKind::b8:
+            default:              emit (OpCode::writeStream_b8,  endpoint.bufferPointer, value, element.second, getSizeInBytes (element.first), frameSize); break;
+        }
+    }
+
+    //==============================================================================
+    // A loop which VectorisableLoop has found gets compiled twice. The block version comes
+    // first, and runs whenever at least framesPerBlock frames remain before run() has to be
+    // suspended: each of its per-frame values holds that many frames side-by-side, so every
+    // instruction does a block's worth of work. Values which are the same for every frame are
+    // calculated once per block and broadcast. The normal version handles any frames left over.
+    static constexpr uint32_t framesPerBlock = 16;
+
+    const VectorisableLoop* currentLoop = nullptr;
+    std::unordered_map<const heart::Variable*, Offset> blockVariables;
+
+    bool canCompileBlockLoop (const VectorisableLoop& loop)
+    {
+        currentLoop = std::addressof (loop);
+        bool ok = true;
+
+        for (auto& v : loop.perFrameVariables)
+            if (! isBlockType (v->type))
+                ok = false;
+
+        for (auto s : loop.block.statements)
+            if (ok && ! canCompileForBlock (*s))
+                ok = false;
+
+        currentLoop = nullptr;
+        return ok;
+    }
+
+    static bool isBlockType (const Type& type)
+    {
+        return getFlatType (type).has_value() && ! type.isBoundedInt();
+    }
+
+    static bool canConvertForBlock (const Type& source, const Type& dest)
+    {
+        if (! needsCast (source, dest))
+            return true;
+
+        auto sourceFlat = getFlatType (source);
+        auto destFlat = getFlatType (dest);
+
+        return sourceFlat.has_value() && destFlat.has_value() && ! dest.isBoundedInt()
+                && sourceFlat->numElements == destFlat->numElements;
+    }
+
+    bool canCompileForBlock (heart::Expression& e, const Type& type)
+    {
+        if (! currentLoop->isPerFrame (e))
+            return true;
+
+        return canCompileForBlock (e) && canConvertForBlock (e.getType(), type);
+    }
+
+    bool canCompileForBlock (heart::Expression& e)
+    {
+        if (! isBlockType (e.getType()))
+            return false;
+
+        if (is_type<heart::Variable> (e))
+            return true;
+
+        if (auto b = cast<heart::BinaryOperator> (e))
+        {
+            auto types = BinaryOp::getTypes (b->operation, b->lhs->getType(), b->rhs->getType());
+
+            return isBlockType (types.operandType) && isBlockType (types.resultType)
+                    && findTypedOpCode (getOperatorName (b->operation), getFlatType (types.operandType)->kind, true).has_value()
+                    && canCompileForBlock (b->lhs, types.operandType)
+                    && canCompileForBlock (b->rhs, types.operandType);
+        }
+
+        if (auto u = cast<heart::UnaryOperator> (e))
+            return findTypedOpCode (getOperatorName (u->operation), getFlatType (u->getType())->kind, true).has_value()
+                    && canCompileForBlock (u->source, u->getType());
+
+        if (auto t = cast<heart::TypeCast> (e))
+            return canCompileForBlock (t->source, t->destType);
+
+        if (auto f = cast<heart::PureFunctionCall> (e))
+            return canCompileIntrinsicForBlock (f->function, f->arguments);
+
+        return false;
+    }
+
+    template <typename ArgListType>
+    bool canCompileIntrinsicForBlock (heart::Function& f, ArgListType& args)
+    {
+        if (! findIntrinsicOpCode (f, framesPerBlock).has_value())
+            return false;
+
+        for (auto& arg : args)
+            if (! canCompileForBlock (arg, f.parameters.front()->type.removeReferenceIfPresent()))
+                return false;
+
+        return true;
+    }
+
+    bool canCompileForBlock (heart::Statement& s)
+    {
+        if (is_type<heart::AdvanceClock> (s))
+            return true;
+
+        if (auto a = cast<heart::AssignFromValue> (s))
+            return canCompileForBlock (a->source, a->target->getType());
+
+        if (auto r = cast<heart::ReadStream> (s))
+            return canConvertForBlock (getEndpointElement (r->source, r->element).first, r->target->getType());
+
+        if (auto w = cast<heart::WriteStream> (s))
+        {
+            auto elementType = getEndpointElement (w->target, w->element).first;
+            return isBlockType (elementType) && canCompileForBlock (w->value, elementType);
+        }
+
+        if (auto call = cast<heart::FunctionCall> (s))
+        {
+            auto& f = call->getFunction();
+
+            return call->target == nullptr
+                    || (canCompileIntrinsicForBlock (f, call->arguments) && canConvertForBlock (f.returnType, call->target->getType()));
+        }
+
+        return false;
+    }
+
+    //==============================================================================
+    void compileBlockLoop (const VectorisableLoop& loop)
+    {
+        currentLoop = std::addressof (loop);
+        blockVariables.clear();
+
+        for (auto& v : loop.perFrameVariables)
+            blockVariables[v.getPointer()] = allocate (getSizeInBytes (v->type) * framesPerBlock);
+
+        auto start = (uint32_t) code.size();
+        auto enter = emit (OpCode::enterBlockLoop, 0, 0, 0, framesPerBlock);
+
+        for (auto s : loop.block.statements)
+        {
+            currentLocation = s->location;
+            compileBlockStatement (*s);
+            releaseTemporaries();
+        }
+
+        emit (OpCode::jump, 0, 0, 0, 1, start);
+        code[enter].param = (int64_t) code.size();
+        currentLoop = nullptr;
+    }
+
+    void compileBlockStatement (heart::Statement& s)
+    {
+        if (is_type<heart::AdvanceClock> (s))
+        {
+            emit (OpCode::advanceBlock, 0, 0, 0, framesPerBlock);
+            return;
+        }
+
+        if (auto a = cast<heart::AssignFromValue> (s))
+        {
+            const auto& type = a->target->getType();
+            return assignBlockResult (*a->target, compileBlockExpressionAs (a->source, type), type);
+        }
+
+        if (auto call = cast<heart::FunctionCall> (s))
+        {
+            if (call->target != nullptr)
+            {
+                auto& f = call->getFunction();
+                assignBlockResult (*call->target, compileBlockIntrinsic (f, call->arguments), f.returnType);
+            }
+
+            return;
+        }
+
+        if (auto r = cast<heart::ReadStream> (s))     return compileBlockReadStream (*r);
+        if (auto w = cast<heart::WriteStream> (s))    return compileBlockWriteStream (*w);
+
+        SOUL_ASSERT_FALSE;
+    }
+
+    void compileBlockReadStream (heart::ReadStream& r)
+    {
+        auto& input = r.source.get();
+        auto& endpoint = result->inputs[getEndpointIndex (input, true)];
+        auto element = getEndpointElement (input, r.element);
+        auto size = getSizeInBytes (element.first);
+        auto value = allocateTemporary (size * framesPerBlock);
+
+        if (input.isStreamEndpoint())
+        {
+            auto index = emit (OpCode::readStreamFrames, value, endpoint.bufferPointer, element.second,
+                               framesPerBlock, getSizeInBytes (input.getFrameType()));
+            code[index].source3 = size;
+        }
+        else
+        {
+            emit (OpCode::broadcast, value, endpoint.valueStorage + element.second, 0, framesPerBlock, size);
+        }
+
+        assignBlockResult (*r.target, value, element.first);
+    }
+
+    void compileBlockWriteStream (heart::WriteStream& w)
+    {
+        auto& output = w.target.get();
+        auto& endpoint = result->outputs[getEndpointIndex (output, false)];
+        auto element = getEndpointElement (output, w.element);
+        auto flat = *getFlatType (element.first);
+        auto value = compileBlockExpressionAs (w.value, element.first);
+        auto frameSize = getSizeInBytes (output.getFrameType());
+        size_t index;
+
+        switch (flat.kind)
+        {
+            case ValueKind::i32:  index = emit (OpCode::writeStreamFrames_i32, endpoint.bufferPointer, value, element.second, framesPerBlock, frameSize); break;
+            case ValueKind::i64:  index = emit (OpCode::writeStreamFrames_i64, endpoint.bufferPointer, value, element.second, framesPerBlock, frameSize); break;
+            case ValueKind::f32:  index = emit (OpCode::writeStreamFrames_f32, endpoint.bufferPointer, value, element.second, framesPerBlock, frameSize); break;
+            case ValueKind::f64:  index = emit (OpCode::writeStreamFrames_f64, endpoint.bufferPointer, value, element.second, framesPerBlock, frameSize); break;
+            case ValueKind::b8:
+            default:              index = emit (OpCode::writeStreamFrames_b8,  endpoint.bufferPointer, value, element.second, framesPerBlock, frameSize); break;
+        }
+
+        code[index].source3 = flat.kind == ValueKind::b8 ? getSizeInBytes (element.first) : flat.numElements;
+    }
+
+    void assignBlockResult (heart::Expression& target, Offset value, const Type& valueType)
+    {
+        auto v = cast<heart::Variable> (target);
+        SOUL_ASSERT (v != nullptr);
+        emitBlockConvert (blockVariables[v.get()], v->type, value, valueType);
+    }
+
+    void emitBlockConvert (Offset dest, const Type& destType, Offset source, const Type& sourceType)
+    {
+        if (! needsCast (sourceType, destType))
+            return emitCopy (dest, source, getSizeInBytes (destType) * framesPerBlock);
+
+        auto destFlat = *getFlatType (destType);
+        emitConvert (dest, destFlat.kind, source, getFlatType (sourceType)->kind, destFlat.numElements * framesPerBlock);
+    }
+
+    Offset compileBlockExpressionAs (heart::Expression& e, const Type& type)
+    {
+        if (! currentLoop->isPerFrame (e))
+        {
+            auto constant = e.getAsConstant();
+
+            if (constant.isValid() && ! needsCast (constant.getType(), type))
+                return getBlockConstant (constant);
+
+            auto size = getSizeInBytes (type);
+            auto target = allocateTemporary (size * framesPerBlock);
+            emit (OpCode::broadcast, target, compileExpressionAs (e, type), 0, framesPerBlock, size);
+            return target;
+        }
+
+        auto value = compileBlockExpression (e);
+
+        if (! needsCast (e.getType(), type))
+            return value;
+
+        auto target = allocateTemporary (getSizeInBytes (type) * framesPerBlock);
+        emitBlockConvert (target, type, value, e.getType());
+        return target;
+    }
+
+    Offset compileBlockExpression (heart::Expression& e)
+    {
+        if (! currentLoop->isPerFrame (e))
+            return compileBlockExpressionAs (e, e.getType());
+
+        if (auto v = cast<heart::Variable> (e))
+        {
+            auto found = blockVariables.find (v.get());
+            SOUL_ASSERT (found != blockVariables.end());
+            return found->second;
+        }
+
+        if (auto b = cast<heart::BinaryOperator> (e))
+        {
+            auto types = BinaryOp::getTypes (b->operation, b->lhs->getType(), b->rhs->getType());
+            auto operandFlat = *getFlatType (types.operandType);
+            auto lhs = compileBlockExpressionAs (b->lhs, types.operandType);
+            auto rhs = compileBlockExpressionAs (b->rhs, types.operandType);
+            auto target = allocateTemporary (getSizeInBytes (types.resultType) * framesPerBlock);
+            emit (*findTypedOpCode (getOperatorName (b->operation), operandFlat.kind, true),
+                  target, lhs, rhs, operandFlat.numElements * framesPerBlock);
+            return target;
+        }
+
+        if (auto u = cast<heart::UnaryOperator> (e))
+        {
+            const auto& type = u->getType();
+            auto flat = *getFlatType (type);
+            auto source = compileBlockExpressionAs (u->source, type);
+            auto target = allocateTemporary (getSizeInBytes (type) * framesPerBlock);
+            emit (*findTypedOpCode (getOperatorName (u->operation), flat.kind, true),
+                  target, source, 0, flat.numElements * framesPerBlock);
+            return target;
+        }
+
+        if (auto t = cast<heart::TypeCast> (e))
+            return compileBlockExpressionAs (t->source, t->destType);
+
+        if (auto f = cast<heart::PureFunctionCall> (e))
+            return compileBlockIntrinsic (f->function, f->arguments);
+
+        SOUL_ASSERT_FALSE;
+        return 0;
+    }
+
+    template <typename ArgListType>
+    Offset compileBlockIntrinsic (heart::Function& f, ArgListType& args)
+    {
+        auto paramType = f.parameters.front()->type.removeReferenceIfPresent();
+        Offset operands[2] = {};
+
+        for (size_t i = 0; i < args.size(); ++i)
+            operands[i] = compileBlockExpressionAs (args[i], paramType);
+
+        auto target = allocateTemporary (getSizeInBytes (f.returnType) * framesPerBlock);
+        emit (*findIntrinsicOpCode (f, framesPerBlock), target, operands[0], operands[1],
+              getFlatType (paramType)->numElements * framesPerBlock);
+        return target;
+    }
+
+    Offset getBlockConstant (const Value& value)
+    {
+        auto size = (uint32_t) value.getPackedDataSize();
+        auto key = std::to_string (framesPerBlock) + "*" + value.getType().getDescription()
+                     + std::string (static_cast<const char*> (value.getPackedData()), size);
+
+        auto found = constants.find (key);
+
+        if (found != constants.end())
+            return found->second;
+
+        auto offset = allocate (size * framesPerBlock);
+
+        for (uint32_t i = 0; i < framesPerBlock; ++i)
+            writeConstant (offset + i * size, value);
+
+        constants[key] = offset;
+        return offset;
+    }
+
+    //==============================================================================
+    void compileFunction (heart::Function& f)
+    {
+        auto& info = getFunctionInfo (f);
+        currentFunction = std::addressof (f);
+        currentFunctionInfo = std::addressof (info);
+        currentLocation = f.location;
+        info.entryPoint = (uint32_t) code.size();
+
+        if (f.blocks.empty())
+            f.location.throwError (Errors::emptyFunction (f.name));
+
+        std::unordered_map<const heart::Block*, uint32_t> blockStarts;
+        std::vector<BlockFixup> fixups;
+        auto loop = VectorisableLoop::find (f);
+
+        if (loop.has_value() && ! canCompileBlockLoop (*loop))
+            loop.reset();
+
+        for (size_t i = 0; i < f.blocks.size(); ++i)
+        {
+            auto& block = f.blocks[i].get();
+            auto nextBlock = i + 1 < f.blocks.size() ? f.blocks[i + 1].getPointer() : nullptr;
+            blockStarts[std::addressof (block)] = (uint32_t) code.size();
+
+            if (loop.has_value() && std::addressof (loop->block) == std::addressof (block))
+                compileBlockLoop (*loop);
+
+            for (auto s : block.statements)
+            {
+                currentLocation = s->location;
+                compileStatement (*s);
+                releaseTemporaries();
+            }
+
+            SOUL_ASSERT (block.terminator != nullptr);
+            compileTerminator (*block.terminator, nextBlock, fixups);
+            releaseTemporaries();
+        }
+
+        for (auto& fixup : fixups)
+        {
+            auto target = blockStarts[fixup.block];
+
+            if (fixup.isFalseTarget)
+                code[fixup.instruction].size = target;
+            else
+                code[fixup.instruction].param = target;
+        }
+
+        currentFunction = nullptr;
+        currentFunctionInfo = nullptr;
+    }
+
+    void compileStateInitialisers()
+    {
+        if (variablesToInitialise.empty())
+            return;
+
+        FunctionInfo info;
+        currentFunctionInfo = std::addressof (info);
+        result->stateInitialisers = (uint32_t) code.size();
+
+        for (auto v : variablesToInitialise)
+        {
+            currentLocation = v->location;
+            compileAssignment (*v, *v->initialValue);
+            releaseTemporaries();
+        }
+
+        emit (OpCode::ret);
+        currentFunctionInfo = nullptr;
+    }
+
+    void compileStatement (heart::Statement& s)
+    {
+        if (auto a = cast<heart::AssignFromValue> (s))
+            return compileAssignment (*a->target, a->source);
+
+        if (auto call = cast<heart::FunctionCall> (s))
+        {
+            auto& f = call->getFunction();
+            auto r = compileFunctionCall (f, call->arguments, {}, false);
+
+            if (call->target != nullptr && r.has_value())
+                assignResult (*call->target, *r, f.returnType);
+
+            return;
+        }
+
+        if (auto r = cast<heart::ReadStream> (s))     return compileReadStream (*r);
+        if (auto w = cast<heart::WriteStream> (s))    return compileWriteStream (*w);
+
+        if (is_type<heart::AdvanceClock> (s))
+        {
+            emit (OpCode::advance);
+            return;
+        }
+
+        SOUL_ASSERT_FALSE;
+    }
+
+    void compileBlockArguments (heart::Block& target, ArgList& args)
+    {
+        if (args.empty())
+            return;
+
+        SOUL_ASSERT (args.size() == target.parameters.size());
+        bool argsReadParameters = false;
+
+        if (args.size() > 1)
+            for (auto& arg : args)
+                for (auto& p : target.parameters)
+                    if (arg->readsVariable (p))
+                        argsReadParameters = true;
+
+        if (! argsReadParameters)
+        {
+            for (size_t i = 0; i < args.size(); ++i)
+                compileExpressionInto (args[i], getVariableLocation (target.parameters[i]).offset, target.parameters[i]->type);
+
+            return;
+        }
+
+        std::vector<Offset> values;
+
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            auto& type = target.parameters[i]->type;
+            auto value = allocateTemporary (getSizeInBytes (type));
+            compileExpressionInto (args[i], value, type);
+            values.push_back (value);
+        }
+
+        for (size_t i = 0; i < args.size(); ++i)
+            emitCopy (getVariableLocation (target.parameters[i]).offset, values[i],
+                      getSizeInBytes (target.parameters[i]->type));
+    }
+
+    void emitJump (heart::Block& target, const heart::Block* nextBlock, std::vector<BlockFixup>& fixups)
+    {
+        if (std::addressof (target) != nextBlock)
+            fixups.push_back ({ emit (OpCode::jump), std::addressof (target), false });
+    }
+
+    void compileTerminator (heart::Terminator& t, const heart::Block* nextBlock, std::vector<BlockFixup>& fixups)
+    {
+        if (auto b = cast<heart::Branch> (t))
+        {
+            compileBlockArguments (b->target, b->targetArgs);
+            return emitJump (b->target, nextBlock, fixups);
+        }
+
+        if (auto b = cast<heart::BranchIf> (t))
+        {
+            auto condition = compileExpressionAs (b->condition, PrimitiveType::bool_);
+
+            if (b->targetArgs[0].empty() && b->targetArgs[1].empty())
+            {
+                auto branch = emit (OpCode::branchIf, 0, condition);
+                fixups.push_back ({ branch, b->targets[0].getPointer(), false });
+                fixups.push_back ({ branch, b->targets[1].getPointer(), true });
+                return;
+            }
+
+            // When the targets take arguments, each path needs its own moves before jumping
+            auto branch = emit (OpCode::branchIf, 0, condition);
+            code[branch].param = (int64_t) code.size();
+            compileBlockArguments (b->targets[0], b->targetArgs[0]);
+            fixups.push_back ({ emit (OpCode::jump), b->targets[0].getPointer(), false });
+            code[branch].size = (uint32_t) code.size();
+            compileBlockArguments (b->targets[1], b->targetArgs[1]);
+            return emitJump (b->targets[1], nextBlock, fixups);
+        }
+
+        if (auto r = cast<heart::ReturnValue> (t))
+        {
+            compileExpressionInto (r->returnValue, currentFunctionInfo->returnValue, currentFunction->returnType);
+            emit (OpCode::ret);
+            return;
+        }
+
+        SOUL_ASSERT (is_type<heart::ReturnVoid> (t));
+        emit (currentFunction->functionType.isRun() ? OpCode::finishRun : OpCode::ret);
+    }
+};
+
+} // namespace soul::interpreter
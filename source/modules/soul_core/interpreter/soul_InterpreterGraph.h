@@ -0,0 +1,1262 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul::interpreter
+{
+
+//==============================================================================
+/** A queue of time-stamped events held in fixed-size slots, and kept sorted by time.
+    Events with the same time-stamp stay in the order in which they were added.
+*/
+class EventQueue
+{
+public:
+    struct Header
+    {
+        int64_t frame;
+        int32_t element;
+        uint32_t typeIndex;
+    };
+
+    void initialise (uint32_t maxPayloadSize, uint32_t maxNumEvents)
+    {
+        slotSize = (uint32_t) getAlignedSize<8> (sizeof (Header) + maxPayloadSize);
+        capacity = maxNumEvents;
+        storage.resize (slotSize * (size_t) capacity / 8);
+        clear();
+    }
+
+    void clear()                                { start = 0; end = 0; }
+    bool isEmpty() const                        { return start == end; }
+    uint32_t size() const                       { return end - start; }
+
+    const Header& getHeader (uint32_t index) const      { return *reinterpret_cast<const Header*> (getSlot (start + index)); }
+    const uint8_t* getData (uint32_t index) const       { return getSlot (start + index) + sizeof (Header); }
+    const Header& front() const                         { return getHeader (0); }
+    const uint8_t* frontData() const                    { return getData (0); }
+
+    void removeFront (uint32_t num = 1)
+    {
+        SOUL_ASSERT (num <= size());
+        start += num;
+
+        if (start == end)
+            clear();
+    }
+
+    /** Returns false if the queue is full. */
+    bool add (int64_t frame, uint32_t typeIndex, int32_t element, const void* data, uint32_t dataSize)
+    {
+        SOUL_ASSERT (sizeof (Header) + dataSize <= slotSize);
+
+        if (end == capacity)
+        {
+            if (start == 0)
+                return false;
+
+            memmove (getSlot (0), getSlot (start), (size_t) (end - start) * slotSize);
+            end -= start;
+            start = 0;
+        }
+
+        auto position = end;
+
+        while (position > start && reinterpret_cast<const Header*> (getSlot (position - 1))->frame > frame)
+            --position;
+
+        if (position != end)
+            memmove (getSlot (position + 1), getSlot (position), (size_t) (end - position) * slotSize);
+
+        auto slot = getSlot (position);
+        *reinterpret_cast<Header*> (slot) = { frame, element, typeIndex };
+        memcpy (slot + sizeof (Header), data, dataSize);
+        ++end;
+        return true;
+    }
+
+private:
+    std::vector<uint64_t> storage;
+    uint32_t slotSize = 0, capacity = 0, start = 0, end = 0;
+
+    uint8_t* getSlot (uint32_t index) const     { return reinterpret_cast<uint8_t*> (const_cast<uint64_t*> (storage.data())) + (size_t) index * slotSize; }
+};
+
+//==============================================================================
+/** Keeps the most recent frames of a stream, so that delayed or resampled
+    connections can read from earlier chunks.
+*/
+struct StreamHistory
+{
+    void initialise (uint32_t minNumFrames, uint32_t bytesPerFrame)
+    {
+        numFrames = 1;
+
+        while (numFrames < minNumFrames)
+            numFrames *= 2;
+
+        frameSize = bytesPerFrame;
+        data.resize ((size_t) numFrames * frameSize);
+        clear();
+    }
+
+    void clear()
+    {
+        std::fill (data.begin(), data.end(), (uint8_t) 0);
+        numWritten = 0;
+    }
+
+    bool isActive() const   { return frameSize != 0; }
+
+    void append (int64_t firstFrame, const uint8_t* frames, uint32_t num)
+    {
+        for (uint32_t i = 0; i < num; ++i)
+            memcpy (getFrameData (firstFrame + i), frames + (size_t) i * frameSize, frameSize);
+
+        numWritten = firstFrame + num;
+    }
+
+    const uint8_t* getFrame (int64_t frame) const
+    {
+        if (frame < 0 || frame >= numWritten || frame < numWritten - numFrames)
+            return nullptr;
+
+        return getFrameData (frame);
+    }
+
+private:
+    std::vector<uint8_t> data;
+    uint32_t numFrames = 0, frameSize = 0;
+    int64_t numWritten = 0;
+
+    uint8_t* getFrameData (int64_t frame) const   { return const_cast<uint8_t*> (data.data()) + (size_t) (frame & (numFrames - 1)) * frameSize; }
+};
+
+//==============================================================================
+/** The properties of an endpoint that the graph needs when moving data around. */
+struct PortInfo
+{
+    PortInfo (const heart::IODeclaration& io) : declaration (io)
+    {
+        arraySize = io.arraySize.value_or (0);
+
+        for (auto& t : io.dataTypes)
+            maxDataSize = std::max (maxDataSize, getSizeInBytes (t));
+
+        if (! io.isEventEndpoint())
+        {
+            elementSize = getSizeInBytes (io.dataTypes.front());
+            frameSize = getSizeInBytes (io.getFrameOrValueType());
+            maxDataSize = std::max (maxDataSize, frameSize);
+        }
+    }
+
+    Type getElementType (int32_t element) const
+    {
+        return element >= 0 ? declaration.dataTypes.front() : declaration.getFrameOrValueType();
+    }
+
+    uint32_t getElementOffset (int32_t element) const     { return element >= 0 ? (uint32_t) element * elementSize : 0; }
+
+    const heart::IODeclaration& declaration;
+    uint32_t arraySize = 0, elementSize = 0, frameSize = 0, maxDataSize = 0;
+};
+
+//==============================================================================
+/** A flattened version of a program's graph, in which every processor instance becomes
+    a node, and every connection has been traced through the intermediate graphs to
+    become a direct route between two nodes.
+
+    The input and output endpoints of the main processor are represented by two extra
+    nodes. Rendering is done in chunks, processing each node in topological order, with
+    the chunk size limited by the shortest delay on any feedback connection.
+
+    The instances in an array of processors share a ProcessorState, with a lane each, and
+    are rendered together so that they run in lockstep. A processor can opt out of this
+    with the annotation [[ lockstep: false ]].
+*/
+class Graph
+{
+public:
+    Graph (Program& p, const std::vector<std::unique_ptr<CompiledModule>>& modules,
+           uint32_t maxBlock, uint32_t maxEvents)
+        : program (p), compiledModules (modules), maxBlockSize (maxBlock), maxEventsPerChunk (maxEvents)
+    {
+    }
+
+    void build (Module& mainModule)
+    {
+        auto flattened = FlattenedGraph::build (program, mainModule);
+
+        for (uint32_t i = 0; i < flattened.nodes.size(); ++i)
+        {
+            auto& n = flattened.nodes[i];
+            createNode (flattened.getNodeName (i), n.module != nullptr ? std::addressof (getCompiledModule (*n.module)) : nullptr,
+                        n.ratio, n.instanceID);
+        }
+
+        inputBoundary = flattened.inputBoundary;
+        outputBoundary = flattened.outputBoundary;
+
+        for (auto& i : mainModule.inputs)
+            nodes[inputBoundary]->outputs.emplace_back (i.get());
+
+        for (auto& o : mainModule.outputs)
+            nodes[outputBoundary]->inputs.emplace_back (o.get());
+
+        createRoutes (flattened);
+        createProcessingSteps (flattened);
+        chooseMaxChunkSize();
+        allocateBuffers();
+    }
+
+    void reset (double sampleRate, int32_t sessionID)
+    {
+        for (auto& n : nodes)
+        {
+            n->frameStart = 0;
+            n->frameEnd = 0;
+
+            for (auto& i : n->inputs)
+                i.events.clear();
+
+            for (auto& o : n->outputs)
+            {
+                o.events.clear();
+                o.history.clear();
+                std::fill (o.value.begin(), o.value.end(), (uint8_t) 0);
+            }
+
+            if (n->state != nullptr)
+                n->state->reset (n->lane, sampleRate * n->ratio.toDouble(), n->instanceID, sessionID,
+                                 (int32_t) n->state->module.module.latency);
+        }
+
+        for (auto& i : inputEvents)
+            i.clear();
+
+        totalFramesRendered = 0;
+        xruns = 0;
+    }
+
+    //==============================================================================
+    /** Provides the block of frames for a top-level stream input for the next render() call. */
+    void setInputStreamFrames (uint32_t input, const uint8_t* frames)     { inputStreamFrames[input] = frames; }
+
+    /** Adds an event to a top-level input, at a frame relative to the start of the next render() call. */
+    bool addInputEvent (uint32_t input, uint32_t frame, uint32_t typeIndex, const void* data, uint32_t size)
+    {
+        if (inputEvents[input].add (totalFramesRendered + frame, typeIndex, -1, data, size))
+            return true;
+
+        ++xruns;
+        return false;
+    }
+
+    uint8_t* getInputValue (uint32_t input)             { return nodes[inputBoundary]->outputs[input].value.data(); }
+    const uint8_t* getOutputValue (uint32_t output)     { return nodes[outputBoundary]->inputs[output].value.data(); }
+    const uint8_t* getOutputStreamFrames (uint32_t output)    { return nodes[outputBoundary]->inputs[output].buffer.data(); }
+
+    /** Returns the events which were emitted by a top-level output during the last render() call.
+        The frame numbers are relative to the start of the block. Call removeOutputEvents()
+        when they've been consumed.
+    */
+    template <typename Callback>
+    uint32_t iterateOutputEvents (uint32_t output, Callback&& callback)
+    {
+        auto& queue = nodes[outputBoundary]->inputs[output].events;
+        auto blockStart = totalFramesRendered - lastBlockSize;
+        uint32_t num = 0;
+
+        for (; num < queue.size(); ++num)
+        {
+            auto& header = queue.getHeader (num);
+
+            if (header.frame >= totalFramesRendered)
+                break;
+
+            if (! callback ((uint32_t) std::max ((int64_t) 0, header.frame - blockStart), header.typeIndex, queue.getData (num)))
+                break;
+        }
+
+        return num;
+    }
+
+    void removeOutputEvents()
+    {
+        for (auto& i : nodes[outputBoundary]->inputs)
+        {
+            while (! i.events.isEmpty() && i.events.front().frame < totalFramesRendered)
+                i.events.removeFront();
+        }
+    }
+
+    void render (uint32_t numFrames)
+    {
+        SOUL_ASSERT (numFrames <= maxBlockSize);
+        auto blockStart = totalFramesRendered;
+        uint32_t done = 0;
+
+        do
+        {
+            auto numToDo = std::min (numFrames - done, maxChunkSize);
+            renderChunk (blockStart, done, numToDo);
+            done += numToDo;
+        }
+        while (done < numFrames);
+
+        totalFramesRendered += numFrames;
+        lastBlockSize = numFrames;
+    }
+
+    uint32_t getXRuns() const    { return xruns; }
+
+private:
+    //==============================================================================
+    struct InputPort
+    {
+        InputPort (const heart::IODeclaration& io) : info (io) {}
+
+        PortInfo info;
+        std::vector<uint8_t> buffer, value;
+        uint8_t* frames = nullptr;
+        std::vector<uint32_t> routes;
+        EventQueue events;
+        bool isAliased = false;
+    };
+
+    struct OutputPort
+    {
+        OutputPort (const heart::IODeclaration& io) : info (io) {}
+
+        PortInfo info;
+        std::vector<uint8_t> buffer, value;
+        uint8_t* frames = nullptr;
+        std::vector<uint32_t> routes;
+        EventQueue events;
+        StreamHistory history;
+    };
+
+    struct Node  : public EventSink
+    {
+        Node (Graph& g) : graph (g) {}
+
+        void handleEvent (uint32_t outputIndex, uint32_t frame, uint32_t typeIndex, int32_t element, const void* data) override
+        {
+            auto& output = outputs[outputIndex];
+
+            if (! output.events.add (frameStart + frame, typeIndex, element, data,
+                                     getSizeInBytes (output.info.declaration.dataTypes[typeIndex])))
+                ++graph.xruns;
+        }
+
+        uint8_t* getInputValue (uint32_t index) const
+        {
+            if (state != nullptr)
+                return state->getMemory (lane, state->module.inputs[index].valueStorage);
+
+            return const_cast<uint8_t*> (inputs[index].value.data());
+        }
+
+        const uint8_t* getOutputValue (uint32_t index) const
+        {
+            if (state != nullptr)
+                return state->getMemory (lane, state->module.outputs[index].valueStorage);
+
+            return outputs[index].value.data();
+        }
+
+        Graph& graph;
+        std::string name;
+        const CompiledModule* module = nullptr;
+        ProcessorState* state = nullptr;
+        uint32_t lane = 0;
+        ClockRatio ratio;
+        int32_t instanceID = 0;
+        int64_t frameStart = 0, frameEnd = 0;
+        std::vector<InputPort> inputs;
+        std::vector<OutputPort> outputs;
+    };
+
+    struct Route  : public FlattenedGraph::Route
+    {
+        Route (const FlattenedGraph::Route& r) : FlattenedGraph::Route (r) {}
+
+        // For streams:
+        uint32_t sourceOffset = 0, destOffset = 0, numElements = 0;
+        ValueKind sourceKind = ValueKind::f32, destKind = ValueKind::f32;
+        bool broadcastSource = false;
+
+        // For streams resampled with a sinc interpolator, the filters and a buffer to
+        // gather the source frames into, with one block of frames per element
+        std::unique_ptr<SincFilterBank<double>> sincFilters;
+        std::vector<double> sincWindow;
+        uint32_t sincWindowSize = 0;
+
+        // For events, the index of the destination type for each type of the source
+        std::vector<int32_t> typeMap;
+    };
+
+    Program& program;
+    const std::vector<std::unique_ptr<CompiledModule>>& compiledModules;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<std::unique_ptr<ProcessorState>> states;
+    std::vector<std::vector<uint32_t>> processingSteps;
+    std::vector<uint32_t> stepPositions;
+    std::vector<Route> routes;
+    uint32_t inputBoundary = 0, outputBoundary = 0;
+    uint32_t maxBlockSize, maxEventsPerChunk, maxChunkSize = 1, lastBlockSize = 0;
+    std::vector<const uint8_t*> inputStreamFrames;
+    std::vector<EventQueue> inputEvents;
+    int64_t totalFramesRendered = 0;
+    uint32_t xruns = 0;
+
+    //==============================================================================
+    uint32_t createNode (std::string name, const CompiledModule* module, ClockRatio ratio, int32_t instanceID)
+    {
+        auto n = std::make_unique<Node> (*this);
+        n->name = std::move (name);
+        n->ratio = ratio;
+        n->instanceID = instanceID;
+        n->module = module;
+
+        if (module != nullptr)
+        {
+            for (auto& i : module->module.inputs)   n->inputs.emplace_back (i.get());
+            for (auto& o : module->module.outputs)  n->outputs.emplace_back (o.get());
+        }
+
+        nodes.push_back (std::move (n));
+        return (uint32_t) nodes.size() - 1;
+    }
+
+    const CompiledModule& getCompiledModule (const Module& m) const
+    {
+        for (auto& c : compiledModules)
+            if (std::addressof (c->module) == std::addressof (m))
+                return *c;
+
+        SOUL_ASSERT_FALSE;
+        return *compiledModules.front();
+    }
+
+    //==============================================================================
+    void createRoutes (const FlattenedGraph& flattened)
+    {
+        for (auto& r : flattened.routes)
+            addRoute (flattened, r);
+
+        for (uint32_t i = 0; i < routes.size(); ++i)
+        {
+            auto& r = routes[i];
+            nodes[r.sourceNode]->outputs[r.sourceOutput].routes.push_back (i);
+            nodes[r.destNode]->inputs[r.destInput].routes.push_back (i);
+        }
+    }
+
+    void addRoute (const FlattenedGraph& flattened, const FlattenedGraph::Route& flattenedRoute)
+    {
+        Route r (flattenedRoute);
+
+        auto& source = nodes[r.sourceNode]->outputs[r.sourceOutput].info;
+        auto& target = nodes[r.destNode]->inputs[r.destInput].info;
+
+        auto throwConnectionError = [&]
+        {
+            r.location.throwError (Errors::cannotConnect (source.declaration.name.toString(), source.declaration.getTypesDescription(),
+                                                          target.declaration.name.toString(), target.declaration.getTypesDescription()));
+        };
+
+        if (source.declaration.isEventEndpoint())
+        {
+            for (auto& sourceType : source.declaration.dataTypes)
+            {
+                auto destType = heart::Utilities::findMatchingEndpointType (program, sourceType, target.declaration.dataTypes, r.location);
+                r.typeMap.push_back (destType.has_value() ? (int32_t) *destType : -1);
+            }
+        }
+        else
+        {
+            auto sourceType = source.getElementType (r.sourceElement);
+            auto destType = target.getElementType (r.destElement);
+            r.sourceOffset = source.getElementOffset (r.sourceElement);
+            r.destOffset = target.getElementOffset (r.destElement);
+
+            if (source.declaration.isValueEndpoint())
+            {
+                if (! layoutsMatch (sourceType, destType))
+                    throwConnectionError();
+
+                r.numElements = getSizeInBytes (destType);
+            }
+            else
+            {
+                auto sourceFlat = getFlatType (sourceType);
+                auto destFlat = getFlatType (destType);
+
+                if (! (sourceFlat.has_value() && destFlat.has_value()))
+                    throwConnectionError();
+
+                if (sourceFlat->numElements != destFlat->numElements)
+                {
+                    if (sourceFlat->numElements != 1)
+                        throwConnectionError();
+
+                    r.broadcastSource = true;
+                }
+
+                r.numElements = destFlat->numElements;
+                r.sourceKind = sourceFlat->kind;
+                r.destKind = destFlat->kind;
+
+                if (r.interpolation == InterpolationType::sinc && (r.sourceKind == ValueKind::f32 || r.sourceKind == ValueKind::f64))
+                    createSincFilters (r, flattened.nodes[r.sourceNode].ratio, flattened.nodes[r.destNode].ratio);
+            }
+        }
+
+        routes.push_back (std::move (r));
+    }
+
+    static void createSincFilters (Route& r, ClockRatio sourceRatio, ClockRatio destRatio)
+    {
+        // When downsampling, the cutoff drops to the destination's nyquist frequency
+        auto destFramesPerSourceFrame = (double) (sourceRatio.denominator * destRatio.numerator)
+                                          / (double) (sourceRatio.numerator * destRatio.denominator);
+
+        r.sincFilters = std::make_unique<SincFilterBank<double>> (destFramesPerSourceFrame, FlattenedGraph::numSincZeroCrossings);
+        r.sincWindowSize = (uint32_t) (2 * r.sincFilters->getHalfLength() + 4);
+        r.sincWindow.resize ((size_t) r.sincWindowSize * (r.broadcastSource ? 1u : r.numElements));
+    }
+
+    //==============================================================================
+    void createProcessingSteps (const FlattenedGraph& flattened)
+    {
+        if (! sortProcessingSteps (flattened, findLockstepArrays (flattened)))
+            sortProcessingSteps (flattened, {});
+
+        for (auto& step : processingSteps)
+        {
+            auto module = nodes[step.front()]->module;
+
+            if (module == nullptr)
+                continue;
+
+            std::vector<EventSink*> sinks;
+
+            for (auto n : step)
+            {
+                nodes[n]->lane = (uint32_t) sinks.size();
+                sinks.push_back (nodes[n].get());
+            }
+
+            states.push_back (std::make_unique<ProcessorState> (*module, std::move (sinks)));
+
+            for (auto n : step)
+                nodes[n]->state = states.back().get();
+        }
+    }
+
+    // Finds the sets of nodes which are elements of the same array of processors
+    static std::vector<std::vector<uint32_t>> findLockstepArrays (const FlattenedGraph& flattened)
+    {
+        std::unordered_map<std::string, std::vector<uint32_t>> arrays;
+
+        for (auto i : flattened.processingOrder)
+        {
+            auto& n = flattened.nodes[i];
+
+            if (n.module != nullptr && n.module->annotation.getBool ("lockstep", true))
+            {
+                auto pattern = getArrayElementPattern (n.path);
+
+                if (! pattern.empty())
+                    arrays[pattern].push_back (i);
+            }
+        }
+
+        std::vector<std::vector<uint32_t>> result;
+
+        for (auto& a : arrays)
+        {
+            auto& first = flattened.nodes[a.second.front()];
+
+            auto isSameAsFirst = [&] (uint32_t i)
+            {
+                return flattened.nodes[i].module == first.module && flattened.nodes[i].ratio == first.ratio;
+            };
+
+            if (a.second.size() > 1 && std::all_of (a.second.begin(), a.second.end(), isSameAsFirst))
+                result.push_back (std::move (a.second));
+        }
+
+        return result;
+    }
+
+    // Removes the indexes from a path, e.g. "voices[2].osc" -> "voices[].osc", returning
+    // an empty string if the path isn't inside an array
+    static std::string getArrayElementPattern (const std::string& path)
+    {
+        std::string result;
+        bool isInArray = false, isInIndex = false;
+
+        for (auto c : path)
+        {
+            if (c == '[')
+                isInArray = isInIndex = true;
+            else if (c == ']')
+                isInIndex = false;
+            else if (isInIndex)
+                continue;
+
+            result += c;
+        }
+
+        return isInArray ? result : std::string();
+    }
+
+    // Each array becomes a single step, and every other node a step of its own. The steps are then
+    // put into an order where each step's dependencies come before it, keeping as close as possible
+    // to the original order. If an array's elements depend on each other, there's no such order.
+    bool sortProcessingSteps (const FlattenedGraph& flattened, const std::vector<std::vector<uint32_t>>& arrays)
+    {
+        std::vector<std::vector<uint32_t>> steps;
+        std::vector<int32_t> arrayOfNode (nodes.size(), -1);
+        std::vector<uint32_t> stepOfNode (nodes.size(), std::numeric_limits<uint32_t>::max());
+
+        for (size_t i = 0; i < arrays.size(); ++i)
+            for (auto n : arrays[i])
+                arrayOfNode[n] = (int32_t) i;
+
+        for (auto n : flattened.processingOrder)
+        {
+            if (stepOfNode[n] != std::numeric_limits<uint32_t>::max())
+                continue;
+
+            if (arrayOfNode[n] < 0)
+                steps.push_back ({ n });
+            else
+                steps.push_back (arrays[(size_t) arrayOfNode[n]]);
+
+            for (auto member : steps.back())
+                stepOfNode[member] = (uint32_t) steps.size() - 1;
+        }
+
+        std::vector<std::vector<uint32_t>> dependents (steps.size());
+        std::vector<uint32_t> numDependencies (steps.size());
+
+        for (auto& r : routes)
+        {
+            if (r.delay == 0)
+            {
+                auto source = stepOfNode[r.sourceNode], dest = stepOfNode[r.destNode];
+
+                if (source == dest)
+                    return false;
+
+                dependents[source].push_back (dest);
+                ++numDependencies[dest];
+            }
+        }
+
+        // a min-heap of the steps which are ready to go, so the earliest is always taken first
+        std::vector<uint32_t> ready;
+        std::vector<std::vector<uint32_t>> sortedSteps;
+
+        for (uint32_t i = 0; i < steps.size(); ++i)
+            if (numDependencies[i] == 0)
+                ready.push_back (i);
+
+        while (! ready.empty())
+        {
+            std::pop_heap (ready.begin(), ready.end(), std::greater<uint32_t>());
+            auto next = ready.back();
+            ready.pop_back();
+            sortedSteps.push_back (std::move (steps[next]));
+
+            for (auto d : dependents[next])
+            {
+                if (--numDependencies[d] == 0)
+                {
+                    ready.push_back (d);
+                    std::push_heap (ready.begin(), ready.end(), std::greater<uint32_t>());
+                }
+            }
+        }
+
+        if (sortedSteps.size() != steps.size())
+            return false;
+
+        processingSteps = std::move (sortedSteps);
+        stepPositions.resize (nodes.size());
+
+        for (uint32_t i = 0; i < processingSteps.size(); ++i)
+            for (auto n : processingSteps[i])
+                stepPositions[n] = i;
+
+        return true;
+    }
+
+    // Connections which feed back to an earlier step can only be read a chunk later,
+    // so the chunks must be no longer than the shortest of their delays
+    void chooseMaxChunkSize()
+    {
+        maxChunkSize = std::max (1u, maxBlockSize);
+
+        for (auto& r : routes)
+        {
+            if (stepPositions[r.sourceNode] >= stepPositions[r.destNode])
+            {
+                auto& ratio = nodes[r.destNode]->ratio;
+                auto limit = std::max ((int64_t) 1, r.delay * ratio.denominator / ratio.numerator);
+                maxChunkSize = std::min (maxChunkSize, (uint32_t) std::min (limit, (int64_t) maxChunkSize));
+            }
+        }
+    }
+
+    void allocateBuffers()
+    {
+        auto getMaxLocalFrames = [this] (const Node& n) { return (uint32_t) n.ratio.getLocalFrame (maxChunkSize) + 1; };
+
+        for (auto& n : nodes)
+        {
+            auto maxFrames = getMaxLocalFrames (*n);
+
+            for (auto& i : n->inputs)
+            {
+                if (i.info.declaration.isStreamEndpoint())
+                    i.buffer.resize ((size_t) i.info.frameSize * (n.get() == nodes[outputBoundary].get() ? std::max (1u, maxBlockSize) : maxFrames));
+                else if (i.info.declaration.isEventEndpoint())
+                    i.events.initialise (i.info.maxDataSize, maxEventsPerChunk);
+
+                i.value.resize (n->state == nullptr ? std::max (1u, i.info.maxDataSize) : 0);
+            }
+
+            for (auto& o : n->outputs)
+            {
+                if (o.info.declaration.isStreamEndpoint())
+                {
+                    o.buffer.resize ((size_t) o.info.frameSize * maxFrames);
+
+                    uint32_t historyNeeded = 0;
+
+                    for (auto r : o.routes)
+                    {
+                        auto& route = routes[r];
+                        auto& dest = *nodes[route.destNode];
+
+                        if (route.delay != 0 || dest.ratio != n->ratio)
+                        {
+                            auto sourceDelay = (uint32_t) ((route.delay * n->ratio.numerator * dest.ratio.denominator)
+                                                             / (n->ratio.denominator * dest.ratio.numerator));
+                            historyNeeded = std::max (historyNeeded, sourceDelay + maxFrames * 2 + 4 + route.sincWindowSize);
+                        }
+                    }
+
+                    if (historyNeeded != 0)
+                        o.history.initialise (historyNeeded, o.info.frameSize);
+                }
+                else if (o.info.declaration.isEventEndpoint())
+                {
+                    o.events.initialise (o.info.maxDataSize, maxEventsPerChunk);
+                }
+
+                o.value.resize (n->state == nullptr ? std::max (1u, o.info.maxDataSize) : 0);
+            }
+        }
+
+        inputStreamFrames.resize (nodes[inputBoundary]->outputs.size());
+        inputEvents.resize (nodes[inputBoundary]->outputs.size());
+
+        for (size_t i = 0; i < inputEvents.size(); ++i)
+            inputEvents[i].initialise (nodes[inputBoundary]->outputs[i].info.maxDataSize, maxEventsPerChunk);
+
+        // A stream input fed by a single connection from a node running at the same rate can
+        // read straight from the source's buffer
+        for (auto& n : nodes)
+        {
+            if (n->state == nullptr)
+                continue;
+
+            for (auto& i : n->inputs)
+            {
+                if (i.info.declaration.isStreamEndpoint() && i.routes.size() == 1)
+                {
+                    auto& r = routes[i.routes.front()];
+                    auto& source = *nodes[r.sourceNode];
+                    auto& sourceInfo = source.outputs[r.sourceOutput].info;
+
+                    i.isAliased = r.delay == 0 && source.ratio == n->ratio
+                                   && r.sourceElement < 0 && r.destElement < 0 && ! r.broadcastSource
+                                   && r.sourceKind == r.destKind && sourceInfo.frameSize == i.info.frameSize;
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    void renderChunk (int64_t blockStart, uint32_t offsetInBlock, uint32_t numFrames)
+    {
+        auto chunkStart = blockStart + offsetInBlock;
+        auto chunkEnd = chunkStart + numFrames;
+
+        for (auto& step : processingSteps)
+        {
+            for (auto nodeIndex : step)
+            {
+                auto& node = *nodes[nodeIndex];
+                node.frameStart = node.ratio.getLocalFrame (chunkStart);
+                node.frameEnd = node.ratio.getLocalFrame (chunkEnd);
+            }
+
+            if (step.front() == inputBoundary)
+                prepareInputBoundary (*nodes[inputBoundary], offsetInBlock, chunkEnd);
+            else if (step.front() == outputBoundary)
+                processOutputBoundary (*nodes[outputBoundary], offsetInBlock);
+            else
+                processStep (step);
+
+            for (auto nodeIndex : step)
+            {
+                auto& node = *nodes[nodeIndex];
+
+                for (uint32_t i = 0; i < node.outputs.size(); ++i)
+                    sendOutput (node, node.outputs[i]);
+            }
+        }
+    }
+
+    void prepareInputBoundary (Node& node, uint32_t offsetInBlock, int64_t chunkEnd)
+    {
+        for (uint32_t i = 0; i < node.outputs.size(); ++i)
+        {
+            auto& output = node.outputs[i];
+
+            if (output.info.declaration.isStreamEndpoint())
+            {
+                if (inputStreamFrames[i] != nullptr)
+                {
+                    output.frames = const_cast<uint8_t*> (inputStreamFrames[i]) + (size_t) offsetInBlock * output.info.frameSize;
+                }
+                else
+                {
+                    output.frames = output.buffer.data();
+                    memset (output.frames, 0, (size_t) (node.frameEnd - node.frameStart) * output.info.frameSize);
+                }
+            }
+            else if (output.info.declaration.isEventEndpoint())
+            {
+                auto& queue = inputEvents[i];
+
+                while (! queue.isEmpty() && queue.front().frame < chunkEnd)
+                {
+                    auto& header = queue.front();
+
+                    if (! output.events.add (header.frame, header.typeIndex, header.element, queue.frontData(),
+                                             getSizeInBytes (output.info.declaration.dataTypes[header.typeIndex])))
+                        ++xruns;
+
+                    queue.removeFront();
+                }
+            }
+        }
+    }
+
+    void processOutputBoundary (Node& node, uint32_t offsetInBlock)
+    {
+        auto numFrames = (uint32_t) (node.frameEnd - node.frameStart);
+
+        for (uint32_t i = 0; i < node.inputs.size(); ++i)
+        {
+            auto& input = node.inputs[i];
+
+            if (input.info.declaration.isStreamEndpoint())
+            {
+                input.frames = input.buffer.data() + (size_t) offsetInBlock * input.info.frameSize;
+                mixStreamInput (node, input, numFrames);
+            }
+            else if (input.info.declaration.isValueEndpoint())
+            {
+                readValueInput (node, i);
+            }
+        }
+    }
+
+    // Renders all the nodes in a step, which share the same state. Each node's events are
+    // delivered to its own lane, and in between them all the lanes are rendered together.
+    void processStep (const std::vector<uint32_t>& step)
+    {
+        auto& firstNode = *nodes[step.front()];
+        auto& state = *firstNode.state;
+        auto numFrames = (uint32_t) (firstNode.frameEnd - firstNode.frameStart);
+
+        for (auto nodeIndex : step)
+            prepareNode (*nodes[nodeIndex], numFrames);
+
+        state.setFrame (0);
+
+        for (uint32_t frame = 0; frame < numFrames;)
+        {
+            auto nextEventFrame = numFrames;
+
+            for (auto nodeIndex : step)
+                nextEventFrame = std::min (nextEventFrame, dispatchEvents (*nodes[nodeIndex], frame, numFrames));
+
+            state.render (nextEventFrame - frame);
+            frame = nextEventFrame;
+        }
+    }
+
+    void prepareNode (Node& node, uint32_t numFrames)
+    {
+        auto& state = *node.state;
+        auto& module = state.module;
+
+        for (uint32_t i = 0; i < node.inputs.size(); ++i)
+        {
+            auto& input = node.inputs[i];
+
+            if (input.info.declaration.isStreamEndpoint())
+            {
+                if (input.isAliased)
+                {
+                    auto& r = routes[input.routes.front()];
+                    input.frames = nodes[r.sourceNode]->outputs[r.sourceOutput].frames;
+                }
+                else
+                {
+                    input.frames = input.buffer.data();
+                    mixStreamInput (node, input, numFrames);
+                }
+
+                state.setPointer (node.lane, module.inputs[i].bufferPointer, input.frames);
+            }
+            else if (input.info.declaration.isValueEndpoint())
+            {
+                readValueInput (node, i);
+            }
+        }
+
+        for (uint32_t i = 0; i < node.outputs.size(); ++i)
+        {
+            auto& output = node.outputs[i];
+
+            if (output.info.declaration.isStreamEndpoint())
+            {
+                output.frames = output.buffer.data();
+                memset (output.frames, 0, (size_t) numFrames * output.info.frameSize);
+                state.setPointer (node.lane, module.outputs[i].bufferPointer, output.frames);
+            }
+        }
+    }
+
+    // Delivers any events which are due at the given frame, and returns the frame of the next one
+    uint32_t dispatchEvents (Node& node, uint32_t frame, uint32_t numFrames)
+    {
+        auto nextEventFrame = numFrames;
+
+        for (uint32_t i = 0; i < node.inputs.size(); ++i)
+        {
+            auto& queue = node.inputs[i].events;
+
+            while (! queue.isEmpty())
+            {
+                auto eventFrame = queue.front().frame - node.frameStart;
+
+                if (eventFrame > (int64_t) frame)
+                {
+                    nextEventFrame = (uint32_t) std::min ((int64_t) nextEventFrame, eventFrame);
+                    break;
+                }
+
+                dispatchEvent (node, i, queue.front(), queue.frontData());
+                queue.removeFront();
+            }
+        }
+
+        return nextEventFrame;
+    }
+
+    void dispatchEvent (Node& node, uint32_t inputIndex, const EventQueue::Header& header, const uint8_t* data)
+    {
+        auto& state = *node.state;
+        auto& handlers = state.module.inputs[inputIndex].eventHandlers;
+
+        if (header.typeIndex >= handlers.size() || ! handlers[header.typeIndex].has_value())
+            return;
+
+        auto& handler = *handlers[header.typeIndex];
+        auto arraySize = node.inputs[inputIndex].info.arraySize;
+        auto dataSize = getSizeInBytes (node.inputs[inputIndex].info.declaration.dataTypes[header.typeIndex]);
+
+        auto call = [&] (int32_t element)
+        {
+            if (handler.indexParameter.has_value())
+                writeUnaligned (state.getMemory (node.lane, *handler.indexParameter), element);
+
+            if (handler.valueIsReference)
+                state.setPointer (node.lane, handler.valueParameter, data);
+            else
+                memcpy (state.getMemory (node.lane, handler.valueParameter), data, dataSize);
+
+            state.call (node.lane, handler.entryPoint);
+        };
+
+        if (header.element < 0 && arraySize > 1 && handler.indexParameter.has_value())
+        {
+            for (uint32_t i = 0; i < arraySize; ++i)
+                call ((int32_t) i);
+        }
+        else
+        {
+            call (std::max (0, header.element));
+        }
+    }
+
+    void readValueInput (Node& node, uint32_t inputIndex)
+    {
+        auto& input = node.inputs[inputIndex];
+        auto dest = node.getInputValue (inputIndex);
+
+        for (auto r : input.routes)
+        {
+            auto& route = routes[r];
+            memcpy (dest + route.destOffset, nodes[route.sourceNode]->getOutputValue (route.sourceOutput) + route.sourceOffset,
+                    route.numElements);
+        }
+    }
+
+    //==============================================================================
+    template <typename Dest, typename Source>
+    static void addElements (uint8_t* dest, const uint8_t* source, uint32_t num, bool broadcast)
+    {
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            auto d = dest + i * sizeof (Dest);
+            auto s = readUnaligned<Source> (source + (broadcast ? 0 : i * sizeof (Source)));
+
+            if constexpr (std::is_same<Dest, b8>::value)
+                writeUnaligned (d, Ops::cast<b8> (s));
+            else
+                writeUnaligned (d, Ops::add (readUnaligned<Dest> (d), Ops::cast<Dest> (s)));
+        }
+    }
+
+    template <typename Source>
+    static void addElements (uint8_t* dest, ValueKind destKind, const uint8_t* source, uint32_t num, bool broadcast)
+    {
+        switch (destKind)
+        {
+            case ValueKind::b8:   return addElements<b8,  Source> (dest, source, num, broadcast);
+            case ValueKind::i32:  return addElements<i32, Source> (dest, source, num, broadcast);
+            case ValueKind::i64:  return addElements<i64, Source> (dest, source, num, broadcast);
+            case ValueKind::f32:  return addElements<f32, Source> (dest, source, num, broadcast);
+            case ValueKind::f64:  return addElements<f64, Source> (dest, source, num, broadcast);
+            default:              SOUL_ASSERT_FALSE; return;
+        }
+    }
+
+    static void addElements (const Route& r, uint8_t* dest, const uint8_t* source)
+    {
+        switch (r.sourceKind)
+        {
+            case ValueKind::b8:   return addElements<b8>  (dest, r.destKind, source, r.numElements, r.broadcastSource);
+            case ValueKind::i32:  return addElements<i32> (dest, r.destKind, source, r.numElements, r.broadcastSource);
+            case ValueKind::i64:  return addElements<i64> (dest, r.destKind, source, r.numElements, r.broadcastSource);
+            case ValueKind::f32:  return addElements<f32> (dest, r.destKind, source, r.numElements, r.broadcastSource);
+            case ValueKind::f64:  return addElements<f64> (dest, r.destKind, source, r.numElements, r.broadcastSource);
+            default:              SOUL_ASSERT_FALSE; return;
+        }
+    }
+
+    template <typename Type>
+    static void interpolate (uint8_t* dest, const uint8_t* a, const uint8_t* b, Type fraction, uint32_t num)
+    {
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            auto v1 = readUnaligned<Type> (a + i * sizeof (Type));
+            auto v2 = readUnaligned<Type> (b + i * sizeof (Type));
+            writeUnaligned (dest + i * sizeof (Type), v1 + (v2 - v1) * fraction);
+        }
+    }
+
+    const uint8_t* getSourceFrame (const Node& source, const OutputPort& output, int64_t frame) const
+    {
+        if (frame >= source.frameStart && frame < source.frameEnd)
+            return output.frames + (size_t) (frame - source.frameStart) * output.info.frameSize;
+
+        if (output.history.isActive())
+            return output.history.getFrame (frame);
+
+        return nullptr;
+    }
+
+    void mixStreamInput (Node& node, InputPort& input, uint32_t numFrames)
+    {
+        auto frameSize = input.info.frameSize;
+        memset (input.frames, 0, (size_t) numFrames * frameSize);
+
+        for (auto routeIndex : input.routes)
+        {
+            auto& r = routes[routeIndex];
+            auto& source = *nodes[r.sourceNode];
+            auto& output = source.outputs[r.sourceOutput];
+            auto destFrames = input.frames + r.destOffset;
+            auto sourceElementSize = r.broadcastSource ? getSizeOfKind (r.sourceKind) : r.numElements * getSizeOfKind (r.sourceKind);
+            auto numerator = source.ratio.numerator * node.ratio.denominator;
+            auto denominator = source.ratio.denominator * node.ratio.numerator;
+            bool isLinear = r.interpolation == InterpolationType::linear && numerator < denominator
+                             && (r.sourceKind == ValueKind::f32 || r.sourceKind == ValueKind::f64);
+            uint64_t scratch[32];
+
+            if (r.sincFilters != nullptr && sourceElementSize <= sizeof (scratch))
+            {
+                auto interpolated = reinterpret_cast<uint8_t*> (scratch);
+
+                for (uint32_t i = 0; i < numFrames; ++i)
+                {
+                    interpolateSinc (r, source, output, (node.frameStart + i - r.delay) * numerator, denominator, interpolated);
+                    addElements (r, destFrames + (size_t) i * frameSize, interpolated);
+                }
+
+                continue;
+            }
+
+            for (uint32_t i = 0; i < numFrames; ++i)
+            {
+                auto position = (node.frameStart + i - r.delay) * numerator;
+                auto sourceFrame = position >= 0 ? position / denominator : -1;
+                auto frameData = getSourceFrame (source, output, sourceFrame);
+
+                if (frameData == nullptr)
+                    continue;
+
+                frameData += r.sourceOffset;
+
+                if (isLinear && position % denominator != 0 && sourceElementSize <= sizeof (scratch))
+                {
+                    if (auto next = getSourceFrame (source, output, sourceFrame + 1))
+                    {
+                        auto fraction = (double) (position % denominator) / (double) denominator;
+                        auto numElements = r.broadcastSource ? 1u : r.numElements;
+                        auto interpolated = reinterpret_cast<uint8_t*> (scratch);
+
+                        if (r.sourceKind == ValueKind::f32)
+                            interpolate<f32> (interpolated, frameData, next + r.sourceOffset, (f32) fraction, numElements);
+                        else
+                            interpolate<f64> (interpolated, frameData, next + r.sourceOffset, fraction, numElements);
+
+                        frameData = interpolated;
+                    }
+                }
+
+                addElements (r, destFrames + (size_t) i * frameSize, frameData);
+            }
+        }
+    }
+
+    /** Calculates the value of a resampled stream at a position in the source, given as a
+        fraction. The filters need frames on both sides of the position, so it reads from half
+        a filter length earlier, which means that all the frames it needs have already been rendered.
+    */
+    void interpolateSinc (Route& r, const Node& source, const OutputPort& output,
+                          int64_t positionNumerator, int64_t positionDenominator, uint8_t* result)
+    {
+        auto& filters = *r.sincFilters;
+        auto halfLength = filters.getHalfLength();
+        auto position = (double) positionNumerator / (double) positionDenominator - halfLength;
+        auto firstFrame = (int64_t) std::floor (position) - halfLength + 1;
+        auto numElements = r.broadcastSource ? 1u : r.numElements;
+        auto isFloat32 = r.sourceKind == ValueKind::f32;
+        auto elementSize = isFloat32 ? sizeof (f32) : sizeof (f64);
+
+        for (uint32_t i = 0; i < r.sincWindowSize; ++i)
+        {
+            auto frame = getSourceFrame (source, output, firstFrame + i);
+
+            for (uint32_t e = 0; e < numElements; ++e)
+            {
+                auto& sample = r.sincWindow[(size_t) e * r.sincWindowSize + i];
+
+                if (frame == nullptr)
+                    sample = 0;
+                else if (isFloat32)
+                    sample = (double) readUnaligned<f32> (frame + r.sourceOffset + e * elementSize);
+                else
+                    sample = readUnaligned<f64> (frame + r.sourceOffset + e * elementSize);
+            }
+        }
+
+        for (uint32_t e = 0; e < numElements; ++e)
+        {
+            auto value = filters.getSample (r.sincWindow.data() + (size_t) e * r.sincWindowSize,
+                                            (int64_t) r.sincWindowSize, position - (double) firstFrame);
+
+            if (isFloat32)
+                writeUnaligned (result + e * elementSize, (f32) value);
+            else
+                writeUnaligned (result + e * elementSize, value);
+        }
+    }
+
+    void sendOutput (Node& node, OutputPort& output)
+    {
+        if (output.info.declaration.isStreamEndpoint())
+        {
+            if (output.history.isActive() && output.frames != nullptr)
+                output.history.append (node.frameStart, output.frames, (uint32_t) (node.frameEnd - node.frameStart));
+
+            return;
+        }
+
+        if (! output.info.declaration.isEventEndpoint())
+            return;
+
+        for (uint32_t e = 0; e < output.events.size(); ++e)
+        {
+            auto& header = output.events.getHeader (e);
+
+            for (auto routeIndex : output.routes)
+            {
+                auto& r = routes[routeIndex];
+
+                if (r.sourceElement >= 0 && header.element >= 0 && header.element != r.sourceElement)
+                    continue;
+
+                auto destType = r.typeMap[header.typeIndex];
+
+                if (destType < 0)
+                    continue;
+
+                auto& dest = *nodes[r.destNode];
+                auto frame = (header.frame * dest.ratio.numerator * node.ratio.denominator)
+                                / (dest.ratio.denominator * node.ratio.numerator) + r.delay;
+                auto element = r.destElement >= 0 ? r.destElement : (r.sourceElement >= 0 ? -1 : header.element);
+                auto& destInput = dest.inputs[r.destInput];
+
+                if (! destInput.events.add (frame, (uint32_t) destType, element, output.events.getData (e),
+                                            getSizeInBytes (destInput.info.declaration.dataTypes[(size_t) destType])))
+                    ++xruns;
+            }
+        }
+
+        output.events.clear();
+    }
+};
+
+} // namespace soul::interpreter
@@ -0,0 +1,551 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul::interpreter
+{
+
+//==============================================================================
+/** Receives the events that a processor emits while it's running. */
+struct EventSink
+{
+    virtual ~EventSink() {}
+
+    virtual void handleEvent (uint32_t outputIndex, uint32_t frame, uint32_t typeIndex,
+                              int32_t element, const void* data) = 0;
+};
+
+//==============================================================================
+/** The running state of one processor instance, or of a set of identical instances.
+
+    The run() function is treated as a coroutine: each call to render() resumes it from
+    where it last stopped, and it gets suspended again when it has advanced the requested
+    number of frames. Event handlers are called while it's suspended, using their own stack.
+
+    Each instance is a lane with its own copy of the memory. Lanes which have reached the
+    same point in their run() functions are kept together in a group, and each instruction
+    is decoded once and then applied to every lane in the group. When the lanes take different
+    sides of a branch, the group is split, and groups which later arrive at the same place on
+    the same frame are merged again.
+*/
+class ProcessorState
+{
+public:
+    ProcessorState (const CompiledModule& m, std::vector<EventSink*> sinks)
+        : module (m), code (m.code.data()), eventSinks (std::move (sinks))
+    {
+        SOUL_ASSERT (! eventSinks.empty());
+        auto numLanes = getNumLanes();
+        laneSize = ((m.initialState.size() + 7) / 8 + 1) * 8;
+        memoryBlock.resize (laneSize / 8 * numLanes);
+        memory = getLaneMemory (0);
+
+        // Everything is allocated up-front, so that splitting a group never needs to allocate
+        groups.resize (numLanes);
+
+        for (auto& g : groups)
+            allocateGroup (g);
+
+        allocateGroup (eventGroup);
+    }
+
+    uint32_t getNumLanes() const     { return (uint32_t) eventSinks.size(); }
+
+    void reset (uint32_t lane, double frequency, int32_t instanceID, int32_t sessionID, int32_t latency)
+    {
+        memory = getLaneMemory (lane);
+        memcpy (memory, module.initialState.data(), module.initialState.size());
+        writeUnaligned (memory + module.frequency, frequency);
+        writeUnaligned (memory + module.period, 1.0 / frequency);
+        writeUnaligned (memory + module.id, instanceID);
+        writeUnaligned (memory + module.session, sessionID);
+        writeUnaligned (memory + module.latency, latency);
+
+        removeLane (lane);
+        frame = 0;
+        stopFrame = 0;
+
+        if (module.runFunction.has_value())
+            startRun (lane);
+
+        if (module.stateInitialisers.has_value())   call (lane, *module.stateInitialisers);
+        if (module.systemInitFunction.has_value())  call (lane, *module.systemInitFunction);
+        if (module.userInitFunction.has_value())    call (lane, *module.userInitFunction);
+    }
+
+    /** Resumes the run() function of every lane until it has advanced by the given number of frames. */
+    void render (uint32_t numFrames)
+    {
+        stopFrame = frame + numFrames;
+
+        if (numFrames != 0 && numGroups != 0)
+        {
+            if (getNumLanes() == 1)
+            {
+                execute<false> (groups.front());
+                removeEmptyGroups();
+            }
+            else
+            {
+                renderGroups();
+            }
+        }
+
+        frame = stopFrame;
+    }
+
+    /** Calls an event handler or other function for one of the lanes. */
+    void call (uint32_t lane, uint32_t entryPoint)
+    {
+        eventGroup.lanes.assign (1, lane);
+        eventGroup.pc = entryPoint;
+        eventGroup.frame = frame;
+        eventGroup.callDepth = 0;
+        execute<false> (eventGroup);
+    }
+
+    /** Sets the frame index within the current chunk, which stream reads and writes will use. */
+    void setFrame (uint32_t newFrame)
+    {
+        frame = newFrame;
+
+        for (uint32_t i = 0; i < numGroups; ++i)
+            groups[i].frame = newFrame;
+    }
+
+    uint32_t getFrame() const            { return frame; }
+
+    uint8_t* getMemory (uint32_t lane, Offset offset) const                  { return getLaneMemory (lane) + offset; }
+    void setPointer (uint32_t lane, Offset slot, const void* pointer)        { writeUnaligned (getLaneMemory (lane) + slot, pointer); }
+
+    const CompiledModule& module;
+
+private:
+    // A set of lanes which are all at the same point in the code
+    struct LaneGroup
+    {
+        std::vector<uint32_t> lanes, callStack;
+        uint32_t pc = 0, frame = 0, callDepth = 0;
+    };
+
+    const Instruction* const code;
+    std::vector<EventSink*> eventSinks;
+    std::vector<uint64_t> memoryBlock;
+    size_t laneSize = 0;
+    uint8_t* memory = nullptr;
+    uint32_t currentLane = 0, frame = 0, stopFrame = 0, numGroups = 0;
+    std::vector<LaneGroup> groups;
+    LaneGroup eventGroup;
+
+    uint8_t* getLaneMemory (uint32_t lane) const
+    {
+        return reinterpret_cast<uint8_t*> (const_cast<uint64_t*> (memoryBlock.data())) + lane * laneSize;
+    }
+
+    void allocateGroup (LaneGroup& g)
+    {
+        g.lanes.reserve (getNumLanes());
+        g.callStack.resize (module.maxCallDepth + 1);
+    }
+
+    void startRun (uint32_t lane)
+    {
+        for (uint32_t i = 0; i < numGroups; ++i)
+        {
+            auto& g = groups[i];
+
+            if (g.pc == *module.runFunction && g.callDepth == 0 && g.frame == 0)
+            {
+                g.lanes.push_back (lane);
+                return;
+            }
+        }
+
+        auto& g = groups[numGroups++];
+        g.lanes.assign (1, lane);
+        g.pc = *module.runFunction;
+        g.frame = 0;
+        g.callDepth = 0;
+    }
+
+    void removeLane (uint32_t lane)
+    {
+        for (uint32_t i = 0; i < numGroups; ++i)
+            removeFirst (groups[i].lanes, [=] (uint32_t l) { return l == lane; });
+
+        removeEmptyGroups();
+    }
+
+    void removeEmptyGroups()
+    {
+        for (uint32_t i = numGroups; i > 0; --i)
+            if (groups[i - 1].lanes.empty())
+                std::swap (groups[i - 1], groups[--numGroups]);
+    }
+
+    // Repeatedly runs whichever group is furthest behind, so that groups which have
+    // diverged get the chance to meet up again at the same frame
+    void renderGroups()
+    {
+        for (;;)
+        {
+            LaneGroup* next = nullptr;
+
+            for (uint32_t i = 0; i < numGroups; ++i)
+                if (groups[i].frame < stopFrame && (next == nullptr || groups[i].frame < next->frame))
+                    next = std::addressof (groups[i]);
+
+            if (next == nullptr)
+                return;
+
+            execute<true> (*next);
+            removeEmptyGroups();
+            mergeGroups();
+        }
+    }
+
+    void mergeGroups()
+    {
+        for (uint32_t i = 0; i < numGroups; ++i)
+        {
+            for (uint32_t j = numGroups; --j > i;)
+            {
+                auto& a = groups[i];
+                auto& b = groups[j];
+
+                if (a.pc == b.pc && a.frame == b.frame && a.callDepth == b.callDepth
+                     && std::equal (a.callStack.begin(), a.callStack.begin() + a.callDepth, b.callStack.begin()))
+                {
+                    a.lanes.insert (a.lanes.end(), b.lanes.begin(), b.lanes.end());
+                    b.lanes.clear();
+                    std::swap (b, groups[--numGroups]);
+                }
+            }
+        }
+    }
+
+    // Moves the lanes for which a branch condition is false into a new group,
+    // and returns the target for the lanes that remain
+    uint32_t branchLanes (LaneGroup& g, const Instruction& i)
+    {
+        auto isFalse = [this, &i] (uint32_t lane) { return readUnaligned<b8> (getLaneMemory (lane) + i.source1) == 0; };
+        auto numFalse = (size_t) std::count_if (g.lanes.begin(), g.lanes.end(), isFalse);
+
+        if (numFalse == 0)                  return (uint32_t) i.param;
+        if (numFalse == g.lanes.size())     return i.size;
+
+        SOUL_ASSERT (numGroups < groups.size());
+        auto& newGroup = groups[numGroups++];
+        newGroup.lanes.clear();
+
+        for (auto lane : g.lanes)
+            if (isFalse (lane))
+                newGroup.lanes.push_back (lane);
+
+        g.lanes.erase (std::remove_if (g.lanes.begin(), g.lanes.end(), isFalse), g.lanes.end());
+
+        newGroup.pc = i.size;
+        newGroup.frame = frame;
+        newGroup.callDepth = g.callDepth;
+        std::copy (g.callStack.begin(), g.callStack.begin() + g.callDepth, newGroup.callStack.begin());
+        return (uint32_t) i.param;
+    }
+
+    // Applies an operation to the memory of each lane in a group
+    template <bool isPacked, typename Operation>
+    void forEachLane (const LaneGroup& g, Operation&& op)
+    {
+        if constexpr (isPacked)
+        {
+            for (auto lane : g.lanes)
+            {
+                memory = getLaneMemory (lane);
+                currentLane = lane;
+                op();
+            }
+        }
+        else
+        {
+            op();
+        }
+    }
+
+    template <typename Type> Type get (Offset offset) const         { return readUnaligned<Type> (memory + offset); }
+    template <typename Type> void set (Offset offset, Type value)   { writeUnaligned (memory + offset, value); }
+    uint8_t* getPointer (Offset slot) const                         { return readUnaligned<uint8_t*> (memory + slot); }
+    void setPointer (Offset slot, const void* pointer)              { writeUnaligned (memory + slot, pointer); }
+
+    uint8_t* getStreamFrame (const Instruction& i, Offset bufferPointer) const
+    {
+        return getPointer (bufferPointer) + (size_t) frame * (size_t) i.param + i.source2;
+    }
+
+    template <typename Type>
+    void addToStream (uint8_t* dest, Offset source, uint32_t numElements)
+    {
+        for (uint32_t n = 0; n < numElements; ++n)
+        {
+            auto d = dest + n * sizeof (Type);
+            writeUnaligned (d, Ops::add (readUnaligned<Type> (d), get<Type> (source + n * (Offset) sizeof (Type))));
+        }
+    }
+
+    template <typename Type>
+    void writeStream (const Instruction& i)
+    {
+        addToStream<Type> (getStreamFrame (i, i.dest), i.source1, i.size);
+    }
+
+    template <typename Type>
+    void writeStreamFrames (const Instruction& i)
+    {
+        auto dest = getStreamFrame (i, i.dest);
+
+        for (uint32_t n = 0; n < i.size; ++n)
+            addToStream<Type> (dest + (size_t) n * (size_t) i.param, i.source1 + n * i.source3 * (Offset) sizeof (Type), i.source3);
+    }
+
+    void readStreamFrames (const Instruction& i)
+    {
+        auto source = getStreamFrame (i, i.source1);
+
+        if (i.param == i.source3)
+        {
+            memcpy (memory + i.dest, source, (size_t) i.size * i.source3);
+            return;
+        }
+
+        for (uint32_t n = 0; n < i.size; ++n)
+            memcpy (memory + i.dest + n * i.source3, source + (size_t) n * (size_t) i.param, i.source3);
+    }
+
+    void writeStreamFrames_b8 (const Instruction& i)
+    {
+        auto dest = getStreamFrame (i, i.dest);
+
+        for (uint32_t n = 0; n < i.size; ++n)
+            memcpy (dest + (size_t) n * (size_t) i.param, memory + i.source1 + n * i.source3, i.source3);
+    }
+
+    uint8_t* getElementAddress (const Instruction& i) const
+    {
+        auto base = (i.flags & baseIsPointer) != 0 ? getPointer (i.source1) : memory + i.source1;
+        auto index = (i.flags & indexIsInt64) != 0 ? get<int64_t> (i.source2) : (int64_t) get<int32_t> (i.source2);
+
+        if ((i.flags & indexIsTrusted) == 0)
+        {
+            auto size = i.size != 0 ? (int64_t) i.size : getUnsizedArraySize (base);
+            index = size > 0 ? Ops::wrap (index, size) : 0;
+        }
+
+        return base + index * i.param;
+    }
+
+    template <bool isPacked>
+    void execute (LaneGroup& g)
+    {
+        #define SOUL_INTERPRETER_EXECUTE_BINARY_OP(op, type) \
+            case OpCode::op ## _ ## type: \
+                forEachLane<isPacked> (g, [&] { set (i.dest, Ops::op (get<type> (i.source1), get<type> (i.source2))); }); \
+                ++pc; break; \
+            case OpCode::op ## _ ## type ## _vec: \
+                forEachLane<isPacked> (g, [&] \
+                { \
+                    using Result = decltype (Ops::op (type(), type())); \
+                    for (uint32_t n = 0; n < i.size; ++n) \
+                        set (i.dest + n * (Offset) sizeof (Result), Ops::op (get<type> (i.source1 + n * (Offset) sizeof (type)), \
+                                                                            get<type> (i.source2 + n * (Offset) sizeof (type)))); \
+                }); \
+                ++pc; break;
+
+        #define SOUL_INTERPRETER_EXECUTE_UNARY_OP(op, type) \
+            case OpCode::op ## _ ## type: \
+                forEachLane<isPacked> (g, [&] { set (i.dest, Ops::op (get<type> (i.source1))); }); \
+                ++pc; break; \
+            case OpCode::op ## _ ## type ## _vec: \
+                forEachLane<isPacked> (g, [&] \
+                { \
+                    using Result = decltype (Ops::op (type())); \
+                    for (uint32_t n = 0; n < i.size; ++n) \
+                        set (i.dest + n * (Offset) sizeof (Result), Ops::op (get<type> (i.source1 + n * (Offset) sizeof (type)))); \
+                }); \
+                ++pc; break;
+
+        #define SOUL_INTERPRETER_EXECUTE_CAST_OP(from, to) \
+            case OpCode::cast_ ## from ## _ ## to: \
+                forEachLane<isPacked> (g, [&] { set (i.dest, Ops::cast<to, from> (get<from> (i.source1))); }); \
+                ++pc; break; \
+            case OpCode::cast_ ## from ## _ ## to ## _vec: \
+                forEachLane<isPacked> (g, [&] \
+                { \
+                    for (uint32_t n = 0; n < i.size; ++n) \
+                        set (i.dest + n * (Offset) sizeof (to), Ops::cast<to, from> (get<from> (i.source1 + n * (Offset) sizeof (from)))); \
+                }); \
+                ++pc; break;
+
+        #define SOUL_INTERPRETER_EXECUTE_CLAMP(op, type) \
+            case OpCode::op ## _ ## type: \
+                forEachLane<isPacked> (g, [&] { set (i.dest, Ops::clamp (get<type> (i.source1), get<type> (i.source2), get<type> (i.source3))); }); \
+                ++pc; break;
+
+        #define SOUL_INTERPRETER_EXECUTE_STREAM_WRITE(op, type) \
+            case OpCode::op ## _ ## type: \
+                forEachLane<isPacked> (g, [&] { op<type> (i); }); \
+                ++pc; break;
+
+        auto pc = g.pc;
+        frame = g.frame;
+        memory = getLaneMemory (g.lanes.front());
+        currentLane = g.lanes.front();
+
+        for (;;)
+        {
+            auto& i = code[pc];
+
+            switch (i.opcode)
+            {
+                case OpCode::nop:        ++pc; break;
+                case OpCode::jump:       pc = (uint32_t) i.param; break;
+
+                case OpCode::branchIf:
+                    if constexpr (isPacked)
+                        pc = branchLanes (g, i);
+                    else
+                        pc = get<b8> (i.source1) != 0 ? (uint32_t) i.param : i.size;
+
+                    break;
+
+                case OpCode::call:
+                    SOUL_ASSERT (g.callDepth < g.callStack.size());
+                    g.callStack[g.callDepth++] = pc + 1;
+                    pc = (uint32_t) i.param;
+                    break;
+
+                case OpCode::ret:
+                    if (g.callDepth == 0)
+                        return;
+
+                    pc = g.callStack[--g.callDepth];
+                    break;
+
+                case OpCode::finishRun:
+                    g.lanes.clear();
+                    g.callDepth = 0;
+                    frame = stopFrame;
+                    return;
+
+                case OpCode::advance:
+                    ++pc;
+
+                    // while groups are diverged, they each stop after every frame to give them a chance to merge
+                    if (++frame >= stopFrame || (isPacked && numGroups > 1))
+                    {
+                        g.pc = pc;
+                        g.frame = frame;
+                        return;
+                    }
+
+                    break;
+
+                case OpCode::enterBlockLoop:
+                    pc = stopFrame - frame >= i.size ? pc + 1 : (uint32_t) i.param;
+                    break;
+
+                case OpCode::advanceBlock:
+                    ++pc;
+                    frame += i.size;
+
+                    if (frame >= stopFrame || (isPacked && numGroups > 1))
+                    {
+                        g.pc = pc;
+                        g.frame = frame;
+                        return;
+                    }
+
+                    break;
+
+                case OpCode::copy:    forEachLane<isPacked> (g, [&] { memcpy (memory + i.dest, memory + i.source1, i.size); }); ++pc; break;
+                case OpCode::copy1:   forEachLane<isPacked> (g, [&] { memory[i.dest] = memory[i.source1]; }); ++pc; break;
+                case OpCode::copy4:   forEachLane<isPacked> (g, [&] { memcpy (memory + i.dest, memory + i.source1, 4); }); ++pc; break;
+                case OpCode::copy8:   forEachLane<isPacked> (g, [&] { memcpy (memory + i.dest, memory + i.source1, 8); }); ++pc; break;
+                case OpCode::zero:    forEachLane<isPacked> (g, [&] { memset (memory + i.dest, 0, i.size); }); ++pc; break;
+
+                case OpCode::broadcast:
+                    forEachLane<isPacked> (g, [&]
+                    {
+                        for (uint32_t n = 0; n < i.size; ++n)
+                            memcpy (memory + i.dest + n * (Offset) i.param, memory + i.source1, (size_t) i.param);
+                    });
+
+                    ++pc; break;
+
+                case OpCode::loadIndirect:    forEachLane<isPacked> (g, [&] { memcpy (memory + i.dest, getPointer (i.source1) + i.param, i.size); }); ++pc; break;
+                case OpCode::storeIndirect:   forEachLane<isPacked> (g, [&] { memcpy (getPointer (i.dest) + i.param, memory + i.source1, i.size); }); ++pc; break;
+                case OpCode::storePointer:    forEachLane<isPacked> (g, [&] { setPointer (i.dest, memory + i.source1); }); ++pc; break;
+                case OpCode::offsetPointer:   forEachLane<isPacked> (g, [&] { setPointer (i.dest, getPointer (i.source1) + i.param); }); ++pc; break;
+                case OpCode::elementAddress:  forEachLane<isPacked> (g, [&] { setPointer (i.dest, getElementAddress (i)); }); ++pc; break;
+                case OpCode::getArraySize:    forEachLane<isPacked> (g, [&] { set (i.dest, (int32_t) getUnsizedArraySize (getPointer (i.source1))); }); ++pc; break;
+
+                case OpCode::wrapToLimit:     forEachLane<isPacked> (g, [&] { set (i.dest, Ops::wrap (get<int32_t> (i.source1), (int32_t) i.param)); }); ++pc; break;
+                case OpCode::clampToLimit:    forEachLane<isPacked> (g, [&] { set (i.dest, Ops::clamp (get<int32_t> (i.source1), 0, (int32_t) i.param - 1)); }); ++pc; break;
+
+                case OpCode::readStream:
+                    forEachLane<isPacked> (g, [&] { memcpy (memory + i.dest, getStreamFrame (i, i.source1), i.size); });
+                    ++pc; break;
+
+                case OpCode::writeStream_b8:
+                    forEachLane<isPacked> (g, [&] { memcpy (getStreamFrame (i, i.dest), memory + i.source1, i.size); });
+                    ++pc; break;
+
+                case OpCode::readStreamFrames:      forEachLane<isPacked> (g, [&] { readStreamFrames (i); }); ++pc; break;
+                case OpCode::writeStreamFrames_b8:  forEachLane<isPacked> (g, [&] { writeStreamFrames_b8 (i); }); ++pc; break;
+
+                case OpCode::writeEvent:
+                    forEachLane<isPacked> (g, [&]
+                    {
+                        eventSinks[currentLane]->handleEvent ((uint32_t) i.param, frame, i.flags,
+                                                              i.size != 0 ? get<int32_t> (i.source2) : -1, memory + i.source1);
+                    });
+
+                    ++pc; break;
+
+                SOUL_INTERPRETER_BINARY_OPS (SOUL_INTERPRETER_EXECUTE_BINARY_OP)
+                SOUL_INTERPRETER_COMPARISON_OPS (SOUL_INTERPRETER_EXECUTE_BINARY_OP)
+                SOUL_INTERPRETER_UNARY_OPS (SOUL_INTERPRETER_EXECUTE_UNARY_OP)
+                SOUL_INTERPRETER_TEST_OPS (SOUL_INTERPRETER_EXECUTE_UNARY_OP)
+                SOUL_INTERPRETER_NUMERIC_TYPES (SOUL_INTERPRETER_EXECUTE_CLAMP, clamp)
+                SOUL_INTERPRETER_CAST_OPS (SOUL_INTERPRETER_EXECUTE_CAST_OP)
+                SOUL_INTERPRETER_STREAM_WRITE_OPS (SOUL_INTERPRETER_EXECUTE_STREAM_WRITE)
+
+                case OpCode::numOpCodes:
+                default:
+                    SOUL_ASSERT_FALSE;
+                    return;
+            }
+        }
+
+        #undef SOUL_INTERPRETER_EXECUTE_BINARY_OP
+        #undef SOUL_INTERPRETER_EXECUTE_UNARY_OP
+        #undef SOUL_INTERPRETER_EXECUTE_CAST_OP
+        #undef SOUL_INTERPRETER_EXECUTE_CLAMP
+        #undef SOUL_INTERPRETER_EXECUTE_STREAM_WRITE
+    }
+};
+
+} // namespace soul::interpreter
@@ -28,6 +28,7 @@
 #endif
 
 #include <thread>
+#include <deque>
 #include <iomanip>
 #include <fstream>
 #include <cctype>
@@ -40,12 +41,18 @@
 
 #if SOUL_INTEL
  #include <xmmintrin.h>
+ #include <emmintrin.h>
 #endif
 
 #ifdef __APPLE__
  #include <AvailabilityMacros.h>
 #endif
 
+#ifdef __linux__
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
 #define SOUL_INSIDE_CORE_CPP 1
 #define printf NO_PRINTFS_TODAY_THANKYOU
 
@@ -72,6 +79,7 @@
 #include "types/soul_EndpointType.cpp"
 #include "heart/soul_heart_Printer.h"
 #include "heart/soul_heart_Parser.h"
+#include "heart/soul_heart_BinaryFormat.h"
 #include "heart/soul_heart_Checker.h"
 #include "types/soul_Type.cpp"
 #include "compiler/soul_StandardLibrary.h"
@@ -88,6 +96,7 @@
 #include "heart/soul_Module.cpp"
 #include "heart/soul_Program.cpp"
 #include "venue/soul_RenderingVenue.cpp"
+#include "interpreter/soul_Interpreter.cpp"
 #include "diagnostics/soul_CodeLocation.cpp"
 #include "diagnostics/soul_Logging.cpp"
 #include "diagnostics/soul_CompileMessageList.cpp"
@@ -98,6 +107,7 @@
 #include "documentation/soul_SourceCodeOperations.cpp"
 #include "documentation/soul_SourceCodeModel.cpp"
 #include "documentation/soul_HTMLGeneration.cpp"
+#include "code_generation/soul_CPlusPlusGenerator.cpp"
 
 #ifdef __clang__
  #pragma clang diagnostic pop
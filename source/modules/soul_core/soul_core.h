@@ -47,10 +47,12 @@
 #endif
 
 #include <vector>
+#include <deque>
 #include <string>
 #include <sstream>
 #include <array>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <functional>
 #include <mutex>
@@ -61,6 +63,7 @@
 #include <atomic>
 #include <limits>
 #include <condition_variable>
+#include <thread>
 #include <cassert>
 #include <random>
 #include <optional>
@@ -140,7 +143,10 @@ namespace soul
 #include "heart/soul_heart_FunctionBuilder.h"
 #include "heart/soul_heart_CallFlowGraph.h"
 #include "heart/soul_heart_Optimisations.h"
+#include "heart/soul_heart_SSAOptimisations.h"
 #include "heart/soul_heart_DelayCompensation.h"
+#include "heart/soul_heart_FlattenedGraph.h"
+#include "heart/soul_heart_VectorisableLoop.h"
 
 #include "compiler/soul_AST.h"
 #include "compiler/soul_Compiler.h"
@@ -149,6 +155,7 @@ namespace soul
 #include "venue/soul_Performer.h"
 #include "venue/soul_Venue.h"
 #include "venue/soul_RenderingVenue.h"
+#include "interpreter/soul_Interpreter.h"
 
 #include "utilities/soul_EventQueue.h"
 #include "utilities/soul_MultiEndpointFIFO.h"
@@ -159,3 +166,4 @@ namespace soul
 #include "documentation/soul_SourceCodeOperations.h"
 #include "documentation/soul_SourceCodeModel.h"
 #include "documentation/soul_HTMLGeneration.h"
+#include "code_generation/soul_CPlusPlusGenerator.h"
@@ -31,17 +31,27 @@ namespace soul
     const ConstantTable::Item* ConstantTable::end() const     { return items.end(); }
     size_t ConstantTable::size() const                        { return items.size(); }
 
+    static size_t getContentHash (const Value& value)
+    {
+        return std::hash<std::string_view>() (std::string_view (static_cast<const char*> (value.getPackedData()),
+                                                                value.getPackedDataSize()));
+    }
+
     ConstantTable::Handle ConstantTable::getHandleForValue (Value value)
     {
         if (! value.isValid())
             return 0;
 
-        for (auto& i : items)
-            if (value == *i.value)
-                return i.handle;
+        auto hash = getContentHash (value);
+        auto matches = handlesForContentHashes.equal_range (hash);
+
+        for (auto i = matches.first; i != matches.second; ++i)
+            if (value == *getValueForHandle (i->second))
+                return i->second;
 
         auto handle = nextIndex++;
         items.push_back ({ handle, std::make_unique<Value> (std::move (value)) });
+        addToIndex (items.back(), items.size() - 1);
         return handle;
     }
 
@@ -50,9 +60,10 @@ namespace soul
         if (handle == 0)
             return {};
 
-        for (auto& i : items)
-            if (handle == i.handle)
-                return i.value.get();
+        auto index = indexesForHandles.find (handle);
+
+        if (index != indexesForHandles.end())
+            return items[index->second].value.get();
 
         SOUL_ASSERT_FALSE;
         return {};
@@ -62,5 +73,12 @@ namespace soul
     {
         nextIndex = std::max (nextIndex, i.handle + 1);
         items.push_back (std::move (i));
+        addToIndex (items.back(), items.size() - 1);
+    }
+
+    void ConstantTable::addToIndex (const Item& item, size_t index)
+    {
+        handlesForContentHashes.emplace (getContentHash (*item.value), item.handle);
+        indexesForHandles[item.handle] = index;
     }
 }
@@ -54,7 +54,11 @@ public:
 
 private:
     ArrayWithPreallocation<Item, 32> items;
+    std::unordered_multimap<size_t, Handle> handlesForContentHashes;
+    std::unordered_map<Handle, size_t> indexesForHandles;
     Handle nextIndex = 1;
+
+    void addToIndex (const Item&, size_t index);
 };
 
 
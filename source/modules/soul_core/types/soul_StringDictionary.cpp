@@ -32,12 +32,16 @@ namespace soul
         if (text.empty())
             return {};
 
-        for (auto& s : strings)
-            if (s.text == text)
-                return s.handle;
+        auto key = std::string (text);
+        auto existing = handlesForStrings.find (key);
+
+        if (existing != handlesForStrings.end())
+            return existing->second;
 
         auto handle = StringDictionary::Handle { nextIndex++ };
-        strings.push_back ({ handle, std::string (text) });
+        indexesForHandles[handle.handle] = strings.size();
+        strings.push_back ({ handle, key });
+        handlesForStrings.emplace (std::move (key), handle);
         return handle;
     }
 
@@ -46,11 +50,34 @@ namespace soul
         if (handle == Handle())
             return {};
 
-        for (auto& s : strings)
-            if (s.handle == handle)
-                return s.text;
+        auto index = indexesForHandles.find (handle.handle);
+
+        if (index != indexesForHandles.end())
+            return strings[index->second].text;
 
         SOUL_ASSERT_FALSE;
         return {};
     }
+
+    void StringDictionary::addItem (Item item)
+    {
+        nextIndex = std::max (nextIndex, item.handle.handle + 1);
+        indexesForHandles[item.handle.handle] = strings.size();
+        handlesForStrings[item.text] = item.handle;
+        strings.push_back (std::move (item));
+    }
+
+    void StringDictionary::removeUnusedStrings (const std::unordered_set<uint32_t>& handlesUsed)
+    {
+        removeIf (strings, [&] (const Item& item) { return handlesUsed.find (item.handle.handle) == handlesUsed.end(); });
+
+        handlesForStrings.clear();
+        indexesForHandles.clear();
+
+        for (size_t i = 0; i < strings.size(); ++i)
+        {
+            handlesForStrings[strings[i].text] = strings[i].handle;
+            indexesForHandles[strings[i].handle.handle] = i;
+        }
+    }
 }
@@ -38,9 +38,20 @@ public:
         std::string text;
     };
 
-    std::vector<Item> strings;
+    const std::vector<Item>& getStrings() const     { return strings; }
+
+    /** Removes any strings whose handles aren't in the given set. The handles of the
+        remaining strings are left unchanged.
+    */
+    void removeUnusedStrings (const std::unordered_set<uint32_t>& handlesUsed);
+
+    /** Manually adds an item - obviously to be used with care. */
+    void addItem (Item);
 
 private:
+    std::vector<Item> strings;
+    std::unordered_map<std::string, Handle> handlesForStrings;
+    std::unordered_map<uint32_t, size_t> indexesForHandles;
     uint32_t nextIndex = 1;
 };
 
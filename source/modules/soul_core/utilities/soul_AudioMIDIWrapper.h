@@ -117,7 +117,12 @@ struct AudioInputList
     template <typename PerformerOrSession>
     void connectEndpoint (PerformerOrSession& p, EndpointID endpointID, choc::buffer::ChannelRange channels)
     {
-        mappings.push_back ({ p.getEndpointHandle (endpointID), channels });
+        mappings.push_back ({ p.getEndpointHandle (endpointID), channels, {} });
+
+        // Each multi-channel endpoint needs its own interleaved frames, as the performer may not
+        // read them until advance() is called, after the other endpoints have been given theirs
+        if (channels.size() > 1)
+            mappings.back().frames.resize ({ channels.size(), maxBlockSize });
 
         if (channels.size() > scratchBuffer.getNumChannels())
             scratchBuffer.resize ({ channels.size(), maxBlockSize });
@@ -153,10 +158,69 @@ struct AudioInputList
         return true;
     }
 
+    /** Gives each audio input endpoint its own buffer that the performer reads directly
+        during advance(), so that setNextInputStreamFrames() only has to copy the channel data
+        into it. Any endpoints which can't take a buffer are still sent their frames.
+    */
+    void attachBuffers (Performer& p)
+    {
+        for (auto& mapping : mappings)
+        {
+            mapping.frames.resize ({ mapping.channels.size(), maxBlockSize });
+            mapping.isAttached = p.attachStreamBuffer (mapping.endpoint, mapping.frames.getView().data.data);
+
+            if (! mapping.isAttached && mapping.channels.size() == 1)
+                mapping.frames = {};
+        }
+    }
+
+    void detachBuffers (Performer& p)
+    {
+        for (auto& mapping : mappings)
+        {
+            if (mapping.isAttached)
+                p.attachStreamBuffer (mapping.endpoint, nullptr);
+
+            mapping.isAttached = false;
+        }
+    }
+
+    /** Hands a block of input frames straight to the performer's audio input endpoints,
+        bypassing the FIFO. Endpoints with an attached buffer just have the frames copied
+        into it, mono endpoints are given a view of the caller's channel data without any
+        copying, and other multi-channel endpoints are interleaved into their own buffer.
+        The performer may hold on to any of these views until its next advance() call.
+    */
+    void setNextInputStreamFrames (Performer& p, choc::buffer::ChannelArrayView<const float> inputChannels)
+    {
+        auto numFrames = inputChannels.getNumFrames();
+
+        for (auto& mapping : mappings)
+        {
+            if (mapping.isAttached)
+            {
+                copy (mapping.frames.getStart (numFrames), inputChannels.getChannelRange (mapping.channels));
+            }
+            else if (mapping.channels.size() == 1)
+            {
+                auto channel = inputChannels.getChannel (mapping.channels.start);
+                p.setNextInputStreamFrames (mapping.endpoint, choc::value::createArrayView (const_cast<float*> (channel.data.data), numFrames));
+            }
+            else
+            {
+                copy (mapping.frames.getStart (numFrames), inputChannels.getChannelRange (mapping.channels));
+                p.setNextInputStreamFrames (mapping.endpoint, choc::value::create2DArrayView (mapping.frames.getView().data.data,
+                                                                                              numFrames, mapping.channels.size()));
+            }
+        }
+    }
+
     struct InputMapping
     {
         EndpointHandle endpoint;
         choc::buffer::ChannelRange channels;
+        choc::buffer::InterleavedBuffer<float> frames;
+        bool isAttached = false;
     };
 
     std::vector<InputMapping> mappings;
@@ -194,22 +258,50 @@ struct AudioOutputList
     template <typename PerformerOrSession>
     void connectEndpoint (PerformerOrSession& p, EndpointID endpointID, choc::buffer::ChannelRange channels)
     {
-        mappings.push_back ({ p.getEndpointHandle (endpointID), channels });
+        mappings.push_back ({ p.getEndpointHandle (endpointID), channels, {} });
         totalNumChannels = std::max (totalNumChannels, channels.end);
     }
 
+    /** Gives each audio output endpoint a buffer that the performer copies its frames into
+        during advance(), so that handleOutputData() doesn't need to ask for them.
+    */
+    void attachBuffers (Performer& p, uint32_t maxBlockSize)
+    {
+        for (auto& mapping : mappings)
+        {
+            mapping.frames.resize ({ mapping.channels.size(), maxBlockSize });
+
+            if (! p.attachStreamBuffer (mapping.endpoint, mapping.frames.getView().data.data))
+                mapping.frames = {};
+        }
+    }
+
+    void detachBuffers (Performer& p)
+    {
+        for (auto& mapping : mappings)
+            if (mapping.frames.getNumChannels() != 0)
+                p.attachStreamBuffer (mapping.endpoint, nullptr);
+    }
+
     template <typename PerformerOrSession>
     void handleOutputData (PerformerOrSession& p, choc::buffer::ChannelArrayView<float> outputChannels)
     {
         for (auto& mapping : mappings)
-            addIntersection (outputChannels.getChannelRange (mapping.channels),
-                             getChannelSetFromArray (p.getOutputStreamFrames (mapping.endpoint)));
+        {
+            if (mapping.frames.getNumChannels() != 0)
+                addIntersection (outputChannels.getChannelRange (mapping.channels),
+                                 mapping.frames.getStart (outputChannels.getNumFrames()));
+            else
+                addIntersection (outputChannels.getChannelRange (mapping.channels),
+                                 getChannelSetFromArray (p.getOutputStreamFrames (mapping.endpoint)));
+        }
     }
 
     struct OutputMapping
     {
         EndpointHandle endpoint;
         choc::buffer::ChannelRange channels;
+        choc::buffer::InterleavedBuffer<float> frames;
     };
 
     uint32_t totalNumChannels = 0;
@@ -283,8 +375,29 @@ struct MIDIOutputList
     {
         clear();
 
-        for (auto& e : getOutputEndpointsOfType (p, OutputEndpointType::midi))
-            outputs.push_back (p.getEndpointHandle (e.endpointID));
+        auto endpoints = getOutputEndpointsOfType (p, OutputEndpointType::midi);
+        outputs.resize (endpoints.size());
+
+        for (size_t i = 0; i < endpoints.size(); ++i)
+        {
+            auto& output = outputs[i];
+            output.endpoint = p.getEndpointHandle (endpoints[i].endpointID);
+
+            // The performer writes events straight into this buffer, so it mustn't move after being attached
+            auto recordSize = p.getEventRecordSize (output.endpoint);
+            output.records.resize ((size_t) recordSize * maxEventsPerBlock);
+            output.buffer = { output.records.data(), recordSize, maxEventsPerBlock, 0 };
+
+            if (! p.attachEventBuffer (output.endpoint, std::addressof (output.buffer)))
+                output.records.clear();
+        }
+    }
+
+    void detachBuffers (Performer& p)
+    {
+        for (auto& output : outputs)
+            if (! output.records.empty())
+                p.attachEventBuffer (output.endpoint, nullptr);
     }
 
     void clear()
@@ -294,20 +407,41 @@ struct MIDIOutputList
 
     void handleOutputData (Performer& p, uint32_t startFrame, MIDIEventOutputList& midiOut)
     {
-        if (midiOut.capacity == 0)
-            return;
-
         for (auto& output : outputs)
         {
-            p.iterateOutputEvents (output, [=, &midiOut] (uint32_t frameOffset, const choc::value::ValueView& event) -> bool
+            if (! output.records.empty())
             {
-                return midiOut.addEvent (MIDIEvent::fromPackedMIDIData (startFrame + frameOffset,
-                                                                        event["midiBytes"].getInt32()));
-            });
+                auto record = output.records.data();
+
+                for (uint32_t i = 0; i < output.buffer.numEvents; ++i, record += output.buffer.recordSize)
+                {
+                    auto header = readUnaligned<Performer::EventRecordHeader> (record);
+
+                    if (! midiOut.addEvent (MIDIEvent::fromPackedMIDIData (startFrame + header.frameOffset,
+                                                                           readUnaligned<int32_t> (record + sizeof (header)))))
+                        break;
+                }
+            }
+            else if (midiOut.capacity != 0)
+            {
+                p.iterateOutputEvents (output.endpoint, [=, &midiOut] (uint32_t frameOffset, const choc::value::ValueView& event) -> bool
+                {
+                    return midiOut.addEvent (MIDIEvent::fromPackedMIDIData (startFrame + frameOffset,
+                                                                            event["midiBytes"].getInt32()));
+                });
+            }
         }
     }
 
-    std::vector<EndpointHandle> outputs;
+    struct MIDIOutput
+    {
+        EndpointHandle endpoint;
+        std::vector<uint8_t> records;
+        Performer::EventBuffer buffer;
+    };
+
+    static constexpr uint32_t maxEventsPerBlock = 1024;
+    std::vector<MIDIOutput> outputs;
 };
 
 //==============================================================================
@@ -383,7 +517,12 @@ struct EventOutputList
 
 //==============================================================================
 /** Holds the values for a list of traditional float32 parameters, and efficiently
-    allows them to be updated and for changed ones to be iterated.
+    allows them to be updated and for changed ones to be applied to a performer.
+
+    The values live in a flat array of atomics, with a bitset recording which ones have
+    changed, so setParameter() and markAsChanged() can be called from any thread without
+    locking, and applyChanges() can pass the new values straight to the performer without
+    having to serialise them through a FIFO.
 */
 struct ParameterStateList
 {
@@ -396,41 +535,25 @@ struct ParameterStateList
     {
         valueHolder = choc::value::createFloat32 (0);
 
-        rampedValueHolder = createWrappedSparseStreamEventHolder (0.0f, 0);
-        rampFramesMember = rampedValueHolder.getObjectMemberAt (0).value;
-        rampTargetMember = rampedValueHolder.getObjectMemberAt (1).value;
+        auto params = getInputEndpointsOfType (p, InputEndpointType::parameter);
+        numParameters = static_cast<uint32_t> (params.size());
+        parameters.reset (new Parameter[numParameters]);
+        dirtyFlags.reset (new std::atomic<uint64_t>[getNumDirtyFlagWords()]);
 
-        {
-            auto params = getInputEndpointsOfType (p, InputEndpointType::parameter);
+        for (uint32_t i = 0; i < getNumDirtyFlagWords(); ++i)
+            dirtyFlags[i] = 0;
 
-            parameters.clear();
-            parameters.reserve (params.size());
+        for (uint32_t i = 0; i < numParameters; ++i)
+        {
+            auto& param = parameters[i];
+            param.endpoint = p.getEndpointHandle (params[i].endpointID);
 
-            for (auto& parameterInput : params)
+            if (isStream (params[i]))
             {
-                Parameter param;
-                param.endpoint = p.getEndpointHandle (parameterInput.endpointID);
-
-                if (isStream (parameterInput))
-                {
-                    SOUL_ASSERT (getRampLengthForSparseStreamFn != nullptr);
-                    param.rampFrames = getRampLengthForSparseStreamFn (parameterInput);
-                }
-
-                parameters.push_back (param);
+                SOUL_ASSERT (getRampLengthForSparseStreamFn != nullptr);
+                param.rampFrames = getRampLengthForSparseStreamFn (params[i]);
             }
         }
-
-        std::vector<Parameter*> parameterPtrs;
-        parameterPtrs.reserve (parameters.size());
-
-        for (auto& param : parameters)
-            parameterPtrs.push_back (std::addressof (param));
-
-        auto dirtyHandles = dirtyList.initialise (parameterPtrs);
-
-        for (size_t i = 0; i < parameters.size(); ++i)
-            parameters[i].dirtyListHandle = dirtyHandles[i];
     }
 
     /** Sets the current value for a parameter, and if the value has changed, marks it as
@@ -438,63 +561,71 @@ struct ParameterStateList
     */
     void setParameter (uint32_t parameterIndex, float newValue)
     {
-        SOUL_ASSERT (parameterIndex < parameters.size());
-        auto& param = parameters[parameterIndex];
+        SOUL_ASSERT (parameterIndex < numParameters);
 
-        if (param.currentValue != newValue)
-        {
-            param.currentValue = newValue;
-            dirtyList.markAsDirty (param.dirtyListHandle);
-        }
+        if (parameters[parameterIndex].currentValue.exchange (newValue, std::memory_order_relaxed) != newValue)
+            markAsChanged (parameterIndex);
     }
 
     /** Forces the parameter to be marked as needing an update. */
     void markAsChanged (uint32_t parameterIndex)
     {
-        SOUL_ASSERT (parameterIndex < parameters.size());
-        dirtyList.markAsDirty (parameters[parameterIndex].dirtyListHandle);
+        SOUL_ASSERT (parameterIndex < numParameters);
+        dirtyFlags[parameterIndex / bitsPerWord].fetch_or (uint64_t (1) << (parameterIndex % bitsPerWord),
+                                                          std::memory_order_release);
     }
 
-    /** Pushes events for any endpoints which have had their value
-        modified by setParameter() or markAsChanged().
+    /** Sends the latest values of any parameters which have been modified by setParameter()
+        or markAsChanged() to their endpoints. This must be called on the rendering thread,
+        after the performer has been prepared for its next block.
     */
-    bool addToFIFO (MultiEndpointFIFO& fifo, uint64_t time)
+    template <typename PerformerOrSession>
+    void applyChanges (PerformerOrSession& p)
     {
-        while (auto p = dirtyList.popNextDirtyObject())
+        for (uint32_t word = 0; word < getNumDirtyFlagWords(); ++word)
         {
-            if (p->rampFrames == 0)
-            {
-                valueHolder.getViewReference().set (p->currentValue);
+            if (dirtyFlags[word].load (std::memory_order_relaxed) == 0)
+                continue;
 
-                if (! fifo.addInputData (p->endpoint, time, valueHolder))
-                    return false;
-            }
-            else
-            {
-                rampFramesMember.set (static_cast<int32_t> (p->rampFrames));
-                rampTargetMember.set (p->currentValue);
+            auto flags = dirtyFlags[word].exchange (0, std::memory_order_acquire);
 
-                if (! fifo.addInputData (p->endpoint, time, rampedValueHolder))
-                    return false;
-            }
+            for (auto index = word * bitsPerWord; flags != 0; ++index, flags >>= 1)
+                if ((flags & 1) != 0)
+                    applyValue (p, parameters[index]);
         }
-
-        return true;
     }
 
 private:
     struct Parameter
     {
-        choc::fifo::DirtyList<Parameter>::Handle dirtyListHandle = {};
         soul::EndpointHandle endpoint;
-        float currentValue = 0;
+        std::atomic<float> currentValue { 0 };
         uint32_t rampFrames = 0;
     };
 
-    std::vector<Parameter> parameters;
-    choc::fifo::DirtyList<Parameter> dirtyList;
-    choc::value::Value valueHolder, rampedValueHolder;
-    choc::value::ValueView rampFramesMember, rampTargetMember;
+    static constexpr uint32_t bitsPerWord = 64;
+
+    std::unique_ptr<Parameter[]> parameters;
+    std::unique_ptr<std::atomic<uint64_t>[]> dirtyFlags;
+    uint32_t numParameters = 0;
+    choc::value::Value valueHolder;
+
+    uint32_t getNumDirtyFlagWords() const      { return (numParameters + bitsPerWord - 1) / bitsPerWord; }
+
+    template <typename PerformerOrSession>
+    void applyValue (PerformerOrSession& p, const Parameter& param)
+    {
+        valueHolder.getViewReference().set (param.currentValue.load (std::memory_order_relaxed));
+
+        switch (param.endpoint.getType())
+        {
+            case EndpointType::stream:  p.setSparseInputStreamTarget (param.endpoint, valueHolder, param.rampFrames); break;
+            case EndpointType::event:   p.addInputEvent (param.endpoint, valueHolder); break;
+            case EndpointType::value:   p.setInputValue (param.endpoint, valueHolder); break;
+            case EndpointType::unknown:
+            default:                    SOUL_ASSERT_FALSE;
+        }
+    }
 };
 
 
@@ -641,6 +772,11 @@ struct TimelineEventEndpointList
 /**
     A wrapper to simplify the job of rendering a Performer which only needs to deal
     with a synchronous set of audio, MIDI and parameter data (i.e. standard plugin stuff).
+
+    Incoming audio is passed directly to the performer's stream inputs for each chunk
+    that is rendered, so the FIFO only has to carry MIDI, events and parameter changes.
+    Where the performer allows it, the audio and MIDI endpoints have buffers attached once
+    when preparing, so rendering a chunk doesn't need any per-endpoint calls for them.
 */
 struct AudioMIDIWrapper
 {
@@ -649,6 +785,10 @@ struct AudioMIDIWrapper
 
     void reset()
     {
+        audioInputList.detachBuffers (performer);
+        audioOutputList.detachBuffers (performer);
+        midiOutputList.detachBuffers (performer);
+
         totalFramesRendered = 0;
         audioInputList.initialise (maxInternalBlockSize);
         audioOutputList.clear();
@@ -676,7 +816,9 @@ struct AudioMIDIWrapper
         maxBlockSize = std::min (maxInternalBlockSize, processorMaxBlockSize);
 
         audioInputList.attachToAllAudioEndpoints (perf);
+        audioInputList.attachBuffers (perf);
         audioOutputList.initialise (perf);
+        audioOutputList.attachBuffers (perf, maxBlockSize);
         midiInputList.initialise (perf);
         midiOutputList.initialise (perf);
         parameterList.initialise (perf, std::move (getRampLengthForSparseStreamFn));
@@ -695,37 +837,7 @@ struct AudioMIDIWrapper
         if (numFrames > maxInternalBlockSize)
             return renderInChunks (input, output, midiIn, midiOut);
 
-        SOUL_ASSERT (input.getNumFrames() == numFrames && maxBlockSize != 0);
-
-        audioInputList.addToFIFO (inputFIFO, totalFramesRendered, input);
-        midiInputList.addToFIFO (inputFIFO, totalFramesRendered, midiIn);
-        parameterList.addToFIFO (inputFIFO, totalFramesRendered);
-        timelineEventEndpointList.addToFIFO (inputFIFO, totalFramesRendered);
-        uint32_t framesDone = 0;
-
-        inputFIFO.prepareForReading (totalFramesRendered, numFrames);
-
-        for (;;)
-        {
-            auto numFramesToDo = inputFIFO.getNumFramesInNextChunk (maxBlockSize);
-
-            if (numFramesToDo == 0)
-                break;
-
-            performer.prepare (numFramesToDo);
-            inputFIFO.processNextChunk ([&] (EndpointHandle endpoint, uint64_t /*itemStart*/, const choc::value::ValueView& value)
-                                        {
-                                            deliverValueToEndpoint (endpoint, value);
-                                        });
-            performer.advance();
-            audioOutputList.handleOutputData (performer, output.getFrameRange ({ framesDone, output.size.numFrames }));
-            midiOutputList.handleOutputData (performer, framesDone, midiOut);
-            eventOutputList.postOutputEvents (performer, totalFramesRendered + framesDone);
-            framesDone += numFramesToDo;
-        }
-
-        inputFIFO.finishReading();
-        totalFramesRendered += framesDone;
+        renderChunk (input, output, midiIn, midiOut, 0);
     }
 
     uint32_t getExpectedNumInputChannels() const     { return audioInputList.totalNumChannels; }
@@ -761,6 +873,51 @@ private:
 
     static constexpr uint32_t maxInternalBlockSize = 512;
 
+    // The MIDI event frame indexes are relative to the start of the caller's block, which
+    // begins blockOffset frames before this chunk.
+    void renderChunk (choc::buffer::ChannelArrayView<const float> input,
+                      choc::buffer::ChannelArrayView<float> output,
+                      MIDIEventInputList midiIn,
+                      MIDIEventOutputList& midiOut,
+                      uint32_t blockOffset)
+    {
+        auto numFrames = output.getNumFrames();
+        SOUL_ASSERT (input.getNumFrames() == numFrames && maxBlockSize != 0);
+
+        midiInputList.addToFIFO (inputFIFO, totalFramesRendered - blockOffset, midiIn);
+        timelineEventEndpointList.addToFIFO (inputFIFO, totalFramesRendered);
+        uint32_t framesDone = 0;
+
+        inputFIFO.prepareForReading (totalFramesRendered, numFrames);
+
+        for (;;)
+        {
+            auto numFramesToDo = inputFIFO.getNumFramesInNextChunk (maxBlockSize);
+
+            if (numFramesToDo == 0)
+                break;
+
+            performer.prepare (numFramesToDo);
+
+            if (framesDone == 0)
+                parameterList.applyChanges (performer);
+
+            inputFIFO.processNextChunk ([&] (EndpointHandle endpoint, uint64_t /*itemStart*/, const choc::value::ValueView& value)
+                                        {
+                                            deliverValueToEndpoint (endpoint, value);
+                                        });
+            audioInputList.setNextInputStreamFrames (performer, input.getFrameRange ({ framesDone, framesDone + numFramesToDo }));
+            performer.advance();
+            audioOutputList.handleOutputData (performer, output.getFrameRange ({ framesDone, framesDone + numFramesToDo }));
+            midiOutputList.handleOutputData (performer, blockOffset + framesDone, midiOut);
+            eventOutputList.postOutputEvents (performer, totalFramesRendered + framesDone);
+            framesDone += numFramesToDo;
+        }
+
+        inputFIFO.finishReading();
+        totalFramesRendered += framesDone;
+    }
+
     void renderInChunks (choc::buffer::ChannelArrayView<const float> input,
                          choc::buffer::ChannelArrayView<float> output,
                          MIDIEventInputList midiIn,
@@ -773,9 +930,9 @@ private:
             auto framesToDo = std::min (numFramesRemaining, maxInternalBlockSize);
             auto endFrame = start + framesToDo;
 
-            render (input.getFrameRange ({ start, endFrame }),
-                    output.getFrameRange ({ start, endFrame }),
-                    midiIn.removeEventsBefore (endFrame), midiOut);
+            renderChunk (input.getFrameRange ({ start, endFrame }),
+                         output.getFrameRange ({ start, endFrame }),
+                         midiIn.removeEventsBefore (endFrame), midiOut, start);
 
             if (numFramesRemaining <= framesToDo)
                 break;
@@ -51,35 +51,29 @@ struct Identifier  final
         {
             SOUL_ASSERT (! newString.empty());
 
-            size_t s = 0;
-            size_t e = strings.size();
+            if (slots.empty())
+                slots.resize (initialNumSlots);
 
-            while (s < e)
-            {
-                auto* elem = strings[s].get();
-
-                if (*elem == newString)
-                    return Identifier (elem);
-
-                auto halfway = (s + e) / 2;
-                bool isBeforeHalfway = (newString < *strings[halfway]);
+            auto hash = std::hash<std::string_view>() (newString);
+            auto mask = slots.size() - 1;
 
-                if (halfway == s)
-                {
-                    if (! isBeforeHalfway)
-                        ++s;
+            for (auto i = hash & mask;; i = (i + 1) & mask)
+            {
+                auto& slot = slots[i];
 
+                if (slot.string == nullptr)
                     break;
-                }
 
-                if (isBeforeHalfway)
-                    e = halfway;
-                else
-                    s = halfway;
+                if (slot.hash == hash && *slot.string == newString)
+                    return Identifier (slot.string);
             }
 
-            auto* sharedString = new std::string (newString);
-            strings.insert (strings.begin() + (int) s, std::unique_ptr<std::string> (sharedString));
+            // Keeping the table at most half full means that probe sequences stay short
+            if (2 * (strings.size() + 1) > slots.size())
+                resize (2 * slots.size());
+
+            auto* sharedString = std::addressof (strings.emplace_back (newString));
+            insert ({ hash, sharedString });
             return Identifier (sharedString);
         }
 
@@ -94,10 +88,42 @@ struct Identifier  final
         void clear()
         {
             strings.clear();
+            slots.clear();
         }
 
     private:
-        std::vector<std::unique_ptr<std::string>> strings;
+        struct Slot
+        {
+            size_t hash = 0;
+            const std::string* string = nullptr;
+        };
+
+        static constexpr size_t initialNumSlots = 256;
+
+        // A deque never moves its elements, so the pointers held by identifiers remain valid as it grows
+        std::deque<std::string> strings;
+        std::vector<Slot> slots;
+
+        void insert (Slot newSlot)
+        {
+            auto mask = slots.size() - 1;
+            auto i = newSlot.hash & mask;
+
+            while (slots[i].string != nullptr)
+                i = (i + 1) & mask;
+
+            slots[i] = newSlot;
+        }
+
+        void resize (size_t newNumSlots)
+        {
+            std::vector<Slot> oldSlots (newNumSlots);
+            std::swap (slots, oldSlots);
+
+            for (auto& s : oldSlots)
+                if (s.string != nullptr)
+                    insert (s);
+        }
     };
 
 private:
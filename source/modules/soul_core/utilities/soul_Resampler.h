@@ -21,91 +21,300 @@
 namespace soul
 {
 
-/** A sinc interpolator that can resample a chunk of audio data to fit a new number of frames. */
-template <typename DestType, typename SourceType>
-void resampleToFit (DestType&& dest, const SourceType& source, int zeroCrossings = 50)
-{
-    SOUL_ASSERT (dest.getNumChannels() == source.getNumChannels());
-    using SampleType = typename std::remove_reference<DestType>::type::Sample;
-    static constexpr auto localPi = SampleType (soul::pi);
+//==============================================================================
+/**
+    A polyphase bank of windowed-sinc kernels, used for band-limited interpolation.
 
-    struct Resampler
+    The kernels are evaluated once for a set of evenly-spaced fractional positions between
+    two samples, and getSample() interpolates between the two nearest ones, so producing an
+    output sample is just a pair of dot products, with no trig functions involved.
+
+    The cutoff is a proportion of the source's Nyquist frequency: when downsampling, it
+    should be the ratio of the new rate to the old one, which stretches the kernels so that
+    they also act as the anti-aliasing filter.
+*/
+template <typename SampleType>
+struct SincFilterBank
+{
+    SincFilterBank (double cutoffProportion, int numZeroCrossings)
+        : cutoff (getCutoff (cutoffProportion)),
+          halfLength (getHalfLength (cutoff, numZeroCrossings)),
+          kernelSize ((int) getAlignedSize<numLanes> ((size_t) (2 * halfLength))),
+          numPhases (getNumPhases (cutoff))
     {
-        static void resample (choc::buffer::MonoView<SampleType> dest, const choc::buffer::MonoView<SampleType>& source, int zeroCrossings)
+        SOUL_ASSERT (cutoffProportion > 0 && numZeroCrossings > 0);
+        kernels.resize ((size_t) ((numPhases + 1) * kernelSize));
+
+        for (int phase = 0; phase <= numPhases; ++phase)
         {
-            if (dest.getNumFrames() < source.getNumFrames())
-            {
-                choc::buffer::MonoBuffer<SampleType> bandlimitedInput (1, source.getNumFrames());
-                resample (bandlimitedInput, source, float (dest.getNumFrames()) / float (source.getNumFrames()), zeroCrossings);
-                resample (dest, bandlimitedInput, 1.0f, zeroCrossings);
-            }
-            else
+            auto kernel = kernels.data() + phase * kernelSize;
+
+            for (int i = 0; i < 2 * halfLength; ++i)
             {
-                resample (dest, source, 1.0f, zeroCrossings);
+                auto distance = (i - halfLength + 1) - phase / (double) numPhases;
+                kernel[i] = static_cast<SampleType> (cutoff * windowedSinc (cutoff * distance, numZeroCrossings));
             }
         }
+    }
 
-        static void resample (choc::buffer::MonoView<SampleType> dest, const choc::buffer::MonoView<SampleType>& source, float ratio, int zeroCrossings) noexcept
-        {
-            SOUL_ASSERT (source.data.stride == 1);
-            auto sampleIncrement = double (source.getNumFrames()) / double (dest.getNumFrames());
-            auto dst = dest.data;
+    /** Returns the interpolated value at a fractional position in a block of samples.
+        Samples outside the block are treated as silence.
+    */
+    SampleType getSample (const SampleType* data, int64_t numFrames, double position) const noexcept
+    {
+        auto base = (int64_t) std::floor (position);
+        auto phasePosition = (position - (double) base) * numPhases;
+        auto phase = std::min ((int) phasePosition, numPhases - 1);
+        auto proportion = static_cast<SampleType> (phasePosition - phase);
 
-            for (choc::buffer::FrameCount i = 0; i < dest.getNumFrames(); ++i)
+        auto first = base - halfLength + 1;
+        auto kernel1 = kernels.data() + phase * kernelSize;
+        auto kernel2 = kernel1 + kernelSize;
+        SampleType sum1 = {}, sum2 = {};
+
+        if (first >= 0 && first + kernelSize <= numFrames)
+        {
+            getDotProducts (data + first, kernel1, kernel2, sum1, sum2);
+        }
+        else
+        {
+            for (int i = 0; i < kernelSize; ++i)
             {
-                *dst.data = static_cast<SampleType> (ratio * getBandlimitedSample (source, sampleIncrement * i, ratio, zeroCrossings));
-                dst.data += dst.stride;
+                auto index = first + i;
+
+                if (index >= 0 && index < numFrames)
+                {
+                    sum1 += data[index] * kernel1[i];
+                    sum2 += data[index] * kernel2[i];
+                }
             }
         }
 
-        static SampleType getBandlimitedSample (const choc::buffer::MonoView<SampleType>& source, double pos, float ratio, int numZeroCrossings) noexcept
+        return sum1 + proportion * (sum2 - sum1);
+    }
+
+    /** The number of samples needed on either side of a position to calculate its value. */
+    int getHalfLength() const noexcept      { return halfLength; }
+
+    /** These give the sizes that a bank with the given settings will use, so that code
+        which builds the same kernels elsewhere (e.g. in generated C++) can match them.
+    */
+    static double getCutoff (double cutoffProportion) noexcept                { return std::min (1.0, cutoffProportion); }
+    static int getHalfLength (double cutoff, int numZeroCrossings) noexcept   { return (int) std::ceil (numZeroCrossings / cutoff); }
+
+    // stretched kernels change more slowly between phases, so need proportionally fewer of them
+    static int getNumPhases (double cutoff) noexcept    { return std::clamp ((int) (maxNumPhases * cutoff), minNumPhases, maxNumPhases); }
+
+private:
+    static constexpr int numLanes = 4;
+    static constexpr int minNumPhases = 16;
+    static constexpr int maxNumPhases = 512;
+
+    double cutoff;
+    int halfLength, kernelSize, numPhases;
+    std::vector<SampleType> kernels;
+
+    static double windowedSinc (double f, int numZeroCrossings) noexcept
+    {
+        if (f == 0)
+            return 1.0;
+
+        if (f > numZeroCrossings || f < -numZeroCrossings)
+            return 0;
+
+        f *= pi;
+        auto window = 0.5 + 0.5 * std::cos (f / numZeroCrossings);
+        return window * std::sin (f) / f;
+    }
+
+    void getDotProducts (const SampleType* data, const SampleType* kernel1, const SampleType* kernel2,
+                         SampleType& result1, SampleType& result2) const noexcept
+    {
+        // Separate accumulators for each lane let the compiler vectorise this loop
+        SampleType sums1[numLanes] = {}, sums2[numLanes] = {};
+
+        for (int i = 0; i < kernelSize; i += numLanes)
         {
-            auto intPos  = (int64_t) pos;
-            auto fracPos = (float) (pos - (double) intPos);
-            auto result = SampleType();
-            auto floatZeroCrossings = SampleType (numZeroCrossings);
-            auto data = source.data.data;
-            auto numFrames = source.getNumFrames();
-
-            if (fracPos > 0)
+            for (int lane = 0; lane < numLanes; ++lane)
             {
-                fracPos = 1.0f - fracPos;
-                ++intPos;
+                sums1[lane] += data[i + lane] * kernel1[i + lane];
+                sums2[lane] += data[i + lane] * kernel2[i + lane];
             }
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            result1 += sums1[lane];
+            result2 += sums2[lane];
+        }
+    }
+};
 
-            int crossings = int (float (numZeroCrossings) / ratio);
+//==============================================================================
+/** Calls a function for each channel index, spreading the channels across some temporary
+    threads if there's enough work to make that worthwhile.
+*/
+template <typename ChannelFn>
+void processChannelsInParallel (choc::buffer::ChannelCount numChannels, uint64_t workPerChannel, ChannelFn&& processChannel)
+{
+    static constexpr uint64_t minWorkForThreading = 1000000;
+    auto numThreads = std::min (numChannels, std::max (1u, std::thread::hardware_concurrency()));
 
-            for (int i = -crossings; i <= crossings; ++i)
-            {
-                auto sincPosition = SampleType (fracPos + (ratio * float (i)));
-                auto samplePosition = (uint32_t) (intPos + i);
+    if (numThreads <= 1 || workPerChannel < minWorkForThreading)
+    {
+        for (choc::buffer::ChannelCount channel = 0; channel < numChannels; ++channel)
+            processChannel (channel);
 
-                if (samplePosition < numFrames)
-                    result += static_cast<SampleType> (data[samplePosition] * windowedSinc (sincPosition, floatZeroCrossings));
-            }
+        return;
+    }
 
-            return result;
-        }
+    std::atomic<choc::buffer::ChannelCount> nextChannel { 0 };
 
-        static SampleType windowedSinc (SampleType f, SampleType numZeroCrossings) noexcept
+    auto processNextChannels = [&]
+    {
+        for (;;)
         {
-            if (f == SampleType())
-                return static_cast<SampleType> (1);
+            auto channel = nextChannel++;
 
-            if (f > numZeroCrossings || f < -numZeroCrossings)
-                return {};
+            if (channel >= numChannels)
+                break;
 
-            f *= localPi;
-            const auto window = SampleType (0.5) + SampleType (0.5) * std::cos (f / numZeroCrossings);
-            return window * std::sin (f) / f;
+            processChannel (channel);
         }
     };
 
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.emplace_back (processNextChannels);
+
+    processNextChannels();
+
+    for (auto& t : threads)
+        t.join();
+}
+
+//==============================================================================
+/** A sinc interpolator that can resample a chunk of audio data to fit a new number of frames. */
+template <typename DestType, typename SourceType>
+void resampleToFit (DestType&& dest, const SourceType& source, int zeroCrossings = 50)
+{
+    SOUL_ASSERT (dest.getNumChannels() == source.getNumChannels());
+    using SampleType = typename std::remove_reference<DestType>::type::Sample;
+
     if (dest.getNumFrames() == source.getNumFrames())
         return copy (dest, source);
 
-    for (choc::buffer::ChannelCount channel = 0; channel < source.getNumChannels(); ++channel)
-        Resampler::resample (dest.getChannel (channel), source.getChannel (channel), zeroCrossings);
+    auto numSourceFrames = source.getNumFrames();
+    auto numDestFrames = dest.getNumFrames();
+    auto sampleIncrement = double (numSourceFrames) / double (numDestFrames);
+    SincFilterBank<SampleType> filters (1.0 / sampleIncrement, zeroCrossings);
+
+    processChannelsInParallel (source.getNumChannels(), (uint64_t) numDestFrames * (uint64_t) filters.getHalfLength(),
+                               [&] (choc::buffer::ChannelCount channel)
+    {
+        auto src = source.getChannel (channel);
+        SOUL_ASSERT (src.data.stride == 1);
+        auto dst = dest.getChannel (channel).data;
+
+        for (choc::buffer::FrameCount i = 0; i < numDestFrames; ++i)
+        {
+            *dst.data = filters.getSample (src.data.data, numSourceFrames, sampleIncrement * i);
+            dst.data += dst.stride;
+        }
+    });
 }
 
+//==============================================================================
+/**
+    Resamples a continuous stream of audio which arrives in blocks, e.g. from a live input.
+
+    Each call to process() takes a block of input and writes out all the output frames that
+    can be calculated so far. Because the filter needs to see some input beyond each output
+    position, the output lags getLatencyInSourceFrames() behind the input, but its timing is
+    otherwise exact, i.e. output frame n always corresponds to input frame n * sourceRate / destRate.
+*/
+template <typename SampleType>
+struct StreamingResampler
+{
+    StreamingResampler (choc::buffer::ChannelCount numChannels, double sourceRate, double destRate,
+                        choc::buffer::FrameCount maxInputFramesPerBlock, int zeroCrossings = 16)
+        : filters (destRate / sourceRate, zeroCrossings),
+          sampleIncrement (sourceRate / destRate),
+          pendingFrames (numChannels)
+    {
+        SOUL_ASSERT (sourceRate > 0 && destRate > 0);
+
+        for (auto& p : pendingFrames)
+            p.reserve ((size_t) (maxInputFramesPerBlock + 2 * filters.getHalfLength() + 1));
+    }
+
+    /** Clears the stored input, so that the next block is treated as the start of a new stream. */
+    void reset()
+    {
+        for (auto& p : pendingFrames)
+            p.clear();
+
+        position = 0;
+    }
+
+    int getLatencyInSourceFrames() const            { return filters.getHalfLength(); }
+
+    /** Returns the largest number of frames that process() could produce for a block of input. */
+    choc::buffer::FrameCount getMaxOutputFrames (choc::buffer::FrameCount numInputFrames) const
+    {
+        return (choc::buffer::FrameCount) std::ceil ((numInputFrames + getLatencyInSourceFrames()) / sampleIncrement) + 1;
+    }
+
+    /** Reads all the frames from the source, and writes as many output frames as are now
+        available, returning the number written. If the destination isn't large enough to hold
+        them, the remainder are written on the next call.
+    */
+    template <typename DestView, typename SourceView>
+    choc::buffer::FrameCount process (DestView&& dest, const SourceView& source)
+    {
+        auto numChannels = (choc::buffer::ChannelCount) pendingFrames.size();
+        SOUL_ASSERT (source.getNumChannels() == numChannels && dest.getNumChannels() == numChannels);
+
+        for (choc::buffer::ChannelCount channel = 0; channel < numChannels; ++channel)
+        {
+            auto& pending = pendingFrames[channel];
+
+            for (choc::buffer::FrameCount i = 0; i < source.getNumFrames(); ++i)
+                pending.push_back (static_cast<SampleType> (source.getSample (channel, i)));
+        }
+
+        auto numAvailable = (int64_t) pendingFrames.front().size();
+        auto halfLength = filters.getHalfLength();
+        choc::buffer::FrameCount numDone = 0;
+
+        while (numDone < dest.getNumFrames() && (int64_t) std::floor (position) + halfLength < numAvailable)
+        {
+            for (choc::buffer::ChannelCount channel = 0; channel < numChannels; ++channel)
+                dest.getSample (channel, numDone) = filters.getSample (pendingFrames[channel].data(), numAvailable, position);
+
+            position += sampleIncrement;
+            ++numDone;
+        }
+
+        // Discard any frames that are now too far behind the read position to be needed again
+        auto numToDiscard = std::min ((int64_t) std::floor (position) - halfLength + 1, numAvailable);
+
+        if (numToDiscard > 0)
+        {
+            for (auto& pending : pendingFrames)
+                pending.erase (pending.begin(), pending.begin() + (ptrdiff_t) numToDiscard);
+
+            position -= (double) numToDiscard;
+        }
+
+        return numDone;
+    }
+
+private:
+    SincFilterBank<SampleType> filters;
+    double sampleIncrement, position = 0;
+    std::vector<std::vector<SampleType>> pendingFrames;
+};
+
 }
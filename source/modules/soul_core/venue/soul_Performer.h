@@ -130,6 +130,8 @@ public:
         to provide the next block of samples for an input stream. The value provided should be an
         array of as many frames as was specified in prepare(). If this is called more than once before
         advance(), only the most recent value is used.
+        The performer may keep a view of the data rather than copying it, so the data must stay valid
+        and unchanged until advance() has been called.
         The EndpointHandle is obtained by calling getEndpointHandle().
     */
     virtual void setNextInputStreamFrames (EndpointHandle, const choc::value::ValueView& frameArray) noexcept = 0;
@@ -178,6 +180,62 @@ public:
     */
     virtual void iterateOutputEvents (EndpointHandle, HandleNextOutputEventFn) noexcept = 0;
 
+    //==============================================================================
+    /** The header at the start of each record in an EventBuffer.
+        The event's data follows immediately after the header, in the packed layout of the
+        endpoint's data type at index typeIndex.
+    */
+    struct EventRecordHeader
+    {
+        uint32_t frameOffset;
+        uint32_t typeIndex;
+    };
+
+    /** A caller-owned list of events which can be attached to an event endpoint with
+        attachEventBuffer(). The records are stored contiguously, each one being recordSize
+        bytes long, which must be at least getEventRecordSize() for the endpoint.
+        For an input, the caller sets numEvents before calling advance(), and the events
+        (which must be in order, and have frame offsets within the block) are all dispatched
+        and numEvents is reset to 0. For an output, advance() fills in the records and sets
+        numEvents, and if there are more events than the capacity, the extra ones are dropped
+        and counted as an xrun.
+    */
+    struct EventBuffer
+    {
+        void* records = nullptr;
+        uint32_t recordSize = 0;
+        uint32_t capacity = 0;
+        uint32_t numEvents = 0;
+    };
+
+    /** Returns the minimum record size for an EventBuffer attached to this event endpoint,
+        or 0 if the handle isn't an event endpoint, or the performer doesn't support
+        attached buffers.
+    */
+    virtual uint32_t getEventRecordSize (EndpointHandle) noexcept               { return 0; }
+
+    /** Attaches a block of memory to a stream endpoint, which advance() will then use directly.
+        This lets a caller set up its buffers once, rather than making calls for every
+        endpoint on every block. The memory must be large enough to hold the number of frames
+        passed to prepare(), packed in the layout of the endpoint's frame type. For an input,
+        advance() reads the prepared number of frames from it unless setNextInputStreamFrames()
+        or setSparseInputStreamTarget() was called for that block. For an output, advance()
+        copies the rendered frames into it.
+        This can be called at any time after load() while advance() isn't running, and the
+        buffer stays attached until the program is unloaded, or nullptr is attached instead.
+        Returns false if the endpoint's type needs converting, e.g. if it contains strings, or
+        if the performer doesn't support attached buffers, in which case the caller should
+        carry on using the per-block methods. The default implementation always returns false.
+    */
+    virtual bool attachStreamBuffer (EndpointHandle, void*) noexcept            { return false; }
+
+    /** Attaches an EventBuffer to an event endpoint, which advance() will then read from or
+        write to directly. The same rules apply as for attachStreamBuffer(). The EventBuffer
+        object itself must stay valid for as long as it's attached.
+        The default implementation always returns false.
+    */
+    virtual bool attachEventBuffer (EndpointHandle, EventBuffer*) noexcept      { return false; }
+
     /** Renders the next block of frames.
 
         Once the caller has called prepare(), a call to advance() will synchronously render the next
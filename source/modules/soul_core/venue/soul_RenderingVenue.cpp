@@ -26,47 +26,65 @@ namespace soul
 {
 
 //==============================================================================
-struct TaskThread
+/**
+    A set of threads which service a list of task queues. Each queue's tasks are run
+    in the order they were added, and never more than one at a time, but tasks from
+    different queues can run concurrently on different threads.
+*/
+struct TaskThreadPool
 {
-    TaskThread()
+    TaskThreadPool (uint32_t numThreads)
     {
-        queues.reserve (8);
-        thread = std::thread ([this] { run(); });
+        numThreads = std::max (1u, numThreads);
+        runningQueues.resize (numThreads);
+        runningTasks.resize (numThreads);
+        threads.reserve (numThreads);
+
+        for (uint32_t i = 0; i < numThreads; ++i)
+            threads.emplace_back ([this, i] { run (i); });
     }
 
-    ~TaskThread()
+    ~TaskThreadPool()
     {
         shutdown();
     }
 
     void sendShutdownSignal()
     {
+        std::lock_guard<std::mutex> l (lock);
         shuttingDown = 1;
-        std::lock_guard<std::mutex> l (queueLock);
 
-        for (auto& q : queues)
+        for (auto q : readyQueues)
             q->cancelPendingTasks();
 
-        checkQueues.notify_all();
+        for (auto q : runningQueues)
+            if (q != nullptr)
+                q->cancelPendingTasks();
+
+        for (auto t : runningTasks)
+            if (t != nullptr)
+                t->cancelled = 1;
+
+        readyQueues.clear();
+        queueReady.notify_all();
     }
 
-    void waitForThreadToFinish()
+    void waitForThreadsToFinish()
     {
-        SOUL_ASSERT (std::this_thread::get_id() != thread.get_id());
+        SOUL_ASSERT (! isPoolThread());
         SOUL_ASSERT (shuttingDown);
 
-        if (thread.joinable())
-        {
-            thread.join();
-            thread = {};
-        }
+        for (auto& t : threads)
+            if (t.joinable())
+                t.join();
+
+        threads.clear();
     }
 
     void shutdown()
     {
         sendShutdownSignal();
-        waitForThreadToFinish();
-        queues.clear();
+        waitForThreadsToFinish();
     }
 
     using ShouldStopFlag = std::atomic<int>;
@@ -74,32 +92,51 @@ struct TaskThread
     //==============================================================================
     struct Queue
     {
-        Queue (TaskThread& t)  : ownerThread (t)
+        Queue (TaskThreadPool& p)  : pool (p) {}
+
+        using TaskFunction = std::function<void(ShouldStopFlag&)>;
+
+        void attach()
         {
-            tasks.reserve (16);
+            std::lock_guard<std::mutex> l (pool.lock);
+            attached = true;
         }
 
-        using TaskFunction = std::function<void(ShouldStopFlag&)>;
+        /** Cancels any pending tasks, and if a task from this queue is running on another
+            thread, waits for it to finish. This may be called by one of this queue's own
+            tasks, after which the queue can safely be deleted.
+        */
+        void detach()
+        {
+            std::unique_lock<std::mutex> l (pool.lock);
+            attached = false;
+            cancelPendingTasks();
+
+            if (isScheduled)
+            {
+                removeIf (pool.readyQueues, [this] (Queue* q) { return q == this; });
+                isScheduled = false;
+            }
 
-        void attach()  { ownerThread.addQueue (*this); }
-        void detach()  { ownerThread.removeQueue (*this); }
+            pool.waitForQueueToFinishRunning (*this, l);
+        }
 
         void addTask (TaskFunction&& task)
         {
-            std::lock_guard<std::mutex> l (taskListLock);
+            std::lock_guard<std::mutex> l (pool.lock);
 
-            if (ownerThread.shuttingDown)
+            if (pool.shuttingDown || ! attached)
                 return;
 
             auto taskHolder = std::make_unique<TaskHolder>();
             taskHolder->function = std::move (task);
             tasks.emplace_back (std::move (taskHolder));
-            ownerThread.checkQueues.notify_all();
+            pool.scheduleQueue (*this);
         }
 
     private:
-        TaskThread& ownerThread;
-        friend struct TaskThread;
+        TaskThreadPool& pool;
+        friend struct TaskThreadPool;
 
         struct TaskHolder
         {
@@ -107,107 +144,322 @@ struct TaskThread
             ShouldStopFlag cancelled { 0 };
         };
 
-        std::vector<std::unique_ptr<TaskHolder>> tasks;
-        std::mutex taskListLock;
+        std::deque<std::unique_ptr<TaskHolder>> tasks;
+        bool attached = false, isScheduled = false;
 
-        bool serviceNextTask()
+        void cancelPendingTasks()
         {
-            std::unique_lock<std::mutex> l (taskListLock);
+            for (auto& t : tasks)
+                t->cancelled = 1;
 
-            if (tasks.empty())
-                return false;
+            tasks.clear();
+        }
+    };
+
+private:
+    //==============================================================================
+    std::vector<std::thread> threads;
+    ShouldStopFlag shuttingDown { 0 };
+
+    // All the queue and task state is protected by this lock
+    std::mutex lock;
+    std::condition_variable queueReady, queueFinished;
+    std::deque<Queue*> readyQueues;
+    std::vector<Queue*> runningQueues;
+    std::vector<Queue::TaskHolder*> runningTasks;
+
+    bool isPoolThread() const
+    {
+        auto currentThread = std::this_thread::get_id();
+
+        for (auto& t : threads)
+            if (t.get_id() == currentThread)
+                return true;
+
+        return false;
+    }
+
+    bool isQueueRunning (Queue& queue) const
+    {
+        return contains (runningQueues, std::addressof (queue));
+    }
+
+    void scheduleQueue (Queue& queue)
+    {
+        if (! (queue.isScheduled || queue.tasks.empty() || isQueueRunning (queue)))
+        {
+            queue.isScheduled = true;
+            readyQueues.push_back (std::addressof (queue));
+            queueReady.notify_one();
+        }
+    }
+
+    void waitForQueueToFinishRunning (Queue& queue, std::unique_lock<std::mutex>& l)
+    {
+        auto currentThread = std::this_thread::get_id();
+
+        for (size_t i = 0; i < threads.size(); ++i)
+        {
+            // If a task is detaching its own queue, the worker mustn't touch it afterwards
+            if (runningQueues[i] == std::addressof (queue) && threads[i].get_id() == currentThread)
+            {
+                runningQueues[i] = nullptr;
+                return;
+            }
+        }
+
+        queueFinished.wait (l, [&] { return ! isQueueRunning (queue); });
+    }
+
+    void run (size_t threadIndex)
+    {
+        std::unique_lock<std::mutex> l (lock);
+
+        for (;;)
+        {
+            queueReady.wait (l, [this] { return shuttingDown || ! readyQueues.empty(); });
 
-            auto task = std::move (tasks.front());
-            tasks.erase (tasks.begin());
+            if (shuttingDown)
+                return;
+
+            auto queue = readyQueues.front();
+            readyQueues.pop_front();
+            queue->isScheduled = false;
+
+            auto task = std::move (queue->tasks.front());
+            queue->tasks.pop_front();
+
+            runningQueues[threadIndex] = queue;
+            runningTasks[threadIndex] = task.get();
             l.unlock();
 
             if (! task->cancelled)
                 task->function (task->cancelled);
 
-            return true;
+            l.lock();
+            runningTasks[threadIndex] = nullptr;
+
+            if (runningQueues[threadIndex] == queue)
+            {
+                runningQueues[threadIndex] = nullptr;
+
+                if (queue->attached && ! shuttingDown)
+                    scheduleQueue (*queue);
+            }
+
+            queueFinished.notify_all();
         }
+    }
+};
 
-        void cancelPendingTasks()
+//==============================================================================
+/**
+    A fixed set of worker threads which help a render callback to get through a batch
+    of independent jobs. The caller takes part in the work and then spins until every
+    job has been done, so it never waits for a worker that has nothing left to do, and
+    no locks or allocations are involved while a batch runs.
+    Idle workers spin for a while before parking, and on Linux each one is pinned to
+    its own core (leaving core 0 for the caller).
+*/
+struct RenderThreadPool
+{
+    RenderThreadPool (uint32_t numThreads)
+    {
+        workers.reserve (numThreads);
+
+        for (uint32_t i = 0; i < numThreads; ++i)
+            workers.emplace_back ([this, i] { run (i + 1); });
+    }
+
+    ~RenderThreadPool()
+    {
         {
-            std::lock_guard<std::mutex> l (taskListLock);
+            std::lock_guard<std::mutex> l (parkLock);
+            shuttingDown = true;
+        }
 
-            for (auto& t : tasks)
-                t->cancelled = 1;
+        wakeUp.notify_all();
+
+        for (auto& w : workers)
+            w.join();
+    }
 
-            ownerThread.checkQueues.notify_all();
+    /** Calls performJob (index) for each index from 0 to numJobs - 1, in no particular
+        order, sharing the calls between the calling thread and the workers, and returns
+        when they've all finished.
+        This must only be called by one thread at a time.
+    */
+    template <typename PerformJobFn>
+    void perform (uint32_t numJobs, PerformJobFn&& performJob)
+    {
+        if (numJobs <= 1 || workers.empty())
+        {
+            for (uint32_t i = 0; i < numJobs; ++i)
+                performJob (i);
+
+            return;
         }
-    };
+
+        using FunctionType = typename std::remove_reference<PerformJobFn>::type;
+
+        jobContext = std::addressof (performJob);
+        jobFunction = [] (void* context, uint32_t index) { (*static_cast<FunctionType*> (context)) (index); };
+        numJobsFinished.store (0, std::memory_order_relaxed);
+
+        if (++batchNumber == 0)
+            batchNumber = 1;
+
+        jobState.store (makeJobState (batchNumber, numJobs));
+
+        // Parked workers are woken without taking parkLock, so one that's just about to
+        // wait may miss this, but it'll notice the new batch when its wait times out.
+        if (numParkedWorkers.load() != 0)
+            wakeUp.notify_all();
+
+        performJobs (batchNumber);
+
+        while (numJobsFinished.load (std::memory_order_acquire) != numJobs)
+            pause();
+    }
 
 private:
     //==============================================================================
-    std::thread thread;
-    ShouldStopFlag shuttingDown { 0 };
+    std::vector<std::thread> workers;
+
+    void* jobContext = nullptr;
+    void (*jobFunction) (void*, uint32_t) = nullptr;
+    uint32_t batchNumber = 0;
+
+    // The current batch number is held in the upper 32 bits and the number of jobs
+    // still to be claimed in the lower 32, so a worker that's still running after its
+    // batch has finished can never claim a job from the next one.
+    std::atomic<uint64_t> jobState { 0 };
+    std::atomic<uint32_t> numJobsFinished { 0 }, numParkedWorkers { 0 };
+    std::atomic<bool> shuttingDown { false };
+    std::mutex parkLock;
+    std::condition_variable wakeUp;
+
+    static constexpr uint32_t numSpinsBeforeParking = 10000;
+    static constexpr std::chrono::milliseconds maxParkingTime { 1 };
+
+    static uint64_t makeJobState (uint32_t batch, uint32_t jobsRemaining)   { return (static_cast<uint64_t> (batch) << 32) | jobsRemaining; }
+    static uint32_t getBatch (uint64_t state)                               { return static_cast<uint32_t> (state >> 32); }
+    static uint32_t getJobsRemaining (uint64_t state)                       { return static_cast<uint32_t> (state); }
+
+    void run (uint32_t coreIndex)
+    {
+        pinCurrentThreadToCore (coreIndex);
+        ScopedDisableDenormals disableDenormals;
+        uint32_t lastBatch = 0;
 
-    std::vector<Queue*> queues;
-    std::mutex queueLock;
-    std::condition_variable checkQueues;
+        while (waitForNextBatch (lastBatch))
+            performJobs (lastBatch);
+    }
 
-    void run()
+    bool waitForNextBatch (uint32_t& lastBatch)
     {
-        while (! shuttingDown)
+        for (uint32_t i = 0; i < numSpinsBeforeParking; ++i)
         {
-            bool anyTasksDone = false;
-            std::unique_lock<std::mutex> l (queueLock);
+            if (shuttingDown)
+                return false;
 
-            // NB: avoid iterator because the vector can be modified during the loop
-            for (size_t i = 0; i < queues.size(); ++i)
-            {
-                if (shuttingDown)
-                    return;
+            auto batch = getBatch (jobState.load (std::memory_order_acquire));
 
-                if (queues[i]->serviceNextTask())
-                    anyTasksDone = true;
+            if (batch != lastBatch)
+            {
+                lastBatch = batch;
+                return true;
             }
 
-            if (! anyTasksDone)
-                checkQueues.wait_for (l, std::chrono::milliseconds (500));
+            pause();
         }
+
+        std::unique_lock<std::mutex> l (parkLock);
+        ++numParkedWorkers;
+
+        while (! (shuttingDown || getBatch (jobState.load()) != lastBatch))
+            wakeUp.wait_for (l, maxParkingTime);
+
+        --numParkedWorkers;
+
+        if (shuttingDown)
+            return false;
+
+        lastBatch = getBatch (jobState.load());
+        return true;
     }
 
-    void addQueue (Queue& queue)
+    void performJobs (uint32_t batch)
     {
-        std::unique_lock<std::mutex> l;
+        for (;;)
+        {
+            auto state = jobState.load (std::memory_order_acquire);
 
-        if (std::this_thread::get_id() != thread.get_id())
-            l = std::unique_lock<std::mutex> (queueLock);
+            do
+            {
+                if (getBatch (state) != batch || getJobsRemaining (state) == 0)
+                    return;
+            }
+            while (! jobState.compare_exchange_weak (state, state - 1, std::memory_order_acq_rel));
 
-        queues.push_back (std::addressof (queue));
+            jobFunction (jobContext, getJobsRemaining (state) - 1);
+            numJobsFinished.fetch_add (1, std::memory_order_release);
+        }
     }
 
-    void removeQueue (Queue& queue)
+    static void pause() noexcept
     {
-        std::unique_lock<std::mutex> l;
+       #if SOUL_INTEL
+        _mm_pause();
+       #elif SOUL_ARM64 || SOUL_ARM32
+        asm volatile ("yield");
+       #else
+        std::this_thread::yield();
+       #endif
+    }
 
-        if (std::this_thread::get_id() != thread.get_id())
-            l = std::unique_lock<std::mutex> (queueLock);
+    static void pinCurrentThreadToCore (uint32_t coreIndex)
+    {
+       #ifdef __linux__
+        auto numCores = std::thread::hardware_concurrency();
 
-        removeIf (queues, [&] (Queue* q) { return q == std::addressof (queue); });
+        if (numCores > 1)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO (&cpus);
+            CPU_SET (coreIndex % numCores, &cpus);
+            pthread_setaffinity_np (pthread_self(), sizeof (cpus), &cpus);
+        }
+       #else
+        (void) coreIndex;
+       #endif
     }
 };
 
 //==============================================================================
 struct RenderingVenue::Pimpl
 {
-    Pimpl (std::unique_ptr<PerformerFactory> p)
+    Pimpl (std::unique_ptr<PerformerFactory> p, uint32_t numRenderThreads, uint32_t numTaskThreads)
         : performerFactory (std::move (p)),
-          taskThread(),
-          createSessionQueue (taskThread)
+          taskThreads (numTaskThreads),
+          createSessionQueue (taskThreads)
     {
         createSessionQueue.attach();
         loadMeasurer.reset();
+
+        if (numRenderThreads != 0)
+            renderThreadPool = std::make_unique<RenderThreadPool> (numRenderThreads);
     }
 
     ~Pimpl()
     {
-        std::lock_guard<std::mutex> l (sessionListLock);
-        SOUL_ASSERT (activeSessions.empty());
+        {
+            std::lock_guard<std::mutex> l (sessionListLock);
+            SOUL_ASSERT (activeSessionList->empty());
+        }
+
         createSessionQueue.detach();
-        taskThread.shutdown();
+        taskThreads.shutdown();
     }
 
     //==============================================================================
@@ -215,7 +467,7 @@ struct RenderingVenue::Pimpl
     {
         SessionImpl (Pimpl& v, std::unique_ptr<soul::Performer> p)
             : venue (v),
-              taskQueue (venue.taskThread),
+              taskQueue (venue.taskThreads),
               performer (std::move (p))
         {
             SOUL_ASSERT (performer != nullptr);
@@ -235,8 +487,10 @@ struct RenderingVenue::Pimpl
             if (program.isEmpty())
                 return false;
 
-            taskQueue.addTask ([this, program,
-                                callback = std::move (loadFinishedCallback)] (TaskThread::ShouldStopFlag& cancelled)
+            // The task gets its own copy, because Program objects share their contents, and
+            // the caller may go on using theirs while another session's task uses the same one
+            taskQueue.addTask ([this, program = program.clone(),
+                                callback = std::move (loadFinishedCallback)] (TaskThreadPool::ShouldStopFlag& cancelled)
             {
                 CompileMessageList messageList;
                 bool ok = performer->load (messageList, program);
@@ -257,7 +511,7 @@ struct RenderingVenue::Pimpl
         {
             stop();
 
-            taskQueue.addTask ([this] (TaskThread::ShouldStopFlag&)
+            taskQueue.addTask ([this] (TaskThreadPool::ShouldStopFlag&)
             {
                 performer->unload();
                 setState (SessionState::empty);
@@ -266,7 +520,7 @@ struct RenderingVenue::Pimpl
 
         bool start() override
         {
-            taskQueue.addTask ([this] (TaskThread::ShouldStopFlag&)
+            taskQueue.addTask ([this] (TaskThreadPool::ShouldStopFlag&)
             {
                 if (state == SessionState::linked)
                 {
@@ -285,7 +539,7 @@ struct RenderingVenue::Pimpl
 
         void stop() override
         {
-            taskQueue.addTask ([this] (TaskThread::ShouldStopFlag&)
+            taskQueue.addTask ([this] (TaskThreadPool::ShouldStopFlag&)
             {
                 if (isRunning())
                 {
@@ -313,7 +567,7 @@ struct RenderingVenue::Pimpl
         //==============================================================================
         bool link (const BuildSettings& settings, CompileTaskFinishedCallback linkFinishedCallback) override
         {
-            taskQueue.addTask ([this, settings, callback = std::move (linkFinishedCallback)] (TaskThread::ShouldStopFlag& cancelled)
+            taskQueue.addTask ([this, settings, callback = std::move (linkFinishedCallback)] (TaskThreadPool::ShouldStopFlag& cancelled)
             {
                 if (state == SessionState::loaded)
                 {
@@ -400,6 +654,9 @@ struct RenderingVenue::Pimpl
             if (beginNextBlockCallback != nullptr)
                 beginNextBlockCallback (numFrames);
 
+            InputActions inputActions (*performer);
+            OutputActions outputActions (*performer);
+
             while (numFrames != 0)
             {
                 auto framesToDo = std::min (maxBlockSize, numFrames);
@@ -418,18 +675,12 @@ struct RenderingVenue::Pimpl
                 performer->prepare (framesToDo);
 
                 if (preRenderCallback != nullptr)
-                {
-                    InputActions actions (*performer);
-                    preRenderCallback (actions, framesToDo);
-                }
+                    preRenderCallback (inputActions, framesToDo);
 
                 performer->advance();
 
                 if (postRenderCallback != nullptr)
-                {
-                    OutputActions actions (*performer);
-                    postRenderCallback (actions, framesToDo);
-                }
+                    postRenderCallback (outputActions, framesToDo);
 
                 totalFramesRendered += framesToDo;
                 numFrames -= framesToDo;
@@ -440,7 +691,7 @@ struct RenderingVenue::Pimpl
 
     private:
         RenderingVenue::Pimpl& venue;
-        TaskThread::Queue taskQueue;
+        TaskThreadPool::Queue taskQueue;
         std::unique_ptr<Performer> performer;
         std::atomic<SessionState> state { SessionState::empty };
         std::atomic<uint64_t> totalFramesRendered { 0 };
@@ -458,18 +709,25 @@ struct RenderingVenue::Pimpl
 
     //==============================================================================
     std::unique_ptr<PerformerFactory> performerFactory;
-    TaskThread taskThread;
-    TaskThread::Queue createSessionQueue;
+    TaskThreadPool taskThreads;
+    TaskThreadPool::Queue createSessionQueue;
 
+    // The render thread only ever reads the list that activeSessions points to, and
+    // never locks. Changes are made to a copy, which is then swapped in, and the old list
+    // is only deleted once the render thread is known to have stopped using it.
+    using SessionList = std::vector<SessionImpl*>;
     std::mutex sessionListLock;
-    std::vector<SessionImpl*> activeSessions;
+    std::unique_ptr<SessionList> activeSessionList { std::make_unique<SessionList>() };
+    std::atomic<const SessionList*> activeSessions { activeSessionList.get() };
+    std::atomic<uint32_t> renderCallbackCount { 0 };
+    std::unique_ptr<RenderThreadPool> renderThreadPool;
 
     CPULoadMeasurer loadMeasurer;
 
     //==============================================================================
     bool createSession (SessionReadyCallback cb)
     {
-        createSessionQueue.addTask ([this, callback = std::move (cb)] (TaskThread::ShouldStopFlag&)
+        createSessionQueue.addTask ([this, callback = std::move (cb)] (TaskThreadPool::ShouldStopFlag&)
         {
             callback (std::make_unique<Pimpl::SessionImpl> (*this, performerFactory->createPerformer()));
         });
@@ -479,38 +737,101 @@ struct RenderingVenue::Pimpl
 
     void addActiveSession (SessionImpl& session)
     {
-        std::lock_guard<std::mutex> l (sessionListLock);
-        activeSessions.push_back (std::addressof (session));
+        modifyActiveSessionList ([&] (SessionList& list) { list.push_back (std::addressof (session)); });
     }
 
     void removeActiveSession (SessionImpl& session)
+    {
+        modifyActiveSessionList ([&] (SessionList& list) { removeIf (list, [&] (SessionImpl* s) { return s == std::addressof (session); }); });
+    }
+
+    template <typename ModifyFn>
+    void modifyActiveSessionList (ModifyFn&& modify)
     {
         std::lock_guard<std::mutex> l (sessionListLock);
-        removeIf (activeSessions, [&] (SessionImpl* s) { return s == std::addressof (session); });
+        auto newList = std::make_unique<SessionList> (*activeSessionList);
+        modify (*newList);
+        activeSessions = newList.get();
+        waitForRenderCallbackToFinish();
+        activeSessionList = std::move (newList);
     }
 
+    // The count is odd while a render callback is running, so if it's odd now, we need
+    // to wait for it to change before the old list (or a removed session) can be deleted.
+    void waitForRenderCallbackToFinish()
+    {
+        auto count = renderCallbackCount.load();
+
+        if ((count & 1u) != 0)
+            while (renderCallbackCount.load() == count)
+                std::this_thread::yield();
+    }
+
+    struct ScopedRenderCallbackCounter
+    {
+        ScopedRenderCallbackCounter (std::atomic<uint32_t>& c) : count (c)  { ++count; }
+        ~ScopedRenderCallbackCounter()                                     { ++count; }
+
+        std::atomic<uint32_t>& count;
+    };
+
     const char* renderActiveSessions (uint32_t numFrames)
     {
+        if (numFrames == 0)
+            return "Illegal frame count";
+
         loadMeasurer.startMeasurement();
+        std::exception_ptr failure;
 
         {
-            std::lock_guard<std::mutex> l (sessionListLock);
+            ScopedRenderCallbackCounter renderCounter (renderCallbackCount);
+            auto& sessions = *activeSessions.load();
 
-            if (numFrames == 0)
-                return "Illegal frame count";
+            if (renderThreadPool != nullptr)
+            {
+                std::atomic<bool> failed { false };
 
-            for (auto& s : activeSessions)
-                s->render (numFrames);
+                // Any exception is handed back to this thread, so that it reaches the caller
+                // in the same way as it would if the sessions were rendered here
+                renderThreadPool->perform (static_cast<uint32_t> (sessions.size()), [&] (uint32_t index)
+                {
+                    try
+                    {
+                        sessions[index]->render (numFrames);
+                    }
+                    catch (...)
+                    {
+                        if (! failed.exchange (true))
+                            failure = std::current_exception();
+                    }
+                });
+            }
+            else
+            {
+                try
+                {
+                    for (auto& s : sessions)
+                        s->render (numFrames);
+                }
+                catch (...)
+                {
+                    failure = std::current_exception();
+                }
+            }
         }
 
         loadMeasurer.stopMeasurement();
+
+        if (failure != nullptr)
+            std::rethrow_exception (failure);
+
         return {};
     }
 };
 
 //==============================================================================
-RenderingVenue::RenderingVenue (std::unique_ptr<PerformerFactory> p)
-    : pimpl (std::make_unique<Pimpl> (std::move (p)))
+RenderingVenue::RenderingVenue (std::unique_ptr<PerformerFactory> p, uint32_t numRenderThreads, uint32_t numTaskThreads)
+    : pimpl (std::make_unique<Pimpl> (std::move (p), numRenderThreads, numTaskThreads))
 {
 }
 
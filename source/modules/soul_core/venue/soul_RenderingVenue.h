@@ -29,11 +29,25 @@ namespace soul
 class RenderingVenue  : public Venue
 {
 public:
-    RenderingVenue (std::unique_ptr<PerformerFactory>);
+    /** Creates a venue which uses the given factory to create performers for its sessions.
+        If numRenderThreads is greater than zero, a pool of that many worker threads is
+        started, and the caller of render() will share the work of rendering the active
+        sessions with them. If it's zero, all sessions are rendered on the caller's thread.
+        The workers spin while waiting for work, so there should be fewer of them than
+        there are cores. Note that when using worker threads, the IO callbacks of different
+        sessions may be invoked concurrently.
+
+        Loading and linking is done by a separate pool of numTaskThreads threads. Each
+        session's tasks are performed in order, but different sessions can be loaded and
+        linked concurrently if there's more than one of these threads, in which case the
+        callbacks for different sessions may also be invoked concurrently.
+    */
+    RenderingVenue (std::unique_ptr<PerformerFactory>, uint32_t numRenderThreads = 0, uint32_t numTaskThreads = 1);
     ~RenderingVenue() override;
 
     /** This method needs to be called by either a thread or an audio callback
-        to keep the rendering process running.
+        to keep the rendering process running. It mustn't be called by more than one
+        thread at a time, and it never blocks waiting for sessions to be started or stopped.
         @returns either nullptr if all went well, or an error message.
     */
     const char* render (uint32_t numFrames);
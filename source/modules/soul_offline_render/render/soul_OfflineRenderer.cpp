@@ -0,0 +1,652 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+namespace soul::offline_render
+{
+
+/** Relative paths in a job are taken to be relative to the current working directory. */
+static juce::File getFile (const std::string& path)
+{
+    return juce::File::getCurrentWorkingDirectory().getChildFile (juce::String (path));
+}
+
+//==============================================================================
+/** The program being rendered, which may be a patch or a plain SOUL file. */
+struct Renderable
+{
+    virtual ~Renderable() = default;
+
+    virtual uint32_t getNumInputChannels() = 0;
+    virtual uint32_t getNumOutputChannels() = 0;
+    virtual uint32_t getLatency() = 0;
+
+    /** Returns the index of the parameter with this ID, or -1 if there isn't one. */
+    virtual int findParameter (std::string_view parameterID) = 0;
+    virtual void setParameter (uint32_t parameterIndex, float newValue) = 0;
+
+    virtual void render (const float* const* input, float* const* output, uint32_t numFrames, MIDIEventInputList) = 0;
+};
+
+//==============================================================================
+/** Runs a .soulpatch, using the same PatchPlayer implementation as the patch loader DLL. */
+struct PatchRenderable  : public Renderable
+{
+    static std::unique_ptr<Renderable> create (const RenderJob& job, std::unique_ptr<PerformerFactory> factory,
+                                               double sampleRate, uint32_t blockSize, std::string& errorMessage)
+    {
+        BuildSettings settings;
+        settings.sampleRate = sampleRate;
+        settings.maxBlockSize = blockSize;
+
+        auto path = getFile (job.sourceFile).getFullPathName();
+        patch::PatchInstance::Ptr instance (patch::createPatchInstance (std::move (factory), settings, path.toRawUTF8()));
+
+        if (instance == nullptr)
+        {
+            errorMessage = "Failed to open " + job.sourceFile;
+            return {};
+        }
+
+        patch::PatchPlayerConfiguration config;
+        config.sampleRate = sampleRate;
+        config.maxFramesPerBlock = blockSize;
+
+        patch::PatchPlayer::Ptr player (instance->compileNewPlayer (config, nullptr, nullptr, nullptr));
+
+        if (player == nullptr || ! player->isPlayable())
+        {
+            errorMessage = "Failed to compile " + job.sourceFile;
+
+            if (player != nullptr)
+                for (auto& m : player->getCompileMessages())
+                    errorMessage += "\n" + m.fullMessage.toString<std::string>();
+
+            return {};
+        }
+
+        return std::make_unique<PatchRenderable> (std::move (instance), std::move (player), job.handleConsoleMessage);
+    }
+
+    PatchRenderable (patch::PatchInstance::Ptr i, patch::PatchPlayer::Ptr p, std::function<void(std::string_view)> consoleFn)
+        : instance (std::move (i)), player (std::move (p)), handleConsoleMessage (std::move (consoleFn))
+    {
+        for (auto& bus : player->getInputBuses())   numInputChannels  += bus.numChannels;
+        for (auto& bus : player->getOutputBuses())  numOutputChannels += bus.numChannels;
+    }
+
+    uint32_t getNumInputChannels() override     { return numInputChannels; }
+    uint32_t getNumOutputChannels() override    { return numOutputChannels; }
+    uint32_t getLatency() override              { return player->getLatencySamples(); }
+
+    int findParameter (std::string_view parameterID) override
+    {
+        auto parameters = player->getParameters();
+
+        for (uint32_t i = 0; i < parameters.size(); ++i)
+            if (parameters[i]->ID.toString<std::string>() == parameterID)
+                return static_cast<int> (i);
+
+        return -1;
+    }
+
+    void setParameter (uint32_t parameterIndex, float newValue) override
+    {
+        player->getParameters()[parameterIndex]->setValue (newValue);
+    }
+
+    void render (const float* const* input, float* const* output, uint32_t numFrames, MIDIEventInputList midiIn) override
+    {
+        patch::PatchPlayer::RenderContext rc;
+        rc.inputChannels = input;
+        rc.outputChannels = output;
+        rc.incomingMIDI = midiIn.listStart;
+        rc.outgoingMIDI = nullptr;
+        rc.numFrames = numFrames;
+        rc.numInputChannels = numInputChannels;
+        rc.numOutputChannels = numOutputChannels;
+        rc.numMIDIMessagesIn = static_cast<uint32_t> (midiIn.listEnd - midiIn.listStart);
+        rc.maximumMIDIMessagesOut = 0;
+        rc.numMIDIMessagesOut = 0;
+
+        player->render (rc);
+        player->handleOutgoingEvents (this, nullptr, handleConsoleMessage != nullptr ? printConsoleMessage : nullptr);
+    }
+
+private:
+    patch::PatchInstance::Ptr instance;
+    patch::PatchPlayer::Ptr player;
+    std::function<void(std::string_view)> handleConsoleMessage;
+    uint32_t numInputChannels = 0, numOutputChannels = 0;
+
+    static void printConsoleMessage (void* context, uint64_t, const char* message)
+    {
+        static_cast<PatchRenderable*> (context)->handleConsoleMessage (message);
+    }
+};
+
+//==============================================================================
+/** Builds a single .soul file and drives its performer directly with an AudioMIDIWrapper. */
+struct ProgramRenderable  : public Renderable
+{
+    static std::unique_ptr<Renderable> create (const RenderJob& job, std::unique_ptr<PerformerFactory> factory,
+                                               double sampleRate, uint32_t blockSize, std::string& errorMessage)
+    {
+        auto file = getFile (job.sourceFile);
+
+        if (! file.existsAsFile())
+        {
+            errorMessage = "Can't find " + job.sourceFile;
+            return {};
+        }
+
+        BuildBundle build;
+        build.sourceFiles.push_back ({ file.getFileName().toStdString(), file.loadFileAsString().toStdString() });
+        build.settings.sampleRate = sampleRate;
+        build.settings.maxBlockSize = blockSize;
+
+        CompileMessageList messages;
+        auto program = Compiler::build (messages, build);
+        std::unique_ptr<ProgramRenderable> renderable;
+
+        if (! program.isEmpty())
+        {
+            renderable = std::make_unique<ProgramRenderable> (std::move (factory), job.handleConsoleMessage);
+            auto& performer = *renderable->performer;
+
+            if (performer.load (messages, program) && performer.link (messages, build.settings, nullptr))
+            {
+                renderable->prepare (blockSize);
+                return renderable;
+            }
+        }
+
+        errorMessage = "Failed to compile " + job.sourceFile;
+
+        if (messages.hasErrors())
+            errorMessage += "\n" + messages.toString();
+
+        return {};
+    }
+
+    ProgramRenderable (std::unique_ptr<PerformerFactory> f, std::function<void(std::string_view)> consoleFn)
+        : factory (std::move (f)), performer (factory->createPerformer()), wrapper (*performer),
+          handleConsoleMessage (std::move (consoleFn))
+    {
+    }
+
+    ~ProgramRenderable() override
+    {
+        performer->unload();
+    }
+
+    uint32_t getNumInputChannels() override     { return wrapper.getExpectedNumInputChannels(); }
+    uint32_t getNumOutputChannels() override    { return wrapper.getExpectedNumOutputChannels(); }
+    uint32_t getLatency() override              { return performer->getLatency(); }
+
+    int findParameter (std::string_view parameterID) override
+    {
+        for (size_t i = 0; i < parameters.size(); ++i)
+            if (parameters[i].ID == parameterID)
+                return static_cast<int> (i);
+
+        return -1;
+    }
+
+    void setParameter (uint32_t parameterIndex, float newValue) override
+    {
+        auto& p = parameters[parameterIndex];
+        wrapper.parameterList.setParameter (parameterIndex, p.minValue < p.maxValue ? std::clamp (newValue, p.minValue, p.maxValue)
+                                                                                    : newValue);
+    }
+
+    void render (const float* const* input, float* const* output, uint32_t numFrames, MIDIEventInputList midiIn) override
+    {
+        MIDIEventOutputList midiOut;
+
+        wrapper.render (choc::buffer::createChannelArrayView (input, getNumInputChannels(), numFrames),
+                        choc::buffer::createChannelArrayView (output, getNumOutputChannels(), numFrames),
+                        midiIn, midiOut);
+
+        wrapper.deliverOutgoingEvents ([this] (uint64_t, const std::string& endpointName, const choc::value::ValueView& eventData)
+        {
+            if (handleConsoleMessage != nullptr && isConsoleEndpoint (endpointName))
+                handleConsoleMessage (dump (eventData));
+        });
+    }
+
+private:
+    struct Parameter
+    {
+        std::string ID;
+        float minValue, maxValue;
+    };
+
+    std::unique_ptr<PerformerFactory> factory;
+    std::unique_ptr<Performer> performer;
+    AudioMIDIWrapper wrapper;
+    std::vector<Parameter> parameters;
+    std::function<void(std::string_view)> handleConsoleMessage;
+
+    void prepare (uint32_t blockSize)
+    {
+        wrapper.prepare (blockSize, [] (const EndpointDetails& endpoint) -> uint32_t
+                                    {
+                                        return patch::readRampLengthForEndpoint (endpoint);
+                                    });
+
+        // Parameters start at the same initial values that a patch would give them
+        for (auto& endpoint : wrapper.getParameterEndpoints())
+        {
+            patch::PatchParameterProperties props (endpoint.name, endpoint.annotation.toExternalValue());
+            parameters.push_back ({ endpoint.name, props.minValue, props.maxValue });
+            setParameter (static_cast<uint32_t> (parameters.size() - 1), props.initialValue);
+        }
+    }
+};
+
+//==============================================================================
+struct JobRenderer
+{
+    JobRenderer (const RenderJob& j) : job (j)
+    {
+        formats.registerBasicFormats();
+    }
+
+    bool run (const CreatePerformerFactoryFn& createFactory)
+    {
+        return openAudioInput()
+                && loadMIDIInput()
+                && createRenderable (createFactory)
+                && loadAutomation()
+                && openOutput()
+                && renderAllBlocks();
+    }
+
+    std::string errorMessage;
+    double sampleRate = 0;
+    uint64_t framesWritten = 0;
+
+private:
+    //==============================================================================
+    struct TimedMIDIMessage
+    {
+        uint64_t frame;
+        choc::midi::ShortMessage message;
+    };
+
+    struct AutomationPoint
+    {
+        uint64_t frame;
+        uint32_t parameterIndex;
+        float value;
+    };
+
+    const RenderJob& job;
+    juce::AudioFormatManager formats;
+    std::unique_ptr<juce::AudioFormatReader> audioReader;
+    std::unique_ptr<Renderable> renderable;
+    std::unique_ptr<juce::TemporaryFile> tempOutputFile;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    std::vector<TimedMIDIMessage> midiMessages;
+    std::vector<AutomationPoint> automation;
+    uint64_t endOfInput = 0;
+
+    bool fail (std::string message)
+    {
+        errorMessage = std::move (message);
+        return false;
+    }
+
+    uint64_t secondsToFrames (double seconds) const
+    {
+        return static_cast<uint64_t> (std::llround (std::max (0.0, seconds) * sampleRate));
+    }
+
+    //==============================================================================
+    bool openAudioInput()
+    {
+        if (job.blockSize == 0)
+            return fail ("The block size must be greater than zero");
+
+        sampleRate = job.sampleRate;
+
+        if (! job.audioInputFile.empty())
+        {
+            audioReader.reset (formats.createReaderFor (getFile (job.audioInputFile)));
+
+            if (audioReader == nullptr)
+                return fail ("Failed to read audio file " + job.audioInputFile);
+
+            if (sampleRate == 0)
+                sampleRate = audioReader->sampleRate;
+            else if (sampleRate != audioReader->sampleRate)
+                return fail ("The sample rate of " + job.audioInputFile + " doesn't match the rendering rate");
+
+            endOfInput = static_cast<uint64_t> (audioReader->lengthInSamples);
+        }
+
+        if (sampleRate == 0)
+            sampleRate = 44100.0;
+
+        return true;
+    }
+
+    bool loadMIDIInput()
+    {
+        if (job.midiInputFile.empty())
+            return true;
+
+        juce::FileInputStream stream (getFile (job.midiInputFile));
+        juce::MidiFile midiFile;
+
+        if (! (stream.openedOk() && midiFile.readFrom (stream)))
+            return fail ("Failed to read MIDI file " + job.midiInputFile);
+
+        midiFile.convertTimestampTicksToSeconds();
+
+        for (int i = 0; i < midiFile.getNumTracks(); ++i)
+        {
+            for (auto event : *midiFile.getTrack (i))
+            {
+                auto& message = event->message;
+                auto size = message.getRawDataSize();
+
+                if (size == 0 || size > 3 || message.isMetaEvent())
+                    continue;
+
+                auto data = message.getRawData();
+                midiMessages.push_back ({ secondsToFrames (message.getTimeStamp()),
+                                          choc::midi::ShortMessage (data[0], size > 1 ? data[1] : 0, size > 2 ? data[2] : 0) });
+            }
+        }
+
+        std::stable_sort (midiMessages.begin(), midiMessages.end(),
+                          [] (const TimedMIDIMessage& a, const TimedMIDIMessage& b) { return a.frame < b.frame; });
+
+        if (! midiMessages.empty())
+            endOfInput = std::max (endOfInput, midiMessages.back().frame + 1);
+
+        return true;
+    }
+
+    bool createRenderable (const CreatePerformerFactoryFn& createFactory)
+    {
+        auto factory = createFactory();
+
+        if (factory == nullptr)
+            return fail ("Failed to create a performer factory");
+
+        if (getFile (job.sourceFile).hasFileExtension (patch::getManifestSuffix()))
+            renderable = PatchRenderable::create (job, std::move (factory), sampleRate, job.blockSize, errorMessage);
+        else
+            renderable = ProgramRenderable::create (job, std::move (factory), sampleRate, job.blockSize, errorMessage);
+
+        if (renderable == nullptr)
+            return false;
+
+        if (renderable->getNumOutputChannels() == 0)
+            return fail (job.sourceFile + " has no audio outputs");
+
+        return true;
+    }
+
+    bool loadAutomation()
+    {
+        if (job.automationFile.empty())
+            return true;
+
+        auto file = getFile (job.automationFile);
+
+        if (! file.existsAsFile())
+            return fail ("Can't find " + job.automationFile);
+
+        try
+        {
+            auto json = choc::json::parse (file.loadFileAsString().toStdString());
+
+            if (! json.isObject())
+                return fail (job.automationFile + ": expected an object containing parameter IDs");
+
+            for (uint32_t i = 0; i < json.size(); ++i)
+            {
+                auto member = json.getView().getObjectMemberAt (i);
+                auto parameterIndex = renderable->findParameter (member.name);
+
+                if (parameterIndex < 0)
+                    return fail (job.automationFile + ": unknown parameter \"" + member.name + "\"");
+
+                if (! member.value.isArray())
+                    return fail (job.automationFile + ": expected an array of points for \"" + member.name + "\"");
+
+                for (uint32_t j = 0; j < member.value.size(); ++j)
+                {
+                    auto point = member.value[j];
+
+                    if (! (point.isArray() && point.size() == 2 && point[0].isPrimitive() && point[1].isPrimitive()))
+                        return fail (job.automationFile + ": expected each point for \"" + member.name + "\" to be a [seconds, value] pair");
+
+                    automation.push_back ({ secondsToFrames (point[0].getWithDefault<double> (0)),
+                                            static_cast<uint32_t> (parameterIndex),
+                                            point[1].getWithDefault<float> (0) });
+                }
+            }
+        }
+        catch (const choc::json::ParseError& e)
+        {
+            return fail (job.automationFile + ":" + std::to_string (e.line) + ":" + std::to_string (e.column) + ": " + e.message);
+        }
+
+        std::stable_sort (automation.begin(), automation.end(),
+                          [] (const AutomationPoint& a, const AutomationPoint& b) { return a.frame < b.frame; });
+
+        if (! automation.empty())
+            endOfInput = std::max (endOfInput, automation.back().frame + 1);
+
+        return true;
+    }
+
+    //==============================================================================
+    bool openOutput()
+    {
+        if (job.outputFile.empty())
+            return fail ("No output file was specified");
+
+        auto file = getFile (job.outputFile);
+        auto format = formats.findFormatForFileExtension (file.getFileExtension());
+
+        if (format == nullptr)
+            return fail ("Unknown output file format: " + job.outputFile);
+
+        if (! format->getPossibleBitDepths().contains (job.bitDepth))
+            return fail ("The output format doesn't support a bit depth of " + std::to_string (job.bitDepth));
+
+        // Writing to a temporary file means that an existing output file is only replaced once the
+        // render has succeeded.
+        tempOutputFile = std::make_unique<juce::TemporaryFile> (file);
+        std::unique_ptr<juce::FileOutputStream> stream (tempOutputFile->getFile().createOutputStream());
+
+        if (stream == nullptr || ! stream->openedOk())
+            return fail ("Failed to write to " + job.outputFile);
+
+        writer.reset (format->createWriterFor (stream.get(), sampleRate, renderable->getNumOutputChannels(),
+                                               job.bitDepth, {}, 0));
+
+        if (writer == nullptr)
+            return fail ("Failed to create a writer for " + job.outputFile);
+
+        stream.release();
+        return true;
+    }
+
+    uint64_t getNumFramesToWrite() const
+    {
+        if (job.lengthSeconds > 0)
+            return secondsToFrames (job.lengthSeconds);
+
+        return endOfInput + secondsToFrames (job.tailSeconds);
+    }
+
+    bool renderAllBlocks()
+    {
+        auto blockSize = job.blockSize;
+        auto numInputChannels = renderable->getNumInputChannels();
+        auto numOutputChannels = renderable->getNumOutputChannels();
+        auto latency = job.compensateForLatency ? static_cast<uint64_t> (renderable->getLatency()) : 0;
+        auto numFramesToRender = getNumFramesToWrite() + latency;
+
+        // Each program input channel reads from the matching file channel, wrapping around if the
+        // file has fewer channels (so a mono file feeds every input). With no file, they all read silence.
+        auto numFileChannels = audioReader != nullptr ? std::max (1, static_cast<int> (audioReader->numChannels)) : 1;
+        juce::AudioBuffer<float> inputBuffer (numFileChannels, static_cast<int> (blockSize));
+        juce::AudioBuffer<float> outputBuffer (static_cast<int> (numOutputChannels), static_cast<int> (blockSize));
+        inputBuffer.clear();
+
+        std::vector<const float*> inputChannels (numInputChannels);
+        std::vector<float*> outputChannels (numOutputChannels);
+        std::vector<const float*> channelsToWrite (numOutputChannels);
+        std::vector<MIDIEvent> midiForChunk;
+        midiForChunk.reserve (midiMessages.size());
+        size_t nextMIDIMessage = 0, nextAutomationPoint = 0;
+
+        for (uint64_t blockStart = 0; blockStart < numFramesToRender; blockStart += blockSize)
+        {
+            auto numFrames = static_cast<uint32_t> (std::min<uint64_t> (blockSize, numFramesToRender - blockStart));
+
+            if (audioReader != nullptr)
+                audioReader->read (&inputBuffer, 0, static_cast<int> (numFrames), static_cast<juce::int64> (blockStart), true, true);
+
+            // The block is split wherever an automation point lands, so that parameter changes happen
+            // on the right frame.
+            for (uint32_t chunkStart = 0; chunkStart < numFrames;)
+            {
+                while (nextAutomationPoint < automation.size() && automation[nextAutomationPoint].frame <= blockStart + chunkStart)
+                {
+                    auto& point = automation[nextAutomationPoint++];
+                    renderable->setParameter (point.parameterIndex, point.value);
+                }
+
+                auto chunkEnd = numFrames;
+
+                if (nextAutomationPoint < automation.size())
+                    chunkEnd = static_cast<uint32_t> (std::min<uint64_t> (numFrames, automation[nextAutomationPoint].frame - blockStart));
+
+                midiForChunk.clear();
+
+                while (nextMIDIMessage < midiMessages.size() && midiMessages[nextMIDIMessage].frame < blockStart + chunkEnd)
+                {
+                    auto& m = midiMessages[nextMIDIMessage++];
+                    midiForChunk.push_back ({ static_cast<uint32_t> (m.frame - blockStart - chunkStart), m.message });
+                }
+
+                for (uint32_t i = 0; i < numInputChannels; ++i)
+                    inputChannels[i] = inputBuffer.getReadPointer (static_cast<int> (i) % numFileChannels, static_cast<int> (chunkStart));
+
+                for (uint32_t i = 0; i < numOutputChannels; ++i)
+                    outputChannels[i] = outputBuffer.getWritePointer (static_cast<int> (i), static_cast<int> (chunkStart));
+
+                renderable->render (inputChannels.data(), outputChannels.data(), chunkEnd - chunkStart,
+                                    { midiForChunk.data(), midiForChunk.data() + midiForChunk.size() });
+
+                chunkStart = chunkEnd;
+            }
+
+            // Skip the output that was rendered before the first frame of the program's latency
+            auto numToSkip = blockStart < latency ? static_cast<uint32_t> (std::min<uint64_t> (numFrames, latency - blockStart)) : 0u;
+
+            if (numToSkip < numFrames)
+            {
+                for (uint32_t i = 0; i < numOutputChannels; ++i)
+                    channelsToWrite[i] = outputBuffer.getReadPointer (static_cast<int> (i), static_cast<int> (numToSkip));
+
+                if (! writer->writeFromFloatArrays (channelsToWrite.data(), static_cast<int> (numOutputChannels),
+                                                    static_cast<int> (numFrames - numToSkip)))
+                    return fail ("Failed to write to " + job.outputFile);
+
+                framesWritten += numFrames - numToSkip;
+            }
+        }
+
+        writer.reset();
+
+        if (! tempOutputFile->overwriteTargetFileWithTemporary())
+            return fail ("Failed to replace " + job.outputFile);
+
+        return true;
+    }
+};
+
+//==============================================================================
+RenderResult render (const RenderJob& job, const CreatePerformerFactoryFn& createFactory)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    JobRenderer renderer (job);
+
+    RenderResult result;
+    result.succeeded = renderer.run (createFactory);
+    result.errorMessage = std::move (renderer.errorMessage);
+    result.sampleRate = renderer.sampleRate;
+    result.framesWritten = renderer.framesWritten;
+    result.secondsTaken = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    return result;
+}
+
+std::vector<RenderResult> render (const std::vector<RenderJob>& jobs,
+                                  const CreatePerformerFactoryFn& createFactory,
+                                  uint32_t numThreads,
+                                  const JobFinishedFn& jobFinished)
+{
+    std::vector<RenderResult> results (jobs.size());
+    std::atomic<size_t> nextJob { 0 };
+
+    if (numThreads == 0)
+        numThreads = std::max (1u, std::thread::hardware_concurrency());
+
+    numThreads = static_cast<uint32_t> (std::min<size_t> (numThreads, jobs.size()));
+
+    auto renderNextJobs = [&]
+    {
+        for (;;)
+        {
+            auto index = nextJob++;
+
+            if (index >= jobs.size())
+                break;
+
+            results[index] = render (jobs[index], createFactory);
+
+            if (jobFinished != nullptr)
+                jobFinished (index, results[index]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.emplace_back (renderNextJobs);
+
+    renderNextJobs();
+
+    for (auto& t : threads)
+        t.join();
+
+    return results;
+}
+
+} // namespace soul::offline_render
@@ -0,0 +1,129 @@
+/*
+    _____ _____ _____ __
+   |   __|     |  |  |  |      The SOUL language
+   |__   |  |  |  |  |  |__    Copyright (c) 2019 - ROLI Ltd.
+   |_____|_____|_____|_____|
+
+   The code in this file is provided under the terms of the ISC license:
+
+   Permission to use, copy, modify, and/or distribute this software for any purpose
+   with or without fee is hereby granted, provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD
+   TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN
+   NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+   DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER
+   IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+   CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*******************************************************************************
+ BEGIN_JUCE_MODULE_DECLARATION
+
+  ID:               soul_offline_render
+  vendor:           SOUL
+  version:          0.0.1
+  name:             SOUL offline renderer
+  description:      Renders SOUL programs and patches to audio files, faster than realtime
+  website:          https://soul.dev/
+  license:          ISC
+
+  dependencies:     soul_core, soul_patch_loader, juce_audio_formats
+
+ END_JUCE_MODULE_DECLARATION
+*******************************************************************************/
+
+#pragma once
+#define SOUL_OFFLINE_RENDER_H_INCLUDED 1
+
+#include <soul_core/soul_core.h>
+#include <soul_patch_loader/soul_patch_loader.h>
+
+//==============================================================================
+/**
+    A headless renderer which runs a .soul or .soulpatch file over some input audio,
+    MIDI and parameter automation, and writes the result to an audio file.
+
+    Nothing is tied to an audio device, so each job runs as fast as its performer can
+    go, and a list of jobs can be spread across a pool of threads.
+*/
+namespace soul::offline_render
+{
+    /** Describes a single file to be rendered. */
+    struct RenderJob
+    {
+        /** The .soulpatch manifest, or a single .soul file, to run. */
+        std::string sourceFile;
+
+        /** The file to write. The format is chosen from the file extension. */
+        std::string outputFile;
+
+        /** An optional audio file to feed to the program's audio inputs. */
+        std::string audioInputFile;
+
+        /** An optional standard MIDI file to send to the program's MIDI inputs. */
+        std::string midiInputFile;
+
+        /** An optional JSON file of parameter automation. This must contain an object
+            whose members are parameter IDs, each holding an array of [seconds, value]
+            pairs, e.g. { "volume": [[0, -6], [2.5, -20]] }
+        */
+        std::string automationFile;
+
+        /** The rate to run at. If this is 0, the audio input file's rate is used, or
+            44100 if there isn't one.
+        */
+        double sampleRate = 0;
+
+        /** The length of the output. If this is 0, it'll be long enough to contain the
+            whole of the audio, MIDI and automation input, plus the tail.
+        */
+        double lengthSeconds = 0;
+
+        /** The time to keep rendering after the last input, when no length is given. */
+        double tailSeconds = 2.0;
+
+        /** The number of frames to read, render and write in each block. */
+        uint32_t blockSize = 8192;
+
+        /** The bit depth for the output file. */
+        int bitDepth = 24;
+
+        /** If this is true, the output is shifted back by the program's latency. */
+        bool compensateForLatency = true;
+
+        /** If provided, this is called with any console output that the program
+            produces. It will be called on the thread that's rendering the job.
+        */
+        std::function<void(std::string_view)> handleConsoleMessage;
+    };
+
+    /** The outcome of a RenderJob. */
+    struct RenderResult
+    {
+        bool succeeded = false;
+        std::string errorMessage;
+        double sampleRate = 0;
+        uint64_t framesWritten = 0;
+        double secondsTaken = 0;
+    };
+
+    /** Each job needs a back-end of its own, which is created by calling this. */
+    using CreatePerformerFactoryFn = std::function<std::unique_ptr<PerformerFactory>()>;
+
+    /** Synchronously renders a job on the calling thread. */
+    RenderResult render (const RenderJob&, const CreatePerformerFactoryFn&);
+
+    /** Called when a job finishes. This may be called on any of the render threads. */
+    using JobFinishedFn = std::function<void(size_t jobIndex, const RenderResult&)>;
+
+    /** Renders a list of jobs on a pool of threads, and returns their results.
+        If numThreads is 0, one thread is used for each hardware core.
+    */
+    std::vector<RenderResult> render (const std::vector<RenderJob>&,
+                                      const CreatePerformerFactoryFn&,
+                                      uint32_t numThreads,
+                                      const JobFinishedFn&);
+
+} // namespace soul::offline_render
@@ -195,8 +195,8 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
                 if (newCallback != nullptr && sampleRate != 0)
                     newCallback->renderStarting (sampleRate, blockSize);
 
-                oldCallback = callback;
-                callback = newCallback;
+                oldCallback = callback.exchange (newCallback);
+                waitForAudioCallbackToFinish();
             }
         }
 
@@ -230,8 +230,11 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
 
     CPULoadMeasurer loadMeasurer;
 
+    // The audio thread reads the callback pointer without locking, and callbackLock is
+    // only used to serialise changes to it on other threads.
     std::mutex callbackLock;
-    Callback* callback = nullptr;
+    std::atomic<Callback*> callback { nullptr };
+    std::atomic<uint32_t> ioCallbackCount { 0 };
 
     //==============================================================================
     void log (const std::string& text)
@@ -254,8 +257,8 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
 
         std::lock_guard<decltype(callbackLock)> lock (callbackLock);
 
-        if (callback != nullptr)
-            callback->renderStarting (sampleRate, blockSize);
+        if (auto c = callback.load())
+            c->renderStarting (sampleRate, blockSize);
     }
 
     void audioDeviceStopped() override
@@ -266,8 +269,8 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
 
         std::lock_guard<decltype(callbackLock)> lock (callbackLock);
 
-        if (callback != nullptr)
-            callback->renderStopped();
+        if (auto c = callback.load())
+            c->renderStopped();
     }
 
     void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
@@ -285,12 +288,14 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
 
         if (totalFramesProcessed > numWarmUpFrames)
         {
-            std::lock_guard<decltype(callbackLock)> lock (callbackLock);
+            ++ioCallbackCount;
+
+            if (auto c = callback.load())
+                c->render (choc::buffer::createChannelArrayView (inputChannelData,  (uint32_t) numInputChannels,  (uint32_t) numFrames),
+                           choc::buffer::createChannelArrayView (outputChannelData, (uint32_t) numOutputChannels, (uint32_t) numFrames),
+                           midiInput);
 
-            if (callback != nullptr)
-                callback->render (choc::buffer::createChannelArrayView (inputChannelData,  (uint32_t) numInputChannels,  (uint32_t) numFrames),
-                                  choc::buffer::createChannelArrayView (outputChannelData, (uint32_t) numOutputChannels, (uint32_t) numFrames),
-                                  midiInput);
+            ++ioCallbackCount;
         }
 
         totalFramesProcessed += static_cast<uint64_t> (numFrames);
@@ -301,6 +306,17 @@ struct AudioMIDISystem::Pimpl  : private juce::AudioIODeviceCallback,
        #endif
     }
 
+    // The count is odd while the audio thread may be using the callback, so a callback
+    // that has just been replaced can't be stopped until the count changes.
+    void waitForAudioCallbackToFinish()
+    {
+        auto count = ioCallbackCount.load();
+
+        if ((count & 1u) != 0)
+            while (ioCallbackCount.load() == count)
+                std::this_thread::yield();
+    }
+
     void timerCallback() override
     {
         checkForStalledProcessor();
@@ -0,0 +1,449 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#pragma once
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+ #define SOUL_BENCHMARK_HAS_TSC 1
+
+ #ifdef _MSC_VER
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace soul::benchmark
+{
+
+//==============================================================================
+/** A program to benchmark: either one of the library processors wrapped in a small
+    graph, or the sources of an example patch.
+*/
+struct Case
+{
+    std::string name, kind;
+    SourceFiles sourceFiles;
+
+    /** If the program has any externals, this is called to provide their values. */
+    std::function<choc::value::Value(const ExternalVariable&)> resolveExternal;
+};
+
+struct Settings
+{
+    double secondsToRender = 5.0;
+    std::vector<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+    std::vector<uint32_t> blockSizes { 32, 128, 512 };
+
+    /** If this is non-zero, it's used to turn times into cycles. Otherwise, on x86 the
+        time-stamp counter is read, and on other CPUs no cycle count is reported.
+    */
+    double cpuGHz = 0;
+
+    std::string backendName = "interpreter";
+    std::function<std::unique_ptr<PerformerFactory>()> createPerformerFactory;
+};
+
+//==============================================================================
+/** Wraps a library processor in a graph with a float input and output, so that it can be
+    compiled as a main processor. The connections are written in terms of the graph's
+    "in" and "out" endpoints and an instance called "p".
+*/
+inline Case createLibraryCase (const std::string& name, const std::string& processor,
+                               bool hasAudioInput, const std::string& connections)
+{
+    auto source = "graph Benchmark  [[ main ]]\n"
+                  "{\n"
+                  + std::string (hasAudioInput ? "    input  stream float in;\n" : "")
+                  + "    output stream float out;\n"
+                    "\n"
+                    "    let p = " + processor + ";\n"
+                    "\n"
+                    "    connection\n"
+                    "    {\n"
+                    "        " + connections + "\n"
+                    "    }\n"
+                    "}\n";
+
+    return { name, "library", { { "benchmark.soul", source } }, nullptr };
+}
+
+/** Returns a case for each of the processors in soul::filters, soul::oscillators,
+    soul::mixers and soul::noise, using their default settings.
+*/
+inline std::vector<Case> getLibraryCases()
+{
+    return
+    {
+        createLibraryCase ("soul::filters::dc_blocker",            "soul::filters::dc_blocker::Processor",           true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::onepole",               "soul::filters::onepole::Processor",              true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::rbj_eq",                "soul::filters::rbj_eq::Processor",               true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::sos_cascade",           "soul::filters::sos_cascade::Processor (float64[] (0.0675, 0.135, 0.0675, 1.0, -1.143, 0.4128, "
+                                                                                                                  "0.0675, 0.135, 0.0675, 1.0, -1.143, 0.4128))",
+                                                                                                                     true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::butterworth",           "soul::filters::butterworth::Processor (4)",      true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::analytic",             "soul::filters::analytic::Processor",             true,  "in -> p.in; p.realOut -> out;"),
+        createLibraryCase ("soul::filters::complex_resonator",     "soul::filters::complex_resonator::Processor",    true,  "in -> p.in; p.realOut -> out;"),
+        createLibraryCase ("soul::filters::tpt::onepole",          "soul::filters::tpt::onepole::Processor",         true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::tpt::svf",              "soul::filters::tpt::svf::Processor",             true,  "in -> p.in; p.lowpassOut -> out;"),
+        createLibraryCase ("soul::filters::tpt::butterworth",      "soul::filters::tpt::butterworth::Processor (4)", true,  "in -> p.in; p.out -> out;"),
+        createLibraryCase ("soul::filters::tpt::crossover",        "soul::filters::tpt::crossover::Processor",       true,  "in -> p.in; p.lowOut -> out;"),
+        createLibraryCase ("soul::filters::tpt::simper_eq",        "soul::filters::tpt::simper_eq::Processor",       true,  "in -> p.in; p.out -> out;"),
+
+        createLibraryCase ("soul::oscillators::phasor",            "soul::oscillators::phasor::Processor",           false, "p.out -> out;"),
+        createLibraryCase ("soul::oscillators::Sine",              "soul::oscillators::Sine",                        false, "p.out -> out;"),
+        createLibraryCase ("soul::oscillators::poly_blep",         "soul::oscillators::poly_blep::Processor",        false, "p.out -> out;"),
+        createLibraryCase ("soul::oscillators::quadrature",        "soul::oscillators::quadrature::Processor",       false, "p.sineOut -> out;"),
+        createLibraryCase ("soul::oscillators::lfo",               "soul::oscillators::lfo::Processor",              false, "p.out -> out;"),
+
+        createLibraryCase ("soul::mixers::FixedSum",               "soul::mixers::FixedSum (float, 0.5f, 0.5f)",     true,  "in -> p.in1; in -> p.in2; p.out -> out;"),
+        createLibraryCase ("soul::mixers::DynamicSum",             "soul::mixers::DynamicSum (float)",               true,  "in -> p.in1; in -> p.in2; in -> p.gain1; in -> p.gain2; p.out -> out;"),
+        createLibraryCase ("soul::mixers::DynamicMix",             "soul::mixers::DynamicMix (float, 100.0f)",       true,  "in -> p.in1; in -> p.in2; in -> p.mix; p.out -> out;"),
+
+        createLibraryCase ("soul::noise::White",                   "soul::noise::White",                             false, "p.out -> out;"),
+        createLibraryCase ("soul::noise::Brown",                   "soul::noise::Brown",                             false, "p.out -> out;"),
+        createLibraryCase ("soul::noise::Pink",                    "soul::noise::Pink",                              false, "p.out -> out;")
+    };
+}
+
+//==============================================================================
+struct Result
+{
+    std::string name, kind, error;
+    double sampleRate = 0;
+    uint32_t blockSize = 0;
+    uint64_t framesRendered = 0;
+
+    double compileSeconds = 0, linkSeconds = 0, performerLoadSeconds = 0, performerLinkSeconds = 0;
+    double renderSeconds = 0, cyclesPerSample = 0;
+    std::vector<ScopedTimingCollector::Timing> stages;
+
+    double getNanosecondsPerFrame() const   { return renderSeconds * 1.0e9 / static_cast<double> (std::max (framesRendered, (uint64_t) 1)); }
+    double getRealtimeFactor() const        { return static_cast<double> (framesRendered) / (sampleRate * std::max (renderSeconds, 1.0e-9)); }
+
+    choc::value::Value toJSON() const
+    {
+        auto o = choc::value::createObject ("Result",
+                                            "name", name,
+                                            "kind", kind,
+                                            "sampleRate", sampleRate,
+                                            "blockSize", (int64_t) blockSize);
+
+        if (! error.empty())
+        {
+            o.addMember ("error", error);
+            return o;
+        }
+
+        o.addMember ("compileSeconds", compileSeconds,
+                     "linkSeconds", linkSeconds,
+                     "performerLoadSeconds", performerLoadSeconds,
+                     "performerLinkSeconds", performerLinkSeconds,
+                     "framesRendered", (int64_t) framesRendered,
+                     "nsPerFrame", getNanosecondsPerFrame(),
+                     "realtimeFactor", getRealtimeFactor());
+
+        if (cyclesPerSample > 0)
+            o.addMember ("cyclesPerSample", cyclesPerSample);
+
+        auto stageList = choc::value::createObject ("Stages");
+
+        for (auto& s : stages)
+            stageList.addMember (s.description, s.seconds);
+
+        o.addMember ("stages", stageList);
+        return o;
+    }
+};
+
+//==============================================================================
+/** Builds a case with the given rate and block size, then renders the requested length
+    of audio through a Performer, and reports how long each stage took.
+*/
+struct Runner
+{
+    Runner (const Case& c, const Settings& s, double rate, uint32_t size)
+        : benchmarkCase (c), settings (s)
+    {
+        result.name = c.name;
+        result.kind = c.kind;
+        result.sampleRate = rate;
+        result.blockSize = size;
+    }
+
+    Result run()
+    {
+        ScopedTimingCollector timings;
+        auto factory = settings.createPerformerFactory();
+        auto performer = factory->createPerformer();
+
+        if (build (*performer))
+            render (*performer);
+
+        performer->unload();
+
+        for (auto& t : timings.timings)
+            addStage (t);
+
+        return result;
+    }
+
+    static uint64_t readCycleCounter()
+    {
+       #if SOUL_BENCHMARK_HAS_TSC
+        return static_cast<uint64_t> (__rdtsc());
+       #else
+        return 0;
+       #endif
+    }
+
+private:
+    const Case& benchmarkCase;
+    const Settings& settings;
+    Result result;
+
+    bool fail (const std::string& stage, const CompileMessageList& messages)
+    {
+        result.error = stage + " failed";
+
+        if (messages.hasErrors())
+            result.error += ": " + messages.toString();
+
+        return false;
+    }
+
+    bool build (Performer& performer)
+    {
+        BuildSettings buildSettings;
+        buildSettings.sampleRate = result.sampleRate;
+        buildSettings.maxBlockSize = result.blockSize;
+
+        CompileMessageList messages;
+        Compiler compiler;
+        Program program;
+
+        {
+            ScopedTimer timer ("benchmark: compile");
+
+            for (auto& file : benchmarkCase.sourceFiles)
+                if (! compiler.addCode (messages, CodeLocation::createFromSourceFile (file)))
+                    return fail ("compile", messages);
+
+            result.compileSeconds = timer.getElapsedSeconds();
+        }
+
+        {
+            ScopedTimer timer ("benchmark: link");
+            program = compiler.link (messages, buildSettings);
+
+            if (program.isEmpty())
+                return fail ("link", messages);
+
+            result.linkSeconds = timer.getElapsedSeconds();
+        }
+
+        {
+            ScopedTimer timer ("benchmark: performer load");
+
+            if (! performer.load (messages, program))
+                return fail ("performer load", messages);
+
+            result.performerLoadSeconds = timer.getElapsedSeconds();
+        }
+
+        if (benchmarkCase.resolveExternal != nullptr)
+        {
+            for (auto& ev : performer.getExternalVariables())
+            {
+                auto value = benchmarkCase.resolveExternal (ev);
+
+                if (! value.isVoid())
+                    performer.setExternalVariable (ev.name.c_str(), value);
+            }
+        }
+
+        ScopedTimer timer ("benchmark: performer link");
+
+        if (! performer.link (messages, buildSettings, nullptr))
+            return fail ("performer link", messages);
+
+        result.performerLinkSeconds = timer.getElapsedSeconds();
+        return true;
+    }
+
+    void render (Performer& performer)
+    {
+        AudioMIDIWrapper wrapper (performer);
+        wrapper.prepare (result.blockSize, [] (const EndpointDetails& endpoint) -> uint32_t
+                                           {
+                                               return patch::readRampLengthForEndpoint (endpoint);
+                                           });
+
+        // Parameters start at the same initial values that a patch would give them
+        uint32_t parameterIndex = 0;
+
+        for (auto& endpoint : wrapper.getParameterEndpoints())
+            wrapper.parameterList.setParameter (parameterIndex++, patch::PatchParameterProperties (endpoint.name, endpoint.annotation.toExternalValue()).initialValue);
+
+        auto blockSize = result.blockSize;
+        choc::buffer::ChannelArrayBuffer<float> input (wrapper.getExpectedNumInputChannels(), blockSize),
+                                                output (wrapper.getExpectedNumOutputChannels(), blockSize);
+
+        // Quiet white noise for any audio inputs, and a repeating chord for any MIDI inputs
+        uint32_t seed = 1234;
+
+        choc::buffer::setAllFrames (input, [&]
+                                           {
+                                               seed = seed * 1664525u + 1013904223u;
+                                               return static_cast<float> (seed >> 8) / 33554432.0f - 0.25f;
+                                           });
+
+        std::vector<MIDIEvent> midiIn;
+        std::vector<MIDIEvent> midiOutSpace (1024);
+        auto notePeriod = static_cast<uint64_t> (result.sampleRate * 0.5);
+        auto totalFrames = static_cast<uint64_t> (result.sampleRate * settings.secondsToRender);
+
+        auto renderBlock = [&] (uint64_t blockStart)
+        {
+            midiIn.clear();
+
+            for (auto frame = blockStart; frame < blockStart + blockSize; ++frame)
+            {
+                auto position = frame % notePeriod;
+
+                if (position == 0 || position == notePeriod * 4 / 5)
+                {
+                    static constexpr uint8_t chord[] = { 48, 60, 64, 67 };
+                    bool isNoteOn = position == 0;
+
+                    for (auto note : chord)
+                        midiIn.push_back ({ static_cast<uint32_t> (frame - blockStart),
+                                            { static_cast<uint8_t> (isNoteOn ? 0x90 : 0x80), note, static_cast<uint8_t> (isNoteOn ? 100 : 0) } });
+                }
+            }
+
+            MIDIEventOutputList midiOut { midiOutSpace.data(), static_cast<uint32_t> (midiOutSpace.size()) };
+            wrapper.render (input, output, { midiIn.data(), midiIn.data() + midiIn.size() }, midiOut);
+            wrapper.deliverOutgoingEvents ([] (uint64_t, const std::string&, const choc::value::ValueView&) {});
+        };
+
+        // Every case should make a sound, so if the output is all zeros or contains any non-finite
+        // values, something's broken and the timings don't mean anything. The whole output is
+        // checked, as some patches only start playing at the second chord.
+        bool isSilent = true, isFinite = true;
+
+        auto checkOutput = [&]
+        {
+            for (uint32_t channel = 0; channel < output.getNumChannels(); ++channel)
+            {
+                for (uint32_t frame = 0; frame < blockSize; ++frame)
+                {
+                    auto sample = output.getSample (channel, frame);
+                    isSilent = isSilent && sample == 0;
+                    isFinite = isFinite && std::isfinite (sample);
+                }
+            }
+        };
+
+        // One block to let anything that's lazily set up get out of the way
+        renderBlock (0);
+        checkOutput();
+
+        // Each block is timed separately, so that checking the output isn't included
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::duration renderTime {};
+        uint64_t framesDone = 0, cycles = 0;
+
+        while (framesDone < totalFrames)
+        {
+            auto startTime = Clock::now();
+            auto startCycles = readCycleCounter();
+            renderBlock (blockSize + framesDone);
+            cycles += readCycleCounter() - startCycles;
+            renderTime += Clock::now() - startTime;
+
+            checkOutput();
+            framesDone += blockSize;
+        }
+
+        if (! isFinite)
+        {
+            result.error = "render failed: the output contained non-finite values";
+            return;
+        }
+
+        if (isSilent)
+        {
+            result.error = "render failed: the output was silent";
+            return;
+        }
+
+        result.renderSeconds = std::chrono::duration<double> (renderTime).count();
+        result.framesRendered = framesDone;
+
+        if (settings.cpuGHz > 0)
+            result.cyclesPerSample = result.getNanosecondsPerFrame() * settings.cpuGHz;
+        else if (cycles > 0)
+            result.cyclesPerSample = static_cast<double> (cycles) / static_cast<double> (framesDone);
+    }
+
+    void addStage (const ScopedTimingCollector::Timing& t)
+    {
+        // Our own timers are already reported as separate members
+        if (choc::text::startsWith (t.description, "benchmark: "))
+            return;
+
+        for (auto& s : result.stages)
+        {
+            if (s.description == t.description)
+            {
+                s.seconds += t.seconds;
+                return;
+            }
+        }
+
+        result.stages.push_back (t);
+    }
+};
+
+//==============================================================================
+/** Runs every case at each of the sample rates and block sizes in the settings,
+    calling a function as each one finishes, and returns the results as a JSON object.
+*/
+inline choc::value::Value runAll (const std::vector<Case>& cases, const Settings& settings,
+                                  const std::function<void(const Result&)>& resultReady)
+{
+    auto results = choc::value::createEmptyArray();
+
+    for (auto& c : cases)
+    {
+        for (auto rate : settings.sampleRates)
+        {
+            for (auto blockSize : settings.blockSizes)
+            {
+                auto result = Runner (c, settings, rate, blockSize).run();
+
+                if (resultReady != nullptr)
+                    resultReady (result);
+
+                results.addArrayElement (result.toJSON());
+            }
+        }
+    }
+
+    auto cycleSource = settings.cpuGHz > 0 ? "cpuGHz" : (Runner::readCycleCounter() != 0 ? "tsc" : "none");
+
+    return choc::value::createObject ("Benchmark",
+                                      "backend", settings.backendName,
+                                      "secondsRendered", settings.secondsToRender,
+                                      "cycleSource", cycleSource,
+                                      "results", results);
+}
+
+} // namespace soul::benchmark
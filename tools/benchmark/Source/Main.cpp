@@ -0,0 +1,233 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#include <JuceHeader.h>
+#include "../../../include/soul/patch/helper_classes/soul_patch_Utilities.h"
+#include "Benchmark.h"
+
+//==============================================================================
+/**
+    Compiles and renders each of the library's filters, oscillators, mixers and noise
+    generators, and each of the example patches, then writes the timings as JSON.
+*/
+static constexpr const char* usage = R"(
+Usage:
+
+ soul_benchmark [options] [<patches folder>]
+
+The patches folder defaults to examples/patches in the current directory, and is
+searched recursively for .soulpatch files.
+
+Options:
+ --output=<JSON file>       Where to write the results (default: stdout)
+ --seconds=<seconds>        Length of audio to render for each test (default 5, and at
+                            least 1, so that every patch gets a second chord)
+ --rates=<list>             Comma-separated sample rates (default 44100,48000,96000)
+ --block-sizes=<list>       Comma-separated block sizes (default 32,128,512)
+ --cpu-ghz=<GHz>            Derive cycles/sample from this clock speed, rather than
+                            reading the CPU's time-stamp counter
+ --filter=<text>            Only run tests whose names contain this text
+ --no-library               Don't run the library processor tests
+ --no-patches               Don't run the example patch tests
+)";
+
+template <typename Type>
+static std::vector<Type> parseList (const juce::String& text, std::vector<Type> defaultList)
+{
+    if (text.isEmpty())
+        return defaultList;
+
+    std::vector<Type> result;
+
+    for (auto& item : juce::StringArray::fromTokens (text, ",", {}))
+        if (item.trim().getDoubleValue() > 0)
+            result.push_back (static_cast<Type> (item.trim().getDoubleValue()));
+
+    if (result.empty())
+        juce::ConsoleApplication::fail ("Expected a comma-separated list of numbers, but got \"" + text + "\"");
+
+    return result;
+}
+
+//==============================================================================
+/** Loads any audio files that a patch's externals refer to, in the same way that the
+    patch loader does, apart from the resampling and channel-extraction annotations.
+*/
+static choc::value::Value resolveExternal (const juce::File& folder, const choc::value::ValueView& externals,
+                                           const soul::ExternalVariable& ev)
+{
+    if (! (externals.isObject() && externals.hasObjectMember (ev.name)))
+        return {};
+
+    return soul::replaceStringsWithValues (externals[ev.name], [&] (std::string_view s) -> choc::value::Value
+    {
+        auto file = folder.getChildFile (juce::String (std::string (s)));
+
+        if (file.existsAsFile())
+        {
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+
+            if (std::unique_ptr<juce::AudioFormatReader> reader { formats.createReaderFor (file) })
+            {
+                choc::buffer::ChannelArrayBuffer<float> buffer ((uint32_t) reader->numChannels, (uint32_t) reader->lengthInSamples);
+                reader->read (buffer.getView().data.channels, (int) reader->numChannels, 0, (int) reader->lengthInSamples);
+                return soul::convertAudioDataToObject (buffer, reader->sampleRate);
+            }
+        }
+
+        return choc::value::createString (s);
+    });
+}
+
+static std::vector<soul::benchmark::Case> findPatchCases (const juce::File& folder)
+{
+    std::vector<soul::benchmark::Case> cases;
+
+    auto manifests = folder.findChildFiles (juce::File::findFiles, true, "*.soulpatch");
+    manifests.sort();
+
+    for (auto& manifestFile : manifests)
+    {
+        auto patchFolder = manifestFile.getParentDirectory();
+        soul::benchmark::Case c;
+        c.name = manifestFile.getRelativePathFrom (folder).upToLastOccurrenceOf (".", false, false).toStdString();
+        c.kind = "patch";
+
+        try
+        {
+            auto json = choc::json::parse (manifestFile.loadFileAsString().toStdString());
+            auto manifest = json.isObject() ? json["soulPatchV1"] : choc::value::ValueView();
+
+            if (! manifest.isObject())
+                juce::ConsoleApplication::fail ("Expected " + manifestFile.getFullPathName() + " to contain a soulPatchV1 object");
+
+            auto sources = manifest["source"];
+
+            auto addSource = [&] (const choc::value::ValueView& path)
+            {
+                auto file = patchFolder.getChildFile (juce::String (path.getWithDefault<std::string> ({})));
+                c.sourceFiles.push_back ({ file.getFileName().toStdString(), file.loadFileAsString().toStdString() });
+            };
+
+            if (sources.isArray())
+                for (uint32_t i = 0; i < sources.size(); ++i)
+                    addSource (sources[i]);
+            else
+                addSource (sources);
+
+            c.resolveExternal = [patchFolder, externals = choc::value::Value (manifest["externals"])] (const soul::ExternalVariable& ev)
+            {
+                return resolveExternal (patchFolder, externals, ev);
+            };
+
+            cases.push_back (std::move (c));
+        }
+        catch (const choc::json::ParseError& e)
+        {
+            juce::ConsoleApplication::fail (manifestFile.getFullPathName() + ":" + juce::String ((int) e.line) + ":"
+                                              + juce::String ((int) e.column) + ": " + e.message);
+        }
+    }
+
+    return cases;
+}
+
+static juce::String describeResult (const soul::benchmark::Result& result)
+{
+    auto name = juce::String (result.name) + " @ " + juce::String ((int) result.sampleRate) + "Hz, "
+                  + juce::String (result.blockSize) + " frames";
+
+    if (! result.error.empty())
+        return name + ": FAILED: " + juce::String (result.error);
+
+    return name + ": " + juce::String (result.getNanosecondsPerFrame(), 1) + " ns/frame, "
+             + juce::String (result.getRealtimeFactor(), 1) + "x realtime, compile "
+             + juce::String (result.compileSeconds * 1000.0, 1) + " ms, link "
+             + juce::String ((result.linkSeconds + result.performerLinkSeconds) * 1000.0, 1) + " ms";
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        if (args.containsOption ("--help|-h"))
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+
+        soul::benchmark::Settings settings;
+
+        if (args.containsOption ("--seconds"))
+            settings.secondsToRender = std::max (1.0, args.getValueForOption ("--seconds").getDoubleValue());
+
+        settings.sampleRates  = parseList (args.getValueForOption ("--rates"), settings.sampleRates);
+        settings.blockSizes   = parseList (args.getValueForOption ("--block-sizes"), settings.blockSizes);
+        settings.cpuGHz       = args.getValueForOption ("--cpu-ghz").getDoubleValue();
+        settings.createPerformerFactory = [] { return std::make_unique<soul::InterpreterPerformerFactory>(); };
+
+        std::vector<soul::benchmark::Case> cases;
+
+        if (! args.containsOption ("--no-library"))
+            cases = soul::benchmark::getLibraryCases();
+
+        if (! args.containsOption ("--no-patches"))
+        {
+            auto patchesFolder = juce::File::getCurrentWorkingDirectory().getChildFile ("examples/patches");
+
+            for (auto& arg : args.arguments)
+                if (! arg.isOption())
+                    patchesFolder = arg.resolveAsFile();
+
+            if (! patchesFolder.isDirectory())
+                juce::ConsoleApplication::fail ("Can't find the patches folder " + patchesFolder.getFullPathName());
+
+            for (auto& c : findPatchCases (patchesFolder))
+                cases.push_back (std::move (c));
+        }
+
+        auto filter = args.getValueForOption ("--filter").toStdString();
+
+        if (! filter.empty())
+            soul::removeIf (cases, [&] (const soul::benchmark::Case& c) { return ! choc::text::contains (c.name, filter); });
+
+        if (cases.empty())
+            juce::ConsoleApplication::fail ("No tests to run");
+
+        int numFailed = 0;
+
+        auto results = soul::benchmark::runAll (cases, settings, [&] (const soul::benchmark::Result& result)
+        {
+            if (! result.error.empty())
+                ++numFailed;
+
+            std::cerr << describeResult (result) << std::endl;
+        });
+
+        auto json = choc::json::toString (results);
+
+        if (args.containsOption ("--output"))
+        {
+            auto outputFile = args.getFileForOption ("--output");
+
+            if (! outputFile.replaceWithText (json + "\n"))
+                juce::ConsoleApplication::fail ("Failed to write " + outputFile.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+
+        return numFailed == 0 ? 0 : 1;
+    });
+}
@@ -0,0 +1,58 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#include <soul_core/soul_core.h>
+#include <iostream>
+#include <fstream>
+
+//==============================================================================
+/**
+    Builds a test program, and writes the C++ that the generator produces for it.
+    The program's main processor must be called "test".
+
+    Usage: soul_generate_test <.soul file> <output header>
+*/
+int main (int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: soul_generate_test <.soul file> <output header>" << std::endl;
+        return 1;
+    }
+
+    soul::BuildBundle build;
+    build.sourceFiles.push_back ({ argv[1], soul::loadFileAsString (argv[1]) });
+    build.settings.sampleRate = 44100.0;
+    build.settings.maxBlockSize = 64;
+    build.settings.mainProcessor = "test";
+
+    soul::CompileMessageList messages;
+    auto program = soul::Compiler::build (messages, build);
+
+    if (program.isEmpty())
+    {
+        std::cerr << messages.toString() << std::endl;
+        return 1;
+    }
+
+    soul::CPlusPlusGenerationOptions options;
+    options.maxBlockSize = build.settings.maxBlockSize;
+
+    auto code = soul::generateCPlusPlus (messages, program, options);
+
+    if (code.empty())
+    {
+        std::cerr << messages.toString() << std::endl;
+        return 1;
+    }
+
+    std::ofstream out (argv[2]);
+    out << code;
+    return out.good() ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#include <iostream>
+#include <memory>
+#include SOUL_GENERATED_HEADER
+
+//==============================================================================
+/**
+    Runs a generated test class until it reports that it's finished. The program must
+    have a "results" event output of type int, to which it writes 1 for each check that
+    passes, 0 for each one that fails, and -1 when it's done, as in a .soultest file.
+*/
+int main()
+{
+    static constexpr uint32_t maxFramesToRender = 44100;
+
+    auto processor = std::make_unique<SOULProcessor>();
+    processor->init (44100.0);
+
+    int numPassed = 0;
+
+    for (uint32_t frame = 0; frame < maxFramesToRender; frame += SOULProcessor::maxBlockSize)
+    {
+        processor->render (SOULProcessor::maxBlockSize);
+
+        for (uint32_t i = 0; i < processor->getNumOutputEvents_results(); ++i)
+        {
+            auto result = processor->getOutputEvent_results (i).value;
+
+            if (result == -1)
+            {
+                if (numPassed == 0)
+                {
+                    std::cerr << "no checks were made" << std::endl;
+                    return 1;
+                }
+
+                return 0;
+            }
+
+            if (result != 1)
+            {
+                std::cerr << "check " << (numPassed + 1) << " failed at frame "
+                          << processor->getOutputEvent_results (i).frame + frame << std::endl;
+                return 1;
+            }
+
+            ++numPassed;
+        }
+    }
+
+    std::cerr << "the test didn't finish within " << maxFramesToRender << " frames" << std::endl;
+    return 1;
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+#
+# Generates C++ for each test program, compiles it, and runs it.
+#
+# Usage: run_tests.sh [<.soul file>...]
+#
+# Set CXX to choose the compiler. The generator is built from source/modules the first
+# time, into a build folder next to this script.
+
+set -u
+
+toolFolder="$(cd "$(dirname "$0")" && pwd)"
+repoFolder="$(cd "$toolFolder/../.." && pwd)"
+buildFolder="$toolFolder/build"
+compiler="${CXX:-c++}"
+
+mkdir -p "$buildFolder"
+
+if [ ! -x "$buildFolder/soul_generate_test" ]; then
+    echo "Building the generator..."
+
+    "$compiler" -std=c++17 -O1 -w -I"$repoFolder/source/modules" \
+        "$toolFolder/Source/GenerateTest.cpp" "$repoFolder/source/modules/soul_core/soul_core.cpp" \
+        -o "$buildFolder/soul_generate_test" -lpthread -ldl || exit 1
+fi
+
+if [ $# -eq 0 ]; then
+    set -- "$toolFolder"/tests/*.soul
+fi
+
+numRun=0
+numFailed=0
+
+for testFile in "$@"; do
+    name="$(basename "$testFile" .soul)"
+    header="$buildFolder/$name.h"
+    driver="$buildFolder/$name"
+    numRun=$((numRun + 1))
+
+    if "$buildFolder/soul_generate_test" "$testFile" "$header" \
+        && "$compiler" -std=c++17 -O1 -Wall -Wextra -Werror -DSOUL_GENERATED_HEADER="\"$header\"" \
+               "$toolFolder/Source/TestDriver.cpp" -o "$driver" \
+        && "$driver"; then
+        echo "$name: passed"
+    else
+        echo "$name: FAILED"
+        numFailed=$((numFailed + 1))
+    fi
+done
+
+echo "$numRun tests run, $numFailed failed"
+[ $numFailed -eq 0 ]
@@ -0,0 +1,227 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#pragma once
+
+namespace soul::heart_tests
+{
+
+//==============================================================================
+/** One test from a .hearttest file.
+
+    An optimiser test starts with a "## optimise <level>" line, followed by some HEART
+    functions, then a "## expect" line followed by the HEART that those functions should
+    look like after SSAOptimisations::optimise() has been run on them at that level.
+
+    A binary format test starts with a "## binary" line, followed by some HEART
+    functions. The program must survive a round-trip through Program::toBinary() and
+    createFromBinary(), and every truncated or corrupted copy of its binary data must
+    either be rejected or load cleanly.
+
+    The functions are put into a namespace of their own, in a program which has an
+    empty main processor, so that's all a test needs to contain.
+*/
+struct TestCase
+{
+    enum class Kind
+    {
+        optimise,
+        binary
+    };
+
+    Kind kind = Kind::optimise;
+    std::string filename;
+    size_t lineNumber = 0;
+    int optimisationLevel = 0;
+    std::string input, expected;
+
+    std::string getDescription() const      { return filename + ":" + std::to_string (lineNumber); }
+};
+
+/** Splits the text of a .hearttest file into its tests. Lines which start with "//"
+    are comments, and are ignored.
+*/
+inline std::vector<TestCase> parseTestFile (const std::string& filename, const std::string& text)
+{
+    std::vector<TestCase> tests;
+    std::string* currentSection = nullptr;
+    size_t lineNumber = 0;
+
+    auto addTest = [&] (TestCase::Kind kind, int optimisationLevel)
+    {
+        TestCase t;
+        t.kind = kind;
+        t.filename = filename;
+        t.lineNumber = lineNumber;
+        t.optimisationLevel = optimisationLevel;
+        tests.push_back (std::move (t));
+        currentSection = std::addressof (tests.back().input);
+    };
+
+    for (auto& line : choc::text::splitIntoLines (text, true))
+    {
+        ++lineNumber;
+
+        if (choc::text::startsWith (choc::text::trimStart (line), "//"))
+            continue;
+
+        if (choc::text::startsWith (line, "## "))
+        {
+            auto header = choc::text::splitAtWhitespace (choc::text::trim (line.substr (3)));
+
+            if (header.size() == 2 && header[0] == "optimise")
+            {
+                addTest (TestCase::Kind::optimise, std::stoi (header[1]));
+                continue;
+            }
+
+            if (header.size() == 1 && header[0] == "binary")
+            {
+                addTest (TestCase::Kind::binary, 0);
+                continue;
+            }
+
+            if (header.size() == 1 && header[0] == "expect"
+                 && ! tests.empty() && tests.back().kind == TestCase::Kind::optimise)
+            {
+                currentSection = std::addressof (tests.back().expected);
+                continue;
+            }
+
+            throw std::runtime_error (filename + ":" + std::to_string (lineNumber) + ": unknown test header: " + choc::text::trim (line));
+        }
+
+        if (currentSection != nullptr)
+            *currentSection += line;
+    }
+
+    return tests;
+}
+
+/** Reduces each run of whitespace to a single space and drops blank lines, so that the
+    expected HEART doesn't need to copy the printer's column alignment.
+*/
+inline std::string normaliseWhitespace (const std::string& text)
+{
+    std::string result;
+
+    for (auto& line : choc::text::splitIntoLines (text, false))
+    {
+        auto tokens = choc::text::splitAtWhitespace (choc::text::trim (line));
+
+        if (! tokens.empty())
+            result += joinStrings (tokens, " ") + "\n";
+    }
+
+    return result;
+}
+
+/** Returns the printed contents of one of the namespaces in a program's HEART */
+inline std::string getNamespaceContent (const std::string& heart, const std::string& name)
+{
+    auto start = heart.find ("\nnamespace " + name + "\n{\n");
+
+    if (start == std::string::npos)
+        return {};
+
+    start = heart.find ("{\n", start) + 2;
+    return heart.substr (start, heart.find ("\n}", start) - start);
+}
+
+//==============================================================================
+inline std::string runOptimiserTest (const TestCase& test, Program& program)
+{
+    SSAOptimisations::optimise (program, test.optimisationLevel);
+
+    auto output = getNamespaceContent (program.toHEART(), "test");
+
+    if (normaliseWhitespace (output) == normaliseWhitespace (test.expected))
+        return {};
+
+    return "expected:\n" + test.expected + "\nbut got:\n" + output;
+}
+
+inline std::string runBinaryFormatTest (const Program& program)
+{
+    auto data = program.toBinary();
+    auto heart = program.toHEART();
+
+    {
+        CompileMessageList messages;
+        auto reloaded = Program::createFromBinary (messages, data.data(), data.size());
+
+        if (reloaded.isEmpty())
+            return "failed to reload the binary data: " + messages.toString();
+
+        if (reloaded.toHEART() != heart)
+            return "expected the reloaded program to be:\n" + heart + "\nbut got:\n" + reloaded.toHEART();
+    }
+
+    // The format has no optional trailing data, so every prefix of it must be rejected
+    for (size_t size = 0; size < data.size(); ++size)
+    {
+        std::vector<uint8_t> truncated (data.begin(), data.begin() + static_cast<std::ptrdiff_t> (size));
+        CompileMessageList messages;
+
+        if (! Program::createFromBinary (messages, truncated.data(), truncated.size()).isEmpty())
+            return "a copy truncated to " + std::to_string (size) + " bytes was loaded";
+    }
+
+    // A corrupted byte may happen to still give a valid program, but mustn't crash the reader
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        for (uint8_t replacement : { static_cast<uint8_t> (0), static_cast<uint8_t> (0xff), static_cast<uint8_t> (data[i] ^ 0x80) })
+        {
+            auto corrupted = data;
+            corrupted[i] = replacement;
+            CompileMessageList messages;
+            Program::createFromBinary (messages, corrupted.data(), corrupted.size());
+        }
+    }
+
+    return {};
+}
+
+/** Runs a test, and returns an empty string if it passed, or a description of what
+    went wrong.
+*/
+inline std::string runTest (const TestCase& test)
+{
+    auto heart = "#SOUL 1\n"
+                 "\n"
+                 "processor Main [[ main: true ]]\n"
+                 "{\n"
+                 "  output out stream float32;\n"
+                 "\n"
+                 "  function run() -> void\n"
+                 "  {\n"
+                 "    @block_0:\n"
+                 "      advance;\n"
+                 "      branch @block_0;\n"
+                 "  }\n"
+                 "}\n"
+                 "\n"
+                 "namespace test\n"
+                 "{\n"
+                 + test.input
+                 + "}\n";
+
+    CompileMessageList messages;
+    auto program = Program::createFromHEART (messages, CodeLocation::createFromString (test.filename, heart));
+
+    if (program.isEmpty())
+        return "failed to parse the input: " + messages.toString();
+
+    if (test.kind == TestCase::Kind::binary)
+        return runBinaryFormatTest (program);
+
+    return runOptimiserTest (test, program);
+}
+
+} // namespace soul::heart_tests
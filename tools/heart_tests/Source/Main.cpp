@@ -0,0 +1,103 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#include <JuceHeader.h>
+#include "HeartTests.h"
+
+//==============================================================================
+/**
+    Runs the HEART-in, HEART-out tests in a set of .hearttest files, and reports any
+    whose output differs from what was expected.
+*/
+static constexpr const char* usage = R"(
+Usage:
+
+ soul_heart_tests [<.hearttest file or folder>...]
+
+With no arguments, the tests are read from tools/heart_tests/tests in the current
+directory. Folders are searched recursively for .hearttest files.
+)";
+
+static juce::Array<juce::File> findTestFiles (const juce::ArgumentList& args)
+{
+    juce::Array<juce::File> files;
+
+    auto addFileOrFolder = [&] (const juce::File& f)
+    {
+        if (f.isDirectory())
+        {
+            auto children = f.findChildFiles (juce::File::findFiles, true, "*.hearttest");
+            children.sort();
+            files.addArray (children);
+        }
+        else if (f.existsAsFile())
+        {
+            files.add (f);
+        }
+        else
+        {
+            juce::ConsoleApplication::fail ("Can't find " + f.getFullPathName());
+        }
+    };
+
+    for (auto& arg : args.arguments)
+        if (! arg.isOption())
+            addFileOrFolder (arg.resolveAsFile());
+
+    if (files.isEmpty())
+        addFileOrFolder (juce::File::getCurrentWorkingDirectory().getChildFile ("tools/heart_tests/tests"));
+
+    return files;
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        if (args.containsOption ("--help|-h"))
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+
+        int numRun = 0, numFailed = 0;
+
+        for (auto& file : findTestFiles (args))
+        {
+            std::vector<soul::heart_tests::TestCase> tests;
+
+            try
+            {
+                tests = soul::heart_tests::parseTestFile (file.getFileName().toStdString(), file.loadFileAsString().toStdString());
+            }
+            catch (const std::runtime_error& e)
+            {
+                juce::ConsoleApplication::fail (e.what());
+            }
+
+            for (auto& test : tests)
+            {
+                auto error = soul::heart_tests::runTest (test);
+                ++numRun;
+
+                if (! error.empty())
+                {
+                    ++numFailed;
+                    std::cerr << test.getDescription() << ": FAILED: " << error << std::endl;
+                }
+            }
+        }
+
+        std::cout << numRun << " tests run, " << numFailed << " failed" << std::endl;
+        return numFailed == 0 ? 0 : 1;
+    });
+}
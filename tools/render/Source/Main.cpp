@@ -0,0 +1,205 @@
+/*
+     _____ _____ _____ __
+    |   __|     |  |  |  |
+    |__   |  |  |  |  |  |__
+    |_____|_____|_____|_____|
+
+    Copyright (c) 2018 - ROLI Ltd.
+*/
+
+#include <JuceHeader.h>
+
+using soul::offline_render::RenderJob;
+using soul::offline_render::RenderResult;
+
+//==============================================================================
+/**
+    A command-line front-end for the soul_offline_render module. It can render a
+    single .soul or .soulpatch file, or read a JSON list of jobs and spread them
+    across all the available cores.
+*/
+static constexpr const char* usage = R"(
+Usage:
+
+ soul_render --output=<audio file> [options] <.soul or .soulpatch file>
+                    Renders a single file
+
+ soul_render --jobs=<JSON file> [--threads=<num threads>] [options]
+                    Renders a list of jobs in parallel
+
+Options:
+ --input=<audio file>       Audio to feed to the program's inputs
+ --midi=<MIDI file>         A standard MIDI file to send to the program's MIDI inputs
+ --automation=<JSON file>   Parameter automation, as { "paramID": [[seconds, value], ...] }
+ --rate=<sample rate>       Defaults to the input file's rate, or 44100
+ --length=<seconds>         Defaults to the length of the inputs plus the tail
+ --tail=<seconds>           Time to keep rendering after the inputs end (default 2)
+ --block-size=<frames>      Frames rendered per block (default 8192)
+ --bit-depth=<bits>         Output bit depth (default 24)
+ --no-latency-compensation  Don't shift the output back by the program's latency
+
+In a job list, each job is an object with the members "source" and "output", and
+optionally "input", "midi", "automation", "rate", "length", "tail", "blockSize",
+"bitDepth" and "compensateLatency". Any options given on the command line are used
+as defaults for every job. Relative paths are resolved against the job file's folder.
+)";
+
+static RenderJob parseJobOptions (const juce::ArgumentList& args)
+{
+    RenderJob job;
+
+    auto getPath = [&] (const char* option) -> std::string
+    {
+        if (args.containsOption (option))
+            return args.getFileForOption (option).getFullPathName().toStdString();
+
+        return {};
+    };
+
+    job.outputFile      = getPath ("--output");
+    job.audioInputFile  = getPath ("--input");
+    job.midiInputFile   = getPath ("--midi");
+    job.automationFile  = getPath ("--automation");
+
+    if (args.containsOption ("--rate"))        job.sampleRate = args.getValueForOption ("--rate").getDoubleValue();
+    if (args.containsOption ("--length"))      job.lengthSeconds = args.getValueForOption ("--length").getDoubleValue();
+    if (args.containsOption ("--tail"))        job.tailSeconds = args.getValueForOption ("--tail").getDoubleValue();
+    if (args.containsOption ("--block-size"))  job.blockSize = (uint32_t) args.getValueForOption ("--block-size").getIntValue();
+    if (args.containsOption ("--bit-depth"))   job.bitDepth = args.getValueForOption ("--bit-depth").getIntValue();
+
+    job.compensateForLatency = ! args.containsOption ("--no-latency-compensation");
+    return job;
+}
+
+static std::vector<RenderJob> loadJobList (const juce::File& jobFile, const RenderJob& defaults)
+{
+    std::vector<RenderJob> jobs;
+    auto folder = jobFile.getParentDirectory();
+
+    try
+    {
+        auto json = choc::json::parse (jobFile.loadFileAsString().toStdString());
+
+        if (! json.isArray())
+            juce::ConsoleApplication::fail ("Expected " + jobFile.getFileName() + " to contain an array of jobs");
+
+        for (uint32_t i = 0; i < json.size(); ++i)
+        {
+            auto item = json.getView()[i];
+
+            if (! item.isObject())
+                juce::ConsoleApplication::fail ("Expected each job in " + jobFile.getFileName() + " to be an object");
+
+            auto getPath = [&] (const char* name, const std::string& defaultPath)
+            {
+                auto path = item[name].getWithDefault<std::string> ({});
+                return path.empty() ? defaultPath : folder.getChildFile (juce::String (path)).getFullPathName().toStdString();
+            };
+
+            auto job = defaults;
+            job.sourceFile            = getPath ("source", defaults.sourceFile);
+            job.outputFile            = getPath ("output", defaults.outputFile);
+            job.audioInputFile        = getPath ("input", defaults.audioInputFile);
+            job.midiInputFile         = getPath ("midi", defaults.midiInputFile);
+            job.automationFile        = getPath ("automation", defaults.automationFile);
+            job.sampleRate            = item["rate"].getWithDefault<double> (defaults.sampleRate);
+            job.lengthSeconds         = item["length"].getWithDefault<double> (defaults.lengthSeconds);
+            job.tailSeconds           = item["tail"].getWithDefault<double> (defaults.tailSeconds);
+            job.blockSize             = item["blockSize"].getWithDefault<uint32_t> (defaults.blockSize);
+            job.bitDepth              = item["bitDepth"].getWithDefault<int> (defaults.bitDepth);
+            job.compensateForLatency  = item["compensateLatency"].getWithDefault<bool> (defaults.compensateForLatency);
+
+            if (job.sourceFile.empty() || job.outputFile.empty())
+                juce::ConsoleApplication::fail ("Job " + juce::String (i + 1) + " in " + jobFile.getFileName()
+                                                  + " needs a source and an output file");
+
+            jobs.push_back (std::move (job));
+        }
+    }
+    catch (const choc::json::ParseError& e)
+    {
+        juce::ConsoleApplication::fail (jobFile.getFileName() + ":" + juce::String ((int) e.line) + ":"
+                                          + juce::String ((int) e.column) + ": " + e.message);
+    }
+
+    return jobs;
+}
+
+static juce::String describeResult (const RenderJob& job, const RenderResult& result)
+{
+    auto name = juce::File (job.outputFile).getFileName();
+
+    if (! result.succeeded)
+        return name + ": FAILED: " + juce::String (result.errorMessage);
+
+    auto durationRendered = (double) result.framesWritten / result.sampleRate;
+
+    return name + ": " + juce::String (result.framesWritten) + " frames in "
+             + juce::String (result.secondsTaken, 2) + "s ("
+             + juce::String (durationRendered / std::max (result.secondsTaken, 0.001), 1) + "x realtime)";
+}
+
+//==============================================================================
+int main (int argc, char** argv)
+{
+    juce::ArgumentList args (argc, argv);
+
+    return juce::ConsoleApplication::invokeCatchingFailures ([&]
+    {
+        if (args.size() == 0 || args.containsOption ("--help|-h"))
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+
+        auto defaults = parseJobOptions (args);
+        std::vector<RenderJob> jobs;
+
+        if (args.containsOption ("--jobs"))
+        {
+            jobs = loadJobList (args.getExistingFileForOption ("--jobs"), defaults);
+        }
+        else
+        {
+            for (auto& arg : args.arguments)
+                if (! arg.isOption())
+                    defaults.sourceFile = arg.resolveAsExistingFile().getFullPathName().toStdString();
+
+            if (defaults.sourceFile.empty())
+                juce::ConsoleApplication::fail ("Expected a .soul or .soulpatch file to render");
+
+            if (defaults.outputFile.empty())
+                juce::ConsoleApplication::fail ("Expected an --output file");
+
+            jobs.push_back (defaults);
+        }
+
+        std::mutex printLock;
+        size_t numFinished = 0, numFailed = 0;
+
+        for (auto& job : jobs)
+        {
+            job.handleConsoleMessage = [&printLock, name = juce::File (job.outputFile).getFileName()] (std::string_view message)
+            {
+                std::lock_guard<std::mutex> lock (printLock);
+                std::cout << name << ": " << message << std::endl;
+            };
+        }
+
+        soul::offline_render::render (jobs,
+                                      [] { return std::make_unique<soul::InterpreterPerformerFactory>(); },
+                                      (uint32_t) std::max (0, args.getValueForOption ("--threads").getIntValue()),
+                                      [&] (size_t jobIndex, const RenderResult& result)
+                                      {
+                                          std::lock_guard<std::mutex> lock (printLock);
+
+                                          if (! result.succeeded)
+                                              ++numFailed;
+
+                                          std::cout << "[" << ++numFinished << "/" << jobs.size() << "] "
+                                                    << describeResult (jobs[jobIndex], result) << std::endl;
+                                      });
+
+        return numFailed == 0 ? 0 : 1;
+    });
+}